@@ -0,0 +1,59 @@
+#ifndef _MS_SCHED_H
+#define _MS_SCHED_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/msgb.h>
+
+/* Ready list of MS instances with pending messages.  Enqueueing a
+ * message marks its queue pending and puts the MS on the ready list,
+ * the main loop only services the MS found there. */
+
+struct osmocom_ms;
+
+/* message queues of an MS, in the order they are serviced */
+enum ms_queue {
+	MS_Q_RSL,	/* RSL-SAP, from LAPDm */
+	MS_Q_RR,	/* RR-SAP, RR to MM */
+	MS_Q_MMXX,	/* MMxx-SAP, MM to CC/SS/SMS */
+	MS_Q_MMR,	/* MMR-SAP, to MM */
+	MS_Q_MMEVENT,	/* MM events */
+	MS_Q_PLMN,	/* PLMN selection events */
+	MS_Q_CS,	/* cell selection events */
+	MS_Q_SIM,	/* SIM jobs */
+	MS_Q_MNCC,	/* MNCC to layer 4 */
+	_NUM_MS_Q
+};
+
+struct ms_queue_stats {
+	unsigned long enqueued;		/* messages enqueued */
+	unsigned int depth;		/* messages currently queued */
+	unsigned int max_depth;		/* highest depth seen */
+	unsigned long services;		/* times the queue was serviced */
+	unsigned long wait_us;		/* total wait from pending to service */
+	unsigned long max_wait_us;	/* longest wait */
+};
+
+struct ms_sched {
+	struct llist_head ready;	/* entry in the ready list */
+	uint16_t pending;		/* queues to service, 1 << ms_queue */
+	struct timespec since[_NUM_MS_Q]; /* pending since */
+	struct ms_queue_stats stats[_NUM_MS_Q];
+};
+
+extern const char *ms_queue_names[_NUM_MS_Q];
+
+void ms_sched_init(struct osmocom_ms *ms);
+void ms_enqueue(struct osmocom_ms *ms, enum ms_queue q,
+		struct llist_head *queue, struct msgb *msg);
+struct msgb *ms_dequeue(struct osmocom_ms *ms, enum ms_queue q,
+			struct llist_head *queue);
+void ms_sched_pending(struct osmocom_ms *ms, enum ms_queue q);
+int ms_sched_service(struct osmocom_ms *ms, enum ms_queue q);
+void ms_sched_wake(struct osmocom_ms *ms);
+void ms_sched_remove(struct osmocom_ms *ms);
+struct osmocom_ms *ms_sched_next(void);
+
+#endif /* _MS_SCHED_H */
@@ -4,6 +4,7 @@
 #include <osmocom/core/select.h>
 #include <osmocom/gsm/gsm_utils.h>
 #include <osmocom/core/write_queue.h>
+#include <osmocom/core/frame_reader.h>
 
 struct osmocom_ms;
 
@@ -21,6 +22,7 @@ struct osmocom_ms;
 #include <osmocom/bb/mobile/mncc_sock.h>
 #include <osmocom/bb/common/sim.h>
 #include <osmocom/bb/common/l1ctl.h>
+#include <osmocom/bb/common/ms_sched.h>
 
 struct osmosap_entity {
 	osmosap_cb_t msg_handler;
@@ -58,7 +60,10 @@ struct rx_meas_stat {
 struct osmocom_ms {
 	struct llist_head entity;
 	char *name;
+	void *pool;	/* talloc pool holding the MS, or NULL */
 	struct osmo_wqueue l2_wq, sap_wq;
+	struct osmo_frame_reader l2_rx;
+	struct ms_sched sched;
 	uint16_t test_arfcn;
 	struct osmol1_entity l1_entity;
 
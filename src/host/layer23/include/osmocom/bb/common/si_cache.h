@@ -0,0 +1,47 @@
+#ifndef _SI_CACHE_H
+#define _SI_CACHE_H
+
+#include <stdint.h>
+
+#include <osmocom/bb/common/sysinfo.h>
+
+/* Process wide cache of the frequency lists of system information.  All
+ * MS instances that see the same cells receive the same lists, so each
+ * list is decoded once and the set of ARFCNs is shared by reference.
+ * Shared sets are never written, a changed list is looked up again. */
+
+/* frequency lists, in the order of the statistics */
+enum si_cache_type {
+	SI_CACHE_SI1,		/* Cell Channel Description, SI 1 */
+	SI_CACHE_SI2,		/* Neighbour Cell Description, SI 2 */
+	SI_CACHE_SI2BIS,	/* Neighbour Cell Description, SI 2bis */
+	SI_CACHE_SI2TER,	/* Neighbour Cell Description 2, SI 2ter */
+	SI_CACHE_SI5,		/* Neighbour Cell Description, SI 5 */
+	SI_CACHE_SI5BIS,	/* Neighbour Cell Description, SI 5bis */
+	SI_CACHE_SI5TER,	/* Neighbour Cell Description 2, SI 5ter */
+	_NUM_SI_CACHE
+};
+
+/* all lists above have 16 octets */
+#define SI_CACHE_LIST_LEN	16
+
+struct si_cache_stats {
+	unsigned long lookups;		/* lists looked up */
+	unsigned long hits;		/* lists found decoded */
+	unsigned int entries;		/* lists currently cached */
+	unsigned int max_entries;	/* highest number cached */
+};
+
+extern const char *si_cache_names[_NUM_SI_CACHE];
+extern struct si_cache_stats si_cache_stats[_NUM_SI_CACHE];
+
+const struct gsm_freq_map *si_cache_get(enum si_cache_type type,
+	const uint8_t *list);
+const struct gsm_freq_map *si_cache_ref(const struct gsm_freq_map *map);
+void si_cache_put(const struct gsm_freq_map *map);
+void si_cache_replace(const struct gsm_freq_map **map,
+	enum si_cache_type type, const uint8_t *list);
+int si_cache_refs(const struct gsm_freq_map *map);
+void si_cache_dump(void (*print)(void *, const char *, ...), void *priv);
+
+#endif /* _SI_CACHE_H */
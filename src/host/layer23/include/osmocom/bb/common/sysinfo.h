@@ -1,21 +1,88 @@
 #ifndef _SYSINFO_H
 #define _SYSINFO_H
 
+#include <stdint.h>
+#include <string.h>
+
 #include <osmocom/gsm/gsm48_ie.h>
 
 /* collection of system information of the current cell */
 
-/* frequency mask flags of frequency type */
-#define	FREQ_TYPE_SERV		0x01 /* frequency of the serving cell */
-#define	FREQ_TYPE_HOPP		0x02 /* frequency used for channel hopping */
-#define	FREQ_TYPE_NCELL		0x1c /* frequency of the neighbor cell */
-#define	FREQ_TYPE_NCELL_2	0x04 /* sub channel of SI 2 */
-#define	FREQ_TYPE_NCELL_2bis	0x08 /* sub channel of SI 2bis */
-#define	FREQ_TYPE_NCELL_2ter	0x10 /* sub channel of SI 2ter */
-#define	FREQ_TYPE_REP		0xe0 /* frequency to be reported */
-#define	FREQ_TYPE_REP_5		0x20 /* sub channel of SI 5 */
-#define	FREQ_TYPE_REP_5bis	0x40 /* sub channel of SI 5bis */
-#define	FREQ_TYPE_REP_5ter	0x80 /* sub channel of SI 5ter */
+/* set of ARFCNs 0..1023, one bit each */
+struct gsm_freq_map {
+	uint64_t			w[16];
+};
+
+static inline void freq_map_zero(struct gsm_freq_map *m)
+{
+	memset(m, 0, sizeof(*m));
+}
+
+static inline void freq_map_set(struct gsm_freq_map *m, uint16_t arfcn)
+{
+	m->w[(arfcn & 1023) >> 6] |= 1ULL << (arfcn & 63);
+}
+
+static inline int freq_map_test(const struct gsm_freq_map *m, uint16_t arfcn)
+{
+	return (m->w[(arfcn & 1023) >> 6] >> (arfcn & 63)) & 1;
+}
+
+static inline void freq_map_or(struct gsm_freq_map *m,
+	const struct gsm_freq_map *a)
+{
+	int i;
+
+	for (i = 0; i < 16; i++)
+		m->w[i] |= a->w[i];
+}
+
+/* number of ARFCNs in the set */
+static inline int freq_map_count(const struct gsm_freq_map *m)
+{
+	int i, n = 0;
+
+	for (i = 0; i < 16; i++)
+		n += __builtin_popcountll(m->w[i]);
+
+	return n;
+}
+
+/* first ARFCN in the set from 'from' on, -1 if none */
+static inline int freq_map_next(const struct gsm_freq_map *m, int from)
+{
+	int i = from >> 6;
+	uint64_t w;
+
+	if (from >= 1024)
+		return -1;
+	w = m->w[i] & (~0ULL << (from & 63));
+	while (!w) {
+		if (++i == 16)
+			return -1;
+		w = m->w[i];
+	}
+
+	return (i << 6) + __builtin_ctzll(w);
+}
+
+/* same in the order of frequency lists (1..1023,0), start with 1 */
+static inline int freq_map_next_list(const struct gsm_freq_map *m, int from)
+{
+	int i = freq_map_next(m, from);
+
+	if (i >= 0)
+		return i;
+	return freq_map_test(m, 0) ? 0 : -1;
+}
+
+#define freq_map_for_each(i, m) \
+	for (i = freq_map_next(m, 0); i >= 0; i = freq_map_next(m, i + 1))
+
+/* ARFCN 0 comes last, as in the lists of GSM 04.08 */
+#define freq_map_for_each_list(i, m) \
+	for (i = freq_map_next_list(m, 1); i >= 0; \
+	     i = (i) ? freq_map_next_list(m, i + 1) : -1)
 
 /* structure of all received system informations */
 struct gsm48_sysinfo {
@@ -35,7 +102,13 @@ struct gsm48_sysinfo {
 	uint8_t				si5t_msg[18];
 	uint8_t				si6_msg[18];
 
-	struct	gsm_sysinfo_freq	freq[1024]; /* all frequencies */
+	/* frequencies, the lists are shared through the sysinfo cache, so
+	 * copy with gsm48_sysinfo_copy() and clear with gsm48_sysinfo_reset()
+	 */
+	const struct gsm_freq_map	*freq_serv; /* serving cell, SI 1 */
+	const struct gsm_freq_map	*freq_ncell[3]; /* SI 2, 2bis, 2ter */
+	const struct gsm_freq_map	*freq_rep[3]; /* SI 5, 5bis, 5ter */
+	struct gsm_freq_map		freq_hopp; /* used for CBCH hopping */
 	uint16_t			hopping[64]; /* hopping arfcn */
 	uint8_t				hopp_len;
 
@@ -120,6 +193,23 @@ struct gsm48_sysinfo {
 	uint16_t			nb_class_barr; /* bit 10 is emergency */
 };
 
+extern const struct gsm_freq_map freq_map_empty;
+
+/* ARFCNs of the serving cell */
+static inline const struct gsm_freq_map *
+gsm48_sysinfo_serv(const struct gsm48_sysinfo *s)
+{
+	return s->freq_serv ? s->freq_serv : &freq_map_empty;
+}
+
+struct gsm48_sysinfo *gsm48_sysinfo_alloc(void *ctx);
+void gsm48_sysinfo_reset(struct gsm48_sysinfo *s);
+void gsm48_sysinfo_copy(struct gsm48_sysinfo *dst,
+	const struct gsm48_sysinfo *src);
+void gsm48_sysinfo_ncell(const struct gsm48_sysinfo *s,
+	struct gsm_freq_map *m);
+void gsm48_sysinfo_rep(const struct gsm48_sysinfo *s,
+	struct gsm_freq_map *m);
 char *gsm_print_arfcn(uint16_t arfcn);
 uint8_t gsm_refer_pcs(uint16_t arfcn, struct gsm48_sysinfo *s);
 int gsm48_sysinfo_dump(struct gsm48_sysinfo *s, uint16_t arfcn,
@@ -151,7 +241,9 @@ int gsm48_decode_sysinfo5ter(struct gsm48_sysinfo *s,
 		struct gsm48_system_information_type_5ter *si, int len);
 int gsm48_decode_sysinfo6(struct gsm48_sysinfo *s,
 		struct gsm48_system_information_type_6 *si, int len);
-int gsm48_decode_mobile_alloc(struct gsm_sysinfo_freq *freq,
+int gsm48_decode_freq_map(struct gsm_freq_map *m, uint8_t *cd,
+	uint8_t len, uint8_t mask);
+int gsm48_decode_mobile_alloc(struct gsm48_sysinfo *s,
 	uint8_t *ma, uint8_t len, uint16_t *hopping, uint8_t *hopp_len,
 	int si4);
 int gsm48_encode_lai_hex(struct gsm48_loc_area_id *lai, uint16_t mcc,
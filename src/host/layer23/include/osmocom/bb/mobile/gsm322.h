@@ -1,6 +1,8 @@
 #ifndef _GSM322_H
 #define _GSM322_H
 
+#include <time.h>
+
 /* 4.3.1.1 List of states for PLMN slection process (automatic mode) */
 #define GSM322_A0_NULL			0
 #define	GSM322_A1_TRYING_RPLMN		1
@@ -100,11 +102,20 @@ struct gsm322_ba_list {
 #define GSM322_CS_FLAG_FORBIDD	0x40 /* cell in list of forbidden LAs */
 #define GSM322_CS_FLAG_TEMP_AA	0x80 /* if temporary available and allowable */
 
+/* cells of one PLMN in the cell selection list */
+struct gsm322_plmn_index {
+	struct llist_head	entry;
+	uint16_t		mcc, mnc;
+	int16_t			first; /* first cell, -1 if none */
+};
+
 /* Cell selection list */
 struct gsm322_cs_list {
 	uint8_t			flags; /* see GSM322_CS_FLAG_* */
 	uint8_t			rxlev; /* rx level range format */
 	struct gsm48_sysinfo	*sysinfo;
+	struct gsm322_plmn_index *plmn_idx; /* PLMN the cell is filed under */
+	int16_t			plmn_next; /* next cell of that PLMN, or -1 */
 };
 
 /* PLMN search process */
@@ -154,6 +165,29 @@ struct gsm322_neighbour {
 #define GSM322_NB_NO_BCCH	4	/* sync */
 #define GSM322_NB_SYSINFO	5	/* sysinfo */
 
+/* block of frequencies for one power measurement request */
+struct gsm322_pm_range {
+	uint16_t		from, to; /* list index of first and last */
+	uint8_t			rxlev; /* best rxlev of last scan */
+};
+
+struct gsm322_pm_ranges {
+	struct gsm322_pm_range	*range;
+	int			num, size;
+};
+
+/* power scan and time from scanning without a cell until camping */
+struct gsm322_scan_stats {
+	unsigned long		scans; /* power scans completed */
+	unsigned long		ranges; /* power measurement requests */
+	unsigned long		last_scan_ms; /* duration of last scan */
+	unsigned long		camps; /* camped after scanning */
+	unsigned long		last_camp_ms;
+	unsigned long		min_camp_ms;
+	unsigned long		max_camp_ms;
+	unsigned long		sum_camp_ms;
+};
+
 struct gsm48_sysinfo;
 /* Cell selection process */
 struct gsm322_cellsel {
@@ -164,10 +198,19 @@ struct gsm322_cellsel {
 	struct llist_head	ba_list; /* BCCH Allocation per PLMN */
 	struct gsm322_cs_list	list[1024+299];
 					/* cell selection list per frequency. */
+	struct llist_head	plmn_index; /* cells of list per PLMN */
+	int			plmn_index_num; /* PLMNs in plmn_index */
 	/* scan and tune state */
 	struct osmo_timer_list	timer; /* cell selection timer */
 	uint16_t		mcc, mnc; /* current network to search for */
 	uint8_t			powerscan; /* currently scanning for power */
+	struct gsm322_pm_ranges	pm_bands; /* supported blocks of all bands */
+	struct gsm322_pm_ranges	pm_plan; /* blocks of the current scan */
+	int			pm_next; /* next block of plan to request */
+	int			pm_inflight; /* blocks requested, not done */
+	struct timespec		pm_start; /* start of current scan */
+	struct timespec		camp_start; /* start of scanning without cell */
+	struct gsm322_scan_stats scan_stats;
 	uint8_t			ccch_state; /* special state of current ccch */
 	uint32_t		scan_state; /* special state of current scan */
 	uint16_t		arfcn; /* current tuned idle mode arfcn */
@@ -23,7 +23,7 @@ struct gsm_sms {
 
 int gsm411_sms_init(struct osmocom_ms *ms);
 int gsm411_sms_exit(struct osmocom_ms *ms);
-struct gsm_sms *sms_alloc(void);
+struct gsm_sms *sms_alloc(void *ctx);
 void sms_free(struct gsm_sms *sms);
 struct gsm_sms *sms_from_text(const char *receiver, int dcs, const char *text);
 int gsm411_rcv_sms(struct osmocom_ms *ms, struct msgb *msg);
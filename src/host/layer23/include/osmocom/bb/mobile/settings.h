@@ -82,6 +82,7 @@ struct gsm_settings {
 
 	/* radio */
 	uint16_t		dsc_max;
+	uint8_t			pm_ranges;
 	uint8_t			force_rekey;
 
 	/* dialing */
@@ -83,6 +83,7 @@ struct gsm_support {
 	uint8_t scan_to;
 	uint8_t sync_to;
 	uint16_t dsc_max; /* maximum dl signal failure counter */
+	uint8_t pm_ranges; /* power scan ranges layer 1 takes at once */
 
 	/* codecs */
 	uint8_t full_v1;
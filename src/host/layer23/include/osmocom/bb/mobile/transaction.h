@@ -19,6 +19,9 @@ struct gsm_trans {
 	/* To whom we belong */
 	struct osmocom_ms *ms;
 
+	/* talloc pool holding this transaction and its allocations */
+	void *pool;
+
 	/* reference from MNCC or other application */
 	uint32_t callref;
 
@@ -42,62 +42,39 @@
 #define GSM_L2_LENGTH 256
 #define GSM_L2_HEADROOM 32
 
+static int layer2_frame(struct osmo_frame_reader *fr, struct msgb *msg)
+{
+	l1ctl_recv((struct osmocom_ms *) fr->data, msg);
+
+	return 0;
+}
+
 static int layer2_read(struct osmo_fd *fd)
 {
-	struct msgb *msg;
-	uint16_t len;
+	struct osmocom_ms *ms = fd->data;
 	int rc;
 
-	msg = msgb_alloc_headroom(GSM_L2_LENGTH+GSM_L2_HEADROOM, GSM_L2_HEADROOM, "Layer2");
-	if (!msg) {
-		LOGP(DL1C, LOGL_ERROR, "Failed to allocate msg.\n");
-		return -ENOMEM;
-	}
-
-	rc = read(fd->fd, &len, sizeof(len));
-	if (rc < sizeof(len)) {
+	/* all complete messages, a partial one waits for the rest */
+	rc = osmo_frame_reader_read(&ms->l2_rx, fd->fd);
+	if (rc < 0) {
+		if (rc == -EBADMSG)
+			LOGP(DL1C, LOGL_ERROR, "Invalid message length\n");
 		fprintf(stderr, "Layer2 socket failed\n");
-		msgb_free(msg);
-		if (rc >= 0)
-			rc = -EIO;
-		layer2_close((struct osmocom_ms *) fd->data);
+		layer2_close(ms);
 		return rc;
 	}
 
-	len = ntohs(len);
-	if (len > GSM_L2_LENGTH) {
-		LOGP(DL1C, LOGL_ERROR, "Length is too big: %u\n", len);
-		msgb_free(msg);
-		return -EINVAL;
-	}
-
-
-	msg->l1h = msgb_put(msg, len);
-	rc = read(fd->fd, msg->l1h, msgb_l1len(msg));
-	if (rc != msgb_l1len(msg)) {
-		LOGP(DL1C, LOGL_ERROR, "Can not read data: len=%d rc=%d "
-		     "errno=%d\n", len, rc, errno);
-		msgb_free(msg);
-		return rc;
-	}
-
-	l1ctl_recv((struct osmocom_ms *) fd->data, msg);
-
 	return 0;
 }
 
-static int layer2_write(struct osmo_fd *fd, struct msgb *msg)
+static int layer2_write_error(struct osmo_fd *fd, int err)
 {
-	int rc;
-
-	if (fd->fd <= 0)
-		return -EINVAL;
+	struct osmocom_ms *ms = fd->data;
 
-	rc = write(fd->fd, msg->data, msg->len);
-	if (rc != msg->len) {
-		LOGP(DL1C, LOGL_ERROR, "Failed to write data: rc: %d\n", rc);
-		return rc;
-	}
+	/* the L1CTL stream can't be resumed after a broken write */
+	LOGP(DL1C, LOGL_ERROR, "Failed to write data: %s\n", strerror(err));
+	fprintf(stderr, "Layer2 socket failed\n");
+	layer2_close(ms);
 
 	return 0;
 }
@@ -130,7 +107,13 @@ int layer2_open(struct osmocom_ms *ms, const char *socket_path)
 	ms->l2_wq.bfd.data = ms;
 	ms->l2_wq.bfd.when = BSC_FD_READ;
 	ms->l2_wq.read_cb = layer2_read;
-	ms->l2_wq.write_cb = layer2_write;
+	ms->l2_wq.error_cb = layer2_write_error;
+	ms->l2_wq.flags = OSMO_WQUEUE_F_WRITEV;
+
+	osmo_frame_reader_init(&ms->l2_rx, GSM_L2_LENGTH, GSM_L2_HEADROOM,
+			       "Layer2");
+	ms->l2_rx.frame_cb = layer2_frame;
+	ms->l2_rx.data = ms;
 
 	rc = osmo_fd_register(&ms->l2_wq.bfd);
 	if (rc != 0) {
@@ -151,6 +134,7 @@ int layer2_close(struct osmocom_ms *ms)
 	ms->l2_wq.bfd.fd = -1;
 	osmo_fd_unregister(&ms->l2_wq.bfd);
 	osmo_wqueue_clear(&ms->l2_wq);
+	osmo_frame_reader_reset(&ms->l2_rx);
 
 	return 0;
 }
@@ -248,6 +248,7 @@ int main(int argc, char **argv)
 
 	ms->name = talloc_strdup(ms, "1");
 	ms->test_arfcn = 871;
+	ms_sched_init(ms);
 
 	handle_options(argc, argv);
 
@@ -0,0 +1,136 @@
+/* ready list of MS instances with pending messages */
+
+/* (C) 2026 by the osmocom-bb contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/msgb.h>
+
+#include <osmocom/bb/common/osmocom_data.h>
+#include <osmocom/bb/common/ms_sched.h>
+
+static LLIST_HEAD(ms_ready_list);
+
+const char *ms_queue_names[_NUM_MS_Q] = {
+	[MS_Q_RSL]	= "RSL",
+	[MS_Q_RR]	= "RR",
+	[MS_Q_MMXX]	= "MMxx",
+	[MS_Q_MMR]	= "MMR",
+	[MS_Q_MMEVENT]	= "MM event",
+	[MS_Q_PLMN]	= "PLMN",
+	[MS_Q_CS]	= "cell selection",
+	[MS_Q_SIM]	= "SIM",
+	[MS_Q_MNCC]	= "MNCC",
+};
+
+void ms_sched_init(struct osmocom_ms *ms)
+{
+	memset(&ms->sched, 0, sizeof(ms->sched));
+	INIT_LLIST_HEAD(&ms->sched.ready);
+}
+
+/* put MS on the ready list, without a pending queue it is only looked at */
+void ms_sched_wake(struct osmocom_ms *ms)
+{
+	if (llist_empty(&ms->sched.ready))
+		llist_add_tail(&ms->sched.ready, &ms_ready_list);
+}
+
+void ms_sched_remove(struct osmocom_ms *ms)
+{
+	llist_del_init(&ms->sched.ready);
+}
+
+/* take the next MS off the ready list */
+struct osmocom_ms *ms_sched_next(void)
+{
+	struct osmocom_ms *ms;
+
+	if (llist_empty(&ms_ready_list))
+		return NULL;
+
+	ms = llist_entry(ms_ready_list.next, struct osmocom_ms, sched.ready);
+	llist_del_init(&ms->sched.ready);
+
+	return ms;
+}
+
+/* mark a queue to be serviced, also if its messages were left over */
+void ms_sched_pending(struct osmocom_ms *ms, enum ms_queue q)
+{
+	struct ms_sched *sched = &ms->sched;
+
+	if (!(sched->pending & (1 << q))) {
+		sched->pending |= 1 << q;
+		clock_gettime(CLOCK_MONOTONIC, &sched->since[q]);
+	}
+	ms_sched_wake(ms);
+}
+
+/* clear pending state before servicing a queue, returns if it was set */
+int ms_sched_service(struct osmocom_ms *ms, enum ms_queue q)
+{
+	struct ms_sched *sched = &ms->sched;
+	struct ms_queue_stats *stats = &sched->stats[q];
+	struct timespec now;
+	unsigned long wait;
+
+	if (!(sched->pending & (1 << q)))
+		return 0;
+	sched->pending &= ~(1 << q);
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	wait = (now.tv_sec - sched->since[q].tv_sec) * 1000000 +
+	       (now.tv_nsec - sched->since[q].tv_nsec) / 1000;
+	stats->services++;
+	stats->wait_us += wait;
+	if (wait > stats->max_wait_us)
+		stats->max_wait_us = wait;
+
+	return 1;
+}
+
+void ms_enqueue(struct osmocom_ms *ms, enum ms_queue q,
+		struct llist_head *queue, struct msgb *msg)
+{
+	struct ms_queue_stats *stats = &ms->sched.stats[q];
+
+	msgb_enqueue(queue, msg);
+	stats->enqueued++;
+	if (++stats->depth > stats->max_depth)
+		stats->max_depth = stats->depth;
+
+	ms_sched_pending(ms, q);
+}
+
+struct msgb *ms_dequeue(struct osmocom_ms *ms, enum ms_queue q,
+			struct llist_head *queue)
+{
+	struct msgb *msg = msgb_dequeue(queue);
+
+	if (msg)
+		ms->sched.stats[q].depth--;
+
+	return msg;
+}
@@ -0,0 +1,214 @@
+/* process wide cache of decoded frequency lists of system information */
+
+/* (C) 2026 by the osmocom-bb contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/talloc.h>
+
+#include <osmocom/bb/common/sysinfo.h>
+#include <osmocom/bb/common/si_cache.h>
+
+#define SI_CACHE_BUCKETS	256	/* power of two */
+
+/* The key is the type and the octets of the list.  The decoded set only
+ * depends on them, so the same list sent by different cells is shared
+ * as well. */
+struct si_cache_entry {
+	struct llist_head	list;	/* entry in hash bucket */
+	uint32_t		hash;
+	int			refs;
+	uint8_t			type;
+	uint8_t			raw[SI_CACHE_LIST_LEN];
+	struct gsm_freq_map	map;
+};
+
+const char *si_cache_names[_NUM_SI_CACHE] = {
+	[SI_CACHE_SI1]		= "SI 1",
+	[SI_CACHE_SI2]		= "SI 2",
+	[SI_CACHE_SI2BIS]	= "SI 2bis",
+	[SI_CACHE_SI2TER]	= "SI 2ter",
+	[SI_CACHE_SI5]		= "SI 5",
+	[SI_CACHE_SI5BIS]	= "SI 5bis",
+	[SI_CACHE_SI5TER]	= "SI 5ter",
+};
+
+/* format mask for gsm48_decode_freq_list(), 2ter/5ter have no bit map 0 */
+static const uint8_t si_cache_mask[_NUM_SI_CACHE] = {
+	[SI_CACHE_SI1]		= 0xce,
+	[SI_CACHE_SI2]		= 0xce,
+	[SI_CACHE_SI2BIS]	= 0xce,
+	[SI_CACHE_SI2TER]	= 0x8e,
+	[SI_CACHE_SI5]		= 0xce,
+	[SI_CACHE_SI5BIS]	= 0xce,
+	[SI_CACHE_SI5TER]	= 0x8e,
+};
+
+struct si_cache_stats si_cache_stats[_NUM_SI_CACHE];
+
+static struct llist_head si_cache_hash[SI_CACHE_BUCKETS];
+static void *si_cache_ctx;
+
+/* FNV-1a over type and list */
+static uint32_t si_cache_hash_list(uint8_t type, const uint8_t *list)
+{
+	uint32_t h = 2166136261u;
+	int i;
+
+	h = (h ^ type) * 16777619u;
+	for (i = 0; i < SI_CACHE_LIST_LEN; i++)
+		h = (h ^ list[i]) * 16777619u;
+
+	return h;
+}
+
+static inline struct si_cache_entry *map2entry(const struct gsm_freq_map *map)
+{
+	return (struct si_cache_entry *)
+		((char *) map - offsetof(struct si_cache_entry, map));
+}
+
+static void si_cache_init(void)
+{
+	int i;
+
+	si_cache_ctx = talloc_named_const(NULL, 0, "si_cache");
+	for (i = 0; i < SI_CACHE_BUCKETS; i++)
+		INIT_LLIST_HEAD(&si_cache_hash[i]);
+}
+
+/* get the decoded set of a list, decode it if nobody has it yet
+ * the caller holds a reference to the result, see si_cache_put() */
+const struct gsm_freq_map *si_cache_get(enum si_cache_type type,
+	const uint8_t *list)
+{
+	struct si_cache_stats *stats = &si_cache_stats[type];
+	struct llist_head *bucket;
+	struct si_cache_entry *e;
+	uint32_t hash;
+
+	if (!si_cache_ctx)
+		si_cache_init();
+
+	stats->lookups++;
+	hash = si_cache_hash_list(type, list);
+	bucket = &si_cache_hash[hash & (SI_CACHE_BUCKETS - 1)];
+	llist_for_each_entry(e, bucket, list) {
+		if (e->hash == hash && e->type == type
+		 && !memcmp(e->raw, list, SI_CACHE_LIST_LEN)) {
+			stats->hits++;
+			e->refs++;
+			return &e->map;
+		}
+	}
+
+	e = talloc_zero(si_cache_ctx, struct si_cache_entry);
+	if (!e)
+		return NULL;
+	e->hash = hash;
+	e->refs = 1;
+	e->type = type;
+	memcpy(e->raw, list, SI_CACHE_LIST_LEN);
+	gsm48_decode_freq_map(&e->map, e->raw, SI_CACHE_LIST_LEN,
+		si_cache_mask[type]);
+	llist_add(&e->list, bucket);
+
+	if (++stats->entries > stats->max_entries)
+		stats->max_entries = stats->entries;
+
+	return &e->map;
+}
+
+/* take another reference, NULL is no set */
+const struct gsm_freq_map *si_cache_ref(const struct gsm_freq_map *map)
+{
+	if (map)
+		map2entry(map)->refs++;
+
+	return map;
+}
+
+/* drop a reference, the set is freed with the last one */
+void si_cache_put(const struct gsm_freq_map *map)
+{
+	struct si_cache_entry *e;
+
+	if (!map)
+		return;
+
+	e = map2entry(map);
+	if (--e->refs > 0)
+		return;
+
+	si_cache_stats[e->type].entries--;
+	llist_del(&e->list);
+	talloc_free(e);
+}
+
+/* replace the set at *map by the one of a new list, an unchanged list
+ * keeps its set */
+void si_cache_replace(const struct gsm_freq_map **map,
+	enum si_cache_type type, const uint8_t *list)
+{
+	const struct gsm_freq_map *old = *map;
+
+	*map = si_cache_get(type, list);
+	si_cache_put(old);
+}
+
+/* number of references, for diagnostics */
+int si_cache_refs(const struct gsm_freq_map *map)
+{
+	return map ? map2entry(map)->refs : 0;
+}
+
+void si_cache_dump(void (*print)(void *, const char *, ...), void *priv)
+{
+	struct si_cache_stats *stats;
+	unsigned long refs = 0;
+	unsigned int entries = 0;
+	struct si_cache_entry *e;
+	int i;
+
+	print(priv, "System information cache:\n");
+	print(priv, " list     lookups     hits  rate  entries  max\n");
+	for (i = 0; i < _NUM_SI_CACHE; i++) {
+		stats = &si_cache_stats[i];
+		print(priv, " %-7s %8lu %8lu  %3lu%%  %7u  %3u\n",
+			si_cache_names[i], stats->lookups, stats->hits,
+			stats->lookups ? stats->hits * 100 / stats->lookups : 0,
+			stats->entries, stats->max_entries);
+	}
+
+	if (si_cache_ctx) {
+		for (i = 0; i < SI_CACHE_BUCKETS; i++) {
+			llist_for_each_entry(e, &si_cache_hash[i], list) {
+				entries++;
+				refs += e->refs;
+			}
+		}
+	}
+	print(priv, " %u sets of %u bytes shared by %lu references\n",
+		entries, (unsigned int) sizeof(struct si_cache_entry), refs);
+}
@@ -150,6 +150,10 @@ void gsm_sim_reply(struct osmocom_ms *ms, uint8_t result_type, uint8_t *result,
 	LOGP(DSIM, LOGL_INFO, "sending result to callback function "
 		"(type=%d)\n", result_type);
 
+	/* the next job can be started */
+	if (!llist_empty(&sim->jobs))
+		ms_sched_pending(ms, MS_Q_SIM);
+
 	/* if no handler, or no callback, just free the job */
 	sh = (struct sim_hdr *)msg->data;
 	handler = sim_get_handler(sim, sh->handle);
@@ -212,7 +216,7 @@ int gsm_sim_job_dequeue(struct osmocom_ms *ms)
 		return 0;
 
 	/* get next job */
-	while ((msg = msgb_dequeue(&sim->jobs))) {
+	while ((msg = ms_dequeue(ms, MS_Q_SIM, &sim->jobs))) {
 		/* resolve handler */
 		sh = (struct sim_hdr *) msg->data;
 		LOGP(DSIM, LOGL_INFO, "got new job: %s (handle=%08x)\n",
@@ -1211,7 +1215,7 @@ void sim_job(struct osmocom_ms *ms, struct msgb *msg)
 {
 	struct gsm_sim *sim = &ms->sim;
 
-	msgb_enqueue(&sim->jobs, msg);
+	ms_enqueue(ms, MS_Q_SIM, &sim->jobs, msg);
 }
 
 /*
@@ -1252,7 +1256,7 @@ int gsm_sim_exit(struct osmocom_ms *ms)
 	llist_for_each_entry_safe(handler, handler2, &sim->handlers, entry)
 		sim_close(ms, handler->handle);
 	/* flush jobs */
-	while ((msg = msgb_dequeue(&sim->jobs)))
+	while ((msg = ms_dequeue(ms, MS_Q_SIM, &sim->jobs)))
 		msgb_free(msg);
 
 	return 0;
@@ -25,14 +25,102 @@
 #include <arpa/inet.h>
 
 #include <osmocom/core/bitvec.h>
+#include <osmocom/core/talloc.h>
 
 #include <osmocom/bb/common/osmocom_data.h>
 #include <osmocom/bb/common/networks.h>
 #include <osmocom/bb/common/logging.h>
 #include <osmocom/bb/common/sysinfo.h>
+#include <osmocom/bb/common/si_cache.h>
 
 #define MIN(a, b) ((a < b) ? a : b)
 
+const struct gsm_freq_map freq_map_empty;
+
+/*
+ * storage
+ */
+
+static void sysinfo_put_lists(struct gsm48_sysinfo *s)
+{
+	int i;
+
+	si_cache_put(s->freq_serv);
+	for (i = 0; i < 3; i++) {
+		si_cache_put(s->freq_ncell[i]);
+		si_cache_put(s->freq_rep[i]);
+	}
+}
+
+static int sysinfo_destructor(struct gsm48_sysinfo *s)
+{
+	sysinfo_put_lists(s);
+	return 0;
+}
+
+/* allocate sysinfo, the shared lists are released when it is freed */
+struct gsm48_sysinfo *gsm48_sysinfo_alloc(void *ctx)
+{
+	struct gsm48_sysinfo *s;
+
+	s = talloc_zero(ctx, struct gsm48_sysinfo);
+	if (s)
+		talloc_set_destructor(s, sysinfo_destructor);
+
+	return s;
+}
+
+/* forget all system information */
+void gsm48_sysinfo_reset(struct gsm48_sysinfo *s)
+{
+	sysinfo_put_lists(s);
+	memset(s, 0, sizeof(*s));
+}
+
+/* copy system information, both share the lists afterwards */
+void gsm48_sysinfo_copy(struct gsm48_sysinfo *dst,
+	const struct gsm48_sysinfo *src)
+{
+	int i;
+
+	if (dst == src)
+		return;
+
+	si_cache_ref(src->freq_serv);
+	for (i = 0; i < 3; i++) {
+		si_cache_ref(src->freq_ncell[i]);
+		si_cache_ref(src->freq_rep[i]);
+	}
+	sysinfo_put_lists(dst);
+	memcpy(dst, src, sizeof(*dst));
+}
+
+/* The neighbour and report lists are the union of up to three messages,
+ * each message only replaces its own part.  Add the union to m. */
+void gsm48_sysinfo_ncell(const struct gsm48_sysinfo *s,
+	struct gsm_freq_map *m)
+{
+	uint8_t valid[3] = { s->si2, s->si2bis, s->si2ter };
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		if (valid[i] && s->freq_ncell[i])
+			freq_map_or(m, s->freq_ncell[i]);
+	}
+}
+
+void gsm48_sysinfo_rep(const struct gsm48_sysinfo *s,
+	struct gsm_freq_map *m)
+{
+	uint8_t valid[3] = { s->si5, s->si5bis, s->si5ter };
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		if (valid[i] && s->freq_rep[i])
+			freq_map_or(m, s->freq_rep[i]);
+	}
+}
+
 /*
  * dumping
  */
@@ -70,10 +158,17 @@ uint8_t gsm_refer_pcs(uint16_t arfcn, struct gsm48_sysinfo *s)
 int gsm48_sysinfo_dump(struct gsm48_sysinfo *s, uint16_t arfcn,
 	void (*print)(void *, const char *, ...), void *priv, uint8_t *freq_map)
 {
+	const struct gsm_freq_map *serv = gsm48_sysinfo_serv(s);
+	struct gsm_freq_map ncell, rep;
 	char buffer[81];
 	int i, j, k, index;
 	int refer_pcs = gsm_refer_pcs(arfcn, s);
 
+	freq_map_zero(&ncell);
+	gsm48_sysinfo_ncell(s, &ncell);
+	freq_map_zero(&rep);
+	gsm48_sysinfo_rep(s, &rep);
+
 	/* available sysinfos */
 	print(priv, "ARFCN = %s  channels 512+ refer to %s\n",
 		gsm_print_arfcn(arfcn),
@@ -104,68 +199,62 @@ int gsm48_sysinfo_dump(struct gsm48_sysinfo *s, uint16_t arfcn,
 
 	/* frequency list */
 	j = 0; k = 0;
-	for (i = 0; i < 1024; i++) {
-		if ((s->freq[i].mask & FREQ_TYPE_SERV)) {
-			if (!k) {
-				sprintf(buffer, "serv. cell  : ");
-				j = strlen(buffer);
-			}
-			if (j >= 75) {
-				buffer[j - 1] = '\0';
-				print(priv, "%s\n", buffer);
-				sprintf(buffer, "              ");
-				j = strlen(buffer);
-			}
-			sprintf(buffer + j, "%d,", i);
+	freq_map_for_each(i, serv) {
+		if (!k) {
+			sprintf(buffer, "serv. cell  : ");
 			j = strlen(buffer);
-			k++;
 		}
+		if (j >= 75) {
+			buffer[j - 1] = '\0';
+			print(priv, "%s\n", buffer);
+			sprintf(buffer, "              ");
+			j = strlen(buffer);
+		}
+		sprintf(buffer + j, "%d,", i);
+		j = strlen(buffer);
+		k++;
 	}
 	if (j) {
 		buffer[j - 1] = '\0';
 		print(priv, "%s\n", buffer);
 	}
 	j = 0; k = 0;
-	for (i = 0; i < 1024; i++) {
-		if ((s->freq[i].mask & FREQ_TYPE_NCELL)) {
-			if (!k) {
-				sprintf(buffer, "SI2 (neigh.) BA=%d: ",
-					s->nb_ba_ind_si2);
-				j = strlen(buffer);
-			}
-			if (j >= 70) {
-				buffer[j - 1] = '\0';
-				print(priv, "%s\n", buffer);
-				sprintf(buffer, "                   ");
-				j = strlen(buffer);
-			}
-			sprintf(buffer + j, "%d,", i);
+	freq_map_for_each(i, &ncell) {
+		if (!k) {
+			sprintf(buffer, "SI2 (neigh.) BA=%d: ",
+				s->nb_ba_ind_si2);
 			j = strlen(buffer);
-			k++;
 		}
+		if (j >= 70) {
+			buffer[j - 1] = '\0';
+			print(priv, "%s\n", buffer);
+			sprintf(buffer, "                   ");
+			j = strlen(buffer);
+		}
+		sprintf(buffer + j, "%d,", i);
+		j = strlen(buffer);
+		k++;
 	}
 	if (j) {
 		buffer[j - 1] = '\0';
 		print(priv, "%s\n", buffer);
 	}
 	j = 0; k = 0;
-	for (i = 0; i < 1024; i++) {
-		if ((s->freq[i].mask & FREQ_TYPE_REP)) {
-			if (!k) {
-				sprintf(buffer, "SI5 (report) BA=%d: ",
-					s->nb_ba_ind_si5);
-				j = strlen(buffer);
-			}
-			if (j >= 70) {
-				buffer[j - 1] = '\0';
-				print(priv, "%s\n", buffer);
-				sprintf(buffer, "                   ");
-				j = strlen(buffer);
-			}
-			sprintf(buffer + j, "%d,", i);
+	freq_map_for_each(i, &rep) {
+		if (!k) {
+			sprintf(buffer, "SI5 (report) BA=%d: ",
+				s->nb_ba_ind_si5);
 			j = strlen(buffer);
-			k++;
 		}
+		if (j >= 70) {
+			buffer[j - 1] = '\0';
+			print(priv, "%s\n", buffer);
+			sprintf(buffer, "                   ");
+			j = strlen(buffer);
+		}
+		sprintf(buffer + j, "%d,", i);
+		j = strlen(buffer);
+		k++;
 	}
 	if (j) {
 		buffer[j - 1] = '\0';
@@ -180,14 +269,14 @@ int gsm48_sysinfo_dump(struct gsm48_sysinfo *s, uint16_t arfcn,
 			index = i+j;
 			if (refer_pcs && index >= 512 && index <= 885)
 				index = index-512+1024;
-			if ((s->freq[i+j].mask & FREQ_TYPE_SERV))
+			if (freq_map_test(serv, i+j))
 				buffer[j + 5] = 'S';
-			else if ((s->freq[i+j].mask & FREQ_TYPE_NCELL)
-			      && (s->freq[i+j].mask & FREQ_TYPE_REP))
+			else if (freq_map_test(&ncell, i+j)
+			      && freq_map_test(&rep, i+j))
 				buffer[j + 5] = 'b';
-			else if ((s->freq[i+j].mask & FREQ_TYPE_NCELL))
+			else if (freq_map_test(&ncell, i+j))
 				buffer[j + 5] = 'n';
-			else if ((s->freq[i+j].mask & FREQ_TYPE_REP))
+			else if (freq_map_test(&rep, i+j))
 				buffer[j + 5] = 'r';
 			else if (!freq_map || (freq_map[index >> 3]
 						& (1 << (index & 7))))
@@ -325,10 +414,15 @@ int gsm48_decode_chan_h1(struct gsm48_chan_desc *cd, uint8_t *tsc,
 	return 0;
 }
 
-/* decode "Cell Channel Description" (10.5.2.1b) and other frequency lists */
-static int decode_freq_list(struct gsm_sysinfo_freq *f, uint8_t *cd,
-	uint8_t len, uint8_t mask, uint8_t frqt)
+/* decode "Cell Channel Description" (10.5.2.1b) and other frequency lists
+ * into a set of ARFCNs */
+int gsm48_decode_freq_map(struct gsm_freq_map *m, uint8_t *cd,
+	uint8_t len, uint8_t mask)
 {
+	struct gsm_sysinfo_freq f[1024];
+	uint64_t w;
+	int i, j, rc;
+
 #if 0
 	/* only Bit map 0 format for P-GSM */
 	if ((cd[0] & 0xc0 & mask) != 0x00 &&
@@ -336,7 +430,18 @@ static int decode_freq_list(struct gsm_sysinfo_freq *f, uint8_t *cd,
 		return 0;
 #endif
 
-	return gsm48_decode_freq_list(f, cd, len, mask, frqt);
+	/* decode with bit 0 as the only frequency type */
+	memset(f, 0, sizeof(f));
+	rc = gsm48_decode_freq_list(f, cd, len, mask, 1);
+
+	for (i = 0; i < 16; i++) {
+		w = 0;
+		for (j = 0; j < 64; j++)
+			w |= (uint64_t) f[(i << 6) + j].mask << j;
+		m->w[i] = w;
+	}
+
+	return rc;
 }
 
 /* decode "Cell Selection Parameters" (10.5.2.4) */
@@ -388,7 +493,7 @@ static int gsm48_decode_ccd(struct gsm48_sysinfo *s,
 }
 
 /* decode "Mobile Allocation" (10.5.2.21) */
-int gsm48_decode_mobile_alloc(struct gsm_sysinfo_freq *freq,
+int gsm48_decode_mobile_alloc(struct gsm48_sysinfo *s,
 	uint8_t *ma, uint8_t len, uint16_t *hopping, uint8_t *hopp_len, int si4)
 {
 	int i, j = 0;
@@ -400,20 +505,15 @@ int gsm48_decode_mobile_alloc(struct gsm_sysinfo_freq *freq,
 
 	/* tabula rasa */
 	*hopp_len = 0;
-	if (si4) {
-		for (i = 0; i < 1024; i++)
-			freq[i].mask &= ~FREQ_TYPE_HOPP;
-	}
+	if (si4)
+		freq_map_zero(&s->freq_hopp);
 
 	/* generating list of all frequencies (1..1023,0) */
-	for (i = 1; i <= 1024; i++) {
-		if ((freq[i & 1023].mask & FREQ_TYPE_SERV)) {
-			LOGP(DRR, LOGL_INFO, "Serving cell ARFCN #%d: %d\n",
-				j, i & 1023);
-			f[j++] = i & 1023;
-			if (j == (len << 3))
-				break;
-		}
+	freq_map_for_each_list(i, gsm48_sysinfo_serv(s)) {
+		LOGP(DRR, LOGL_INFO, "Serving cell ARFCN #%d: %d\n", j, i);
+		f[j++] = i;
+		if (j == (len << 3))
+			break;
 	}
 
 	/* fill hopping table with frequency index given by IE
@@ -434,7 +534,7 @@ int gsm48_decode_mobile_alloc(struct gsm_sysinfo_freq *freq,
 			}
 			hopping[(*hopp_len)++] = f[i];
 			if (si4)
-				freq[f[i]].mask |= FREQ_TYPE_HOPP;
+				freq_map_set(&s->freq_hopp, f[i]);
 		}
 	}
 
@@ -601,8 +701,8 @@ int gsm48_decode_sysinfo1(struct gsm48_sysinfo *s,
 	memcpy(s->si1_msg, si, MIN(len, sizeof(s->si1_msg)));
 
 	/* Cell Channel Description */
-	decode_freq_list(s->freq, si->cell_channel_description,
-		sizeof(si->cell_channel_description), 0xce, FREQ_TYPE_SERV);
+	si_cache_replace(&s->freq_serv, SI_CACHE_SI1,
+		si->cell_channel_description);
 	/* RACH Control Parameter */
 	gsm48_decode_rach_ctl_param(s, &si->rach_control);
 	/* SI 1 Rest Octets */
@@ -630,13 +730,14 @@ int gsm48_decode_sysinfo2(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description */
 	s->nb_ext_ind_si2 = (si->bcch_frequency_list[0] >> 6) & 1;
 	s->nb_ba_ind_si2 = (si->bcch_frequency_list[0] >> 5) & 1;
-	decode_freq_list(s->freq, si->bcch_frequency_list,
-		sizeof(si->bcch_frequency_list), 0xce, FREQ_TYPE_NCELL_2);
 	/* NCC Permitted */
 	s->nb_ncc_permitted_si2 = si->ncc_permitted;
 	/* RACH Control Parameter */
 	gsm48_decode_rach_ctl_neigh(s, &si->rach_control);
 
+	si_cache_replace(&s->freq_ncell[0], SI_CACHE_SI2,
+		si->bcch_frequency_list);
+
 	s->si2 = 1;
 
 	return 0;
@@ -650,11 +751,12 @@ int gsm48_decode_sysinfo2bis(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description */
 	s->nb_ext_ind_si2bis = (si->bcch_frequency_list[0] >> 6) & 1;
 	s->nb_ba_ind_si2bis = (si->bcch_frequency_list[0] >> 5) & 1;
-	decode_freq_list(s->freq, si->bcch_frequency_list,
-		sizeof(si->bcch_frequency_list), 0xce, FREQ_TYPE_NCELL_2bis);
 	/* RACH Control Parameter */
 	gsm48_decode_rach_ctl_neigh(s, &si->rach_control);
 
+	si_cache_replace(&s->freq_ncell[1], SI_CACHE_SI2BIS,
+		si->bcch_frequency_list);
+
 	s->si2bis = 1;
 
 	return 0;
@@ -668,9 +770,9 @@ int gsm48_decode_sysinfo2ter(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description 2 */
 	s->nb_multi_rep_si2ter = (si->ext_bcch_frequency_list[0] >> 6) & 3;
 	s->nb_ba_ind_si2ter = (si->ext_bcch_frequency_list[0] >> 5) & 1;
-	decode_freq_list(s->freq, si->ext_bcch_frequency_list,
-		sizeof(si->ext_bcch_frequency_list), 0x8e,
-			FREQ_TYPE_NCELL_2ter);
+
+	si_cache_replace(&s->freq_ncell[2], SI_CACHE_SI2TER,
+		si->ext_bcch_frequency_list);
 
 	s->si2ter = 1;
 
@@ -754,7 +856,7 @@ short_read:
 				"SYSTEM INFORMATION 4 until SI 1 is "
 				"received.\n");
 		} else {
-			gsm48_decode_mobile_alloc(s->freq, data + 2, data[1],
+			gsm48_decode_mobile_alloc(s, data + 2, data[1],
 				s->hopping, &s->hopp_len, 1);
 		}
 		payload_len -= 2 + data[1];
@@ -777,8 +879,9 @@ int gsm48_decode_sysinfo5(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description */
 	s->nb_ext_ind_si5 = (si->bcch_frequency_list[0] >> 6) & 1;
 	s->nb_ba_ind_si5 = (si->bcch_frequency_list[0] >> 5) & 1;
-	decode_freq_list(s->freq, si->bcch_frequency_list,
-		sizeof(si->bcch_frequency_list), 0xce, FREQ_TYPE_REP_5);
+
+	si_cache_replace(&s->freq_rep[0], SI_CACHE_SI5,
+		si->bcch_frequency_list);
 
 	s->si5 = 1;
 
@@ -793,8 +896,9 @@ int gsm48_decode_sysinfo5bis(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description */
 	s->nb_ext_ind_si5bis = (si->bcch_frequency_list[0] >> 6) & 1;
 	s->nb_ba_ind_si5bis = (si->bcch_frequency_list[0] >> 5) & 1;
-	decode_freq_list(s->freq, si->bcch_frequency_list,
-		sizeof(si->bcch_frequency_list), 0xce, FREQ_TYPE_REP_5bis);
+
+	si_cache_replace(&s->freq_rep[1], SI_CACHE_SI5BIS,
+		si->bcch_frequency_list);
 
 	s->si5bis = 1;
 
@@ -809,8 +913,9 @@ int gsm48_decode_sysinfo5ter(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description */
 	s->nb_multi_rep_si5ter = (si->bcch_frequency_list[0] >> 6) & 3;
 	s->nb_ba_ind_si5ter = (si->bcch_frequency_list[0] >> 5) & 1;
-	decode_freq_list(s->freq, si->bcch_frequency_list,
-		sizeof(si->bcch_frequency_list), 0x8e, FREQ_TYPE_REP_5ter);
+
+	si_cache_replace(&s->freq_rep[2], SI_CACHE_SI5TER,
+		si->bcch_frequency_list);
 
 	s->si5ter = 1;
 
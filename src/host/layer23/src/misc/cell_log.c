@@ -339,7 +339,7 @@ static void start_sync(void)
 	pm[arfcn].flags |= INFO_FLG_SYNC;
 	LOGP(DSUM, LOGL_INFO, "Sync ARFCN %d (rxlev %d, %d syncs left)%s\n",
 		arfcn, pm[arfcn].rxlev_dbm, sync_count--, dist_str);
-	memset(&sysinfo, 0, sizeof(sysinfo));
+	gsm48_sysinfo_reset(&sysinfo);
 	sysinfo.arfcn = arfcn;
 	state = SCAN_STATE_SYNC;
 	l1ctl_tx_reset_req(ms, L1CTL_RES_T_FULL);
@@ -58,6 +58,7 @@ static int gsm322_nb_read(struct gsm322_cellsel *cs, int yes);
 static int gsm322_c_camp_any_cell(struct osmocom_ms *ms, struct msgb *msg);
 static int gsm322_nb_start(struct osmocom_ms *ms, int synced);
 static void gsm322_cs_loss(void *arg);
+static void gsm322_camp_time(struct gsm322_cellsel *cs);
 static int gsm322_nb_meas_ind(struct osmocom_ms *ms, uint16_t arfcn,
 	uint8_t rx_lev);
 
@@ -274,7 +275,7 @@ int gsm322_plmn_sendmsg(struct osmocom_ms *ms, struct msgb *msg)
 {
 	struct gsm322_plmn *plmn = &ms->plmn;
 
-	msgb_enqueue(&plmn->event_queue, msg);
+	ms_enqueue(ms, MS_Q_PLMN, &plmn->event_queue, msg);
 
 	return 0;
 }
@@ -284,7 +285,7 @@ int gsm322_cs_sendmsg(struct osmocom_ms *ms, struct msgb *msg)
 {
 	struct gsm322_cellsel *cs = &ms->cellsel;
 
-	msgb_enqueue(&cs->event_queue, msg);
+	ms_enqueue(ms, MS_Q_CS, &cs->event_queue, msg);
 
 	return 0;
 }
@@ -507,7 +508,7 @@ static void gsm322_unselect_cell(struct gsm322_cellsel *cs)
 	if (cs->si)
 		cs->si->si5 = 0; /* unset SI5* */
 	cs->si = NULL;
-	memset(&cs->sel_si, 0, sizeof(cs->sel_si));
+	gsm48_sysinfo_reset(&cs->sel_si);
 	cs->sel_mcc = cs->sel_mnc = cs->sel_lac = cs->sel_id = 0;
 }
 
@@ -560,7 +561,7 @@ int gsm322_add_forbidden_la(struct osmocom_ms *ms, uint16_t mcc,
 	LOGP(DPLMN, LOGL_INFO, "Add to list of forbidden LAs "
 		"(mcc=%s, mnc=%s, lac=%04x)\n", gsm_print_mcc(mcc),
 		gsm_print_mnc(mnc), lac);
-	la = talloc_zero(l23_ctx, struct gsm322_la_list);
+	la = talloc_zero(ms, struct gsm322_la_list);
 	if (!la)
 		return -ENOMEM;
 	la->mcc = mcc;
@@ -836,15 +837,160 @@ static void new_c_state(struct gsm322_cellsel *cs, int state)
 		LOGP(DCS, LOGL_INFO, "changing state while power scanning\n");
 		l1ctl_tx_reset_req(cs->ms, L1CTL_RES_T_FULL);
 		cs->powerscan = 0;
+		cs->pm_inflight = 0;
+		memset(&cs->pm_start, 0, sizeof(cs->pm_start));
 	}
 
 	cs->state = state;
+
+	if (state == GSM322_C3_CAMPED_NORMALLY
+	 || state == GSM322_C7_CAMPED_ANY_CELL)
+		gsm322_camp_time(cs);
+}
+
+/*
+ * index of cells per PLMN
+ */
+
+/* remove cell from the index, the PLMN goes with its last cell */
+static void gsm322_plmn_index_del(struct gsm322_cellsel *cs, int i)
+{
+	struct gsm322_plmn_index *idx = cs->list[i].plmn_idx;
+	int16_t *p;
+
+	if (!idx)
+		return;
+
+	for (p = &idx->first; *p >= 0; p = &cs->list[*p].plmn_next) {
+		if (*p == i) {
+			*p = cs->list[i].plmn_next;
+			break;
+		}
+	}
+	cs->list[i].plmn_idx = NULL;
+	cs->list[i].plmn_next = -1;
+
+	if (idx->first < 0) {
+		llist_del(&idx->entry);
+		talloc_free(idx);
+		cs->plmn_index_num--;
+	}
+}
+
+/* file cell under the PLMN of its sysinfo */
+static void gsm322_plmn_index_add(struct gsm322_cellsel *cs, int i)
+{
+	struct gsm48_sysinfo *s = cs->list[i].sysinfo;
+	struct gsm322_plmn_index *idx = cs->list[i].plmn_idx, *temp;
+
+	if (idx && s && idx->mcc == s->mcc && idx->mnc == s->mnc)
+		return;
+	gsm322_plmn_index_del(cs, i);
+	if (!s)
+		return;
+
+	idx = NULL;
+	llist_for_each_entry(temp, &cs->plmn_index, entry) {
+		if (temp->mcc == s->mcc && temp->mnc == s->mnc) {
+			idx = temp;
+			break;
+		}
+	}
+	if (!idx) {
+		idx = talloc_zero(cs->ms, struct gsm322_plmn_index);
+		if (!idx)
+			return;
+		idx->mcc = s->mcc;
+		idx->mnc = s->mnc;
+		idx->first = -1;
+		llist_add_tail(&idx->entry, &cs->plmn_index);
+		cs->plmn_index_num++;
+	}
+
+	cs->list[i].plmn_idx = idx;
+	cs->list[i].plmn_next = idx->first;
+	idx->first = i;
+}
+
+/* Sysinfo of a cell may be freed or change its PLMN after the cell was
+ * stored.  Only the cells in the index are checked, not the whole list. */
+static void gsm322_plmn_index_check(struct gsm322_cellsel *cs)
+{
+	struct gsm322_plmn_index *idx, *idx2;
+	struct gsm48_sysinfo *s;
+	int i, next;
+
+	llist_for_each_entry_safe(idx, idx2, &cs->plmn_index, entry) {
+		for (i = idx->first; i >= 0; i = next) {
+			next = cs->list[i].plmn_next;
+			s = cs->list[i].sysinfo;
+			if (!s || s->mcc != idx->mcc || s->mnc != idx->mnc)
+				gsm322_plmn_index_add(cs, i);
+		}
+	}
+}
+
+static void gsm322_plmn_index_flush(struct gsm322_cellsel *cs)
+{
+	struct gsm322_plmn_index *idx, *idx2;
+	int i;
+
+	llist_for_each_entry_safe(idx, idx2, &cs->plmn_index, entry) {
+		for (i = idx->first; i >= 0; i = cs->list[i].plmn_next)
+			cs->list[i].plmn_idx = NULL;
+		llist_del(&idx->entry);
+		talloc_free(idx);
+	}
+	cs->plmn_index_num = 0;
 }
 
 /*
  * list of PLMNs
  */
 
+/* PLMN while creating the sorted list */
+struct plmn_sort {
+	struct gsm322_plmn_list	*plmn;
+	uint8_t			rxlev;
+	int			first; /* first cell in the cell selection list */
+	int			moved; /* moved to the sorted list */
+};
+
+static int plmn_sort_first_cmp(const void *a, const void *b)
+{
+	return ((const struct plmn_sort *) a)->first
+		- ((const struct plmn_sort *) b)->first;
+}
+
+static int plmn_sort_key_cmp(const void *a, const void *b)
+{
+	const struct gsm322_plmn_list *pa = (*(struct plmn_sort **) a)->plmn;
+	const struct gsm322_plmn_list *pb = (*(struct plmn_sort **) b)->plmn;
+
+	if (pa->mcc != pb->mcc)
+		return pa->mcc - pb->mcc;
+	return pa->mnc - pb->mnc;
+}
+
+/* decreasing rx level, equal levels in order of the cell selection list */
+static int plmn_sort_rxlev_cmp(const void *a, const void *b)
+{
+	const struct plmn_sort *ka = *(struct plmn_sort **) a;
+	const struct plmn_sort *kb = *(struct plmn_sort **) b;
+
+	if (ka->rxlev != kb->rxlev)
+		return kb->rxlev - ka->rxlev;
+	return ka->first - kb->first;
+}
+
+static void plmn_sort_move(struct gsm322_plmn *plmn, struct plmn_sort *k)
+{
+	if (k->moved)
+		return;
+	llist_add_tail(&k->plmn->entry, &plmn->sorted_plmn);
+	k->moved = 1;
+}
+
 /* 4.4.3 create sorted list of PLMN
  *
  * the source of entries are
@@ -864,6 +1010,9 @@ static void new_c_state(struct gsm322_cellsel *cs, int state)
  * The list contains all PLMNs even if not allowed, so entries have to be
  * removed when selecting from the list. (In case we use manual cell selection,
  * we need to provide non-allowed networks also.)
+ *
+ * The networks are taken from the index of cells per PLMN, which is updated
+ * when a cell is stored, so the list of 1024+299 frequencies is not walked.
  */
 static int gsm322_sort_list(struct osmocom_ms *ms)
 {
@@ -872,11 +1021,11 @@ static int gsm322_sort_list(struct osmocom_ms *ms)
 	struct gsm_subscriber *subscr = &ms->subscr;
 	struct gsm_sub_plmn_list *sim_entry;
 	struct gsm_sub_plmn_na *na_entry;
-	struct llist_head temp_list;
-	struct gsm322_plmn_list *temp, *found;
+	struct gsm322_plmn_index *idx;
+	struct gsm322_plmn_list *temp, key_plmn;
+	struct plmn_sort *list, **keyed, key, *k, **found;
 	struct llist_head *lh, *lh2;
-	int i, entries, move;
-	uint8_t search = 0;
+	int i, n, num, entries, move;
 
 	/* flush list */
 	llist_for_each_safe(lh, lh2, &plmn->sorted_plmn) {
@@ -884,108 +1033,105 @@ static int gsm322_sort_list(struct osmocom_ms *ms)
 		talloc_free(lh);
 	}
 
-	/* Create a temporary list of all networks */
-	INIT_LLIST_HEAD(&temp_list);
-	for (i = 0; i <= 1023+299; i++) {
-		if (!(cs->list[i].flags & GSM322_CS_FLAG_TEMP_AA)
-		 || !cs->list[i].sysinfo)
-			continue;
+	gsm322_plmn_index_check(cs);
+	if (!cs->plmn_index_num)
+		goto done;
+	list = talloc_zero_array(ms, struct plmn_sort, cs->plmn_index_num);
+	keyed = talloc_zero_array(ms, struct plmn_sort *,
+		cs->plmn_index_num);
+	if (!list || !keyed) {
+		talloc_free(list);
+		talloc_free(keyed);
+		return -ENOMEM;
+	}
 
-		/* search if network has multiple cells */
-		found = NULL;
-		llist_for_each_entry(temp, &temp_list, entry) {
-			if (temp->mcc == cs->list[i].sysinfo->mcc
-			 && temp->mnc == cs->list[i].sysinfo->mnc) {
-				found = temp;
-				break;
-			}
+	/* Create a temporary list of all networks from the index, a network
+	 * with multiple cells gets the best rx level of them */
+	num = 0;
+	llist_for_each_entry(idx, &cs->plmn_index, entry) {
+		k = &list[num];
+		k->first = -1;
+		for (i = idx->first; i >= 0; i = cs->list[i].plmn_next) {
+			if (!(cs->list[i].flags & GSM322_CS_FLAG_TEMP_AA))
+				continue;
+			if (k->first < 0 || cs->list[i].rxlev > k->rxlev)
+				k->rxlev = cs->list[i].rxlev;
+			if (k->first < 0 || i < k->first)
+				k->first = i;
 		}
-		/* update or create */
-		if (found) {
-			if (cs->list[i].rxlev > found->rxlev)
-				found->rxlev = cs->list[i].rxlev;
-		} else {
-			temp = talloc_zero(l23_ctx, struct gsm322_plmn_list);
-			if (!temp)
-				return -ENOMEM;
-			temp->mcc = cs->list[i].sysinfo->mcc;
-			temp->mnc = cs->list[i].sysinfo->mnc;
-			temp->rxlev = cs->list[i].rxlev;
-			llist_add_tail(&temp->entry, &temp_list);
+		if (k->first < 0)
+			continue;
+		temp = talloc_zero(ms, struct gsm322_plmn_list);
+		if (!temp) {
+			while (num--)
+				talloc_free(list[num].plmn);
+			talloc_free(keyed);
+			talloc_free(list);
+			return -ENOMEM;
 		}
+		temp->mcc = idx->mcc;
+		temp->mnc = idx->mnc;
+		temp->rxlev = k->rxlev;
+		k->plmn = temp;
+		num++;
 	}
 
+	/* in order of the cell selection list, like scanning it */
+	qsort(list, num, sizeof(*list), plmn_sort_first_cmp);
+	for (i = 0; i < num; i++)
+		keyed[i] = &list[i];
+	qsort(keyed, num, sizeof(*keyed), plmn_sort_key_cmp);
+
 	/* move Home PLMN, if in list, else add it */
 	if (subscr->sim_valid) {
-		found = NULL;
-		llist_for_each_entry(temp, &temp_list, entry) {
-			if (gsm_match_mnc(temp->mcc, temp->mnc, subscr->imsi)) {
-				found = temp;
+		for (i = 0; i < num; i++) {
+			if (gsm_match_mnc(list[i].plmn->mcc,
+					list[i].plmn->mnc, subscr->imsi)) {
+				plmn_sort_move(plmn, &list[i]);
 				break;
 			}
 		}
-		if (found) {
-			/* move */
-			llist_del(&found->entry);
-			llist_add_tail(&found->entry, &plmn->sorted_plmn);
-		}
 	}
 
 	/* move entries if in SIM's PLMN Selector list */
 	llist_for_each_entry(sim_entry, &subscr->plmn_list, entry) {
-		found = NULL;
-		llist_for_each_entry(temp, &temp_list, entry) {
-			if (temp->mcc == sim_entry->mcc
-			 && temp->mnc == sim_entry->mnc) {
-				found = temp;
-				break;
-			}
-		}
-		if (found) {
-			llist_del(&found->entry);
-			llist_add_tail(&found->entry, &plmn->sorted_plmn);
-		}
+		key_plmn.mcc = sim_entry->mcc;
+		key_plmn.mnc = sim_entry->mnc;
+		key.plmn = &key_plmn;
+		k = &key;
+		found = bsearch(&k, keyed, num, sizeof(*keyed),
+			plmn_sort_key_cmp);
+		if (found)
+			plmn_sort_move(plmn, *found);
 	}
 
 	/* move PLMN above -85 dBm in random order */
 	entries = 0;
-	llist_for_each_entry(temp, &temp_list, entry) {
-		if (rxlev2dbm(temp->rxlev) > -85)
-			entries++;
+	for (i = 0; i < num; i++) {
+		if (list[i].moved || rxlev2dbm(list[i].plmn->rxlev) <= -85)
+			continue;
+		keyed[entries++] = &list[i];
 	}
-	while(entries) {
+	while (entries) {
 		move = random() % entries;
-		i = 0;
-		llist_for_each_entry(temp, &temp_list, entry) {
-			if (rxlev2dbm(temp->rxlev) > -85) {
-				if (i == move) {
-					llist_del(&temp->entry);
-					llist_add_tail(&temp->entry,
-						&plmn->sorted_plmn);
-					break;
-				}
-				i++;
-			}
-		}
-		entries--;
+		plmn_sort_move(plmn, keyed[move]);
+		keyed[move] = keyed[--entries];
 	}
 
 	/* move ohter PLMN in decreasing order */
-	while(1) {
-		found = NULL;
-		llist_for_each_entry(temp, &temp_list, entry) {
-			if (!found
-			 || temp->rxlev > search) {
-				search = temp->rxlev;
-				found = temp;
-			}
-		}
-		if (!found)
-			break;
-		llist_del(&found->entry);
-		llist_add_tail(&found->entry, &plmn->sorted_plmn);
+	n = 0;
+	for (i = 0; i < num; i++) {
+		if (!list[i].moved)
+			keyed[n++] = &list[i];
 	}
+	qsort(keyed, n, sizeof(*keyed), plmn_sort_rxlev_cmp);
+	for (i = 0; i < n; i++)
+		plmn_sort_move(plmn, keyed[i]);
+
+	talloc_free(keyed);
+	talloc_free(list);
 
+done:
 	/* mark forbidden PLMNs, if in list of forbidden networks */
 	i = 0;
 	llist_for_each_entry(temp, &plmn->sorted_plmn, entry) {
@@ -2153,13 +2299,12 @@ static int gsm322_search_end(struct osmocom_ms *ms)
 		cs->arfcn = cs->sel_arfcn;
 		cs->arfci = arfcn2index(cs->arfcn);
 		if (!cs->list[cs->arfci].sysinfo)
-			cs->list[cs->arfci].sysinfo = talloc_zero(l23_ctx,
-							struct gsm48_sysinfo);
+			cs->list[cs->arfci].sysinfo = gsm48_sysinfo_alloc(ms);
 		if (!cs->list[cs->arfci].sysinfo)
 			exit(-ENOMEM);
 		cs->list[cs->arfci].flags |= GSM322_CS_FLAG_SYSINFO;
-		memcpy(cs->list[cs->arfci].sysinfo, &cs->sel_si,
-			sizeof(struct gsm48_sysinfo));
+		gsm48_sysinfo_copy(cs->list[cs->arfci].sysinfo, &cs->sel_si);
+		gsm322_plmn_index_add(cs, cs->arfci);
 		cs->si = cs->list[cs->arfci].sysinfo;
 		cs->sel_mcc = cs->si->mcc;
 		cs->sel_mnc = cs->si->mnc;
@@ -2257,11 +2402,9 @@ static int gsm322_cs_scan(struct osmocom_ms *ms)
 	/* Allocate/clean system information. */
 	cs->list[cs->arfci].flags &= ~GSM322_CS_FLAG_SYSINFO;
 	if (cs->list[cs->arfci].sysinfo)
-		memset(cs->list[cs->arfci].sysinfo, 0,
-			sizeof(struct gsm48_sysinfo));
+		gsm48_sysinfo_reset(cs->list[cs->arfci].sysinfo);
 	else
-		cs->list[cs->arfci].sysinfo = talloc_zero(l23_ctx,
-						struct gsm48_sysinfo);
+		cs->list[cs->arfci].sysinfo = gsm48_sysinfo_alloc(ms);
 	if (!cs->list[cs->arfci].sysinfo)
 		exit(-ENOMEM);
 	cs->si = cs->list[cs->arfci].sysinfo;
@@ -2318,6 +2461,7 @@ static int gsm322_cs_store(struct osmocom_ms *ms)
 		else
 			cs->list[cs->arfci].flags &= ~GSM322_CS_FLAG_FORBIDD;
 	}
+	gsm322_plmn_index_add(cs, cs->arfci);
 
 	LOGP(DCS, LOGL_DEBUG, "Scan frequency %s: Cell found. (rxlev %s "
 		"mcc %s mnc %s lac %04x)\n", gsm_print_arfcn(cs->arfcn),
@@ -2431,7 +2575,7 @@ indicate_plmn_avail:
 	/* set selected cell */
 	cs->selected = 1;
 	cs->sel_arfcn = cs->arfcn;
-	memcpy(&cs->sel_si, cs->si, sizeof(cs->sel_si));
+	gsm48_sysinfo_copy(&cs->sel_si, cs->si);
 	cs->sel_mcc = cs->si->mcc;
 	cs->sel_mnc = cs->si->mnc;
 	cs->sel_lac = cs->si->lac;
@@ -2463,6 +2607,7 @@ struct gsm322_ba_list *gsm322_cs_sysinfo_sacch(struct osmocom_ms *ms)
 	struct gsm322_cellsel *cs = &ms->cellsel;
 	struct gsm48_sysinfo *s;
 	struct gsm322_ba_list *ba = NULL;
+	struct gsm_freq_map all;
 	int i, refer_pcs;
 	uint8_t freq[128+38];
 
@@ -2481,7 +2626,7 @@ struct gsm322_ba_list *gsm322_cs_sysinfo_sacch(struct osmocom_ms *ms)
 		/* find or create ba list */
 		ba = gsm322_find_ba_list(cs, s->mcc, s->mnc);
 		if (!ba) {
-			ba = talloc_zero(l23_ctx, struct gsm322_ba_list);
+			ba = talloc_zero(ms, struct gsm322_ba_list);
 			if (!ba)
 				return NULL;
 			ba->mcc = s->mcc;
@@ -2491,14 +2636,14 @@ struct gsm322_ba_list *gsm322_cs_sysinfo_sacch(struct osmocom_ms *ms)
 		/* update (add) ba list */
 		refer_pcs = gsm_refer_pcs(cs->arfcn, s);
 		memset(freq, 0, sizeof(freq));
-		for (i = 0; i <= 1023; i++) {
-			if ((s->freq[i].mask & (FREQ_TYPE_SERV
-				| FREQ_TYPE_NCELL | FREQ_TYPE_REP))) {
-				if (refer_pcs && i >= 512 && i <= 810)
-					freq[(i-512+1024) >> 3] |= (1 << (i&7));
-				else
-					freq[i >> 3] |= (1 << (i & 7));
-			}
+		all = *gsm48_sysinfo_serv(s);
+		gsm48_sysinfo_ncell(s, &all);
+		gsm48_sysinfo_rep(s, &all);
+		freq_map_for_each(i, &all) {
+			if (refer_pcs && i >= 512 && i <= 810)
+				freq[(i-512+1024) >> 3] |= (1 << (i&7));
+			else
+				freq[i >> 3] |= (1 << (i & 7));
 		}
 		if (!!memcmp(freq, ba->freq, sizeof(freq))) {
 			LOGP(DCS, LOGL_INFO, "New BA list (mcc=%s mnc=%s  "
@@ -2517,13 +2662,14 @@ static int gsm322_store_ba_list(struct gsm322_cellsel *cs,
 	struct gsm48_sysinfo *s)
 {
 	struct gsm322_ba_list *ba;
+	struct gsm_freq_map all;
 	int i, refer_pcs;
 	uint8_t freq[128+38];
 
 	/* find or create ba list */
 	ba = gsm322_find_ba_list(cs, s->mcc, s->mnc);
 	if (!ba) {
-		ba = talloc_zero(l23_ctx, struct gsm322_ba_list);
+		ba = talloc_zero(cs->ms, struct gsm322_ba_list);
 		if (!ba)
 			return -ENOMEM;
 		ba->mcc = s->mcc;
@@ -2534,14 +2680,14 @@ static int gsm322_store_ba_list(struct gsm322_cellsel *cs,
 	refer_pcs = gsm_refer_pcs(cs->arfcn, s);
 	memset(freq, 0, sizeof(freq));
 	freq[(cs->arfci) >> 3] |= (1 << (cs->arfci & 7));
-	for (i = 0; i <= 1023; i++) {
-		if ((s->freq[i].mask &
-		    (FREQ_TYPE_SERV | FREQ_TYPE_NCELL | FREQ_TYPE_REP))) {
-			if (refer_pcs && i >= 512 && i <= 810)
-				freq[(i-512+1024) >> 3] |= (1 << (i & 7));
-			else
-				freq[i >> 3] |= (1 << (i & 7));
-		}
+	all = *gsm48_sysinfo_serv(s);
+	gsm48_sysinfo_ncell(s, &all);
+	gsm48_sysinfo_rep(s, &all);
+	freq_map_for_each(i, &all) {
+		if (refer_pcs && i >= 512 && i <= 810)
+			freq[(i-512+1024) >> 3] |= (1 << (i & 7));
+		else
+			freq[i >> 3] |= (1 << (i & 7));
 	}
 	if (!!memcmp(freq, ba->freq, sizeof(freq))) {
 		LOGP(DCS, LOGL_INFO, "New BA list (mcc=%s mnc=%s  "
@@ -2604,7 +2750,7 @@ static int gsm322_c_camp_sysinfo_bcch(struct osmocom_ms *ms, struct msgb *msg)
 		if (cs->selected) {
 			LOGP(DCS, LOGL_INFO, "Sysinfo of selected cell is "
 				"now received or updated.\n");
-			memcpy(&cs->sel_si, s, sizeof(cs->sel_si));
+			gsm48_sysinfo_copy(&cs->sel_si, s);
 
 			/* start in case we are camping on serving cell */
 			if (cs->state == GSM322_C3_CAMPED_NORMALLY
@@ -2765,16 +2911,81 @@ static void gsm322_cs_timeout(void *arg)
  * power scan process
  */
 
-/* search for block of unscanned frequencies and start scanning */
-static int gsm322_cs_powerscan(struct osmocom_ms *ms)
+static unsigned long ms_since(const struct timespec *start)
 {
-	struct gsm322_cellsel *cs = &ms->cellsel;
-	struct gsm_settings *set = &ms->settings;
-	int i, s = -1, e;
-	char s_text[ARFCN_TEXT_LEN], e_text[ARFCN_TEXT_LEN];
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000
+		+ (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static int pm_ranges_add(struct gsm322_cellsel *cs,
+	struct gsm322_pm_ranges *rs, int from, int to)
+{
+	struct gsm322_pm_range *r;
+	int i;
+
+	if (rs->num == rs->size) {
+		r = talloc_realloc(cs->ms, rs->range, struct gsm322_pm_range,
+			rs->size ? rs->size * 2 : 16);
+		if (!r)
+			return -ENOMEM;
+		rs->range = r;
+		rs->size = rs->size ? rs->size * 2 : 16;
+	}
+
+	r = &rs->range[rs->num++];
+	r->from = from;
+	r->to = to;
+	r->rxlev = 0;
+	for (i = from; i <= to; i++) {
+		if (cs->list[i].rxlev > r->rxlev)
+			r->rxlev = cs->list[i].rxlev;
+	}
+
+	return 0;
+}
+
+/* blocks of supported frequencies, taken once from the band map, a block
+ * never spans into the PCS part of the list */
+static void gsm322_pm_bands(struct gsm322_cellsel *cs)
+{
+	int i, s = -1;
+
+	cs->pm_bands.num = 0;
+	for (i = 0; i <= 1023+299 + 1; i++) {
+		if (s >= 0 && (i == 1024 || i > 1023+299
+		 || !(cs->list[i].flags & GSM322_CS_FLAG_SUPPORT))) {
+			pm_ranges_add(cs, &cs->pm_bands, s, i - 1);
+			s = -1;
+		}
+		if (s < 0 && i <= 1023+299
+		 && (cs->list[i].flags & GSM322_CS_FLAG_SUPPORT))
+			s = i;
+	}
+}
+
+/* strongest block of the last scan first */
+static int pm_range_cmp(const void *a, const void *b)
+{
+	const struct gsm322_pm_range *ra = a, *rb = b;
+
+	if (ra->rxlev != rb->rxlev)
+		return rb->rxlev - ra->rxlev;
+	return ra->from - rb->from;
+}
+
+/* plan the blocks of frequencies that still need to be scanned */
+static void gsm322_pm_plan(struct gsm322_cellsel *cs)
+{
+	struct gsm_settings *set = &cs->ms->settings;
+	struct gsm322_pm_range *b;
 	uint8_t mask, flags;
+	int i, s;
 
-	again:
+	cs->pm_plan.num = 0;
+	cs->pm_next = 0;
 
 	mask = GSM322_CS_FLAG_SUPPORT | GSM322_CS_FLAG_POWER;
 	flags = GSM322_CS_FLAG_SUPPORT;
@@ -2784,32 +2995,127 @@ static int gsm322_cs_powerscan(struct osmocom_ms *ms)
 		LOGP(DCS, LOGL_DEBUG, "Scanning power for sticked cell.\n");
 		i = arfcn2index(set->stick_arfcn);
 		if ((cs->list[i].flags & mask) == flags)
-			s = e = i;
-	} else {
-		/* search for first frequency to scan */
-		if (cs->state == GSM322_C2_STORED_CELL_SEL
-		 || cs->state == GSM322_C5_CHOOSE_CELL) {
-			LOGP(DCS, LOGL_DEBUG, "Scanning power for stored BA "
-				"list.\n");
-			mask |= GSM322_CS_FLAG_BA;
-			flags |= GSM322_CS_FLAG_BA;
-		} else
-			LOGP(DCS, LOGL_DEBUG, "Scanning power for all "
-				"frequencies.\n");
-		for (i = 0; i <= 1023+299; i++) {
-			if ((cs->list[i].flags & mask) == flags) {
-				s = e = i;
-				break;
+			pm_ranges_add(cs, &cs->pm_plan, i, i);
+		return;
+	}
+
+	if (cs->state == GSM322_C2_STORED_CELL_SEL
+	 || cs->state == GSM322_C5_CHOOSE_CELL) {
+		LOGP(DCS, LOGL_DEBUG, "Scanning power for stored BA list.\n");
+		mask |= GSM322_CS_FLAG_BA;
+		flags |= GSM322_CS_FLAG_BA;
+	} else
+		LOGP(DCS, LOGL_DEBUG, "Scanning power for all frequencies.\n");
+
+	for (b = cs->pm_bands.range; b < cs->pm_bands.range
+	     + cs->pm_bands.num; b++) {
+		s = -1;
+		for (i = b->from; i <= b->to + 1; i++) {
+			if (i <= b->to && (cs->list[i].flags & mask) == flags) {
+				if (s < 0)
+					s = i;
+				continue;
+			}
+			if (s >= 0) {
+				pm_ranges_add(cs, &cs->pm_plan, s, i - 1);
+				s = -1;
 			}
 		}
 	}
 
+	/* the strongest candidates of the stored BA are measured first */
+	if ((flags & GSM322_CS_FLAG_BA))
+		qsort(cs->pm_plan.range, cs->pm_plan.num,
+			sizeof(*cs->pm_plan.range), pm_range_cmp);
+}
+
+/* request blocks of the plan, as many as layer 1 accepts at once */
+static int gsm322_pm_send(struct osmocom_ms *ms)
+{
+	struct gsm322_cellsel *cs = &ms->cellsel;
+	char s_text[ARFCN_TEXT_LEN], e_text[ARFCN_TEXT_LEN];
+	struct gsm322_pm_range *r;
+	int window = ms->settings.pm_ranges;
+	int rc = 0;
+
+	if (window < 1)
+		window = 1;
+
+	while (cs->pm_inflight < window && cs->pm_next < cs->pm_plan.num) {
+		r = &cs->pm_plan.range[cs->pm_next++];
+		strncpy(s_text, gsm_print_arfcn(index2arfcn(r->from)),
+			ARFCN_TEXT_LEN);
+		strncpy(e_text, gsm_print_arfcn(index2arfcn(r->to)),
+			ARFCN_TEXT_LEN);
+		LOGP(DCS, LOGL_DEBUG, "Scanning frequencies. (%s..%s)\n",
+			s_text, e_text);
+		rc = l1ctl_tx_pm_req_range(ms, index2arfcn(r->from),
+			index2arfcn(r->to));
+		if (rc < 0)
+			break;
+		cs->pm_inflight++;
+		cs->scan_stats.ranges++;
+	}
+
+	return rc;
+}
+
+/* the power scan is complete, or there was nothing to scan */
+static void gsm322_pm_end(struct gsm322_cellsel *cs)
+{
+	if (cs->powerscan && cs->pm_start.tv_sec) {
+		cs->scan_stats.scans++;
+		cs->scan_stats.last_scan_ms = ms_since(&cs->pm_start);
+		LOGP(DCS, LOGL_INFO, "Power scan took %lu ms.\n",
+			cs->scan_stats.last_scan_ms);
+	}
+	memset(&cs->pm_start, 0, sizeof(cs->pm_start));
+	cs->powerscan = 0;
+	cs->pm_inflight = 0;
+}
+
+/* camping after scanning without a cell, record how long it took */
+static void gsm322_camp_time(struct gsm322_cellsel *cs)
+{
+	struct gsm322_scan_stats *st = &cs->scan_stats;
+	unsigned long t;
+
+	if (!cs->camp_start.tv_sec)
+		return;
+
+	t = ms_since(&cs->camp_start);
+	memset(&cs->camp_start, 0, sizeof(cs->camp_start));
+	st->last_camp_ms = t;
+	if (!st->camps || t < st->min_camp_ms)
+		st->min_camp_ms = t;
+	if (t > st->max_camp_ms)
+		st->max_camp_ms = t;
+	st->sum_camp_ms += t;
+	st->camps++;
+	LOGP(DCS, LOGL_INFO, "Camping %lu ms after start of scan.\n", t);
+}
+
+/* Scan blocks of unscanned frequencies.  The blocks are planned when the
+ * scan starts and requested from layer 1 as a pipeline, see
+ * gsm322_pm_send().  When all blocks are done, the plan is made again
+ * to catch frequencies that layer 1 did not report. */
+static int gsm322_cs_powerscan(struct osmocom_ms *ms)
+{
+	struct gsm322_cellsel *cs = &ms->cellsel;
+	int i;
+
+	again:
+
+	if (!cs->powerscan
+	 || (cs->pm_next == cs->pm_plan.num && !cs->pm_inflight))
+		gsm322_pm_plan(cs);
+
 	/* if there is no more frequency, we can tune to that cell */
-	if (s < 0) {
+	if (cs->pm_next == cs->pm_plan.num && !cs->pm_inflight) {
 		int found = 0;
 
 		/* stop power level scanning */
-		cs->powerscan = 0;
+		gsm322_pm_end(cs);
 
 		/* check if no signal is found */
 		for (i = 0; i <= 1023+299; i++) {
@@ -2841,32 +3147,17 @@ static int gsm322_cs_powerscan(struct osmocom_ms *ms)
 		return gsm322_cs_scan(ms);
 	}
 
-	/* search last frequency to scan (en block) */
-	e = i;
-	if (!set->stick) {
-		for (i = s + 1; i <= 1023+299; i++) {
-			if (i == 1024)
-				break;
-			if ((cs->list[i].flags & mask) == flags)
-				e = i;
-			else
-				break;
-		}
-	}
-
-	strncpy(s_text, gsm_print_arfcn(index2arfcn(s)), ARFCN_TEXT_LEN);
-	strncpy(e_text, gsm_print_arfcn(index2arfcn(e)), ARFCN_TEXT_LEN);
-	LOGP(DCS, LOGL_DEBUG, "Scanning frequencies. (%s..%s)\n",
-		s_text,
-		e_text);
-
 	/* start scan on radio interface */
 	if (!cs->powerscan) {
 		l1ctl_tx_reset_req(ms, L1CTL_RES_T_FULL);
 		cs->powerscan = 1;
+		cs->pm_inflight = 0;
+		clock_gettime(CLOCK_MONOTONIC, &cs->pm_start);
+		if (!cs->selected && !cs->camp_start.tv_sec)
+			cs->camp_start = cs->pm_start;
 	}
 	cs->sync_pending = 0;
-	return l1ctl_tx_pm_req_range(ms, index2arfcn(s), index2arfcn(e));
+	return gsm322_pm_send(ms);
 }
 
 int gsm322_l1_signal(unsigned int subsys, unsigned int signal,
@@ -2924,6 +3215,8 @@ int gsm322_l1_signal(unsigned int subsys, unsigned int signal,
 		cs = &ms->cellsel;
 		if (!cs->powerscan)
 			return -EINVAL;
+		if (cs->pm_inflight)
+			cs->pm_inflight--;
 		gsm322_cs_powerscan(ms);
 		break;
 	case S_L1CTL_FBSB_RESP:
@@ -3949,7 +4242,7 @@ int gsm322_plmn_dequeue(struct osmocom_ms *ms)
 	struct msgb *msg;
 	int work = 0;
 
-	while ((msg = msgb_dequeue(&plmn->event_queue))) {
+	while ((msg = ms_dequeue(ms, MS_Q_PLMN, &plmn->event_queue))) {
 		/* send event to PLMN select process */
 		if (ms->settings.plmn_mode == PLMN_MODE_AUTO)
 			gsm322_a_event(ms, msg);
@@ -4071,7 +4364,7 @@ int gsm322_cs_dequeue(struct osmocom_ms *ms)
 	struct msgb *msg;
 	int work = 0;
 
-	while ((msg = msgb_dequeue(&cs->event_queue))) {
+	while ((msg = ms_dequeue(ms, MS_Q_CS, &cs->event_queue))) {
 		/* send event to cell selection process */
 		gsm322_c_event(ms, msg);
 		msgb_free(msg);
@@ -4093,7 +4386,7 @@ static struct gsm322_neighbour *gsm322_nb_alloc(struct gsm322_cellsel *cs,
 
 	time(&now);
 
-	nb = talloc_zero(l23_ctx, struct gsm322_neighbour);
+	nb = talloc_zero(cs->ms, struct gsm322_neighbour);
 	if (!nb)
 		return 0;
 
@@ -4420,11 +4713,9 @@ no_cell_found:
 	/* Allocate/clean system information. */
 	cs->list[cs->arfci].flags &= ~GSM322_CS_FLAG_SYSINFO;
 	if (cs->list[cs->arfci].sysinfo)
-		memset(cs->list[cs->arfci].sysinfo, 0,
-			sizeof(struct gsm48_sysinfo));
+		gsm48_sysinfo_reset(cs->list[cs->arfci].sysinfo);
 	else
-		cs->list[cs->arfci].sysinfo = talloc_zero(l23_ctx,
-						struct gsm48_sysinfo);
+		cs->list[cs->arfci].sysinfo = gsm48_sysinfo_alloc(ms);
 	if (!cs->list[cs->arfci].sysinfo)
 		exit(-ENOMEM);
 	cs->si = cs->list[cs->arfci].sysinfo;
@@ -4440,7 +4731,7 @@ static int gsm322_nb_start(struct osmocom_ms *ms, int synced)
 	struct gsm48_sysinfo *s = &cs->sel_si;
 	struct gsm322_neighbour *nb, *nb2;
 	int i, num;
-	uint8_t map[128];
+	struct gsm_freq_map map, ncell;
 	uint16_t nc[32];
 	uint8_t changed = 0;
 	int refer_pcs, index;
@@ -4454,16 +4745,18 @@ static int gsm322_nb_start(struct osmocom_ms *ms, int synced)
 
 	refer_pcs = gsm_refer_pcs(cs->sel_arfcn, s);
 
+	freq_map_zero(&ncell);
+	gsm48_sysinfo_ncell(s, &ncell);
+#ifdef TEST_INCLUDE_SERV
+	freq_map_or(&ncell, gsm48_sysinfo_serv(s));
+#endif
+
 	/* remove all neighbours that are not in list anymore */
-	memset(map, 0, sizeof(map));
+	freq_map_zero(&map);
 	llist_for_each_entry_safe(nb, nb2, &cs->nb_list, entry) {
 		i = nb->arfcn & 1023;
-		map[i >> 3] |= (1 << (i & 7));
-#ifndef TEST_INCLUDE_SERV
-		if (!(s->freq[i].mask & FREQ_TYPE_NCELL)) {
-#else
-		if (!(s->freq[i].mask & (FREQ_TYPE_NCELL | FREQ_TYPE_SERV))) {
-#endif
+		freq_map_set(&map, i);
+		if (!freq_map_test(&ncell, i)) {
 			LOGP(DNB, LOGL_INFO, "Removing neighbour cell %s from "
 				"list.\n", gsm_print_arfcn(nb->arfcn));
 			gsm322_nb_free(nb);
@@ -4483,14 +4776,8 @@ static int gsm322_nb_start(struct osmocom_ms *ms, int synced)
 	}
 
 	/* add missing entries to list */
-	for (i = 0; i <= 1023; i++) {
-#ifndef TEST_INCLUDE_SERV
-		if ((s->freq[i].mask & FREQ_TYPE_NCELL) &&
-		  !(map[i >> 3] & (1 << (i & 7)))) {
-#else
-		if ((s->freq[i].mask & (FREQ_TYPE_NCELL | FREQ_TYPE_SERV)) &&
-		  !(map[i >> 3] & (1 << (i & 7)))) {
-#endif
+	freq_map_for_each(i, &ncell) {
+		if (!freq_map_test(&map, i)) {
 			index = i;
 			if (refer_pcs && i >= 512 && i <= 810)
 				index = i-512+1024;
@@ -4592,11 +4879,10 @@ printf("%d time to sync again: %u\n", nb->arfcn, now + GSM58_READ_AGAIN - nb->wh
 		/* Allocate/clean system information. */
 		cs->list[cs->arfci].flags &= ~GSM322_CS_FLAG_SYSINFO;
 		if (cs->list[cs->arfci].sysinfo)
-			memset(cs->list[cs->arfci].sysinfo, 0,
-				sizeof(struct gsm48_sysinfo));
+			gsm48_sysinfo_reset(cs->list[cs->arfci].sysinfo);
 		else
-			cs->list[cs->arfci].sysinfo = talloc_zero(l23_ctx,
-							struct gsm48_sysinfo);
+			cs->list[cs->arfci].sysinfo =
+				gsm48_sysinfo_alloc(cs->ms);
 		if (!cs->list[cs->arfci].sysinfo)
 			exit(-ENOMEM);
 		cs->si = cs->list[cs->arfci].sysinfo;
@@ -5053,11 +5339,13 @@ int gsm322_init(struct osmocom_ms *ms)
 	INIT_LLIST_HEAD(&plmn->forbidden_la);
 	INIT_LLIST_HEAD(&cs->ba_list);
 	INIT_LLIST_HEAD(&cs->nb_list);
+	INIT_LLIST_HEAD(&cs->plmn_index);
 
 	/* set supported frequencies in cell selection list */
 	for (i = 0; i <= 1023+299; i++)
 		if ((ms->settings.freq_map[i >> 3] & (1 << (i & 7))))
 			cs->list[i].flags |= GSM322_CS_FLAG_SUPPORT;
+	gsm322_pm_bands(cs);
 
 	/* read BA list */
 	ba_filename = talloc_asprintf(ms, "%s/%s.ba", config_dir, ms->name);
@@ -5074,7 +5362,7 @@ int gsm322_init(struct osmocom_ms *ms)
 				"stored BA list becomes obsolete.\n");
 		} else
 		while(!feof(fp)) {
-			ba = talloc_zero(l23_ctx, struct gsm322_ba_list);
+			ba = talloc_zero(ms, struct gsm322_ba_list);
 			if (!ba)
 				return -ENOMEM;
 			rc = fread(buf, 4, 1, fp);
@@ -5136,6 +5424,16 @@ int gsm322_exit(struct osmocom_ms *ms)
 		}
 		cs->list[i].flags = 0;
 	}
+	cs->si = NULL;
+	gsm48_sysinfo_reset(&cs->sel_si);
+
+	gsm322_plmn_index_flush(cs);
+
+	/* free power scan ranges */
+	talloc_free(cs->pm_bands.range);
+	talloc_free(cs->pm_plan.range);
+	memset(&cs->pm_bands, 0, sizeof(cs->pm_bands));
+	memset(&cs->pm_plan, 0, sizeof(cs->pm_plan));
 
 	/* store BA list */
 	ba_filename = talloc_asprintf(ms, "%s/%s.ba", config_dir, ms->name);
@@ -5166,9 +5464,9 @@ int gsm322_exit(struct osmocom_ms *ms)
 		LOGP(DCS, LOGL_ERROR, "Failed to write BA list\n");
 
 	/* free lists */
-	while ((msg = msgb_dequeue(&plmn->event_queue)))
+	while ((msg = ms_dequeue(ms, MS_Q_PLMN, &plmn->event_queue)))
 		msgb_free(msg);
-	while ((msg = msgb_dequeue(&cs->event_queue)))
+	while ((msg = ms_dequeue(ms, MS_Q_CS, &cs->event_queue)))
 		msgb_free(msg);
 	llist_for_each_safe(lh, lh2, &plmn->sorted_plmn) {
 		llist_del(lh);
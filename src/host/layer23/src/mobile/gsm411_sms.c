@@ -86,9 +86,9 @@ int gsm411_sms_exit(struct osmocom_ms *ms)
  * SMS content
  */
 
-struct gsm_sms *sms_alloc(void)
+struct gsm_sms *sms_alloc(void *ctx)
 {
-	return talloc_zero(l23_ctx, struct gsm_sms);
+	return talloc_zero(ctx, struct gsm_sms);
 }
 
 void sms_free(struct gsm_sms *sms)
@@ -98,7 +98,7 @@ void sms_free(struct gsm_sms *sms)
 
 struct gsm_sms *sms_from_text(const char *receiver, int dcs, const char *text)
 {
-	struct gsm_sms *sms = sms_alloc();
+	struct gsm_sms *sms = sms_alloc(l23_ctx);
 
 	if (!sms)
 		return NULL;
@@ -230,7 +230,7 @@ static int gsm340_rx_tpdu(struct gsm_trans *trans, struct msgb *msg)
 	uint8_t address_lv[12]; /* according to 03.40 / 9.1.2.5 */
 	int rc = 0;
 
-	gsms = sms_alloc();
+	gsms = sms_alloc(trans);
 
 	/* invert those fields where 0 means active/present */
 	sms_mti = *smsp & 0x03;
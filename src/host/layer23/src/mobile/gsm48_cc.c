@@ -82,7 +82,7 @@ int gsm48_cc_exit(struct osmocom_ms *ms)
 		}
 	}
 
-	while ((msg = msgb_dequeue(&cc->mncc_upqueue)))
+	while ((msg = ms_dequeue(ms, MS_Q_MNCC, &cc->mncc_upqueue)))
 		msgb_free(msg);
 
 	return 0;
@@ -204,7 +204,7 @@ static int mncc_recvmsg(struct osmocom_ms *ms, struct gsm_trans *trans,
 	if (!msg)
 		return -ENOMEM;
 	memcpy(msg->data, mncc, sizeof(struct gsm_mncc));
-	msgb_enqueue(&cc->mncc_upqueue, msg);
+	ms_enqueue(ms, MS_Q_MNCC, &cc->mncc_upqueue, msg);
 
 	return 0;
 }
@@ -217,7 +217,7 @@ int mncc_dequeue(struct osmocom_ms *ms)
 	struct msgb *msg;
 	int work = 0;
 
-	while ((msg = msgb_dequeue(&cc->mncc_upqueue))) {
+	while ((msg = ms_dequeue(ms, MS_Q_MNCC, &cc->mncc_upqueue))) {
 		mncc = (struct gsm_mncc *)msg->data;
 		if (ms->mncc_entity.mncc_recv)
 			ms->mncc_entity.mncc_recv(ms, mncc->msg_type, mncc);
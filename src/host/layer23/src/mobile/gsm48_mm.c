@@ -719,7 +719,7 @@ int gsm48_mmxx_upmsg(struct osmocom_ms *ms, struct msgb *msg)
 {
 	struct gsm48_mmlayer *mm = &ms->mmlayer;
 
-	msgb_enqueue(&mm->mmxx_upqueue, msg);
+	ms_enqueue(ms, MS_Q_MMXX, &mm->mmxx_upqueue, msg);
 
 	return 0;
 }
@@ -729,7 +729,7 @@ int gsm48_mmr_downmsg(struct osmocom_ms *ms, struct msgb *msg)
 {
 	struct gsm48_mmlayer *mm = &ms->mmlayer;
 
-	msgb_enqueue(&mm->mmr_downqueue, msg);
+	ms_enqueue(ms, MS_Q_MMR, &mm->mmr_downqueue, msg);
 
 	return 0;
 }
@@ -739,7 +739,7 @@ int gsm48_mmevent_msg(struct osmocom_ms *ms, struct msgb *msg)
 {
 	struct gsm48_mmlayer *mm = &ms->mmlayer;
 
-	msgb_enqueue(&mm->event_queue, msg);
+	ms_enqueue(ms, MS_Q_MMEVENT, &mm->event_queue, msg);
 
 	return 0;
 }
@@ -752,7 +752,7 @@ int gsm48_mmxx_dequeue(struct osmocom_ms *ms)
 	struct gsm48_mmxx_hdr *mmh;
 	int work = 0;
 
-	while ((msg = msgb_dequeue(&mm->mmxx_upqueue))) {
+	while ((msg = ms_dequeue(ms, MS_Q_MMXX, &mm->mmxx_upqueue))) {
 		mmh = (struct gsm48_mmxx_hdr *) msg->data;
 		switch (mmh->msg_type & GSM48_MMXX_MASK) {
 		case GSM48_MMCC_CLASS:
@@ -779,7 +779,7 @@ int gsm48_mmr_dequeue(struct osmocom_ms *ms)
 	struct msgb *msg;
 	int work = 0;
 
-	while ((msg = msgb_dequeue(&mm->mmr_downqueue))) {
+	while ((msg = ms_dequeue(ms, MS_Q_MMR, &mm->mmr_downqueue))) {
 		gsm48_rcv_mmr(ms, msg);
 		msgb_free(msg);
 		work = 1; /* work done */
@@ -795,7 +795,7 @@ int gsm48_rr_dequeue(struct osmocom_ms *ms)
 	struct msgb *msg;
 	int work = 0;
 
-	while ((msg = msgb_dequeue(&mm->rr_upqueue))) {
+	while ((msg = ms_dequeue(ms, MS_Q_RR, &mm->rr_upqueue))) {
 		/* msg is freed there */
 		gsm48_rcv_rr(ms, msg);
 		work = 1; /* work done */
@@ -812,7 +812,7 @@ int gsm48_mmevent_dequeue(struct osmocom_ms *ms)
 	struct msgb *msg;
 	int work = 0;
 
-	while ((msg = msgb_dequeue(&mm->event_queue))) {
+	while ((msg = ms_dequeue(ms, MS_Q_MMEVENT, &mm->event_queue))) {
 		mme = (struct gsm48_mm_event *) msg->data;
 		gsm48_mm_ev(ms, mme->msg_type, msg);
 		msgb_free(msg);
@@ -1350,13 +1350,13 @@ int gsm48_mm_exit(struct osmocom_ms *ms)
 			struct gsm48_mm_conn, list);
 		mm_conn_free(conn);
 	}
-	while ((msg = msgb_dequeue(&mm->rr_upqueue)))
+	while ((msg = ms_dequeue(ms, MS_Q_RR, &mm->rr_upqueue)))
 		msgb_free(msg);
-	while ((msg = msgb_dequeue(&mm->mmxx_upqueue)))
+	while ((msg = ms_dequeue(ms, MS_Q_MMXX, &mm->mmxx_upqueue)))
 		msgb_free(msg);
-	while ((msg = msgb_dequeue(&mm->mmr_downqueue)))
+	while ((msg = ms_dequeue(ms, MS_Q_MMR, &mm->mmr_downqueue)))
 		msgb_free(msg);
-	while ((msg = msgb_dequeue(&mm->event_queue)))
+	while ((msg = ms_dequeue(ms, MS_Q_MMEVENT, &mm->event_queue)))
 		msgb_free(msg);
 
 	/* stop timers */
@@ -1425,7 +1425,7 @@ struct gsm48_mm_conn *mm_conn_by_ref(struct gsm48_mmlayer *mm,
 static struct gsm48_mm_conn* mm_conn_new(struct gsm48_mmlayer *mm,
 	int proto, uint8_t transaction_id, uint8_t sapi, uint32_t ref)
 {
-	struct gsm48_mm_conn *conn = talloc_zero(l23_ctx, struct gsm48_mm_conn);
+	struct gsm48_mm_conn *conn = talloc_zero(mm->ms, struct gsm48_mm_conn);
 
 	if (!conn)
 		return NULL;
@@ -2086,19 +2086,18 @@ static int gsm48_mm_sysinfo(struct osmocom_ms *ms, struct msgb *msg)
 	if (s->t3212 && s->t3212 != mm->t3212_value) {
 		if (osmo_timer_pending(&mm->t3212)) {
 			int t;
-			struct timeval current_time;
+			struct timeval rest;
 
-			/* get rest time */
-			gettimeofday(&current_time, NULL);
-			t = mm->t3212.timeout.tv_sec - current_time.tv_sec;
-			if (t < 0)
+			/* get rest time, the timer may run on either clock */
+			if (osmo_timer_remaining(&mm->t3212, NULL, &rest) < 0)
 				t = 0;
+			else
+				t = rest.tv_sec;
 			LOGP(DMM, LOGL_INFO, "New T3212 while timer is running "
 				"(value %d rest %d)\n", s->t3212, t);
 
 			/* rest time modulo given value */
-			mm->t3212.timeout.tv_sec = current_time.tv_sec
-				+ (t % s->t3212);
+			osmo_timer_schedule(&mm->t3212, t % s->t3212, 0);
 		} else {
 			uint32_t rand = random();
 
@@ -78,6 +78,7 @@
 #include <osmocom/bb/common/logging.h>
 #include <osmocom/bb/common/networks.h>
 #include <osmocom/bb/common/l1ctl.h>
+#include <osmocom/bb/common/si_cache.h>
 #include <osmocom/bb/mobile/vty.h>
 
 #include <l1ctl_proto.h>
@@ -508,7 +509,7 @@ int gsm48_rr_upmsg(struct osmocom_ms *ms, struct msgb *msg)
 {
 	struct gsm48_mmlayer *mm = &ms->mmlayer;
 
-	msgb_enqueue(&mm->rr_upqueue, msg);
+	ms_enqueue(ms, MS_Q_RR, &mm->rr_upqueue, msg);
 
 	return 0;
 }
@@ -546,7 +547,7 @@ static int rcv_rsl(struct msgb *msg, struct lapdm_entity *le, void *l3ctx)
 	struct osmocom_ms *ms = l3ctx;
 	struct gsm48_rrlayer *rr = &ms->rrlayer;
 
-	msgb_enqueue(&rr->rsl_upqueue, msg);
+	ms_enqueue(ms, MS_Q_RSL, &rr->rsl_upqueue, msg);
 
 	return 0;
 }
@@ -558,7 +559,7 @@ int gsm48_rsl_dequeue(struct osmocom_ms *ms)
 	struct msgb *msg;
 	int work = 0;
 
-	while ((msg = msgb_dequeue(&rr->rsl_upqueue))) {
+	while ((msg = ms_dequeue(ms, MS_Q_RSL, &rr->rsl_upqueue))) {
 		/* msg is freed there */
 		gsm48_rcv_rsl(ms, msg);
 		work = 1; /* work done */
@@ -1719,6 +1720,7 @@ static int gsm48_new_sysinfo(struct osmocom_ms *ms, uint8_t type)
 	 && s->si5
 	 && (!s->nb_ext_ind_si5 || s->si5bis)) {
 		struct gsm48_rr_meas *rrmeas = &ms->rrlayer.meas;
+		struct gsm_freq_map rep;
 		int n = 0, i, refer_pcs;
 
 		LOGP(DRR, LOGL_NOTICE, "Complete set of SI5* for BA(%d)\n",
@@ -1727,22 +1729,22 @@ static int gsm48_new_sysinfo(struct osmocom_ms *ms, uint8_t type)
 		refer_pcs = gsm_refer_pcs(cs->arfcn, s);
 
 		/* collect channels from freq list (1..1023,0) */
-		for (i = 1; i <= 1024; i++) {
-			if ((s->freq[i & 1023].mask & FREQ_TYPE_REP)) {
-				if (n == 32) {
-					LOGP(DRR, LOGL_NOTICE, "SI5* report "
-						"exceeds 32 BCCHs\n");
-					break;
-				}
-				if (refer_pcs && i >= 512 && i <= 810)
-					rrmeas->nc_arfcn[n] = i | ARFCN_PCS;
-				else
-					rrmeas->nc_arfcn[n] = i & 1023;
-				rrmeas->nc_rxlev_dbm[n] = -128;
-				LOGP(DRR, LOGL_NOTICE, "SI5* report arfcn %s\n",
-					gsm_print_arfcn(rrmeas->nc_arfcn[n]));
-				n++;
+		freq_map_zero(&rep);
+		gsm48_sysinfo_rep(s, &rep);
+		freq_map_for_each_list(i, &rep) {
+			if (n == 32) {
+				LOGP(DRR, LOGL_NOTICE, "SI5* report "
+					"exceeds 32 BCCHs\n");
+				break;
 			}
+			if (refer_pcs && i >= 512 && i <= 810)
+				rrmeas->nc_arfcn[n] = i | ARFCN_PCS;
+			else
+				rrmeas->nc_arfcn[n] = i & 1023;
+			rrmeas->nc_rxlev_dbm[n] = -128;
+			LOGP(DRR, LOGL_NOTICE, "SI5* report arfcn %s\n",
+				gsm_print_arfcn(rrmeas->nc_arfcn[n]));
+			n++;
 		}
 		rrmeas->nc_num = n;
 	}
@@ -3060,8 +3062,6 @@ static int gsm48_rr_render_ma(struct osmocom_ms *ms, struct gsm48_rr_cd *cd,
 
 	/* decode mobile allocation */
 	if (cd->mob_alloc_lv[0]) {
-		struct gsm_sysinfo_freq *freq = s->freq;
-
 		LOGP(DRR, LOGL_INFO, "decoding mobile allocation\n");
 
 		if (cd->cell_desc_lv[0]) {
@@ -3071,11 +3071,11 @@ static int gsm48_rr_render_ma(struct osmocom_ms *ms, struct gsm48_rr_cd *cd,
 					"has invalid lenght\n");
 				return GSM48_RR_CAUSE_ABNORMAL_UNSPEC;
 			}
-			gsm48_decode_freq_list(freq, cd->cell_desc_lv + 1, 16,
-				0xce, FREQ_TYPE_SERV);
+			si_cache_replace(&s->freq_serv, SI_CACHE_SI1,
+				cd->cell_desc_lv + 1);
 		}
 
-		gsm48_decode_mobile_alloc(freq, cd->mob_alloc_lv + 1,
+		gsm48_decode_mobile_alloc(s, cd->mob_alloc_lv + 1,
 			cd->mob_alloc_lv[0], ma, ma_len, 0);
 		if (*ma_len < 1) {
 			LOGP(DRR, LOGL_NOTICE, "mobile allocation with no "
@@ -3086,30 +3086,28 @@ static int gsm48_rr_render_ma(struct osmocom_ms *ms, struct gsm48_rr_cd *cd,
 	} else
 	/* decode frequency list */
 	if (cd->freq_list_lv[0]) {
-		struct gsm_sysinfo_freq f[1024];
+		struct gsm_freq_map f;
 		int j = 0;
 
 		LOGP(DRR, LOGL_INFO, "decoding frequency list\n");
 
 		/* get bitmap */
-		if (gsm48_decode_freq_list(f, cd->freq_list_lv + 1,
-			cd->freq_list_lv[0], 0xce, FREQ_TYPE_SERV)) {
+		if (gsm48_decode_freq_map(&f, cd->freq_list_lv + 1,
+			cd->freq_list_lv[0], 0xce)) {
 			LOGP(DRR, LOGL_NOTICE, "frequency list invalid\n");
 			return GSM48_RR_CAUSE_ABNORMAL_UNSPEC;
 		}
 
 		/* collect channels from bitmap (1..1023,0) */
-		for (i = 1; i <= 1024; i++) {
-			if ((f[i & 1023].mask & FREQ_TYPE_SERV)) {
-				LOGP(DRR, LOGL_INFO, "Listed ARFCN #%d: %s\n",
-					j, gsm_print_arfcn((i & 1023) | pcs));
-				if (j == 64) {
-					LOGP(DRR, LOGL_NOTICE, "frequency list "
-						"exceeds 64 entries!\n");
-					return GSM48_RR_CAUSE_ABNORMAL_UNSPEC;
-				}
-				ma[j++] = i & 1023;
+		freq_map_for_each_list(i, &f) {
+			LOGP(DRR, LOGL_INFO, "Listed ARFCN #%d: %s\n",
+				j, gsm_print_arfcn(i | pcs));
+			if (j == 64) {
+				LOGP(DRR, LOGL_NOTICE, "frequency list "
+					"exceeds 64 entries!\n");
+				return GSM48_RR_CAUSE_ABNORMAL_UNSPEC;
 			}
+			ma[j++] = i;
 		}
 		*ma_len = j;
 	} else
@@ -5528,7 +5526,7 @@ int gsm48_rr_exit(struct osmocom_ms *ms)
 	LOGP(DRR, LOGL_INFO, "exit Radio Ressource process\n");
 
 	/* flush queues */
-	while ((msg = msgb_dequeue(&rr->rsl_upqueue)))
+	while ((msg = ms_dequeue(ms, MS_Q_RSL, &rr->rsl_upqueue)))
 		msgb_free(msg);
 	while ((msg = msgb_dequeue(&rr->downqueue)))
 		msgb_free(msg);
@@ -31,6 +31,7 @@
 #include <osmocom/core/gsmtap.h>
 #include <osmocom/core/signal.h>
 #include <osmocom/core/application.h>
+#include <osmocom/core/timer.h>
 
 #include <arpa/inet.h>
 
@@ -59,6 +60,7 @@ int debug_set = 0;
 char *config_dir = NULL;
 int use_mncc_sock = 0;
 int daemonize = 0;
+int use_timer_wheel = 0;
 
 int mncc_recv_socket(struct osmocom_ms *ms, int msg_type, void *arg);
 
@@ -100,6 +102,8 @@ static void print_help()
 	printf("  -c --config-file filename The config file to use.\n");
 	printf("  -m --mncc-sock	Disable built-in MNCC handler and "
 		"offer socket\n");
+	printf("  -w --timer-wheel	Use timing wheel on the monotonic "
+		"clock for timers\n");
 }
 
 static void handle_options(int argc, char **argv)
@@ -115,10 +119,11 @@ static void handle_options(int argc, char **argv)
 			{"daemonize", 0, 0, 'D'},
 			{"config-file", 1, 0, 'c'},
 			{"mncc-sock", 0, 0, 'm'},
+			{"timer-wheel", 0, 0, 'w'},
 			{0, 0, 0, 0},
 		};
 
-		c = getopt_long(argc, argv, "hi:u:c:v:d:Dm",
+		c = getopt_long(argc, argv, "hi:u:c:v:d:Dmw",
 				long_options, &option_index);
 		if (c == -1)
 			break;
@@ -151,6 +156,9 @@ static void handle_options(int argc, char **argv)
 		case 'm':
 			use_mncc_sock = 1;
 			break;
+		case 'w':
+			use_timer_wheel = 1;
+			break;
 		default:
 			break;
 		}
@@ -221,9 +229,15 @@ int main(int argc, char **argv)
 
 	l23_ctx = talloc_named_const(NULL, 1, "layer2 context");
 	msgb_set_talloc_ctx(l23_ctx);
+	/* recycle the msgbs of the L1CTL and L2/L3 message flow */
+	msgb_pool_init(256, 0);
 
 	handle_options(argc, argv);
 
+	/* must be selected before any timer is started */
+	if (use_timer_wheel)
+		osmo_timers_set_mode(OSMO_TIMER_MODE_WHEEL);
+
 	if (!debug_set)
 		log_parse_category_mask(stderr_target, debug_default);
 	log_set_log_level(stderr_target, LOGL_DEBUG);
@@ -81,6 +81,7 @@ int gsm_settings_init(struct osmocom_ms *ms)
 	set->ch_cap = sup->ch_cap;
 	set->min_rxlev_dbm = sup->min_rxlev_dbm;
 	set->dsc_max = sup->dsc_max;
+	set->pm_ranges = sup->pm_ranges;
 
 	if (sup->half_v1 || sup->half_v3)
 		set->half = 1;
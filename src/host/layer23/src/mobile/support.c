@@ -93,6 +93,7 @@ void gsm_support_init(struct osmocom_ms *ms)
 	sup->sync_to = 6; /* how long to wait sync (0.9 s) */
 	sup->scan_to = 4; /* how long to wait for all sysinfos (>=4 s) */
 	sup->dsc_max = 90; /* the specs defines 90 */
+	sup->pm_ranges = 1; /* the firmware holds a single range */
 
 	/* codec */
 	sup->full_v1 = 1;
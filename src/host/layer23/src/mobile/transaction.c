@@ -29,9 +29,13 @@
 #include <osmocom/bb/common/logging.h>
 #include <osmocom/bb/mobile/mncc.h>
 #include <osmocom/bb/mobile/transaction.h>
+#include <osmocom/bb/mobile/gsm411_sms.h>
 
 extern void *l23_ctx;
 
+/* a transaction and a received SMS fit, including talloc headers */
+#define TRANS_POOL_SIZE	(sizeof(struct gsm_trans) + sizeof(struct gsm_sms) + 256)
+
 void _gsm48_cc_trans_free(struct gsm_trans *trans);
 void _gsm480_ss_trans_free(struct gsm_trans *trans);
 void _gsm411_sms_trans_free(struct gsm_trans *trans);
@@ -66,10 +70,18 @@ struct gsm_trans *trans_alloc(struct osmocom_ms *ms,
 			      uint32_t callref)
 {
 	struct gsm_trans *trans;
+	void *pool;
 
-	trans = talloc_zero(l23_ctx, struct gsm_trans);
-	if (!trans)
+	pool = talloc_pool(ms, TRANS_POOL_SIZE);
+	if (!pool)
+		return NULL;
+	talloc_set_name_const(pool, "trans_pool");
+	trans = talloc_zero(pool, struct gsm_trans);
+	if (!trans) {
+		talloc_free(pool);
 		return NULL;
+	}
+	trans->pool = pool;
 
 	DEBUGP(DCC, "ms %s allocates transaction (proto %d trans_id %d "
 		"callref %x mem %p)\n", ms->name, protocol, trans_id, callref,
@@ -105,7 +117,7 @@ void trans_free(struct gsm_trans *trans)
 
 	llist_del(&trans->entry);
 
-	talloc_free(trans);
+	talloc_free(trans->pool);
 }
 
 /* allocate an unused transaction ID
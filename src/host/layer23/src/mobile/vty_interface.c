@@ -34,6 +34,7 @@
 #include <osmocom/bb/common/osmocom_data.h>
 #include <osmocom/bb/common/networks.h>
 #include <osmocom/bb/common/gps.h>
+#include <osmocom/bb/common/si_cache.h>
 #include <osmocom/bb/mobile/mncc.h>
 #include <osmocom/bb/mobile/transaction.h>
 #include <osmocom/bb/mobile/vty.h>
@@ -230,6 +231,18 @@ static void gsm_ms_dump(struct osmocom_ms *ms, struct vty *vty)
 			gsm_get_mnc(ms->cellsel.sel_mcc, ms->cellsel.sel_mnc),
 			VTY_NEWLINE);
 	}
+	if (ms->cellsel.scan_stats.scans)
+		vty_out(vty, "  power scans: %lu (%lu ranges), last took %lu ms%s",
+			ms->cellsel.scan_stats.scans,
+			ms->cellsel.scan_stats.ranges,
+			ms->cellsel.scan_stats.last_scan_ms, VTY_NEWLINE);
+	if (ms->cellsel.scan_stats.camps)
+		vty_out(vty, "  time to camp: last %lu ms, min %lu ms, avg %lu ms, "
+			"max %lu ms%s", ms->cellsel.scan_stats.last_camp_ms,
+			ms->cellsel.scan_stats.min_camp_ms,
+			ms->cellsel.scan_stats.sum_camp_ms
+				/ ms->cellsel.scan_stats.camps,
+			ms->cellsel.scan_stats.max_camp_ms, VTY_NEWLINE);
 	vty_out(vty, "  radio ressource layer state: %s%s",
 		gsm48_rr_state_names[ms->rrlayer.state], VTY_NEWLINE);
 	vty_out(vty, "  mobility management layer state: %s",
@@ -270,6 +283,99 @@ DEFUN(show_ms, show_ms_cmd, "show ms [MS_NAME]",
 	return CMD_SUCCESS;
 }
 
+static void gsm_ms_pool_dump(struct osmocom_ms *ms, struct vty *vty)
+{
+	struct gsm_trans *trans;
+	size_t trans_num = 0, trans_used = 0, trans_size = 0;
+	long outside;
+
+	vty_out(vty, "MS '%s' memory pool: %lu of %lu bytes used, %lu objects%s",
+		ms->name, (unsigned long) talloc_pool_used(ms->pool),
+		(unsigned long) talloc_pool_size(ms->pool),
+		(unsigned long) talloc_pool_objects(ms->pool), VTY_NEWLINE);
+
+	/* transactions have pools of their own, allocated outside */
+	outside = (long) talloc_total_blocks(ms->pool) - 1 -
+		  (long) talloc_pool_objects(ms->pool);
+	llist_for_each_entry(trans, &ms->trans_list, entry) {
+		trans_num++;
+		trans_used += talloc_pool_used(trans->pool);
+		trans_size += talloc_pool_size(trans->pool);
+		outside -= (long) talloc_total_blocks(trans->pool);
+	}
+	/* pool objects stolen by another parent are not in the MS tree */
+	if (outside < 0)
+		outside = 0;
+	vty_out(vty, "  allocations outside the pool: %ld%s",
+		outside, VTY_NEWLINE);
+	vty_out(vty, "  transaction pools: %lu, %lu of %lu bytes used%s",
+		(unsigned long) trans_num, (unsigned long) trans_used,
+		(unsigned long) trans_size, VTY_NEWLINE);
+}
+
+DEFUN(show_ms_pool, show_ms_pool_cmd, "show memory-pool [MS_NAME]",
+	SHOW_STR "Display occupancy of the memory pool of MS\n"
+	"Name of MS (see \"show ms\")")
+{
+	struct osmocom_ms *ms;
+
+	if (argc) {
+		ms = get_ms(argv[0], vty);
+		if (!ms)
+			return CMD_WARNING;
+		gsm_ms_pool_dump(ms, vty);
+	} else {
+		llist_for_each_entry(ms, &ms_list, entity)
+			gsm_ms_pool_dump(ms, vty);
+	}
+
+	return CMD_SUCCESS;
+}
+
+static void gsm_ms_queues_dump(struct osmocom_ms *ms, struct vty *vty)
+{
+	struct ms_queue_stats *stats;
+	int q;
+
+	vty_out(vty, "MS '%s' message queues:%s", ms->name, VTY_NEWLINE);
+	for (q = 0; q < _NUM_MS_Q; q++) {
+		stats = &ms->sched.stats[q];
+		vty_out(vty, "  %-15s depth %u (max %u), %lu enqueued, "
+			"%lu services, wait avg %lu us max %lu us%s",
+			ms_queue_names[q], stats->depth, stats->max_depth,
+			stats->enqueued, stats->services,
+			stats->services ? stats->wait_us / stats->services : 0,
+			stats->max_wait_us, VTY_NEWLINE);
+	}
+}
+
+DEFUN(show_ms_queues, show_ms_queues_cmd, "show queues [MS_NAME]",
+	SHOW_STR "Display message queue statistics of MS\n"
+	"Name of MS (see \"show ms\")")
+{
+	struct osmocom_ms *ms;
+
+	if (argc) {
+		ms = get_ms(argv[0], vty);
+		if (!ms)
+			return CMD_WARNING;
+		gsm_ms_queues_dump(ms, vty);
+	} else {
+		llist_for_each_entry(ms, &ms_list, entity)
+			gsm_ms_queues_dump(ms, vty);
+	}
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_si_cache, show_si_cache_cmd, "show sysinfo-cache",
+	SHOW_STR "Display frequency lists shared by all MS")
+{
+	si_cache_dump(print_vty, vty);
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(show_support, show_support_cmd, "show support [MS_NAME]",
 	SHOW_STR "Display information about MS support\n"
 	"Name of MS (see \"show ms\")")
@@ -1491,6 +1597,8 @@ static void config_write_ms(struct vty *vty, struct osmocom_ms *ms)
 			VTY_NEWLINE);
 	if (!hide_default || sup->dsc_max != set->dsc_max)
 		vty_out(vty, "  dsc-max %d%s", set->dsc_max, VTY_NEWLINE);
+	if (!hide_default || sup->pm_ranges != set->pm_ranges)
+		vty_out(vty, "  pm-ranges %d%s", set->pm_ranges, VTY_NEWLINE);
 	if (!hide_default || set->skip_max_per_band)
 		vty_out(vty, "  %sskip-max-per-band%s",
 			(set->skip_max_per_band) ? "" : "no ", VTY_NEWLINE);
@@ -2106,7 +2214,7 @@ DEFUN(cfg_abbrev, cfg_ms_abbrev_cmd, "abbrev ABBREVIATION NUMBER [NAME]",
 	if (vty_check_number(vty, argv[1]))
 		return CMD_WARNING;
 
-	abbrev = talloc_zero(l23_ctx, struct gsm_settings_abbrev);
+	abbrev = talloc_zero(ms, struct gsm_settings_abbrev);
 	if (!abbrev) {
 		vty_out(vty, "No Memory!%s", VTY_NEWLINE);
 		return CMD_WARNING;
@@ -2472,6 +2580,19 @@ DEFUN(cfg_ms_sup_dsc_max, cfg_ms_sup_dsc_max_cmd, "dsc-max <90-500>",
 	return CMD_SUCCESS;
 }
 
+DEFUN(cfg_ms_sup_pm_ranges, cfg_ms_sup_pm_ranges_cmd, "pm-ranges <1-8>",
+	"Set how many ranges of a power scan are requested from layer 1 at "
+	"once. The firmware layer 1 holds only one range.\n"
+	"Number of ranges (default is 1)")
+{
+	struct osmocom_ms *ms = vty->index;
+	struct gsm_settings *set = &ms->settings;
+
+	set->pm_ranges = atoi(argv[0]);
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(cfg_ms_sup_skip_max_per_band, cfg_ms_sup_skip_max_per_band_cmd,
 	"skip-max-per-band",
 	"Scan all frequencies per band, not only a maximum number")
@@ -2837,6 +2958,9 @@ int ms_vty_init(void)
 	install_element_ve(&show_ms_cmd);
 	install_element_ve(&show_subscr_cmd);
 	install_element_ve(&show_support_cmd);
+	install_element_ve(&show_ms_pool_cmd);
+	install_element_ve(&show_ms_queues_cmd);
+	install_element_ve(&show_si_cache_cmd);
 	install_element_ve(&show_cell_cmd);
 	install_element_ve(&show_cell_si_cmd);
 	install_element_ve(&show_nbcells_cmd);
@@ -2985,6 +3109,7 @@ int ms_vty_init(void)
 	install_element(SUPPORT_NODE, &cfg_ms_sup_no_half_v3_cmd);
 	install_element(SUPPORT_NODE, &cfg_ms_sup_min_rxlev_cmd);
 	install_element(SUPPORT_NODE, &cfg_ms_sup_dsc_max_cmd);
+	install_element(SUPPORT_NODE, &cfg_ms_sup_pm_ranges_cmd);
 	install_element(SUPPORT_NODE, &cfg_ms_sup_skip_max_per_band_cmd);
 	install_element(SUPPORT_NODE, &cfg_ms_sup_no_skip_max_per_band_cmd);
 	install_node(&testsim_node, config_write_dummy);
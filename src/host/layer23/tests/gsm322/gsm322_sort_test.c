@@ -0,0 +1,321 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* Sorted PLMN list of gsm322_sort_list(), which takes the networks from
+ * the index of cells per PLMN, against the algorithm it replaced, which
+ * walked all 1024+299 frequencies of the cell selection list.  Every
+ * frequency has a cell, spread over about 200 PLMNs, as in a dense area
+ * after a scan of all bands.  Reports the time per sort of both. */
+
+/* the static functions of the cell selection */
+#include "../../src/mobile/gsm322.c"
+
+/* of main.c and app_mobile.c, not linked */
+struct llist_head ms_list;
+char *config_dir = NULL;
+struct gsmtap_inst *gsmtap_inst = NULL;
+
+struct osmocom_ms *mobile_new(char *name)
+{
+	return NULL;
+}
+
+int mobile_init(struct osmocom_ms *ms)
+{
+	return 0;
+}
+
+int mobile_exit(struct osmocom_ms *ms, int force)
+{
+	return 0;
+}
+
+int mobile_delete(struct osmocom_ms *ms, int force)
+{
+	return 0;
+}
+
+/* gsm322_sort_list() before the index, without logging */
+static int ref_sort_list(struct osmocom_ms *ms, struct llist_head *sorted)
+{
+	struct gsm322_cellsel *cs = &ms->cellsel;
+	struct gsm_subscriber *subscr = &ms->subscr;
+	struct gsm_sub_plmn_list *sim_entry;
+	struct gsm_sub_plmn_na *na_entry;
+	struct llist_head temp_list;
+	struct gsm322_plmn_list *temp, *found;
+	struct llist_head *lh, *lh2;
+	int i, entries, move;
+	uint8_t search = 0;
+
+	llist_for_each_safe(lh, lh2, sorted) {
+		llist_del(lh);
+		talloc_free(lh);
+	}
+
+	INIT_LLIST_HEAD(&temp_list);
+	for (i = 0; i <= 1023+299; i++) {
+		if (!(cs->list[i].flags & GSM322_CS_FLAG_TEMP_AA)
+		 || !cs->list[i].sysinfo)
+			continue;
+
+		found = NULL;
+		llist_for_each_entry(temp, &temp_list, entry) {
+			if (temp->mcc == cs->list[i].sysinfo->mcc
+			 && temp->mnc == cs->list[i].sysinfo->mnc) {
+				found = temp;
+				break;
+			}
+		}
+		if (found) {
+			if (cs->list[i].rxlev > found->rxlev)
+				found->rxlev = cs->list[i].rxlev;
+		} else {
+			temp = talloc_zero(ms, struct gsm322_plmn_list);
+			if (!temp)
+				return -ENOMEM;
+			temp->mcc = cs->list[i].sysinfo->mcc;
+			temp->mnc = cs->list[i].sysinfo->mnc;
+			temp->rxlev = cs->list[i].rxlev;
+			llist_add_tail(&temp->entry, &temp_list);
+		}
+	}
+
+	if (subscr->sim_valid) {
+		found = NULL;
+		llist_for_each_entry(temp, &temp_list, entry) {
+			if (gsm_match_mnc(temp->mcc, temp->mnc, subscr->imsi)) {
+				found = temp;
+				break;
+			}
+		}
+		if (found) {
+			llist_del(&found->entry);
+			llist_add_tail(&found->entry, sorted);
+		}
+	}
+
+	llist_for_each_entry(sim_entry, &subscr->plmn_list, entry) {
+		found = NULL;
+		llist_for_each_entry(temp, &temp_list, entry) {
+			if (temp->mcc == sim_entry->mcc
+			 && temp->mnc == sim_entry->mnc) {
+				found = temp;
+				break;
+			}
+		}
+		if (found) {
+			llist_del(&found->entry);
+			llist_add_tail(&found->entry, sorted);
+		}
+	}
+
+	entries = 0;
+	llist_for_each_entry(temp, &temp_list, entry) {
+		if (rxlev2dbm(temp->rxlev) > -85)
+			entries++;
+	}
+	while(entries) {
+		move = random() % entries;
+		i = 0;
+		llist_for_each_entry(temp, &temp_list, entry) {
+			if (rxlev2dbm(temp->rxlev) > -85) {
+				if (i == move) {
+					llist_del(&temp->entry);
+					llist_add_tail(&temp->entry, sorted);
+					break;
+				}
+				i++;
+			}
+		}
+		entries--;
+	}
+
+	while(1) {
+		found = NULL;
+		llist_for_each_entry(temp, &temp_list, entry) {
+			if (!found
+			 || temp->rxlev > search) {
+				search = temp->rxlev;
+				found = temp;
+			}
+		}
+		if (!found)
+			break;
+		llist_del(&found->entry);
+		llist_add_tail(&found->entry, sorted);
+	}
+
+	llist_for_each_entry(temp, sorted, entry) {
+		llist_for_each_entry(na_entry, &subscr->plmn_na, entry) {
+			if (temp->mcc == na_entry->mcc
+			 && temp->mnc == na_entry->mnc) {
+				temp->cause = na_entry->cause;
+				break;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static struct osmocom_ms *setup(void)
+{
+	struct osmocom_ms *ms = talloc_zero(NULL, struct osmocom_ms);
+	struct gsm322_cellsel *cs = &ms->cellsel;
+	struct gsm_subscriber *subscr = &ms->subscr;
+	struct gsm_sub_plmn_list *sim_entry;
+	struct gsm_sub_plmn_na *na_entry;
+	struct gsm48_sysinfo *s;
+	int i, n;
+
+	ms->cellsel.ms = ms;
+	ms->plmn.ms = ms;
+	INIT_LLIST_HEAD(&ms->plmn.sorted_plmn);
+	INIT_LLIST_HEAD(&cs->plmn_index);
+	INIT_LLIST_HEAD(&subscr->plmn_list);
+	INIT_LLIST_HEAD(&subscr->plmn_na);
+
+	/* home PLMN 202-01, two networks in the PLMN selector list, one of
+	 * them not found, and a forbidden one */
+	subscr->sim_valid = 1;
+	strcpy(subscr->imsi, "202010123456789");
+	sim_entry = talloc_zero(ms, struct gsm_sub_plmn_list);
+	sim_entry->mcc = 0x215;
+	sim_entry->mnc = 0x03f;
+	llist_add_tail(&sim_entry->entry, &subscr->plmn_list);
+	sim_entry = talloc_zero(ms, struct gsm_sub_plmn_list);
+	sim_entry->mcc = 0x999;
+	sim_entry->mnc = 0x99f;
+	llist_add_tail(&sim_entry->entry, &subscr->plmn_list);
+	na_entry = talloc_zero(ms, struct gsm_sub_plmn_na);
+	na_entry->mcc = 0x230;
+	na_entry->mnc = 0x02f;
+	na_entry->cause = 11;
+	llist_add_tail(&na_entry->entry, &subscr->plmn_na);
+
+	for (i = 0; i <= 1023+299; i++) {
+		s = talloc_zero(ms, struct gsm48_sysinfo);
+		n = (i * 7) % 41;
+		s->mcc = 0x200 + ((n / 10) << 4) + n % 10;
+		s->mnc = (((i * 13) % 5) << 4) | 0x00f;
+		cs->list[i].sysinfo = s;
+		/* a third of the networks above -85 dBm */
+		if (n % 3)
+			cs->list[i].rxlev = (i * 31) % 26;
+		else
+			cs->list[i].rxlev = (i * 31) % 64;
+		cs->list[i].flags = GSM322_CS_FLAG_TEMP_AA;
+		gsm322_plmn_index_add(cs, i);
+	}
+
+	/* behind the index: a cell changes its PLMN, one loses its sysinfo,
+	 * one is not available */
+	cs->list[5].sysinfo->mcc = 0x299;
+	talloc_free(cs->list[6].sysinfo);
+	cs->list[6].sysinfo = NULL;
+	cs->list[7].flags = 0;
+
+	return ms;
+}
+
+/* equal, except for the order of the PLMNs above -85 dBm, which is random */
+static int compare(struct llist_head *a, struct llist_head *b)
+{
+	struct gsm322_plmn_list *pa, *pb, *t;
+	int na = 0, nb = 0, found;
+
+	llist_for_each_entry(pa, a, entry)
+		na++;
+	llist_for_each_entry(pb, b, entry)
+		nb++;
+	if (na != nb) {
+		printf("%d PLMNs, expected %d\n", na, nb);
+		return -1;
+	}
+
+	pb = llist_entry(b->next, struct gsm322_plmn_list, entry);
+	llist_for_each_entry(pa, a, entry) {
+		found = 0;
+		llist_for_each_entry(t, b, entry) {
+			if (t->mcc == pa->mcc && t->mnc == pa->mnc
+			 && t->rxlev == pa->rxlev && t->cause == pa->cause)
+				found = 1;
+		}
+		if (!found) {
+			printf("mcc %s mnc %s not expected\n",
+				gsm_print_mcc(pa->mcc), gsm_print_mnc(pa->mnc));
+			return -1;
+		}
+		if ((pa->mcc != pb->mcc || pa->mnc != pb->mnc)
+		 && (rxlev2dbm(pa->rxlev) <= -85
+		  || rxlev2dbm(pb->rxlev) <= -85)) {
+			printf("mcc %s mnc %s out of order\n",
+				gsm_print_mcc(pa->mcc), gsm_print_mnc(pa->mnc));
+			return -1;
+		}
+		pb = llist_entry(pb->entry.next, struct gsm322_plmn_list,
+			entry);
+	}
+
+	return 0;
+}
+
+static double cpu_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	int loops = argc > 1 ? atoi(argv[1]) : 1000;
+	struct osmocom_ms *ms;
+	struct llist_head ref;
+	struct gsm322_plmn_list *temp;
+	double t0, t_ref, t_index;
+	int i, n = 0, rc;
+
+	log_init(&log_info, NULL);
+	ms = setup();
+	INIT_LLIST_HEAD(&ref);
+
+	t0 = cpu_time();
+	for (i = 0; i < loops; i++)
+		ref_sort_list(ms, &ref);
+	t_ref = cpu_time() - t0;
+
+	t0 = cpu_time();
+	for (i = 0; i < loops; i++)
+		gsm322_sort_list(ms);
+	t_index = cpu_time() - t0;
+
+	rc = compare(&ms->plmn.sorted_plmn, &ref);
+	llist_for_each_entry(temp, &ms->plmn.sorted_plmn, entry)
+		n++;
+	printf("%d PLMNs: %s, list walk %6.1f us, index %6.1f us (%.1fx)\n",
+	       n, rc ? "differ" : "same", t_ref / loops * 1e6,
+	       t_index / loops * 1e6, t_ref / t_index);
+
+	talloc_free(ms);
+	return rc ? 1 : 0;
+}
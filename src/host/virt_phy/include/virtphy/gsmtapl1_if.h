@@ -6,7 +6,18 @@
 #include <virtphy/l1ctl_sock.h>
 #include <virtphy/virt_l1_model.h>
 
+/* counters of the downlink demux */
+struct gsmtapl1_demux_stats {
+	unsigned long frames;		/* downlink messages received */
+	unsigned long delivered;	/* messages offered to a MS instance */
+	unsigned long skipped;		/* MS instances not visited thanks to the index */
+};
+
 void gsmtapl1_init(struct l1_model_ms *model);
+void gsmtapl1_demux_add(struct l1_model_ms *ms);
+void gsmtapl1_demux_del(struct l1_model_ms *ms);
+void gsmtapl1_demux_update(struct l1_model_ms *ms);
+void gsmtapl1_demux_get_stats(struct gsmtapl1_demux_stats *stats);
 void gsmtapl1_rx_from_virt_um_inst_cb(struct virt_um_inst *vui,
                                       struct msgb *msg);
 void gsmtapl1_tx_to_virt_um_inst(struct l1_model_ms *ms, uint32_t fn, uint8_t tn, struct msgb *msg);
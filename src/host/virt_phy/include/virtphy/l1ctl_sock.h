@@ -3,6 +3,7 @@
 #include <osmocom/core/msgb.h>
 #include <osmocom/core/linuxlist.h>
 #include <osmocom/core/select.h>
+#include <osmocom/core/frame_reader.h>
 
 #define L1CTL_SOCK_PATH	"/tmp/osmocom_l2"
 
@@ -15,6 +16,8 @@ struct l1ctl_sock_client {
 	struct l1ctl_sock_inst *l1ctl_sock;
 	/* Osmo FD for the client socket */
 	struct osmo_fd ofd;
+	/* reassembles the messages read from ofd */
+	struct osmo_frame_reader rx;
 	/* private data, can be set in accept_cb */
 	void *priv;
 };
@@ -10,6 +10,9 @@
 #define L1S_NUM_NEIGH_CELL	6
 #define A5_KEY_LEN		8
 
+/* horizon of the TDMA scheduler in frames, has to divide GSM_MAX_FN */
+#define VIRT_L1_SCHED_HORIZON	512
+
 enum ms_state {
 	MS_STATE_IDLE_SEARCHING = 0,
 	MS_STATE_IDLE_SYNCING,
@@ -48,7 +51,12 @@ struct l1_state_ms {
 	struct gsm_time current_time; /* GSM time used internally for scheduling */
 	struct {
 		uint32_t last_exec_fn;
-		struct llist_head mframe_items;
+		/* items by fn modulo horizon, see virt_l1_sched.c */
+		struct llist_head ring[VIRT_L1_SCHED_HORIZON];
+		/* items beyond the horizon, ordered by fn */
+		struct llist_head overflow;
+		/* pool of unused items */
+		struct llist_head free_items;
 	} sched;
 
 	enum ms_state state;
@@ -95,9 +103,7 @@ struct l1_state_ms {
 		uint32_t timeout_us;
 		uint32_t timeout_s;
 		struct {
-			int16_t arfcn_sig_lev_dbm[1024];
 			uint8_t arfcn_sig_lev_red_dbm[1024];
-			struct osmo_timer_list arfcn_sig_lev_timers[1024];
 		} meas;
 	} pm;
 };
@@ -110,6 +116,10 @@ struct l1_model_ms {
 	struct virt_um_inst *vui;
 	/* actual per-MS state */
 	struct l1_state_ms state;
+	/* downlink demux index, see gsmtapl1_if.c */
+	struct {
+		struct llist_head list;	/* entry in the arfcn bucket or syncing list */
+	} demux;
 };
 
 
@@ -6,6 +6,7 @@
  * number of BTSs transmitting to GSMTAP, and transmits UL messages via
  * GSMTAP to those BTSs in another multicast group */
 
+#include <stdio.h>
 #include <osmocom/core/select.h>
 #include <osmocom/core/msgb.h>
 #include "osmo_mcast_sock.h"
@@ -19,10 +20,41 @@
 #define DEFAULT_MS_MCAST_GROUP	"239.193.23.1"
 #define DEFAULT_BTS_MCAST_GROUP	"239.193.23.2"
 
+/* number of messages received / transmitted with one syscall at most */
+#define VIRT_UM_RX_BATCH	32
+#define VIRT_UM_TX_BATCH	32
+
+/* number of buckets of the batch size histograms: 1, 2-3, 4-7, ... 32 */
+#define VIRT_UM_BATCH_HIST	6
+
+struct virt_um_stats {
+	unsigned long rx_calls;		/* receive syscalls returning data */
+	unsigned long rx_msgs;		/* messages received */
+	unsigned long rx_batch[VIRT_UM_BATCH_HIST];
+	unsigned long tx_calls;		/* transmit syscalls */
+	unsigned long tx_msgs;		/* messages transmitted */
+	unsigned long tx_errors;	/* messages dropped on transmit errors */
+	unsigned long tx_batch[VIRT_UM_BATCH_HIST];
+};
+
 struct virt_um_inst {
 	void *priv;
 	struct mcast_bidir_sock *mcast_sock;
+	/* called for each received message, msg is owned by the virt um
+	 * and only valid during the call. NULL msg on socket errors */
 	void (*recv_cb)(struct virt_um_inst *vui, struct msgb *msg);
+
+	/* preallocated receive buffers */
+	struct msgb *rx_msgs[VIRT_UM_RX_BATCH];
+	/* messages queued for transmission */
+	struct msgb *tx_msgs[VIRT_UM_TX_BATCH];
+	unsigned int tx_count;
+	/* set while dispatching received messages, transmission is
+	 * then deferred to the end of the TDMA frame */
+	int in_rx;
+	uint32_t rx_fn;
+
+	struct virt_um_stats stats;
 };
 
 struct virt_um_inst *virt_um_init(
@@ -33,3 +65,5 @@ struct virt_um_inst *virt_um_init(
 void virt_um_destroy(struct virt_um_inst *vui);
 
 int virt_um_write_msg(struct virt_um_inst *vui, struct msgb *msg);
+int virt_um_flush(struct virt_um_inst *vui);
+void virt_um_dump_stats(struct virt_um_inst *vui, FILE *out);
@@ -57,6 +57,7 @@ void gsmtapl1_tx_to_virt_um_inst(struct l1_model_ms *ms, uint32_t fn, uint8_t tn
 	struct l1ctl_info_ul *ul;
 	struct gsmtap_hdr *gh;
 	struct msgb *outmsg;	/* msg to send with gsmtap header prepended */
+	const char *lname;
 	uint16_t arfcn = ms->state.serving_cell.arfcn;	/* arfcn of the cell we currently camp on */
 	uint8_t signal_dbm = 63;	/* signal strength */
 	uint8_t snr = 63;	/* signal noise ratio, 63 is best */
@@ -90,14 +91,14 @@ void gsmtapl1_tx_to_virt_um_inst(struct l1_model_ms *ms, uint32_t fn, uint8_t tn
 	if (outmsg) {
 		outmsg->l1h = msgb_data(outmsg);
 		gh = msgb_l1(outmsg);
+		/* outmsg may be freed by the write, name the lchan before */
+		lname = pseudo_lchan_name(gh->arfcn, gh->timeslot, gh->sub_slot, gh->sub_type);
 		if (virt_um_write_msg(ms->vui, outmsg) == -1) {
 			LOGPMS(DVIRPHY, LOGL_ERROR, ms, "%s Tx go GSMTAP failed: %s\n",
-				pseudo_lchan_name(gh->arfcn, gh->timeslot, gh->sub_slot, gh->sub_type),
-				strerror(errno));
+				lname, strerror(errno));
 		} else {
 			DEBUGPMS(DVIRPHY, ms, "%s: Tx to GSMTAP: %s\n",
-				pseudo_lchan_name(gh->arfcn, gh->timeslot, gh->sub_slot, gh->sub_type),
-				osmo_hexdump(data, data_len));
+				lname, osmo_hexdump(data, data_len));
 		}
 	} else
 		LOGPMS(DVIRPHY, LOGL_ERROR, ms, "GSMTAP msg could not be created!\n");
@@ -114,7 +115,87 @@ extern void prim_fbsb_sync(struct l1_model_ms *ms, struct msgb *msg);
 /**
  * @see virt_prim_pm.c
  */
-extern uint16_t prim_pm_set_sig_strength(struct l1_model_ms *ms, uint16_t arfcn, int16_t sig_lev);
+extern void prim_pm_rx_dl(uint16_t arfcn);
+extern int16_t prim_pm_get_sig_strength(struct l1_model_ms *ms, uint16_t arfcn);
+
+/*
+ * Downlink demux index.
+ *
+ * Instead of offering each received message to every connected MS, the MS
+ * instances are kept in per-arfcn buckets according to their state:
+ *  - searching: in no list, the power measurement is taken from the shared
+ *    per-arfcn rx times (see virt_prim_pm.c)
+ *  - syncing: in the syncing list, as the fbsb sync needs to see messages
+ *    from other arfcns to detect a failed sync
+ *  - camping, dedicated, tbf: in the bucket of the serving arfcn, as the
+ *    scheduler of each MS runs off the downlink frames of its serving cell.
+ *    Timeslot, subslot and TFI/USF are filtered per MS in l1ctl_from_virt_um()
+ *
+ * gsmtapl1_demux_update() has to be called whenever the state, the serving
+ * arfcn or the fbsb arfcn of an MS changes.
+ */
+#define DEMUX_BUCKETS	1024
+
+static struct {
+	int initialized;
+	unsigned int num_ms;
+	struct llist_head syncing;
+	struct llist_head arfcn[DEMUX_BUCKETS];
+	struct gsmtapl1_demux_stats stats;
+} demux;
+
+static void demux_init(void)
+{
+	int i;
+
+	if (demux.initialized)
+		return;
+
+	INIT_LLIST_HEAD(&demux.syncing);
+	for (i = 0; i < DEMUX_BUCKETS; i++)
+		INIT_LLIST_HEAD(&demux.arfcn[i]);
+	demux.initialized = 1;
+}
+
+/* register a new MS instance with the downlink demux */
+void gsmtapl1_demux_add(struct l1_model_ms *ms)
+{
+	demux_init();
+	INIT_LLIST_HEAD(&ms->demux.list);
+	demux.num_ms++;
+	gsmtapl1_demux_update(ms);
+}
+
+/* remove a MS instance from the downlink demux */
+void gsmtapl1_demux_del(struct l1_model_ms *ms)
+{
+	llist_del_init(&ms->demux.list);
+	demux.num_ms--;
+}
+
+/* move a MS instance to the list matching its current state */
+void gsmtapl1_demux_update(struct l1_model_ms *ms)
+{
+	llist_del_init(&ms->demux.list);
+
+	switch (ms->state.state) {
+	case MS_STATE_IDLE_SEARCHING:
+		break;
+	case MS_STATE_IDLE_SYNCING:
+		llist_add_tail(&ms->demux.list, &demux.syncing);
+		break;
+	default:
+		llist_add_tail(&ms->demux.list,
+			       &demux.arfcn[ms->state.serving_cell.arfcn % DEMUX_BUCKETS]);
+		break;
+	}
+}
+
+/* get the delivered / skipped counters of the downlink demux */
+void gsmtapl1_demux_get_stats(struct gsmtapl1_demux_stats *stats)
+{
+	*stats = demux.stats;
+}
 
 /* determine if a received Downlink RLC/MAC block matches the current MS configuration */
 static bool gprs_dl_block_matches_ms(struct l1_model_ms *ms, struct msgb *msg, uint8_t timeslot)
@@ -193,7 +274,7 @@ static void l1ctl_from_virt_um(struct l1ctl_sock_client *lsc, struct msgb *msg,
 				uint8_t snr_db)
 {
 	struct l1_model_ms *ms = lsc->priv;
-	uint8_t signal_dbm = dbm2rxlev(prim_pm_set_sig_strength(ms, arfcn & GSMTAP_ARFCN_MASK, MAX_SIG_LEV_DBM));	/* Power measurement with each received massage */
+	uint8_t signal_dbm;
 	uint8_t usf;
 
 	gsm_fn2gsmtime(&ms->state.downlink_time, fn);
@@ -215,6 +296,8 @@ static void l1ctl_from_virt_um(struct l1ctl_sock_client *lsc, struct msgb *msg,
 	virt_l1_sched_sync_time(ms, ms->state.downlink_time, 0);
 	virt_l1_sched_execute(ms, fn);
 
+	signal_dbm = dbm2rxlev(prim_pm_get_sig_strength(ms, arfcn & GSMTAP_ARFCN_MASK));
+
 	/* switch case with removed ACCH flag */
 	switch (gsmtap_chantype & ~GSMTAP_CHANNEL_ACCH & 0xff) {
 	case GSMTAP_CHANNEL_TCH_H:
@@ -275,12 +358,14 @@ static void l1ctl_from_virt_um(struct l1ctl_sock_client *lsc, struct msgb *msg,
  * - uplink messages
  * - messages with a wrong arfcn
  * - if in MS_STATE_IDLE_SEARCHING
+ *
+ * Only the MS instances found in the demux index for the arfcn of the message are visited.
  */
 void gsmtapl1_rx_from_virt_um_inst_cb(struct virt_um_inst *vui,
 				      struct msgb *msg)
 {
-	struct l1ctl_sock_inst *lsi = vui->priv;
-	struct l1ctl_sock_client *lsc;
+	struct l1_model_ms *ms, *ms2;
+	unsigned int visited = 0;
 
 	if (!msg)
 		return;
@@ -311,15 +396,26 @@ void gsmtapl1_rx_from_virt_um_inst_cb(struct virt_um_inst *vui,
 	/* generally ignore all uplink messages received */
 	if (arfcn & GSMTAP_ARFCN_F_UPLINK) {
 		LOGP(DVIRPHY, LOGL_NOTICE, "Ignoring unexpected uplink message in downlink!\n");
-		goto freemsg;
+		return;
 	}
 
-	/* dispatch the incoming DL message from GSMTAP to each of the registered L1CTL instances */
-	llist_for_each_entry(lsc, &lsi->clients, list) {
-		l1ctl_from_virt_um(lsc, msg, fn, arfcn, timeslot, subslot, gsmtap_chantype,
+	demux_init();
+	prim_pm_rx_dl(arfcn & GSMTAP_ARFCN_MASK);
+	demux.stats.frames++;
+
+	/* dispatch the incoming DL message from GSMTAP to the interested L1CTL instances.
+	 * Camped MS first, so a MS that gets synced by this message is not offered it twice */
+	llist_for_each_entry_safe(ms, ms2, &demux.arfcn[arfcn % DEMUX_BUCKETS], demux.list) {
+		l1ctl_from_virt_um(ms->lsc, msg, fn, arfcn, timeslot, subslot, gsmtap_chantype,
+				   chan_nr, link_id, snr);
+		visited++;
+	}
+	llist_for_each_entry_safe(ms, ms2, &demux.syncing, demux.list) {
+		l1ctl_from_virt_um(ms->lsc, msg, fn, arfcn, timeslot, subslot, gsmtap_chantype,
 				   chan_nr, link_id, snr);
+		visited++;
 	}
 
-freemsg:
-	talloc_free(msg);
+	demux.stats.delivered += visited;
+	demux.stats.skipped += demux.num_ms - visited;
 }
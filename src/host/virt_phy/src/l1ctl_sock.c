@@ -51,10 +51,20 @@ static void l1ctl_client_destroy(struct l1ctl_sock_client *lsc)
 	if (lsi->close_cb)
 		lsi->close_cb(lsc);
 	osmo_fd_close(&lsc->ofd);
+	osmo_frame_reader_reset(&lsc->rx);
 	llist_del(&lsc->list);
 	talloc_free(lsc);
 }
 
+/* called by the frame reader for each complete message */
+static int l1ctl_sock_frame_cb(struct osmo_frame_reader *fr, struct msgb *msg)
+{
+	struct l1ctl_sock_client *lsc = fr->data;
+
+	lsc->l1ctl_sock->recv_cb(lsc, msg);
+	return 0;
+}
+
 /**
  * @brief L1CTL socket file descriptor callback function.
  *
@@ -66,41 +76,20 @@ static void l1ctl_client_destroy(struct l1ctl_sock_client *lsc)
 static int l1ctl_sock_data_cb(struct osmo_fd *ofd, unsigned int what)
 {
 	struct l1ctl_sock_client *lsc = ofd->data;
-	struct l1ctl_hdr *l1h;
-	struct msgb *msg;
-	uint16_t len;
 	int rc;
 
 	/* Check if request is really read request */
 	if (!(what & BSC_FD_READ))
 		return 0;
 
-	msg = msgb_alloc(L1CTL_SOCK_MSGB_SIZE, "L1CTL sock rx");
-
-	/* read length of the message first and convert to host byte order */
-	rc = read(ofd->fd, &len, sizeof(len));
-	if (rc < sizeof(len))
-		goto err_close;
-
-	/* convert to host byte order */
-	len = ntohs(len);
-	if (len <= 0 || len > L1CTL_SOCK_MSGB_SIZE)
-		goto err_close;
-
-	rc = read(ofd->fd, msgb_data(msg), len);
-	if (rc == len) {
-		msgb_put(msg, rc);
-		l1h = (void *) msgb_data(msg);
-		msg->l1h = (void *) l1h;
-		lsc->l1ctl_sock->recv_cb(lsc, msg);
-		return 0;
+	/* all complete messages, a partial one waits for the rest */
+	rc = osmo_frame_reader_read(&lsc->rx, ofd->fd);
+	if (rc < 0) {
+		LOGP(DL1C, LOGL_ERROR, "Failed to receive msg from l2. Connection will be closed.\n");
+		l1ctl_client_destroy(lsc);
 	}
-err_close:
-	LOGP(DL1C, LOGL_ERROR, "Failed to receive msg from l2. Connection will be closed.\n");
-	l1ctl_client_destroy(lsc);
 
 	return 0;
-
 }
 
 /* called for the master (listening) socket of the instance, allocates a new client */
@@ -129,6 +118,10 @@ static int l1ctl_sock_accept_cb(struct osmo_fd *ofd, unsigned int what)
 	lsc->ofd.when = BSC_FD_READ;
 	lsc->ofd.cb = l1ctl_sock_data_cb;
 	lsc->ofd.data = lsc;
+	osmo_frame_reader_init(&lsc->rx, L1CTL_SOCK_MSGB_SIZE, 0,
+			       "L1CTL sock rx");
+	lsc->rx.frame_cb = l1ctl_sock_frame_cb;
+	lsc->rx.data = lsc;
 	if (lsi->accept_cb) {
 		rc = lsi->accept_cb(lsc);
 		if (rc < 0) {
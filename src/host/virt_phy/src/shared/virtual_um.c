@@ -19,6 +19,11 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#define _GNU_SOURCE
 #include <osmocom/core/select.h>
 #include <osmocom/core/utils.h>
 #include <osmocom/core/socket.h>
@@ -27,8 +32,71 @@
 #include <osmocom/core/talloc.h>
 #include <virtphy/osmo_mcast_sock.h>
 #include <virtphy/virtual_um.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
+static void count_batch(unsigned long *hist, unsigned int n)
+{
+	unsigned int i = 0;
+
+	while (n > 1 && i < VIRT_UM_BATCH_HIST - 1) {
+		n >>= 1;
+		i++;
+	}
+	hist[i]++;
+}
+
+/* frame number of a received GSMTAP message, to detect the end of a TDMA frame */
+static uint32_t msg_fn(struct msgb *msg)
+{
+	struct gsmtap_hdr *gh = (struct gsmtap_hdr *) msgb_data(msg);
+
+	if (msgb_length(msg) < sizeof(*gh))
+		return 0;
+	return ntohl(gh->frame_number);
+}
+
+/* receive up to VIRT_UM_RX_BATCH messages into the preallocated buffers,
+ * returns the number of messages received or a negative value on error */
+static int virt_um_rx_batch(struct virt_um_inst *vui)
+{
+	int fd = vui->mcast_sock->rx_ofd.fd;
+	int rc;
+#ifdef HAVE_RECVMMSG
+	struct mmsghdr mmsg[VIRT_UM_RX_BATCH];
+	struct iovec iov[VIRT_UM_RX_BATCH];
+	int i;
+
+	memset(mmsg, 0, sizeof(mmsg));
+	for (i = 0; i < VIRT_UM_RX_BATCH; i++) {
+		msgb_reset(vui->rx_msgs[i]);
+		iov[i].iov_base = msgb_data(vui->rx_msgs[i]);
+		iov[i].iov_len = msgb_tailroom(vui->rx_msgs[i]);
+		mmsg[i].msg_hdr.msg_iov = &iov[i];
+		mmsg[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	rc = recvmmsg(fd, mmsg, VIRT_UM_RX_BATCH, MSG_DONTWAIT, NULL);
+	if (rc <= 0)
+		return rc;
+
+	for (i = 0; i < rc; i++)
+		msgb_put(vui->rx_msgs[i], mmsg[i].msg_len);
+#else
+	msgb_reset(vui->rx_msgs[0]);
+	rc = recv(fd, msgb_data(vui->rx_msgs[0]), msgb_tailroom(vui->rx_msgs[0]), 0);
+	if (rc < 0)
+		return rc;
+	msgb_put(vui->rx_msgs[0], rc);
+	rc = 1;
+#endif
+	return rc;
+}
+
 /**
  * Virtual UM interface file descriptor callback.
  * Should be called by select.c when the fd is ready for reading.
@@ -36,24 +104,14 @@
 static int virt_um_fd_cb(struct osmo_fd *ofd, unsigned int what)
 {
 	struct virt_um_inst *vui = ofd->data;
+	int i, rc;
 
 	// check if the read flag is set
 	if (what & BSC_FD_READ) {
-		// allocate message buffer of specified size
-		struct msgb *msg = msgb_alloc(VIRT_UM_MSGB_SIZE,
-		                "Virtual UM Rx");
-		int rc;
-
-		// read message from fd in message buffer
-		rc = mcast_bidir_sock_rx(vui->mcast_sock, msgb_data(msg),
-		                msgb_tailroom(msg));
-		// rc is number of bytes actually read
-		if (rc > 0) {
-			msgb_put(msg, rc);
-			msg->l1h = msgb_data(msg);
-			// call the l1 callback function for a received msg
-			vui->recv_cb(vui, msg);
-		} else {
+		rc = virt_um_rx_batch(vui);
+		if (rc < 0 && (errno == EAGAIN || errno == EINTR))
+			return 0;
+		if (rc <= 0) {
 			// TODO: this kind of error handling might be a bit harsh
 			vui->recv_cb(vui, NULL);
 			// Unregister fd from select loop
@@ -61,7 +119,36 @@ static int virt_um_fd_cb(struct osmo_fd *ofd, unsigned int what)
 			close(ofd->fd);
 			ofd->fd = -1;
 			ofd->when = 0;
+			return 0;
+		}
+
+		vui->stats.rx_calls++;
+		vui->stats.rx_msgs += rc;
+		count_batch(vui->stats.rx_batch, rc);
+
+		vui->in_rx = 1;
+		for (i = 0; i < rc; i++) {
+			struct msgb *msg = vui->rx_msgs[i];
+			uint32_t fn;
+
+			/* skip empty datagrams */
+			if (!msgb_length(msg))
+				continue;
+
+			/* uplink generated for the previous frame goes out
+			 * before this frame is handled */
+			fn = msg_fn(msg);
+			if (fn != vui->rx_fn) {
+				virt_um_flush(vui);
+				vui->rx_fn = fn;
+			}
+
+			msg->l1h = msgb_data(msg);
+			// call the l1 callback function for a received msg
+			vui->recv_cb(vui, msg);
 		}
+		vui->in_rx = 0;
+		virt_um_flush(vui);
 	}
 
 	return 0;
@@ -73,6 +160,14 @@ struct virt_um_inst *virt_um_init(
                 void (*recv_cb)(struct virt_um_inst *vui, struct msgb *msg))
 {
 	struct virt_um_inst *vui = talloc_zero(ctx, struct virt_um_inst);
+	int i;
+
+	for (i = 0; i < VIRT_UM_RX_BATCH; i++) {
+		vui->rx_msgs[i] = msgb_alloc(VIRT_UM_MSGB_SIZE, "Virtual UM Rx");
+		if (!vui->rx_msgs[i])
+			goto err_free;
+	}
+
 	vui->mcast_sock = mcast_bidir_sock_setup(ctx, tx_mcast_group,
 	                tx_mcast_port, rx_mcast_group, rx_mcast_port, 1,
 	                virt_um_fd_cb, vui);
@@ -80,24 +175,118 @@ struct virt_um_inst *virt_um_init(
 
 	return vui;
 
+err_free:
+	while (i--)
+		msgb_free(vui->rx_msgs[i]);
+	talloc_free(vui);
+	return NULL;
 }
 
 void virt_um_destroy(struct virt_um_inst *vui)
 {
+	int i;
+
+	virt_um_flush(vui);
+	for (i = 0; i < VIRT_UM_RX_BATCH; i++)
+		msgb_free(vui->rx_msgs[i]);
 	mcast_bidir_sock_close(vui->mcast_sock);
 	talloc_free(vui);
 }
 
 /**
- * Write msg to to multicast socket and free msg afterwards
+ * Transmit all queued messages and free them.
+ * Returns 0 on success, -1 (with errno set) if messages had to be dropped.
+ */
+int virt_um_flush(struct virt_um_inst *vui)
+{
+	unsigned int i, sent = 0;
+	int rc = 0;
+#ifdef HAVE_SENDMMSG
+	struct mmsghdr mmsg[VIRT_UM_TX_BATCH];
+	struct iovec iov[VIRT_UM_TX_BATCH];
+#endif
+
+	if (!vui->tx_count)
+		return 0;
+
+#ifdef HAVE_SENDMMSG
+	memset(mmsg, 0, sizeof(mmsg));
+	for (i = 0; i < vui->tx_count; i++) {
+		iov[i].iov_base = msgb_data(vui->tx_msgs[i]);
+		iov[i].iov_len = msgb_length(vui->tx_msgs[i]);
+		mmsg[i].msg_hdr.msg_iov = &iov[i];
+		mmsg[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	/* the socket is connected to the multicast group */
+	while (sent < vui->tx_count) {
+		rc = sendmmsg(vui->mcast_sock->tx_ofd.fd, &mmsg[sent], vui->tx_count - sent, 0);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		vui->stats.tx_calls++;
+		count_batch(vui->stats.tx_batch, rc);
+		sent += rc;
+	}
+#else
+	for (i = 0; i < vui->tx_count; i++) {
+		rc = mcast_bidir_sock_tx(vui->mcast_sock, msgb_data(vui->tx_msgs[i]),
+		                msgb_length(vui->tx_msgs[i]));
+		if (rc < 0)
+			break;
+		vui->stats.tx_calls++;
+		count_batch(vui->stats.tx_batch, 1);
+		sent++;
+	}
+#endif
+
+	vui->stats.tx_msgs += sent;
+	vui->stats.tx_errors += vui->tx_count - sent;
+
+	for (i = 0; i < vui->tx_count; i++)
+		msgb_free(vui->tx_msgs[i]);
+	vui->tx_count = 0;
+
+	return rc < 0 ? -1 : 0;
+}
+
+/**
+ * Write msg to to multicast socket and free msg afterwards.
+ *
+ * While received messages are dispatched, the msg is queued and sent in one
+ * batch with the other messages of the same TDMA frame. Errors on deferred
+ * transmission are only counted in the stats.
  */
 int virt_um_write_msg(struct virt_um_inst *vui, struct msgb *msg)
 {
-	int rc;
+	int len = msgb_length(msg);
 
-	rc = mcast_bidir_sock_tx(vui->mcast_sock, msgb_data(msg),
-	                msgb_length(msg));
-	msgb_free(msg);
+	vui->tx_msgs[vui->tx_count++] = msg;
 
-	return rc;
+	if (!vui->in_rx || vui->tx_count == VIRT_UM_TX_BATCH) {
+		if (virt_um_flush(vui) < 0)
+			return -1;
+	}
+
+	return len;
+}
+
+/**
+ * Print the I/O counters and batch size histograms.
+ */
+void virt_um_dump_stats(struct virt_um_inst *vui, FILE *out)
+{
+	const struct virt_um_stats *st = &vui->stats;
+	int i;
+
+	fprintf(out, "virt um rx: %lu msgs in %lu calls, batches:", st->rx_msgs, st->rx_calls);
+	for (i = 0; i < VIRT_UM_BATCH_HIST; i++)
+		fprintf(out, " %lu", st->rx_batch[i]);
+	fprintf(out, "\nvirt um tx: %lu msgs in %lu calls, %lu dropped, batches:",
+		st->tx_msgs, st->tx_calls, st->tx_errors);
+	for (i = 0; i < VIRT_UM_BATCH_HIST; i++)
+		fprintf(out, " %lu", st->tx_batch[i]);
+	fprintf(out, "\n");
 }
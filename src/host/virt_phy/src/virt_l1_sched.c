@@ -0,0 +1,249 @@
+/* (C) 2016 by Sebastian Stumpf <sebastian.stumpf87@googlemail.com>
+ * (C) 2017 by Harald Welte <laforge@gnumonks.org>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* TDMA scheduler of the virtual layer 1
+ *
+ * Uplink items are kept in a ring of VIRT_L1_SCHED_HORIZON frames, indexed
+ * by FN modulo the horizon, each slot holding its items ordered by timeslot.
+ * As the horizon divides GSM_MAX_FN, the slot of a FN does not change across
+ * a hyperframe wrap. Items scheduled further in the future than the horizon
+ * (only RACH with large offsets) wait in an ordered overflow list. Items are
+ * taken from a per-MS free list, so scheduling does not allocate in the steady
+ * state.
+ */
+
+#include <virtphy/virt_l1_sched.h>
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/gsm/gsm_utils.h>
+#include <virtphy/virt_l1_model.h>
+#include <virtphy/logging.h>
+#include <time.h>
+#include <talloc.h>
+
+/* distance of fn b after fn a, in [0, GSM_MAX_FN) */
+static inline uint32_t fn_dist(uint32_t a, uint32_t b)
+{
+	return (b + GSM_MAX_FN - a) % GSM_MAX_FN;
+}
+
+/* does fn 'fn' lie in the past (or the present) of 'ref' ? */
+static inline int fn_passed(uint32_t ref, uint32_t fn)
+{
+	uint32_t d = fn_dist(ref, fn);
+	return d == 0 || d > GSM_MAX_FN / 2;
+}
+
+static struct virt_l1_sched_item *item_alloc(struct l1_model_ms *ms)
+{
+	struct virt_l1_sched_item *si;
+
+	if (llist_empty(&ms->state.sched.free_items))
+		return talloc_zero(ms, struct virt_l1_sched_item);
+
+	si = llist_entry(ms->state.sched.free_items.next, struct virt_l1_sched_item, entry);
+	llist_del(&si->entry);
+	return si;
+}
+
+static void item_release(struct l1_model_ms *ms, struct virt_l1_sched_item *si)
+{
+	si->msg = NULL;
+	llist_add(&si->entry, &ms->state.sched.free_items);
+}
+
+/* insert into a ring slot, keeping the slot ordered by timeslot */
+static void slot_insert(struct llist_head *slot, struct virt_l1_sched_item *si)
+{
+	struct llist_head *pos = slot->prev;
+
+	while (pos != slot && llist_entry(pos, struct virt_l1_sched_item, entry)->ts > si->ts)
+		pos = pos->prev;
+	llist_add(&si->entry, pos);
+}
+
+/* place an item relative to the last executed frame */
+static void item_place(struct l1_model_ms *ms, struct virt_l1_sched_item *si)
+{
+	struct l1_state_ms *l1s = &ms->state;
+	uint32_t last = l1s->sched.last_exec_fn;
+	uint32_t d, slot_fn = si->fn;
+	struct virt_l1_sched_item *pos;
+
+	if (fn_passed(last, si->fn)) {
+		/* too late, send it with the next frame */
+		slot_fn = (last + 1) % GSM_MAX_FN;
+	} else if ((d = fn_dist(last, si->fn)) > VIRT_L1_SCHED_HORIZON) {
+		/* beyond the horizon, keep the overflow list ordered */
+		llist_for_each_entry(pos, &l1s->sched.overflow, entry) {
+			if (fn_dist(last, pos->fn) > d)
+				break;
+		}
+		llist_add_tail(&si->entry, &pos->entry);
+		return;
+	}
+
+	slot_insert(&l1s->sched.ring[slot_fn % VIRT_L1_SCHED_HORIZON], si);
+}
+
+static void slot_execute(struct l1_model_ms *ms, struct llist_head *slot)
+{
+	struct virt_l1_sched_item *si, *si2;
+	LLIST_HEAD(items);
+
+	/* detach first, handlers may schedule new items */
+	llist_splice_init(slot, &items);
+
+	llist_for_each_entry_safe(si, si2, &items, entry) {
+		llist_del(&si->entry);
+		si->handler_cb(ms, si->fn, si->ts, si->msg);
+		item_release(ms, si);
+	}
+}
+
+/**
+ * @brief Initialize the scheduler of a MS instance
+ */
+void virt_l1_sched_init(struct l1_model_ms *ms)
+{
+	struct l1_state_ms *l1s = &ms->state;
+	int i;
+
+	for (i = 0; i < VIRT_L1_SCHED_HORIZON; i++)
+		INIT_LLIST_HEAD(&l1s->sched.ring[i]);
+	INIT_LLIST_HEAD(&l1s->sched.overflow);
+	INIT_LLIST_HEAD(&l1s->sched.free_items);
+}
+
+/**
+ * @brief Start scheduler thread based on current gsm time from model
+ */
+static int virt_l1_sched_start(struct l1_model_ms *ms, struct gsm_time time)
+{
+	virt_l1_sched_sync_time(ms, time, 1);
+	ms->state.sched.last_exec_fn = time.fn;
+	return 0;
+}
+
+/**
+ * @brief Clear scheduler queue and completely restart scheduler.
+ */
+int virt_l1_sched_restart(struct l1_model_ms *ms, struct gsm_time time)
+{
+	virt_l1_sched_stop(ms);
+	return virt_l1_sched_start(ms, time);
+}
+
+/**
+ * @brief Sync scheduler with given time.
+ */
+void virt_l1_sched_sync_time(struct l1_model_ms *ms, struct gsm_time time, uint8_t hard_reset)
+{
+	ms->state.current_time = time;
+}
+
+static void drop_list(struct l1_model_ms *ms, struct llist_head *list)
+{
+	struct virt_l1_sched_item *si, *si2;
+
+	llist_for_each_entry_safe(si, si2, list, entry) {
+		llist_del(&si->entry);
+		talloc_free(si->msg);
+		item_release(ms, si);
+	}
+}
+
+/**
+ * @brief Stop the scheduler thread and cleanup the queued items
+ */
+void virt_l1_sched_stop(struct l1_model_ms *ms)
+{
+	struct l1_state_ms *l1s = &ms->state;
+	int i;
+
+	for (i = 0; i < VIRT_L1_SCHED_HORIZON; i++)
+		drop_list(ms, &l1s->sched.ring[i]);
+	drop_list(ms, &l1s->sched.overflow);
+}
+
+/**
+ * @brief Handle all pending scheduled items up to the current frame number.
+ *
+ * Frames skipped since the last call are caught up on in TDMA order. On a
+ * jump of more than the horizon (or backwards, e.g. after a resync without
+ * restart), everything pending is executed.
+ */
+void virt_l1_sched_execute(struct l1_model_ms *ms, uint32_t fn)
+{
+	struct l1_state_ms *l1s = &ms->state;
+	uint32_t last = l1s->sched.last_exec_fn;
+	uint32_t d, i;
+	struct virt_l1_sched_item *si, *si2;
+
+	fn %= GSM_MAX_FN;
+	d = fn_dist(last, fn);
+	if (d == 0)
+		return;
+	if (d > VIRT_L1_SCHED_HORIZON)
+		d = VIRT_L1_SCHED_HORIZON;
+
+	for (i = 1; i <= d; i++) {
+		/* advance first, so that items the handlers schedule for this
+		 * or an already executed frame go with the next one */
+		l1s->sched.last_exec_fn = (last + i) % GSM_MAX_FN;
+		slot_execute(ms, &l1s->sched.ring[(last + i) % VIRT_L1_SCHED_HORIZON]);
+	}
+
+	l1s->sched.last_exec_fn = fn;
+
+	/* pull overflow items into the ring once they are within the horizon */
+	llist_for_each_entry_safe(si, si2, &l1s->sched.overflow, entry) {
+		if (fn_passed(fn, si->fn)) {
+			llist_del(&si->entry);
+			si->handler_cb(ms, si->fn, si->ts, si->msg);
+			item_release(ms, si);
+		} else if (fn_dist(fn, si->fn) <= VIRT_L1_SCHED_HORIZON) {
+			llist_del(&si->entry);
+			item_place(ms, si);
+		} else
+			break;
+	}
+}
+
+/**
+ * @brief Schedule a msg to the given framenumber and timeslot.
+ */
+void virt_l1_sched_schedule(struct l1_model_ms *ms, struct msgb *msg, uint32_t fn, uint8_t ts,
+                            virt_l1_sched_cb *handler_cb)
+{
+	struct virt_l1_sched_item *si = item_alloc(ms);
+
+	if (!si) {
+		LOGPMS(DL1C, LOGL_ERROR, ms, "Cannot allocate sched item, dropping msg\n");
+		talloc_free(msg);
+		return;
+	}
+
+	si->msg = msg;
+	si->handler_cb = handler_cb;
+	si->fn = fn % GSM_MAX_FN;
+	si->ts = ts;
+
+	item_place(ms, si);
+}
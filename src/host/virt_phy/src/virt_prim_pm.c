@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/time.h>
 
 #include <osmocom/gsm/gsm_utils.h>
 #include <osmocom/gsm/protocol/gsm_08_58.h>
@@ -35,35 +36,50 @@
 #include <virtphy/logging.h>
 #include <l1ctl_proto.h>
 
+/* time of the last downlink message per arfcn, shared by all MS instances
+ * as they all listen on the same virtual um */
+static struct timeval arfcn_last_rx[1024];
+
+/**
+ * @brief Note the reception of a downlink message on a given arfcn.
+ *
+ * Should be called once for each msg received on the virtual layer, independent
+ * of the number of MS instances.
+ *
+ * @param [in] arfcn the msg was received on.
+ */
+void prim_pm_rx_dl(uint16_t arfcn)
+{
+	gettimeofday(&arfcn_last_rx[arfcn % 1024], NULL);
+}
+
 /**
- * @brief Change the signal strength for a given arfcn.
+ * @brief Get the signal strength of a given arfcn as seen by a given MS.
  *
- * Should be called if a msg is received on the virtual layer. The configured signal level reduction is applied.
+ * The configured signal level reduction is applied. If no msg has been received
+ * on the arfcn within the configured timeout, the lowest signal level is returned.
  *
- * @param [in] arfcn to change sig str for.
- * @param [in] sig_lev the measured signal level value.
+ * @param [in] arfcn to get the sig str for.
  */
-uint16_t prim_pm_set_sig_strength(struct l1_model_ms *ms, uint16_t arfcn, int16_t sig_lev)
+int16_t prim_pm_get_sig_strength(struct l1_model_ms *ms, uint16_t arfcn)
 {
 	struct l1_state_ms *l1s = &ms->state;
+	struct timeval *last = &arfcn_last_rx[arfcn % 1024];
+	struct timeval now, timeout, expiry;
+
+	if (!timerisset(last))
+		return MIN_SIG_LEV_DBM;
 
 	if (l1s->pm.timeout_s > 0 || l1s->pm.timeout_us > 0) {
-		osmo_timer_schedule(&l1s->pm.meas.arfcn_sig_lev_timers[arfcn],
-				    l1s->pm.timeout_s, l1s->pm.timeout_us);
+		timeout.tv_sec = l1s->pm.timeout_s + l1s->pm.timeout_us / 1000000;
+		timeout.tv_usec = l1s->pm.timeout_us % 1000000;
+		timeradd(last, &timeout, &expiry);
+		gettimeofday(&now, NULL);
+		if (timercmp(&now, &expiry, >))
+			return MIN_SIG_LEV_DBM;
 	}
-	l1s->pm.meas.arfcn_sig_lev_dbm[arfcn] = sig_lev - l1s->pm.meas.arfcn_sig_lev_red_dbm[arfcn];
-	DEBUGPMS(DL1C, ms, "Power measurement set for arfcn %u. Set signal level to %d (== rxlev: %u).\n",
-		arfcn, l1s->pm.meas.arfcn_sig_lev_dbm[arfcn],
-		dbm2rxlev(l1s->pm.meas.arfcn_sig_lev_dbm[arfcn]));
-	return l1s->pm.meas.arfcn_sig_lev_dbm[arfcn];
-}
 
-void prim_pm_timer_cb(void *data)
-{
-	/* reset the signal level to bad value if no messages have been
-	 * received from that rfcn for a given time */
-	DEBUGP(DL1C, "Timeout occurred for arfcn, signal level reset to worst value.\n");
-	*((int16_t*)data) = MIN_SIG_LEV_DBM;
+	return MAX_SIG_LEV_DBM - l1s->pm.meas.arfcn_sig_lev_red_dbm[arfcn % 1024];
 }
 
 /**
@@ -81,7 +97,6 @@ void prim_pm_timer_cb(void *data)
  */
 void l1ctl_rx_pm_req(struct l1_model_ms *ms, struct msgb *msg)
 {
-	struct l1_state_ms *l1s = &ms->state;
 	struct l1ctl_hdr *l1h = (struct l1ctl_hdr *) msg->data;
 	struct l1ctl_pm_req *pm_req = (struct l1ctl_pm_req *) l1h->data;
 	struct msgb *resp_msg = l1ctl_msgb_alloc(L1CTL_PM_CONF);
@@ -100,8 +115,8 @@ void l1ctl_rx_pm_req(struct l1_model_ms *ms, struct msgb *msg)
 		pm_conf->band_arfcn = htons(arfcn_next);
 		/* set min and max to the value calculated for that
 		 * arfcn (IGNORE UPLINKK AND  PCS AND OTHER FLAGS) */
-		pm_conf->pm[0] = dbm2rxlev(l1s->pm.meas.arfcn_sig_lev_dbm[arfcn_next & ARFCN_NO_FLAGS_MASK]);
-		pm_conf->pm[1] = dbm2rxlev(l1s->pm.meas.arfcn_sig_lev_dbm[arfcn_next & ARFCN_NO_FLAGS_MASK]);
+		pm_conf->pm[0] = dbm2rxlev(prim_pm_get_sig_strength(ms, arfcn_next & ARFCN_NO_FLAGS_MASK));
+		pm_conf->pm[1] = pm_conf->pm[0];
 		if (arfcn_next == pm_req->range.band_arfcn_to) {
 			struct l1ctl_hdr *resp_l1h = msgb_l1(resp_msg);
 			resp_l1h->flags |= L1CTL_F_DONE;
@@ -127,23 +142,10 @@ void l1ctl_rx_pm_req(struct l1_model_ms *ms, struct msgb *msg)
  */
 void prim_pm_init(struct l1_model_ms *model)
 {
-	struct l1_state_ms *l1s = &model->state;
-	int i;
-
-	/* init the signal level of all arfcns with the lowest value possible */
-	memset(l1s->pm.meas.arfcn_sig_lev_dbm, MIN_SIG_LEV_DBM, sizeof (int16_t) * 1024);
-	/* init timers */
-	for (i = 0; i < 1024; ++i) {
-		l1s->pm.meas.arfcn_sig_lev_timers[i].cb = prim_pm_timer_cb;
-		l1s->pm.meas.arfcn_sig_lev_timers[i].data = &l1s->pm.meas.arfcn_sig_lev_dbm[i];
-	}
+	/* nothing to do, the signal levels are derived from the shared
+	 * per-arfcn rx times when requested */
 }
 
 void prim_pm_exit(struct l1_model_ms *model)
 {
-	struct l1_state_ms *l1s = &model->state;
-	int i;
-
-	for (i = 0; i < 1024; ++i)
-		osmo_timer_del(&l1s->pm.meas.arfcn_sig_lev_timers[i]);
 }
@@ -59,6 +59,7 @@ static char *log_mask = DEFAULT_LOG_MASK;
 static char *l1ctl_sock_path = L1CTL_SOCK_PATH;
 static char *arfcn_sig_lev_red_mask = NULL;
 static char *pm_timeout = NULL;
+static int use_epoll = 0;
 
 static void handle_options(int argc, char **argv)
 {
@@ -72,9 +73,10 @@ static void handle_options(int argc, char **argv)
 		        {"l1ctl-sock", required_argument, 0, 's'},
 		        {"arfcn-sig-lev-red", required_argument, 0, 'r'},
 		        {"pm-timeout", required_argument, 0, 't'},
+		        {"epoll", no_argument, 0, 'e'},
 		        {0, 0, 0, 0},
 		};
-		c = getopt_long(argc, argv, "z:y:x:d:s:r:t:", long_options,
+		c = getopt_long(argc, argv, "z:y:x:d:s:r:t:e", long_options,
 		                &option_index);
 		if (c == -1)
 			break;
@@ -101,6 +103,9 @@ static void handle_options(int argc, char **argv)
 		case 't':
 			pm_timeout = optarg;
 			break;
+		case 'e':
+			use_epoll = 1;
+			break;
 		default:
 			break;
 		}
@@ -174,6 +179,8 @@ static void *tall_vphy_ctx;
 
 static void signal_handler(int signum)
 {
+	struct gsmtapl1_demux_stats st;
+
 	LOGP(DMAIN, LOGL_NOTICE, "Signal %d received\n", signum);
 
 	switch (signum) {
@@ -183,6 +190,10 @@ static void signal_handler(int signum)
 		break;
 	case SIGUSR1:
 		talloc_report_full(tall_vphy_ctx, stderr);
+		gsmtapl1_demux_get_stats(&st);
+		fprintf(stderr, "downlink demux: %lu frames, %lu delivered, %lu skipped\n",
+			st.frames, st.delivered, st.skipped);
+		virt_um_dump_stats(g_vphy.virt_um, stderr);
 		break;
 	default:
 		break;
@@ -194,6 +205,8 @@ int main(int argc, char *argv[])
 	tall_vphy_ctx = talloc_named_const(NULL, 1, "root");
 
 	msgb_talloc_ctx_init(tall_vphy_ctx, 0);
+	/* recycle the msgbs of the GSMTAP and L1CTL message flow */
+	msgb_pool_init(256, 0);
 	signal(SIGINT, &signal_handler);
 	signal(SIGTERM, &signal_handler);
 	signal(SIGUSR1, &signal_handler);
@@ -204,6 +217,10 @@ int main(int argc, char *argv[])
 
 	ms_log_init(log_mask);
 
+	/* many L1CTL clients: avoid rebuilding fd_sets every iteration */
+	if (use_epoll && osmo_select_set_backend(OSMO_SELECT_BACKEND_EPOLL) < 0)
+		LOGP(DVIRPHY, LOGL_ERROR, "epoll not available, using select\n");
+
 	LOGP(DVIRPHY, LOGL_INFO, "Virtual physical layer starting up...\n");
 
 	g_vphy.virt_um = virt_um_init(tall_vphy_ctx, ul_tx_grp, port, dl_rx_grp, port,
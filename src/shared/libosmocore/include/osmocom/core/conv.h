@@ -120,6 +120,8 @@ struct osmo_conv_decoder {
 	unsigned int *ae;	/*!< \brief accumulated error */
 	unsigned int *ae_next;	/*!< \brief next accumulated error (tmp in scan) */
 	uint8_t *state_history;	/*!< \brief state history [len][n_states] */
+
+	void *acc;		/*!< \brief accelerated decoder tables (private) */
 };
 
 void osmo_conv_decode_init(struct osmo_conv_decoder *decoder,
@@ -140,6 +142,28 @@ int osmo_conv_decode_get_output(struct osmo_conv_decoder *decoder,
 int osmo_conv_decode(const struct osmo_conv_code *code,
                      const sbit_t *input, ubit_t *output);
 
+	/* Accelerated Add-Compare-Select */
+
+/*! \brief Viterbi Add-Compare-Select implementations
+ *
+ *  All of them produce bit-identical results.  The accelerated ones are
+ *  only used for codes with 8 to 64 states whose state register shifts
+ *  left (all GSM K=5 and K=7 codes), other codes always use the generic
+ *  trellis walk.
+ */
+enum osmo_conv_acc_type {
+	CONV_ACC_GENERIC = 0,	/*!< \brief Generic trellis walk */
+	CONV_ACC_SCALAR,	/*!< \brief Table driven, portable C */
+	CONV_ACC_SSE2,		/*!< \brief x86 SSE2 */
+	CONV_ACC_SSE41,		/*!< \brief x86 SSE4.1 */
+	CONV_ACC_AVX2,		/*!< \brief x86 AVX2 */
+};
+
+int osmo_conv_acc_available(enum osmo_conv_acc_type type);
+int osmo_conv_acc_set(enum osmo_conv_acc_type type);
+enum osmo_conv_acc_type osmo_conv_acc_get(void);
+const char *osmo_conv_acc_name(enum osmo_conv_acc_type type);
+
 
 /*! @} */
 
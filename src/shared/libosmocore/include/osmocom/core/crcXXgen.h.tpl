@@ -51,6 +51,14 @@ int osmo_crcXXgen_check_bits(const struct osmo_crcXXgen_code *code,
 void osmo_crcXXgen_set_bits(const struct osmo_crcXXgen_code *code,
                             const ubit_t *in, int len, ubit_t *crc_bits);
 
+uintXX_t osmo_crcXXgen_compute_pbits(const struct osmo_crcXXgen_code *code,
+                                     const pbit_t *in, int len);
+int osmo_crcXXgen_check_pbits(const struct osmo_crcXXgen_code *code,
+                              const pbit_t *in, int len,
+                              const pbit_t *crc_bits);
+void osmo_crcXXgen_set_pbits(const struct osmo_crcXXgen_code *code,
+                             const pbit_t *in, int len, pbit_t *crc_bits);
+
 
 /*! @} */
 
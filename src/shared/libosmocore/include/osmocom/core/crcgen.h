@@ -0,0 +1,59 @@
+/*
+ * crcgen.h
+ *
+ * Copyright (C) 2011  Sylvain Munaut <tnt@246tNt.com>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __OSMO_CRCGEN_H__
+#define __OSMO_CRCGEN_H__
+
+/*! \defgroup crcgen Osmocom generic CRC routines
+ *  @{
+ */
+
+/*! \file crcgen.h
+ *  \file Osmocom generic CRC routines global header
+ */
+
+#include <osmocom/core/crc8gen.h>
+#include <osmocom/core/crc16gen.h>
+#include <osmocom/core/crc32gen.h>
+#include <osmocom/core/crc64gen.h>
+
+/*! \brief Implementations of the generic CRC routines
+ *
+ *  All of them produce the same results. The table driven ones work on
+ *  whole bytes (slice-by-4 for codes of up to 16 bits, slice-by-8
+ *  above) and fall back to the bitwise one for trailing bits.
+ */
+enum osmo_crcgen_impl {
+	CRCGEN_BITWISE = 0,	/*!< \brief One bit at a time */
+	CRCGEN_TABLE,		/*!< \brief Table driven, portable C */
+	CRCGEN_PCLMUL,		/*!< \brief x86 PCLMULQDQ folding for long
+				 *   inputs, table driven otherwise */
+};
+
+int osmo_crcgen_impl_available(enum osmo_crcgen_impl impl);
+int osmo_crcgen_impl_set(enum osmo_crcgen_impl impl);
+enum osmo_crcgen_impl osmo_crcgen_impl_get(void);
+const char *osmo_crcgen_impl_name(enum osmo_crcgen_impl impl);
+
+/*! @} */
+
+#endif /* __OSMO_CRCGEN_H__ */
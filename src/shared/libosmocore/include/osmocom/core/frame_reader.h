@@ -0,0 +1,63 @@
+#ifndef _OSMO_FRAME_READER_H
+#define _OSMO_FRAME_READER_H
+
+/*! \defgroup frame_reader Length prefixed stream framing
+ *  @{
+ */
+
+/*! \file frame_reader.h
+ *  \brief Receive frames with a 16 bit length prefix from a stream
+ *
+ * Each frame on the stream is a 16 bit length in network byte order
+ * followed by that many bytes, the way L1CTL is carried over its unix
+ * socket.  The reader reads as much as its buffer takes per call, hands
+ * every complete frame to frame_cb and keeps a partial frame for the
+ * next call.
+ *
+ * A frame that ends the data read is handed out in the receive buffer
+ * itself, without copying.  Its msgb is larger than the frame and may
+ * have more headroom than asked for.  Frames followed by more data are
+ * copied into a msgb of their own.
+ */
+
+#include <stdint.h>
+
+#include <osmocom/core/msgb.h>
+
+/*! \brief default size of the receive buffer, headroom included.  This
+ *  is the largest class of the msgb pool, so the buffer is recycled. */
+#define OSMO_FRAME_READER_BUF_SIZE	4096
+
+/*! \brief frame reader statistics */
+struct osmo_frame_reader_stats {
+	unsigned long reads;		/*!< \brief read syscalls with data */
+	unsigned long frames;		/*!< \brief frames handed out */
+	unsigned long copies;		/*!< \brief frames copied out */
+};
+
+/*! \brief reader of length prefixed frames */
+struct osmo_frame_reader {
+	struct msgb *msg;		/*!< \brief receive buffer */
+	const char *name;		/*!< \brief name of the msgbs */
+	uint16_t max_len;		/*!< \brief largest frame accepted */
+	uint16_t headroom;		/*!< \brief headroom of frame msgbs */
+	uint16_t buf_size;		/*!< \brief size of the receive buffer,
+					     headroom included */
+
+	/*! \brief called for each frame, l1h points to its start.  The
+	 *  callback owns the msgb.  It may reset the reader, but not free
+	 *  it.  A negative return stops the reader and is returned. */
+	int (*frame_cb)(struct osmo_frame_reader *fr, struct msgb *msg);
+	void *data;			/*!< \brief private data of the user */
+
+	struct osmo_frame_reader_stats stats; /*!< \brief statistics */
+};
+
+void osmo_frame_reader_init(struct osmo_frame_reader *fr, uint16_t max_len,
+			    uint16_t headroom, const char *name);
+int osmo_frame_reader_read(struct osmo_frame_reader *fr, int fd);
+void osmo_frame_reader_reset(struct osmo_frame_reader *fr);
+
+/*! @} */
+
+#endif /* _OSMO_FRAME_READER_H */
@@ -17,14 +17,33 @@
 /*! \brief Maximum number of logging filters */
 #define LOG_MAX_FILTERS	8
 
+/*! \brief Minimum log level compiled in
+ *
+ * Messages of a lower level are removed at compile time, including the
+ * evaluation of their arguments. Define it (e.g. -DLOG_MIN_LEVEL=3 for
+ * \ref LOGL_INFO) when building an application to drop all debug
+ * logging from it.
+ */
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL	0
+#endif
+
 #define DEBUG
 
-#ifdef DEBUG
-#define DEBUGP(ss, fmt, args...) logp(ss, __FILE__, __LINE__, 0, fmt, ## args)
-#define DEBUGPC(ss, fmt, args...) logp(ss, __FILE__, __LINE__, 1, fmt, ## args)
+#if defined(DEBUG) && LOG_MIN_LEVEL <= 1 /* LOGL_DEBUG */
+#define DEBUGP(ss, fmt, args...) \
+	do { \
+		if (log_check_level(ss, LOGL_DEBUG)) \
+			logp(ss, __FILE__, __LINE__, 0, fmt, ## args); \
+	} while (0)
+#define DEBUGPC(ss, fmt, args...) \
+	do { \
+		if (log_check_level(ss, LOGL_DEBUG)) \
+			logp(ss, __FILE__, __LINE__, 1, fmt, ## args); \
+	} while (0)
 #else
-#define DEBUGP(xss, fmt, args...)
-#define DEBUGPC(ss, fmt, args...)
+#define DEBUGP(xss, fmt, args...) do { } while (0)
+#define DEBUGPC(ss, fmt, args...) do { } while (0)
 #endif
 
 
@@ -33,6 +52,8 @@ void osmo_vlogp(int subsys, int level, const char *file, int line,
 
 void logp(int subsys, const char *file, int line, int cont, const char *format, ...) __attribute__ ((format (printf, 5, 6)));
 
+int log_check_level(int subsys, unsigned int level);
+
 /*! \brief Log a new message through the Osmocom logging framework
  *  \param[in] ss logging subsystem (e.g. \ref DLGLOBAL)
  *  \param[in] level logging level (e.g. \ref LOGL_NOTICE)
@@ -40,7 +61,10 @@ void logp(int subsys, const char *file, int line, int cont, const char *format,
  *  \param[in] args variable argument list
  */
 #define LOGP(ss, level, fmt, args...) \
-	logp2(ss, level, __FILE__, __LINE__, 0, fmt, ##args)
+	do { \
+		if ((level) >= LOG_MIN_LEVEL && log_check_level(ss, level)) \
+			logp2(ss, level, __FILE__, __LINE__, 0, fmt, ##args); \
+	} while (0)
 
 /*! \brief Continue a log message through the Osmocom logging framework
  *  \param[in] ss logging subsystem (e.g. \ref DLGLOBAL)
@@ -49,7 +73,10 @@ void logp(int subsys, const char *file, int line, int cont, const char *format,
  *  \param[in] args variable argument list
  */
 #define LOGPC(ss, level, fmt, args...) \
-	logp2(ss, level, __FILE__, __LINE__, 1, fmt, ##args)
+	do { \
+		if ((level) >= LOG_MIN_LEVEL && log_check_level(ss, level)) \
+			logp2(ss, level, __FILE__, __LINE__, 1, fmt, ##args); \
+	} while (0)
 
 /*! \brief different log levels */
 #define LOGL_DEBUG	1	/*!< \brief debugging information */
@@ -164,8 +191,22 @@ struct log_target {
 	 */
         void (*output) (struct log_target *target, unsigned int level,
 			const char *string);
+
+	/*! \brief asynchronous output state, see \ref log_target_set_async */
+	void *async;
 };
 
+/*! \brief Counters of an asynchronous log target */
+struct log_async_stats {
+	unsigned long written;	/*!< \brief lines written by the thread */
+	unsigned long dropped;	/*!< \brief lines dropped, ring was full */
+	unsigned int queued;	/*!< \brief bytes waiting in the ring */
+	unsigned int size;	/*!< \brief size of the ring in bytes */
+};
+
+/*! \brief Default ring buffer size of asynchronous log targets */
+#define LOG_ASYNC_DEFAULT_SIZE	(256 * 1024)
+
 /* use the above macros */
 void logp2(int subsys, unsigned int level, const char *file,
 	   int line, int cont, const char *format, ...)
@@ -199,6 +240,11 @@ struct log_target *log_target_create_syslog(const char *ident, int option,
 					    int facility);
 int log_target_file_reopen(struct log_target *tgt);
 
+int log_target_set_async(struct log_target *target, unsigned int size);
+void log_target_async_flush(struct log_target *target);
+int log_target_async_stats(struct log_target *target,
+			   struct log_async_stats *stats);
+
 void log_add_target(struct log_target *target);
 void log_del_target(struct log_target *target);
 
@@ -396,6 +396,24 @@ static inline struct msgb *msgb_alloc_headroom(int size, int headroom,
 uint8_t *msgb_data(const struct msgb *msg);
 void msgb_set_talloc_ctx(void *ctx);
 
+/*! \brief number of size classes of the msgb pool */
+#define MSGB_POOL_NUM_CLASSES	4
+
+/*! \brief don't clear the data of recycled msgbs */
+#define MSGB_POOL_F_NO_ZERO	0x0001
+
+/*! \brief counters of a size class of the msgb pool */
+struct msgb_pool_stats {
+	uint16_t size;		/*!< \brief data size of the class */
+	unsigned long allocs;	/*!< \brief msgbs allocated in the class */
+	unsigned long reused;	/*!< \brief ... of which were recycled */
+	unsigned int cached;	/*!< \brief msgbs on the free list */
+};
+
+int msgb_pool_init(unsigned int max_cached, unsigned int flags);
+void msgb_pool_destroy(void);
+void msgb_pool_get_stats(struct msgb_pool_stats *stats);
+
 /*! @} */
 
 #endif /* _MSGB_H */
@@ -28,11 +28,28 @@ struct rate_ctr_per_intv {
 	uint64_t rate;		/*!< \brief counter rate */
 };
 
+/*! \brief Number of per-thread shards of a sharded counter group */
+#define RATE_CTR_SHARDS		16
+
+struct rate_ctr_group;
+
 /*! \brief data we keep for each actual value */
 struct rate_ctr {
-	uint64_t current;	/*!< \brief current value */
+	/*! \brief value at the last one-second tick, use \ref rate_ctr_get
+	 *  or \ref rate_ctr_group_snapshot to include recent increments */
+	uint64_t current;
 	/*! \brief per-interval data */
 	struct rate_ctr_per_intv intv[RATE_CTR_INTV_NUM];
+	/*! \brief group this counter belongs to */
+	struct rate_ctr_group *grp;
+	/*! \brief value sent by the last statistics report */
+	uint64_t reported;
+};
+
+/*! \brief consistent copy of one counter, see \ref rate_ctr_group_snapshot */
+struct rate_ctr_snapshot {
+	uint64_t value;				/*!< \brief current value */
+	uint64_t rate[RATE_CTR_INTV_NUM];	/*!< \brief per-interval rate */
 };
 
 /*! \brief rate counter description */
@@ -61,6 +78,26 @@ struct rate_ctr_group {
 	const struct rate_ctr_group_desc *desc;
 	/*! \brief The index of this ctr_group within its class */
 	unsigned int idx;
+
+	/*! \brief increments not yet folded into the counters, one row of
+	 *  num_ctr values per shard, each row on its own cache lines */
+	uint64_t *shard;
+	/*! \brief distance between two shard rows */
+	unsigned int shard_stride;
+	/*! \brief number of shards - 1, 0 for a group used by one thread */
+	unsigned int shard_mask;
+	/*! \brief the group is queued for the next one-second tick */
+	int touched;
+	/*! \brief entry in the list of touched groups */
+	struct llist_head touched_list;
+	/*! \brief one-second tick the intervals were last computed for */
+	uint64_t tick;
+	/*! \brief sequence count, odd while the tick updates the group */
+	unsigned int seq;
+	/*! \brief statistics report index of the first counter, 0 until
+	 *  the group has been announced */
+	uint32_t stats_idx;
+
 	/*! \brief Actual counter structures below */
 	struct rate_ctr ctr[0];
 };
@@ -69,9 +106,18 @@ struct rate_ctr_group *rate_ctr_group_alloc(void *ctx,
 					    const struct rate_ctr_group_desc *desc,
 					    unsigned int idx);
 
+struct rate_ctr_group *rate_ctr_group_alloc_sharded(void *ctx,
+					const struct rate_ctr_group_desc *desc,
+					unsigned int idx);
+
 void rate_ctr_group_free(struct rate_ctr_group *grp);
 
 void rate_ctr_add(struct rate_ctr *ctr, int inc);
+uint64_t rate_ctr_get(const struct rate_ctr *ctr);
+void rate_ctr_snapshot(const struct rate_ctr *ctr,
+		       struct rate_ctr_snapshot *snap);
+void rate_ctr_group_snapshot(const struct rate_ctr_group *grp,
+			     struct rate_ctr_snapshot *snap);
 
 /*! \brief Increment the counter by 1 */
 static inline void rate_ctr_inc(struct rate_ctr *ctr)
@@ -81,6 +127,9 @@ static inline void rate_ctr_inc(struct rate_ctr *ctr)
 
 int rate_ctr_init(void *tall_ctx);
 
+int rate_ctr_for_each_group(int (*handle_group)(struct rate_ctr_group *,
+						 void *), void *data);
+
 struct rate_ctr_group *rate_ctr_get_group_by_name_idx(const char *name, const unsigned int idx);
 const struct rate_ctr *rate_ctr_get_by_name(const struct rate_ctr_group *ctrg, const char *name);
 
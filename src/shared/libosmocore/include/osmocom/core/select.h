@@ -25,7 +25,8 @@ struct osmo_fd {
 	/*! actual operating-system level file decriptor */
 	int fd;
 	/*! bit-mask or of \ref BSC_FD_READ, \ref BSC_FD_WRITE and/or
-	 * \ref BSC_FD_EXCEPT */
+	 * \ref BSC_FD_EXCEPT.  Once registered, change it only with
+	 * \ref osmo_fd_update_when or the enable/disable helpers */
 	unsigned int when;
 	/*! call-back function to be called once file descriptor becomes
 	 * available */
@@ -34,12 +35,52 @@ struct osmo_fd {
 	void *data;
 	/*! private number, extending \a data */
 	unsigned int priv_nr;
+	/*! internal state of the select loop (registration, event mask
+	 *  currently armed in the kernel) */
+	unsigned int _state;
+};
+
+/*! \brief Back-ends available to \ref osmo_select_main */
+enum osmo_select_backend {
+	/*! classic select(2), rebuilds fd_sets on every iteration */
+	OSMO_SELECT_BACKEND_SELECT,
+	/*! epoll(7), event mask updated incrementally */
+	OSMO_SELECT_BACKEND_EPOLL,
 };
 
 int osmo_fd_register(struct osmo_fd *fd);
 void osmo_fd_unregister(struct osmo_fd *fd);
+void osmo_fd_update_when(struct osmo_fd *fd, unsigned int and_mask,
+			 unsigned int or_mask);
 int osmo_select_main(int polling);
 
+int osmo_select_set_backend(enum osmo_select_backend backend);
+enum osmo_select_backend osmo_select_get_backend(void);
+
+/*! \brief Enable read notifications on a file descriptor */
+static inline void osmo_fd_read_enable(struct osmo_fd *fd)
+{
+	osmo_fd_update_when(fd, ~0, BSC_FD_READ);
+}
+
+/*! \brief Disable read notifications on a file descriptor */
+static inline void osmo_fd_read_disable(struct osmo_fd *fd)
+{
+	osmo_fd_update_when(fd, ~BSC_FD_READ, 0);
+}
+
+/*! \brief Enable write notifications on a file descriptor */
+static inline void osmo_fd_write_enable(struct osmo_fd *fd)
+{
+	osmo_fd_update_when(fd, ~0, BSC_FD_WRITE);
+}
+
+/*! \brief Disable write notifications on a file descriptor */
+static inline void osmo_fd_write_disable(struct osmo_fd *fd)
+{
+	osmo_fd_update_when(fd, ~BSC_FD_WRITE, 0);
+}
+
 /*! @} */
 
 #endif /* _BSC_SELECT_H */
@@ -4,12 +4,16 @@
 /*! \file statistics.h
  *  \brief Common routines regarding statistics */
 
+#include <stdint.h>
+
 /*! structure representing a single counter */
 struct osmo_counter {
 	struct llist_head list;		/*!< \brief internal list head */
 	const char *name;		/*!< \brief human-readable name */
 	const char *description;	/*!< \brief humn-readable description */
 	unsigned long value;		/*!< \brief current value */
+	unsigned long reported;		/*!< \brief value of the last report */
+	uint32_t stats_idx;		/*!< \brief report index, 0: none yet */
 };
 
 /*! \brief Increment counter */
@@ -0,0 +1,102 @@
+#ifndef _OSMO_STATS_H
+#define _OSMO_STATS_H
+
+/*! \defgroup stats Statistics reporter
+ *  @{
+ */
+
+/*! \file stats.h
+ *  \brief Periodic export of \ref rate_ctr groups and \ref osmo_counter
+ *
+ * All counters are walked once per report interval and sent to every
+ * reporter.  Only the counters that changed since the previous report
+ * are sent, except for a full report every \ref OSMO_STATS_FULL_EVERY
+ * intervals and the first one of a new reporter, which let a collector
+ * that missed datagrams or was restarted catch up.
+ *
+ * Binary format, all integers in network byte order.  Each datagram
+ * starts with a \ref osmo_stats_bin_hdr followed by records:
+ *
+ *  - \ref OSMO_STATS_BIN_NAME: u8 tag, u32 index, u8 length, name.
+ *    Sent when a counter shows up for the first time and in full
+ *    reports.
+ *  - \ref OSMO_STATS_BIN_VALUE: u8 tag, u32 index, u64 value.
+ *
+ * StatsD format: one "<prefix>.<name>:<delta>|c" line per changed
+ * counter, several lines per datagram.
+ */
+
+#include <stdint.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/msgb.h>
+
+/*! \brief a full report goes out every this many intervals */
+#define OSMO_STATS_FULL_EVERY		60
+/*! \brief default maximum size of a report datagram */
+#define OSMO_STATS_DEFAULT_MTU		1400
+
+/*! \brief version in \ref osmo_stats_bin_hdr */
+#define OSMO_STATS_BIN_VERSION		1
+/*! \brief \ref osmo_stats_bin_hdr flag: datagram of a full report */
+#define OSMO_STATS_BIN_F_FULL		0x01
+
+/*! \brief binary record tags */
+enum osmo_stats_bin_tag {
+	OSMO_STATS_BIN_NAME	= 1,	/*!< \brief index to name mapping */
+	OSMO_STATS_BIN_VALUE	= 2,	/*!< \brief current counter value */
+};
+
+/*! \brief header of a binary report datagram */
+struct osmo_stats_bin_hdr {
+	uint8_t version;	/*!< \brief \ref OSMO_STATS_BIN_VERSION */
+	uint8_t flags;		/*!< \brief OSMO_STATS_BIN_F_* */
+	uint16_t num_records;	/*!< \brief records in this datagram */
+	uint32_t seq;		/*!< \brief datagram sequence number */
+} __attribute__ ((packed));
+
+/*! \brief wire format of a reporter */
+enum osmo_stats_reporter_type {
+	OSMO_STATS_REPORTER_BINARY,	/*!< \brief indexed binary records */
+	OSMO_STATS_REPORTER_STATSD,	/*!< \brief StatsD text lines */
+};
+
+/*! \brief one destination of statistics reports */
+struct osmo_stats_reporter {
+	struct llist_head list;		/*!< \brief list of reporters */
+	enum osmo_stats_reporter_type type; /*!< \brief wire format */
+	int fd;				/*!< \brief connected UDP socket */
+	char *host;			/*!< \brief collector address */
+	uint16_t port;			/*!< \brief collector UDP port */
+	char *prefix;			/*!< \brief StatsD name prefix */
+	unsigned int mtu;		/*!< \brief maximum datagram size */
+
+	struct msgb *buffer;		/*!< \brief datagram being filled */
+	unsigned int num_records;	/*!< \brief records in buffer */
+	uint32_t seq;			/*!< \brief next sequence number */
+	int full;			/*!< \brief current report is full */
+	int force_full;			/*!< \brief make the next report full */
+
+	unsigned long packets;		/*!< \brief datagrams sent */
+	unsigned long bytes;		/*!< \brief bytes sent */
+	unsigned long errors;		/*!< \brief failed sends */
+};
+
+struct osmo_stats_reporter *
+osmo_stats_reporter_create(void *ctx, enum osmo_stats_reporter_type type,
+			   const char *host, uint16_t port,
+			   const char *prefix);
+void osmo_stats_reporter_free(struct osmo_stats_reporter *rep);
+struct osmo_stats_reporter *
+osmo_stats_reporter_find(enum osmo_stats_reporter_type type,
+			 const char *host, uint16_t port);
+
+extern struct llist_head osmo_stats_reporters;
+
+int osmo_stats_set_interval(int interval);
+int osmo_stats_get_interval(void);
+int osmo_stats_report(void);
+
+/*! @} */
+
+#endif /* _OSMO_STATS_H */
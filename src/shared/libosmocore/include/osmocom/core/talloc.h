@@ -146,6 +146,9 @@ void *_talloc_steal(const void *new_ctx, const void *ptr);
 void *_talloc_move(const void *new_ctx, const void *pptr);
 size_t talloc_total_size(const void *ptr);
 size_t talloc_total_blocks(const void *ptr);
+size_t talloc_pool_size(const void *ptr);
+size_t talloc_pool_used(const void *ptr);
+size_t talloc_pool_objects(const void *ptr);
 void talloc_report_depth_cb(const void *ptr, int depth, int max_depth,
 			    void (*callback)(const void *ptr,
 			  		     int depth, int max_depth,
@@ -61,6 +61,15 @@ struct osmo_timer_list {
 	void *data;		  /*!< \brief user data for callback */
 };
 
+/*! \brief Data structures backing the timer management */
+enum osmo_timer_mode {
+	/*! rb-tree sorted by wall-clock expiration time (default) */
+	OSMO_TIMER_MODE_RBTREE,
+	/*! hierarchical timing wheel on the monotonic clock, O(1)
+	 *  add/delete at a resolution of one millisecond */
+	OSMO_TIMER_MODE_WHEEL,
+};
+
 /**
  * timer management
  */
@@ -84,6 +93,9 @@ void osmo_timers_prepare(void);
 int osmo_timers_update(void);
 int osmo_timers_check(void);
 
+int osmo_timers_set_mode(enum osmo_timer_mode mode);
+enum osmo_timer_mode osmo_timers_get_mode(void);
+
 /*! @} */
 
 #endif
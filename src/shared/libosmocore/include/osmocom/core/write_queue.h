@@ -33,6 +33,32 @@
 #include <osmocom/core/select.h>
 #include <osmocom/core/msgb.h>
 
+/*! \brief maximum number of msgbs handed to one writev()/sendmmsg() */
+#define OSMO_WQUEUE_BATCH	64
+
+/*! \brief drain the queue with writev(), for stream sockets.  The msgbs
+ *  are written as they are, write_cb is not used */
+#define OSMO_WQUEUE_F_WRITEV	0x0001
+/*! \brief drain the queue with sendmmsg(), one datagram per msgb, for
+ *  connected datagram sockets.  write_cb is not used */
+#define OSMO_WQUEUE_F_SENDMMSG	0x0002
+
+/*! \brief what osmo_wqueue_enqueue() does when max_length is reached */
+enum osmo_wqueue_drop_policy {
+	OSMO_WQUEUE_DROP_NEW,	/*!< \brief refuse the new msgb (-ENOSPC) */
+	OSMO_WQUEUE_DROP_OLDEST, /*!< \brief free the oldest queued msgb */
+};
+
+/*! \brief write queue statistics */
+struct osmo_wqueue_stats {
+	unsigned long enqueued;		/*!< \brief msgbs accepted */
+	unsigned long dropped;		/*!< \brief msgbs dropped at max_length */
+	unsigned long written;		/*!< \brief msgbs written */
+	unsigned long write_calls;	/*!< \brief write syscalls */
+	unsigned long write_errors;	/*!< \brief failed write syscalls */
+	unsigned int high_water;	/*!< \brief highest current_length */
+};
+
 /*! write queue instance */
 struct osmo_wqueue {
 	/*! \brief osmocom file descriptor */
@@ -51,6 +77,22 @@ struct osmo_wqueue {
 	int (*write_cb)(struct osmo_fd *fd, struct msgb *msg);
 	/*! \brief call-back in case qeueue has exceptions */
 	int (*except_cb)(struct osmo_fd *fd);
+	/*! \brief call-back on a failed write of the OSMO_WQUEUE_F_* modes,
+	 *	   with the errno.  It may close the fd and clear the queue */
+	int (*error_cb)(struct osmo_fd *fd, int err);
+
+	/*! \brief OSMO_WQUEUE_F_* flags selecting the write mode, 0 writes
+	 *	   one msgb per BSC_FD_WRITE event through write_cb */
+	unsigned int flags;
+	/*! \brief what to do when the queue holds max_length msgbs */
+	enum osmo_wqueue_drop_policy drop_policy;
+	/*! \brief bytes of the first msgb already written (OSMO_WQUEUE_F_WRITEV) */
+	unsigned int head_offset;
+	/*! \brief errno of a failed stream write (OSMO_WQUEUE_F_WRITEV), the
+	 *	   queue is stalled until \ref osmo_wqueue_clear */
+	int error;
+	/*! \brief statistics */
+	struct osmo_wqueue_stats stats;
 };
 
 void osmo_wqueue_init(struct osmo_wqueue *queue, int max_length);
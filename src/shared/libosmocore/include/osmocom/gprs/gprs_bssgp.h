@@ -56,18 +56,25 @@ struct osmo_bssgp_prim {
 
 /* gprs_bssgp.c */
 
+struct bssgp_fc_queue_element;
+
 /*! \brief BSSGP flow control (SGSN side) According to Section 8.2 */
 struct bssgp_flow_control {
 	uint32_t bucket_size_max;	/*!< maximum size of the bucket (octets) */
 	uint32_t bucket_leak_rate; 	/*!< leak rate of the bucket (octets/sec) */
 
 	uint32_t bucket_counter;	/*!< number of tokens in the bucket */
-	struct timeval time_last_pdu;	/*!< timestamp of last PDU sent */
+	uint64_t time_empty;		/*!< CLOCK_MONOTONIC time (ns) at which
+					     the bucket will have leaked empty */
 
 	/* the built-in queue */
 	uint32_t max_queue_depth;	/*!< how many packets to queue (mgs) */
 	uint32_t queue_depth;		/*!< current length of queue (msgs) */
-	struct llist_head queue;	/*!< linked list of msgb's */
+	struct bssgp_fc_queue_element *queue; /*!< ring buffer of queued msgb's,
+					     allocated on demand as talloc
+					     child of the flow control */
+	uint32_t queue_size;		/*!< number of slots in the ring */
+	uint32_t queue_head;		/*!< slot of the oldest queued msgb */
 	struct osmo_timer_list timer;	/*!< timer-based dequeueing */
 
 	/*! callback to be called at output of flow control */
@@ -102,12 +109,22 @@ struct bssgp_bvc_ctx {
 	/* we might want to add this as a shortcut later, avoiding the NSVC
 	 * lookup for every packet, similar to a routing cache */
 	//struct gprs_nsvc *nsvc;
+
+	/*! linkage into the BVC lookup hashes, see btsctx_rehash() */
+	struct {
+		struct llist_head bvci_nsei;
+		struct llist_head raid_cid;
+	} hash;
 };
 extern struct llist_head bssgp_bvc_ctxts;
 /* Find a BTS Context based on parsed RA ID and Cell ID */
 struct bssgp_bvc_ctx *btsctx_by_raid_cid(const struct gprs_ra_id *raid, uint16_t cid);
 /* Find a BTS context based on BVCI+NSEI tuple */
 struct bssgp_bvc_ctx *btsctx_by_bvci_nsei(uint16_t bvci, uint16_t nsei);
+/* Allocate a BTS context for the given BVCI+NSEI tuple */
+struct bssgp_bvc_ctx *btsctx_alloc(uint16_t bvci, uint16_t nsei);
+/* Re-index a BTS context after its RA ID or Cell ID changed */
+void btsctx_rehash(struct bssgp_bvc_ctx *bctx);
 
 #define BVC_F_BLOCKED	0x0001
 
@@ -37,6 +37,30 @@ enum ns_timeout {
 #define NSE_S_BLOCKED	0x0001
 #define NSE_S_ALIVE	0x0002
 
+/*! \brief number of buckets in each NS-VC lookup hash (power of two) */
+#define GPRS_NS_HASH_BITS	12
+#define GPRS_NS_HASH_SIZE	(1 << GPRS_NS_HASH_BITS)
+
+/*! \brief maximum number of datagrams per NS/UDP recvmmsg()/sendmmsg() */
+#define GPRS_NSIP_BATCH		32
+/*! \brief batch size histogram buckets: 1, 2-3, 4-7, 8-15, 16-31, 32 */
+#define GPRS_NSIP_BATCH_HIST	6
+/*! \brief default limit of the NS/UDP transmit queue */
+#define GPRS_NSIP_TXQ_MAX	1024
+
+/*! \brief NS/UDP socket batching statistics */
+struct gprs_nsip_stats {
+	unsigned long rx_calls;	/*!< \brief receive syscalls */
+	unsigned long rx_msgs;	/*!< \brief datagrams received */
+	unsigned long rx_batch[GPRS_NSIP_BATCH_HIST];
+	unsigned long tx_calls;	/*!< \brief transmit syscalls */
+	unsigned long tx_msgs;	/*!< \brief datagrams sent */
+	unsigned long tx_batch[GPRS_NSIP_BATCH_HIST];
+	unsigned long tx_blocked; /*!< \brief flushes stopped by EAGAIN */
+	unsigned long tx_dropped; /*!< \brief PDUs dropped at the queue limit */
+	unsigned int tx_queue_hwm; /*!< \brief highest transmit queue depth */
+};
+
 /*! \brief Osmocom NS link layer types */
 enum gprs_ns_ll {
 	GPRS_NS_LL_UDP,		/*!< NS/UDP/IP */
@@ -73,6 +97,16 @@ struct gprs_ns_inst {
 		struct osmo_fd fd;
 		uint32_t local_ip;
 		uint16_t local_port;
+		/*! \brief PDUs waiting for the socket to become writable */
+		struct llist_head tx_queue;
+		unsigned int tx_queue_len;
+		/*! \brief queue limit, PDUs beyond it are refused */
+		unsigned int tx_queue_max;
+		/*! \brief set while a received batch is dispatched */
+		unsigned int in_rx:1;
+		struct gprs_nsip_stats stats;
+		/*! \brief receive buffers for one batch, kept across reads */
+		struct msgb *rx_msgs[GPRS_NSIP_BATCH];
 	} nsip;
 	/*! \brief NS-over-FR-over-GRE-over-IP specific bits */
 	struct {
@@ -80,6 +114,14 @@ struct gprs_ns_inst {
 		uint32_t local_ip;
 		unsigned int enabled:1;
 	} frgre;
+
+	/*! \brief hash buckets indexing gprs_nsvcs by NSVCI, NSEI and
+	 *	   remote address, see gprs_nsvc_rehash() */
+	struct {
+		struct llist_head nsvci[GPRS_NS_HASH_SIZE];
+		struct llist_head nsei[GPRS_NS_HASH_SIZE];
+		struct llist_head addr[GPRS_NS_HASH_SIZE];
+	} hash;
 };
 
 enum nsvc_timer_mode {
@@ -123,6 +165,18 @@ struct gprs_nsvc {
 			struct sockaddr_in bts_addr;
 		} frgre;
 	};
+
+	/*! \brief number of PDUs of this NS-VC in the NS/UDP tx queue */
+	unsigned int tx_queued;
+	/*! \brief highest value tx_queued has reached */
+	unsigned int tx_queued_hwm;
+
+	/*! \brief linkage into the hash buckets of the NS Instance */
+	struct {
+		struct llist_head nsvci;
+		struct llist_head nsei;
+		struct llist_head addr;
+	} hash;
 };
 
 /* Create a new NS protocol instance */
@@ -156,6 +210,8 @@ struct gprs_nsvc *gprs_nsvc_create(struct gprs_ns_inst *nsi, uint16_t nsvci);
 void gprs_nsvc_delete(struct gprs_nsvc *nsvc);
 struct gprs_nsvc *gprs_nsvc_by_nsei(struct gprs_ns_inst *nsi, uint16_t nsei);
 struct gprs_nsvc *gprs_nsvc_by_nsvci(struct gprs_ns_inst *nsi, uint16_t nsvci);
+/* Re-index a NS-VC after its NSEI, NSVCI or remote address changed */
+void gprs_nsvc_rehash(struct gprs_nsvc *nsvc);
 
 /* Initiate a RESET procedure (including timer start, ...)*/
 void gprs_nsvc_reset(struct gprs_nsvc *nsvc, uint8_t cause);
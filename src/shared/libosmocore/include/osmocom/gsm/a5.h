@@ -58,6 +58,30 @@ void osmo_a5(int n, const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul);
 void osmo_a5_1(const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul);
 void osmo_a5_2(const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul);
 
+/*! \brief Bitsliced implementations of \ref osmo_a5_batch
+ *
+ *  All of them produce the same output, they only differ in the number
+ *  of cipher streams computed in parallel (64, 128 or 256).
+ */
+enum osmo_a5_batch_impl {
+	A5_BATCH_U64 = 0,	/*!< \brief Portable C, 64 lanes */
+	A5_BATCH_SSE2,		/*!< \brief x86 SSE2, 128 lanes */
+	A5_BATCH_AVX2,		/*!< \brief x86 AVX2, 256 lanes */
+};
+
+/*! \brief Output packed bits (15 bytes per stream) instead of ubits */
+#define OSMO_A5_BATCH_F_PACKED	(1 << 0)
+
+int osmo_a5_batch(int n, const uint8_t *keys, const uint32_t *fn,
+                  unsigned int count, uint8_t *dl, uint8_t *ul,
+                  unsigned int flags);
+
+int osmo_a5_batch_impl_available(enum osmo_a5_batch_impl impl);
+int osmo_a5_batch_impl_set(enum osmo_a5_batch_impl impl);
+enum osmo_a5_batch_impl osmo_a5_batch_impl_get(void);
+const char *osmo_a5_batch_impl_name(enum osmo_a5_batch_impl impl);
+unsigned int osmo_a5_batch_impl_lanes(enum osmo_a5_batch_impl impl);
+
 /*! @} */
 
 #endif /* __OSMO_A5_H__ */
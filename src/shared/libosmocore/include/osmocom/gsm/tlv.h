@@ -410,6 +410,52 @@ void tlv_def_patch(struct tlv_definition *dst, const struct tlv_definition *src)
 #define TLVP_LEN(x, y)		(x)->lv[y].len
 #define TLVP_VAL(x, y)		(x)->lv[y].val
 
+/*! \brief sparse result of the TLV parser
+ *
+ * Only the presence bitmap is cleared before parsing, the entries of the
+ * IEs found are stored in order of their first occurrence in \a ie and
+ * \a idx maps a tag to its entry. \a idx and \a ie are only valid for
+ * tags set in \a present.
+ */
+struct tlv_parsed_sparse {
+	uint32_t present[256/32];	/*!< \brief bitmap of the tags found */
+	uint16_t num;			/*!< \brief number of entries in \a ie */
+	uint8_t idx[256];		/*!< \brief tag to index into \a ie */
+	struct tlv_p_entry ie[256];	/*!< \brief the IEs found */
+};
+
+int tlv_parse_sparse(struct tlv_parsed_sparse *dec, const struct tlv_definition *def,
+		     const uint8_t *buf, int buf_len, uint8_t lv_tag, uint8_t lv_tag2);
+void tlv_sparse_to_parsed(struct tlv_parsed *dst, const struct tlv_parsed_sparse *src);
+
+/*! \brief Get the entry of a tag in a sparse TLV parser result
+ *  \returns pointer to the entry, NULL if the tag was not found */
+static inline const struct tlv_p_entry *
+tlvs_get(const struct tlv_parsed_sparse *tp, uint8_t tag)
+{
+	if (!(tp->present[tag >> 5] & (1U << (tag & 31))))
+		return NULL;
+	return &tp->ie[tp->idx[tag]];
+}
+
+/*! \brief Get the value of a tag in a sparse TLV parser result, NULL if not found */
+static inline const uint8_t *tlvs_val(const struct tlv_parsed_sparse *tp, uint8_t tag)
+{
+	const struct tlv_p_entry *e = tlvs_get(tp, tag);
+	return e ? e->val : NULL;
+}
+
+/*! \brief Get the length of a tag in a sparse TLV parser result, 0 if not found */
+static inline uint16_t tlvs_len(const struct tlv_parsed_sparse *tp, uint8_t tag)
+{
+	const struct tlv_p_entry *e = tlvs_get(tp, tag);
+	return e ? e->len : 0;
+}
+
+#define TLVS_PRESENT(x, y)	tlvs_val(x, y)
+#define TLVS_LEN(x, y)		tlvs_len(x, y)
+#define TLVS_VAL(x, y)		tlvs_val(x, y)
+
 /*! @} */
 
 #endif /* _TLV_H */
@@ -76,6 +76,7 @@ enum node_type {
 	SERVICE_NODE,		/*!< \brief Service node. */
 	DEBUG_NODE,		/*!< \brief Debug node. */
 	CFG_LOG_NODE,		/*!< \brief Configure the logging */
+	CFG_STATS_NODE,		/*!< \brief Configure the statistics reporter */
 
 	VTY_NODE,		/*!< \brief Vty node. */
 
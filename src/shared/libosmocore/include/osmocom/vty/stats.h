@@ -0,0 +1,8 @@
+#ifndef _VTY_STATS_H
+#define _VTY_STATS_H
+
+#define STATS_STR	"Configure the statistics reporter\n"
+
+void stats_vty_add_cmds(void);
+
+#endif /* _VTY_STATS_H */
@@ -40,6 +40,8 @@
 #include <osmocom/core/bits.h>
 #include <osmocom/core/conv.h>
 
+#include "conv_acc.h"
+
 
 /* ------------------------------------------------------------------------ */
 /* Common                                                                   */
@@ -236,7 +238,7 @@ osmo_conv_encode(const struct osmo_conv_code *code,
 /* Decoding (viterbi)                                                       */
 /* ------------------------------------------------------------------------ */
 
-#define MAX_AE 0x00ffffff
+#define MAX_AE CONV_ACC_MAX_AE
 
 void
 osmo_conv_decode_init(struct osmo_conv_decoder *decoder,
@@ -262,6 +264,9 @@ osmo_conv_decode_init(struct osmo_conv_decoder *decoder,
 
 	decoder->state_history = malloc(sizeof(uint8_t) * n_states * (len + decoder->code->K - 1));
 
+	/* Tables for the accelerated trellis walk, if the code allows it */
+	decoder->acc = conv_acc_get(code, len);
+
 	/* Classic reset */
 	osmo_conv_decode_reset(decoder, start_state);
 }
@@ -313,6 +318,7 @@ osmo_conv_decode_deinit(struct osmo_conv_decoder *decoder)
 	free(decoder->ae);
 	free(decoder->ae_next);
 	free(decoder->state_history);
+	conv_acc_put(decoder->acc);
 
 	memset(decoder, 0x00, sizeof(struct osmo_conv_decoder));
 }
@@ -333,6 +339,13 @@ osmo_conv_decode_scan(struct osmo_conv_decoder *decoder,
 
 	int i_idx, p_idx;
 
+	/* Accelerated version */
+	if (decoder->acc) {
+		i_idx = conv_acc_scan(decoder, input, n);
+		if (i_idx >= 0)
+			return i_idx;
+	}
+
 	/* Prepare */
 	n_states = decoder->n_states;
 
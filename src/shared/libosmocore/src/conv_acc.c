@@ -0,0 +1,637 @@
+/*
+ * conv_acc.c
+ *
+ * Accelerated Viterbi Add-Compare-Select for convolutional decoding
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*! \addtogroup conv
+ *  @{
+ */
+
+/*! \file conv_acc.c
+ *  \file Osmocom accelerated Viterbi Add-Compare-Select
+ *
+ * For codes whose state register shifts left by one bit per input bit,
+ * the two predecessors of state 'ns' are always 'ns >> 1' and
+ * 'ns >> 1 | n_states / 2'.  This allows to process all states of a
+ * trellis step as butterflies, without any data dependent branch, and
+ * to compute the branch metrics from a few per-step constants.
+ *
+ * Ties are resolved exactly like the generic trellis walk in conv.c
+ * (the lower predecessor wins) and the state history keeps its layout,
+ * so the results are bit-identical.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/conv.h>
+#include <osmocom/core/utils.h>
+
+#include "conv_acc.h"
+
+#if defined(HAVE_X86_SIMD_TARGETS) && (defined(__x86_64__) || defined(__i386__))
+#define CONV_ACC_X86 1
+#include <immintrin.h>
+#endif
+
+#define ACC_MAX_STATES	64
+#define ACC_MAX_N	4
+
+/* per-code tables, shared by all decoders of the same code */
+struct conv_acc_code {
+	/* copy of the code the tables were built from: codes on the stack
+	 * or heap may reuse an address, so the cache compares contents */
+	int K;
+	int N;
+	uint8_t next_output[ACC_MAX_STATES][2];
+	uint8_t next_state[ACC_MAX_STATES][2];
+	int *puncture;		/* -1 terminated, NULL if not punctured */
+
+	int steps;		/* trellis steps covered by 'punc' */
+	int n_states;
+	int half;
+
+	/* output symbols of the branches from 'ns >> 1' (0) and
+	 * 'ns >> 1 | half' (1) into state 'ns' */
+	uint8_t out[2][ACC_MAX_STATES];
+	/* -1 where bit j (MSB first) of out[x][ns] is set, 0 otherwise */
+	int32_t mask[2][ACC_MAX_N][ACC_MAX_STATES];
+	/* 'ns >> 1', the default survivor */
+	int32_t pred[ACC_MAX_STATES];
+
+	/* per trellis step: bit j set if symbol j is punctured */
+	uint8_t *punc;
+
+	int cached;
+};
+
+/* one trellis step: ae/ae_next [n_states], t0/t1 [N] are the branch
+ * metric contributions of each symbol for an output bit of 0/1 */
+typedef void (*acs_fn_t)(const struct conv_acc_code *acc,
+			 const int32_t *ae, int32_t *ae_next, uint8_t *hist,
+			 const int32_t *t0, const int32_t *t1);
+
+static void
+acs_scalar(const struct conv_acc_code *acc,
+           const int32_t *ae, int32_t *ae_next, uint8_t *hist,
+           const int32_t *t0, const int32_t *t1)
+{
+	int32_t bm[1 << ACC_MAX_N];
+	int N = acc->N;
+	int o, j, ns;
+
+	for (o=0; o<(1<<N); o++) {
+		bm[o] = 0;
+		for (j=0; j<N; j++)
+			bm[o] += ((o >> (N - j - 1)) & 1) ? t1[j] : t0[j];
+	}
+
+	for (ns=0; ns<acc->n_states; ns++) {
+		int p0 = ns >> 1;
+		int p1 = p0 + acc->half;
+		int32_t m0 = ae[p0] + bm[acc->out[0][ns]];
+		int32_t m1 = ae[p1] + bm[acc->out[1][ns]];
+		int h = p0;
+
+		if (m0 > CONV_ACC_MAX_AE)
+			m0 = CONV_ACC_MAX_AE;
+		if (m1 < m0) {
+			m0 = m1;
+			h = p1;
+		}
+
+		ae_next[ns] = m0;
+		hist[ns] = h;
+	}
+}
+
+#ifdef CONV_ACC_X86
+
+/* branch metrics of 4 states: base + sum of (mask & (t1 - t0)) */
+#define ACC_BM128(acc, x, ns, base, d, N)				\
+({									\
+	__m128i _bm = base;						\
+	int _j;								\
+	for (_j=0; _j<N; _j++)						\
+		_bm = _mm_add_epi32(_bm, _mm_and_si128(d[_j],		\
+			_mm_loadu_si128((const __m128i *)		\
+				&(acc)->mask[x][_j][ns])));		\
+	_bm;								\
+})
+
+__attribute__((target("sse2")))
+static void
+acs_sse2(const struct conv_acc_code *acc,
+         const int32_t *ae, int32_t *ae_next, uint8_t *hist,
+         const int32_t *t0, const int32_t *t1)
+{
+	__m128i d[ACC_MAX_N], base, max_ae, half;
+	int32_t b = 0;
+	int N = acc->N;
+	int j, g, k;
+
+	for (j=0; j<N; j++) {
+		b += t0[j];
+		d[j] = _mm_set1_epi32(t1[j] - t0[j]);
+	}
+	base = _mm_set1_epi32(b);
+	max_ae = _mm_set1_epi32(CONV_ACC_MAX_AE);
+	half = _mm_set1_epi32(acc->half);
+
+	/* 8 states per round, from 4 consecutive predecessors */
+	for (g=0; g<acc->n_states; g+=8) {
+		__m128i a0 = _mm_loadu_si128((const __m128i *)&ae[g/2]);
+		__m128i a1 = _mm_loadu_si128((const __m128i *)&ae[g/2 + acc->half]);
+		__m128i h[2];
+
+		for (k=0; k<2; k++) {
+			int ns = g + 4*k;
+			__m128i m0, m1, lt, sel;
+
+			m0 = k ? _mm_unpackhi_epi32(a0, a0) : _mm_unpacklo_epi32(a0, a0);
+			m1 = k ? _mm_unpackhi_epi32(a1, a1) : _mm_unpacklo_epi32(a1, a1);
+			m0 = _mm_add_epi32(m0, ACC_BM128(acc, 0, ns, base, d, N));
+			m1 = _mm_add_epi32(m1, ACC_BM128(acc, 1, ns, base, d, N));
+
+			/* m0 = min(m0, MAX_AE) */
+			lt = _mm_cmpgt_epi32(max_ae, m0);
+			m0 = _mm_or_si128(_mm_and_si128(lt, m0),
+			                  _mm_andnot_si128(lt, max_ae));
+
+			/* upper predecessor only survives if strictly better */
+			sel = _mm_cmpgt_epi32(m0, m1);
+			m0 = _mm_or_si128(_mm_and_si128(sel, m1),
+			                  _mm_andnot_si128(sel, m0));
+
+			_mm_storeu_si128((__m128i *)&ae_next[ns], m0);
+			h[k] = _mm_add_epi32(
+				_mm_loadu_si128((const __m128i *)&acc->pred[ns]),
+				_mm_and_si128(sel, half));
+		}
+
+		h[0] = _mm_packs_epi32(h[0], h[1]);
+		h[0] = _mm_packus_epi16(h[0], h[0]);
+		_mm_storel_epi64((__m128i *)&hist[g], h[0]);
+	}
+}
+
+__attribute__((target("sse4.1")))
+static void
+acs_sse41(const struct conv_acc_code *acc,
+          const int32_t *ae, int32_t *ae_next, uint8_t *hist,
+          const int32_t *t0, const int32_t *t1)
+{
+	__m128i d[ACC_MAX_N], base, max_ae, half;
+	int32_t b = 0;
+	int N = acc->N;
+	int j, g, k;
+
+	for (j=0; j<N; j++) {
+		b += t0[j];
+		d[j] = _mm_set1_epi32(t1[j] - t0[j]);
+	}
+	base = _mm_set1_epi32(b);
+	max_ae = _mm_set1_epi32(CONV_ACC_MAX_AE);
+	half = _mm_set1_epi32(acc->half);
+
+	for (g=0; g<acc->n_states; g+=8) {
+		__m128i a0 = _mm_loadu_si128((const __m128i *)&ae[g/2]);
+		__m128i a1 = _mm_loadu_si128((const __m128i *)&ae[g/2 + acc->half]);
+		__m128i h[2];
+
+		for (k=0; k<2; k++) {
+			int ns = g + 4*k;
+			__m128i m0, m1, sel;
+
+			m0 = k ? _mm_unpackhi_epi32(a0, a0) : _mm_unpacklo_epi32(a0, a0);
+			m1 = k ? _mm_unpackhi_epi32(a1, a1) : _mm_unpacklo_epi32(a1, a1);
+			m0 = _mm_add_epi32(m0, ACC_BM128(acc, 0, ns, base, d, N));
+			m1 = _mm_add_epi32(m1, ACC_BM128(acc, 1, ns, base, d, N));
+
+			m0 = _mm_min_epi32(m0, max_ae);
+			sel = _mm_cmpgt_epi32(m0, m1);
+			m0 = _mm_blendv_epi8(m0, m1, sel);
+
+			_mm_storeu_si128((__m128i *)&ae_next[ns], m0);
+			h[k] = _mm_add_epi32(
+				_mm_loadu_si128((const __m128i *)&acc->pred[ns]),
+				_mm_and_si128(sel, half));
+		}
+
+		h[0] = _mm_packs_epi32(h[0], h[1]);
+		h[0] = _mm_packus_epi16(h[0], h[0]);
+		_mm_storel_epi64((__m128i *)&hist[g], h[0]);
+	}
+}
+
+__attribute__((target("avx2")))
+static void
+acs_avx2(const struct conv_acc_code *acc,
+         const int32_t *ae, int32_t *ae_next, uint8_t *hist,
+         const int32_t *t0, const int32_t *t1)
+{
+	__m256i d[ACC_MAX_N], base, max_ae, half, dup;
+	int32_t b = 0;
+	int N = acc->N;
+	int j, g;
+
+	for (j=0; j<N; j++) {
+		b += t0[j];
+		d[j] = _mm256_set1_epi32(t1[j] - t0[j]);
+	}
+	base = _mm256_set1_epi32(b);
+	max_ae = _mm256_set1_epi32(CONV_ACC_MAX_AE);
+	half = _mm256_set1_epi32(acc->half);
+	dup = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+
+	for (g=0; g<acc->n_states; g+=8) {
+		__m256i m0, m1, bm0, bm1, sel, h;
+		__m128i lo, hi;
+
+		m0 = _mm256_castsi128_si256(
+			_mm_loadu_si128((const __m128i *)&ae[g/2]));
+		m1 = _mm256_castsi128_si256(
+			_mm_loadu_si128((const __m128i *)&ae[g/2 + acc->half]));
+		m0 = _mm256_permutevar8x32_epi32(m0, dup);
+		m1 = _mm256_permutevar8x32_epi32(m1, dup);
+
+		bm0 = bm1 = base;
+		for (j=0; j<N; j++) {
+			bm0 = _mm256_add_epi32(bm0, _mm256_and_si256(d[j],
+				_mm256_loadu_si256((const __m256i *)&acc->mask[0][j][g])));
+			bm1 = _mm256_add_epi32(bm1, _mm256_and_si256(d[j],
+				_mm256_loadu_si256((const __m256i *)&acc->mask[1][j][g])));
+		}
+		m0 = _mm256_add_epi32(m0, bm0);
+		m1 = _mm256_add_epi32(m1, bm1);
+
+		m0 = _mm256_min_epi32(m0, max_ae);
+		sel = _mm256_cmpgt_epi32(m0, m1);
+		m0 = _mm256_blendv_epi8(m0, m1, sel);
+		_mm256_storeu_si256((__m256i *)&ae_next[g], m0);
+
+		h = _mm256_add_epi32(
+			_mm256_loadu_si256((const __m256i *)&acc->pred[g]),
+			_mm256_and_si256(sel, half));
+		/* packs work per 128 bit lane, the low 4 bytes of each
+		 * lane hold 4 history entries */
+		h = _mm256_packs_epi32(h, h);
+		h = _mm256_packus_epi16(h, h);
+		lo = _mm256_castsi256_si128(h);
+		hi = _mm256_extracti128_si256(h, 1);
+		_mm_storel_epi64((__m128i *)&hist[g], _mm_unpacklo_epi32(lo, hi));
+	}
+}
+
+#endif /* CONV_ACC_X86 */
+
+
+/* ------------------------------------------------------------------------ */
+/* Implementation selection                                                 */
+/* ------------------------------------------------------------------------ */
+
+static const struct value_string acc_names[] = {
+	{ CONV_ACC_GENERIC,	"generic" },
+	{ CONV_ACC_SCALAR,	"scalar" },
+	{ CONV_ACC_SSE2,	"sse2" },
+	{ CONV_ACC_SSE41,	"sse4.1" },
+	{ CONV_ACC_AVX2,	"avx2" },
+	{ 0, NULL }
+};
+
+static enum osmo_conv_acc_type acc_type;
+static acs_fn_t acc_fn;
+static int acc_selected;
+
+static acs_fn_t
+acc_type_fn(enum osmo_conv_acc_type type)
+{
+	switch (type) {
+	case CONV_ACC_SCALAR:
+		return acs_scalar;
+#ifdef CONV_ACC_X86
+	case CONV_ACC_SSE2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("sse2") ? acs_sse2 : NULL;
+	case CONV_ACC_SSE41:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("sse4.1") ? acs_sse41 : NULL;
+	case CONV_ACC_AVX2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") ? acs_avx2 : NULL;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+static void
+acc_select_default(void)
+{
+	enum osmo_conv_acc_type type;
+
+	if (acc_selected)
+		return;
+
+	for (type=CONV_ACC_AVX2; type>CONV_ACC_GENERIC; type--) {
+		if (acc_type_fn(type))
+			break;
+	}
+
+	osmo_conv_acc_set(type);
+}
+
+/*! \brief Check if an Add-Compare-Select implementation can be used
+ *  \param[in] type implementation
+ *  \returns 1 if supported by the build and the CPU, 0 otherwise
+ */
+int
+osmo_conv_acc_available(enum osmo_conv_acc_type type)
+{
+	return type == CONV_ACC_GENERIC || acc_type_fn(type) != NULL;
+}
+
+/*! \brief Select the Add-Compare-Select implementation for decoding
+ *  \param[in] type implementation to be used from now on
+ *  \returns 0 on success, -ENOTSUP if it is not available
+ *
+ * By default, the fastest implementation supported by the CPU is used.
+ */
+int
+osmo_conv_acc_set(enum osmo_conv_acc_type type)
+{
+	acs_fn_t fn = acc_type_fn(type);
+
+	if (type != CONV_ACC_GENERIC && !fn)
+		return -ENOTSUP;
+
+	acc_type = type;
+	acc_fn = fn;
+	acc_selected = 1;
+
+	return 0;
+}
+
+/*! \brief Get the Add-Compare-Select implementation used for decoding */
+enum osmo_conv_acc_type
+osmo_conv_acc_get(void)
+{
+	acc_select_default();
+	return acc_type;
+}
+
+/*! \brief Get a human readable name of an Add-Compare-Select
+ *         implementation */
+const char *
+osmo_conv_acc_name(enum osmo_conv_acc_type type)
+{
+	return get_value_string(acc_names, type);
+}
+
+
+/* ------------------------------------------------------------------------ */
+/* Per-code tables                                                          */
+/* ------------------------------------------------------------------------ */
+
+#define ACC_CACHE_SIZE 16
+
+static struct conv_acc_code *acc_cache[ACC_CACHE_SIZE];
+
+static void
+acc_code_free(struct conv_acc_code *acc)
+{
+	free(acc->puncture);
+	free(acc->punc);
+	free(acc);
+}
+
+/* Whether 'acc' was built from a code equal to 'code' and covers
+ * 'steps' trellis steps */
+static int
+acc_code_match(const struct conv_acc_code *acc,
+               const struct osmo_conv_code *code, int steps)
+{
+	int p;
+
+	if (acc->K != code->K || acc->N != code->N || acc->steps < steps)
+		return 0;
+
+	if (memcmp(acc->next_output, code->next_output, acc->n_states * 2) ||
+	    memcmp(acc->next_state, code->next_state, acc->n_states * 2))
+		return 0;
+
+	if (!acc->puncture || !code->puncture)
+		return acc->puncture == code->puncture;
+
+	for (p=0; acc->puncture[p] >= 0; p++) {
+		if (code->puncture[p] != acc->puncture[p])
+			return 0;
+	}
+
+	return code->puncture[p] < 0;
+}
+
+static struct conv_acc_code *
+acc_code_build(const struct osmo_conv_code *code, int steps)
+{
+	struct conv_acc_code *acc;
+	int n_states, half, s, b, j;
+
+	n_states = 1 << (code->K - 1);
+	half = n_states >> 1;
+
+	if (n_states < 8 || n_states > ACC_MAX_STATES || code->N > ACC_MAX_N)
+		return NULL;
+
+	/* only codes whose state register shifts left */
+	for (s=0; s<n_states; s++) {
+		if (code->next_state[s][0] == code->next_state[s][1])
+			return NULL;
+		for (b=0; b<2; b++) {
+			if ((code->next_state[s][b] >> 1) != (s & (half - 1)))
+				return NULL;
+		}
+	}
+
+	acc = calloc(1, sizeof(*acc));
+	if (!acc)
+		return NULL;
+
+	acc->K = code->K;
+	acc->N = code->N;
+	memcpy(acc->next_output, code->next_output, n_states * 2);
+	memcpy(acc->next_state, code->next_state, n_states * 2);
+	acc->steps = steps;
+	acc->n_states = n_states;
+	acc->half = half;
+
+	for (s=0; s<n_states; s++) {
+		int x = s >= half;
+
+		for (b=0; b<2; b++) {
+			int ns = code->next_state[s][b];
+			uint8_t out = code->next_output[s][b];
+
+			acc->out[x][ns] = out;
+			for (j=0; j<code->N; j++)
+				acc->mask[x][j][ns] =
+					(out >> (code->N - j - 1)) & 1 ? -1 : 0;
+		}
+	}
+
+	for (s=0; s<n_states; s++)
+		acc->pred[s] = s >> 1;
+
+	if (code->puncture) {
+		int p;
+
+		for (p=0; code->puncture[p] >= 0; p++);
+		acc->puncture = malloc((p + 1) * sizeof(int));
+		acc->punc = calloc(steps, 1);
+		if (!acc->puncture || !acc->punc) {
+			acc_code_free(acc);
+			return NULL;
+		}
+		memcpy(acc->puncture, code->puncture, (p + 1) * sizeof(int));
+
+		/* indexes beyond 'steps' are handled by the generic code */
+		for (p=0; code->puncture[p] >= 0; p++) {
+			int idx = code->puncture[p];
+			if (idx / code->N < steps)
+				acc->punc[idx / code->N] |= 1 << (idx % code->N);
+		}
+	}
+
+	return acc;
+}
+
+/* Get the tables for a decoder of 'len' data bits, NULL if the code
+ * can't be accelerated */
+void *
+conv_acc_get(const struct osmo_conv_code *code, int len)
+{
+	struct conv_acc_code *acc;
+	int steps = len + code->K - 1;
+	int i;
+
+	acc_select_default();
+	if (acc_type == CONV_ACC_GENERIC)
+		return NULL;
+
+	for (i=0; i<ACC_CACHE_SIZE; i++) {
+		acc = __atomic_load_n(&acc_cache[i], __ATOMIC_ACQUIRE);
+		if (acc && acc_code_match(acc, code, steps))
+			return acc;
+	}
+
+	acc = acc_code_build(code, steps);
+	if (!acc)
+		return NULL;
+
+	/* codes are usually static, keep their tables around.  Entries are
+	 * never removed, decoders of several threads may race for a slot */
+	acc->cached = 1;
+	for (i=0; i<ACC_CACHE_SIZE; i++) {
+		struct conv_acc_code *empty = NULL;
+
+		if (__atomic_compare_exchange_n(&acc_cache[i], &empty, acc, 0,
+				__ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			return acc;
+	}
+	acc->cached = 0;
+
+	return acc;
+}
+
+void
+conv_acc_put(void *_acc)
+{
+	struct conv_acc_code *acc = _acc;
+
+	if (acc && !acc->cached)
+		acc_code_free(acc);
+}
+
+/* Equivalent of the trellis walk of osmo_conv_decode_scan(), returns
+ * the number of consumed input symbols or -1 if it must be done by
+ * the generic code */
+int
+conv_acc_scan(struct osmo_conv_decoder *decoder,
+              const sbit_t *input, int n)
+{
+	const struct conv_acc_code *acc = decoder->acc;
+	int32_t t0[ACC_MAX_N], t1[ACC_MAX_N];
+	int32_t *ae, *ae_next, *tmp;
+	uint8_t *hist;
+	int i, j, i_idx, p_idx;
+	acs_fn_t fn = acc_fn;
+
+	if (!fn || decoder->o_idx + n > acc->steps)
+		return -1;
+
+	ae = (int32_t *) decoder->ae;
+	ae_next = (int32_t *) decoder->ae_next;
+	hist = &decoder->state_history[acc->n_states * decoder->o_idx];
+
+	i_idx = 0;
+	p_idx = decoder->p_idx;
+
+	for (i=0; i<n; i++)
+	{
+		uint8_t punc = acc->punc ? acc->punc[decoder->o_idx + i] : 0;
+
+		for (j=0; j<acc->N; j++) {
+			int is;
+
+			if (punc & (1 << j)) {
+				is = 0;	/* Undefined */
+				p_idx++;
+			} else
+				is = input[i_idx++];
+
+			/* squared/scaled error for an output bit of 0 (+127)
+			 * and 1 (-127), nothing for undefined symbols */
+			t0[j] = is ? ((is - 127) * (is - 127)) >> 9 : 0;
+			t1[j] = is ? ((is + 127) * (is + 127)) >> 9 : 0;
+		}
+
+		fn(acc, ae, ae_next, hist, t0, t1);
+		hist += acc->n_states;
+
+		tmp = ae;
+		ae = ae_next;
+		ae_next = tmp;
+	}
+
+	decoder->ae = (unsigned int *) ae;
+	decoder->ae_next = (unsigned int *) ae_next;
+
+	decoder->p_idx = p_idx;
+	decoder->o_idx += n;
+
+	return i_idx;
+}
+
+/*! @} */
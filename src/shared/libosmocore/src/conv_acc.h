@@ -0,0 +1,34 @@
+/*
+ * conv_acc.h
+ *
+ * Accelerated Viterbi Add-Compare-Select, internal interface to conv.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __OSMO_CONV_ACC_H__
+#define __OSMO_CONV_ACC_H__
+
+#include <osmocom/core/conv.h>
+
+/* same as in conv.c: accumulated error of an unreachable state */
+#define CONV_ACC_MAX_AE 0x00ffffff
+
+void *conv_acc_get(const struct osmo_conv_code *code, int len);
+void conv_acc_put(void *acc);
+int conv_acc_scan(struct osmo_conv_decoder *decoder,
+                  const sbit_t *input, int n);
+
+#endif /* __OSMO_CONV_ACC_H__ */
@@ -30,10 +30,196 @@
  *  \file Osmocom generic CRC routines (for max XX bits poly)
  */
 
+#include "config.h"
+
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <osmocom/core/bits.h>
-#include <osmocom/core/crcXXgen.h>
+#include <osmocom/core/crcgen.h>
+
+#include "crcgen_impl.h"
+
+#ifdef CRCGEN_X86
+#include <immintrin.h>
+#endif
+
+/* Table driven implementation
+ *
+ * The state is kept left aligned in a XX bit register, i.e. multiplied
+ * by x^(XX - code->bits), so that codes of any length up to XX bits
+ * share the same byte oriented code. Bytes are processed MSB first,
+ * like osmo_ubit2pbit() packs them.
+ */
+
+#define CRCXX_SLICES	((XX) > 16 ? 8 : 4)
+
+struct crcXX_table {
+	int bits;
+	uintXX_t poly;		/* left aligned */
+	/* t[k][b]: state after byte 'b' followed by 'k' zero bytes */
+	uintXX_t t[CRCXX_SLICES][256];
+#ifdef CRCGEN_X86
+	uint64_t k128;		/* x^128 mod P, P left aligned */
+	uint64_t k192;		/* x^192 mod P, P left aligned */
+#endif
+};
+
+static struct crcXX_table *crcXX_cache[CRCGEN_CACHE_SIZE];
+
+static inline uintXX_t
+crcXX_mask(int bits)
+{
+	return ((uintXX_t)~(uintXX_t)0) >> (XX - bits);
+}
+
+static inline uintXX_t
+crcXX_shift_bit(uintXX_t crc, uintXX_t poly)
+{
+	uintXX_t top = crc >> (XX - 1);
+	crc <<= 1;
+	return top ? crc ^ poly : crc;
+}
+
+static struct crcXX_table *
+crcXX_table_get(const struct osmo_crcXXgen_code *code)
+{
+	struct crcXX_table *tbl;
+	uintXX_t poly, r;
+	int i, b, k;
+
+	if (code->bits < 1 || code->bits > XX)
+		return NULL;
+
+	poly = (code->poly & crcXX_mask(code->bits)) << (XX - code->bits);
+
+	for (i=0; i<CRCGEN_CACHE_SIZE; i++) {
+		tbl = crcXX_cache[i];
+		if (!tbl)
+			break;
+		if (tbl->bits == code->bits && tbl->poly == poly)
+			return tbl;
+	}
+
+	/* cache full: callers fall back to the bitwise code */
+	if (i == CRCGEN_CACHE_SIZE)
+		return NULL;
+
+	tbl = malloc(sizeof(*tbl));
+	if (!tbl)
+		return NULL;
+
+	tbl->bits = code->bits;
+	tbl->poly = poly;
+
+	for (b=0; b<256; b++) {
+		r = (uintXX_t)b << (XX - 8);
+		for (k=0; k<8; k++)
+			r = crcXX_shift_bit(r, poly);
+		tbl->t[0][b] = r;
+	}
+
+	for (k=1; k<CRCXX_SLICES; k++) {
+		for (b=0; b<256; b++) {
+			r = tbl->t[k-1][b];
+			tbl->t[k][b] = (uintXX_t)(r << 8) ^
+			               tbl->t[0][r >> (XX - 8)];
+		}
+	}
+
+#ifdef CRCGEN_X86
+	/* x^n mod P, as needed to fold a 128 bit accumulator */
+	for (r=1, k=0; k<192; k++) {
+		r = crcXX_shift_bit(r, poly);
+		if (k == 127)
+			tbl->k128 = r;
+	}
+	tbl->k192 = r;
+#endif
+
+	crcXX_cache[i] = tbl;
+
+	return tbl;
+}
+
+static inline uintXX_t
+crcXX_table_byte(const struct crcXX_table *tbl, uintXX_t crc, uint8_t byte)
+{
+	return (uintXX_t)(crc << 8) ^ tbl->t[0][(crc >> (XX - 8)) ^ byte];
+}
+
+static inline uint64_t
+crcXX_load_be(const uint8_t *p, int n)
+{
+	uint64_t v = 0;
+	int i;
+
+	for (i=0; i<n; i++)
+		v = (v << 8) | p[i];
+
+	return v;
+}
+
+/* slice-by-N over whole bytes, 'crc' is left aligned */
+static uintXX_t
+crcXX_table_bytes(const struct crcXX_table *tbl, uintXX_t crc,
+                  const uint8_t *p, int n)
+{
+	const int S = CRCXX_SLICES * 8;
+	uint64_t v;
+	int j;
+
+	for (; n>=CRCXX_SLICES; n-=CRCXX_SLICES, p+=CRCXX_SLICES) {
+		v = crcXX_load_be(p, CRCXX_SLICES) ^ ((uint64_t)crc << (S - XX));
+		crc = 0;
+		for (j=0; j<CRCXX_SLICES; j++)
+			crc ^= tbl->t[CRCXX_SLICES-1-j][(v >> (S-8-8*j)) & 0xff];
+	}
+
+	for (; n>0; n--)
+		crc = crcXX_table_byte(tbl, crc, *p++);
+
+	return crc;
+}
+
+#ifdef CRCGEN_X86
+/* Fold 16 byte blocks into a 128 bit accumulator with carry-less
+ * multiplications by x^128 and x^192 mod P, then reduce the
+ * accumulator and the remaining bytes with the tables. Needs n >= 16 */
+__attribute__((target("pclmul,sse2")))
+static uintXX_t
+crcXX_pclmul_bytes(const struct crcXX_table *tbl, uintXX_t crc,
+                   const uint8_t *p, int n)
+{
+	__m128i acc, k, h, l;
+	uint64_t v[2];
+	uint8_t buf[16];
+	int i;
+
+	acc = _mm_set_epi64x(crcXX_load_be(p, 8) ^ ((uint64_t)crc << (64 - XX)),
+	                     crcXX_load_be(p + 8, 8));
+	k = _mm_set_epi64x(tbl->k192, tbl->k128);
+
+	for (p+=16, n-=16; n>=16; p+=16, n-=16) {
+		h = _mm_clmulepi64_si128(acc, k, 0x11);
+		l = _mm_clmulepi64_si128(acc, k, 0x00);
+		acc = _mm_xor_si128(_mm_xor_si128(h, l),
+			_mm_set_epi64x(crcXX_load_be(p, 8),
+			               crcXX_load_be(p + 8, 8)));
+	}
+
+	_mm_storeu_si128((__m128i *)v, acc);
+	for (i=0; i<8; i++) {
+		buf[i] = v[1] >> (56 - 8 * i);
+		buf[8+i] = v[0] >> (56 - 8 * i);
+	}
+
+	crc = crcXX_table_bytes(tbl, 0, buf, 16);
+
+	return crcXX_table_bytes(tbl, crc, p, n);
+}
+#endif /* CRCGEN_X86 */
 
 
 /*! \brief Compute the CRC value of a given array of hard-bits
@@ -46,20 +232,90 @@ uintXX_t
 osmo_crcXXgen_compute_bits(const struct osmo_crcXXgen_code *code,
                            const ubit_t *in, int len)
 {
+	const struct crcXX_table *tbl = NULL;
+	const uintXX_t mask = crcXX_mask(code->bits);
 	const uintXX_t poly = code->poly;
 	uintXX_t crc = code->init;
-	int i, n = code->bits-1;
+	int i = 0, j, n = code->bits-1;
+
+	if (osmo_crcgen_impl_get() != CRCGEN_BITWISE)
+		tbl = crcXX_table_get(code);
+
+	if (tbl) {
+		int d = XX - code->bits;
+		uint8_t byte;
+
+		crc = (uintXX_t)((crc & mask) << d);
+		for (; i+8<=len; i+=8) {
+			for (byte=0, j=0; j<8; j++)
+				byte = (byte << 1) | (in[i+j] & 1);
+			crc = crcXX_table_byte(tbl, crc, byte);
+		}
+		crc >>= d;
+	}
 
-	for (i=0; i<len; i++) {
+	for (; i<len; i++) {
 		uintXX_t bit = in[i] & 1;
 		crc ^= (bit << n);
-		if (crc & (1 << n)) {
+		if (crc & ((uintXX_t)1 << n)) {
 			crc <<= 1;
 			crc ^= poly;
 		} else {
 			crc <<= 1;
 		}
-		crc &= (1ULL << code->bits) - 1;
+		crc &= mask;
+	}
+
+	crc ^= code->remainder;
+
+	return crc;
+}
+
+/*! \brief Compute the CRC value of a given array of packed bits
+ *  \param[in] code The CRC code description to apply
+ *  \param[in] in Array of packed bits (MSB first)
+ *  \param[in] len Number of bits in the array
+ *  \returns The CRC value
+ *
+ * Same result as \ref osmo_crcXXgen_compute_bits on the unpacked bits.
+ */
+uintXX_t
+osmo_crcXXgen_compute_pbits(const struct osmo_crcXXgen_code *code,
+                            const pbit_t *in, int len)
+{
+	const struct crcXX_table *tbl = NULL;
+	const uintXX_t mask = crcXX_mask(code->bits);
+	enum osmo_crcgen_impl impl = osmo_crcgen_impl_get();
+	uintXX_t crc = code->init;
+	int i = 0, n = code->bits-1;
+
+	if (impl != CRCGEN_BITWISE)
+		tbl = crcXX_table_get(code);
+
+	if (tbl) {
+		int d = XX - code->bits;
+
+		crc = (uintXX_t)((crc & mask) << d);
+#ifdef CRCGEN_X86
+		if (impl == CRCGEN_PCLMUL && (len >> 3) >= CRCGEN_PCLMUL_MIN)
+			crc = crcXX_pclmul_bytes(tbl, crc, in, len >> 3);
+		else
+#endif
+			crc = crcXX_table_bytes(tbl, crc, in, len >> 3);
+		crc >>= d;
+		i = len & ~7;
+	}
+
+	for (; i<len; i++) {
+		uintXX_t bit = (in[i >> 3] >> (7 - (i & 7))) & 1;
+		crc ^= (bit << n);
+		if (crc & ((uintXX_t)1 << n)) {
+			crc <<= 1;
+			crc ^= code->poly;
+		} else {
+			crc <<= 1;
+		}
+		crc &= mask;
 	}
 
 	crc ^= code->remainder;
@@ -115,6 +371,61 @@ osmo_crcXXgen_set_bits(const struct osmo_crcXXgen_code *code,
 		crc_bits[i] = ((crc >> (code->bits-i-1)) & 1);
 }
 
+
+/*! \brief Checks the CRC value of a given array of packed bits
+ *  \param[in] code The CRC code description to apply
+ *  \param[in] in Array of packed bits (MSB first)
+ *  \param[in] len Number of bits in the array
+ *  \param[in] crc_bits Array of packed bits with the alleged CRC
+ *  \returns 0 if CRC matches. 1 in case of error.
+ *
+ * The crc_bits array must hold code->bits bits, MSB first
+ */
+int
+osmo_crcXXgen_check_pbits(const struct osmo_crcXXgen_code *code,
+                          const pbit_t *in, int len, const pbit_t *crc_bits)
+{
+	uintXX_t crc;
+	int i;
+
+	crc = osmo_crcXXgen_compute_pbits(code, in, len);
+
+	for (i=0; i<code->bits; i++)
+		if (((crc_bits[i >> 3] >> (7 - (i & 7))) & 1) ^
+		    ((crc >> (code->bits-i-1)) & 1))
+			return 1;
+
+	return 0;
+}
+
+
+/*! \brief Computes and writes the CRC value of a given array of packed bits
+ *  \param[in] code The CRC code description to apply
+ *  \param[in] in Array of packed bits (MSB first)
+ *  \param[in] len Number of bits in the array
+ *  \param[in] crc_bits Array of packed bits to write the computed CRC to
+ *
+ * The crc_bits array must hold code->bits bits, MSB first. Bits of its
+ * last byte beyond the CRC are left untouched.
+ */
+void
+osmo_crcXXgen_set_pbits(const struct osmo_crcXXgen_code *code,
+                        const pbit_t *in, int len, pbit_t *crc_bits)
+{
+	uintXX_t crc;
+	int i;
+
+	crc = osmo_crcXXgen_compute_pbits(code, in, len);
+
+	for (i=0; i<code->bits; i++) {
+		uint8_t m = 1 << (7 - (i & 7));
+		if ((crc >> (code->bits-i-1)) & 1)
+			crc_bits[i >> 3] |= m;
+		else
+			crc_bits[i >> 3] &= ~m;
+	}
+}
+
 /*! @} */
 
 /* vim: set syntax=c: */
@@ -0,0 +1,109 @@
+/*
+ * crcgen.c
+ *
+ * Implementation selection for the generic CRC routines
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*! \addtogroup crcgen
+ *  @{
+ */
+
+/*! \file crcgen.c
+ *  \file Osmocom generic CRC routines implementation selection
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stddef.h>
+
+#include <osmocom/core/crcgen.h>
+#include <osmocom/core/utils.h>
+
+#include "crcgen_impl.h"
+
+static const struct value_string crcgen_impl_names[] = {
+	{ CRCGEN_BITWISE,	"bitwise" },
+	{ CRCGEN_TABLE,		"table" },
+	{ CRCGEN_PCLMUL,	"pclmul" },
+	{ 0, NULL }
+};
+
+static enum osmo_crcgen_impl crcgen_impl;
+static int crcgen_selected;
+
+/*! \brief Check if a CRC implementation can be used
+ *  \param[in] impl implementation
+ *  \returns 1 if supported by the build and the CPU, 0 otherwise
+ */
+int
+osmo_crcgen_impl_available(enum osmo_crcgen_impl impl)
+{
+	switch (impl) {
+	case CRCGEN_BITWISE:
+	case CRCGEN_TABLE:
+		return 1;
+#ifdef CRCGEN_X86
+	case CRCGEN_PCLMUL:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("pclmul") &&
+		       __builtin_cpu_supports("sse2");
+#endif
+	default:
+		return 0;
+	}
+}
+
+/*! \brief Select the implementation of the generic CRC routines
+ *  \param[in] impl implementation to be used from now on
+ *  \returns 0 on success, -ENOTSUP if it is not available
+ *
+ * By default, the fastest implementation supported by the CPU is used.
+ */
+int
+osmo_crcgen_impl_set(enum osmo_crcgen_impl impl)
+{
+	if (!osmo_crcgen_impl_available(impl))
+		return -ENOTSUP;
+
+	crcgen_impl = impl;
+	crcgen_selected = 1;
+
+	return 0;
+}
+
+/*! \brief Get the implementation used by the generic CRC routines */
+enum osmo_crcgen_impl
+osmo_crcgen_impl_get(void)
+{
+	if (!crcgen_selected)
+		osmo_crcgen_impl_set(osmo_crcgen_impl_available(CRCGEN_PCLMUL) ?
+		                     CRCGEN_PCLMUL : CRCGEN_TABLE);
+
+	return crcgen_impl;
+}
+
+/*! \brief Get a human readable name of a CRC implementation */
+const char *
+osmo_crcgen_impl_name(enum osmo_crcgen_impl impl)
+{
+	return get_value_string(crcgen_impl_names, impl);
+}
+
+/*! @} */
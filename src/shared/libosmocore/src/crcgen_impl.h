@@ -0,0 +1,35 @@
+/*
+ * crcgen_impl.h
+ *
+ * Generic CRC routines, internal definitions shared by crcgen.c and
+ * the crcXXgen.c instances
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __OSMO_CRCGEN_IMPL_H__
+#define __OSMO_CRCGEN_IMPL_H__
+
+#if defined(HAVE_X86_SIMD_TARGETS) && (defined(__x86_64__) || defined(__i386__))
+#define CRCGEN_X86 1
+#endif
+
+/* number of distinct (bits, poly) pairs with cached tables, per width */
+#define CRCGEN_CACHE_SIZE	16
+
+/* shortest input (in bytes) worth folding with PCLMULQDQ */
+#define CRCGEN_PCLMUL_MIN	32
+
+#endif /* __OSMO_CRCGEN_IMPL_H__ */
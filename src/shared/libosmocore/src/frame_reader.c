@@ -0,0 +1,169 @@
+/* receive frames with a 16 bit length prefix from a stream socket */
+
+/* (C) 2026 by the osmocom-bb contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*! \addtogroup frame_reader
+ *  @{
+ */
+
+/*! \file frame_reader.c */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <osmocom/core/frame_reader.h>
+#include <osmocom/core/msgb.h>
+
+#define LEN_SIZE	2
+
+/*! \brief Initialize a frame reader
+ *  \param[in] fr the reader
+ *  \param[in] max_len largest frame accepted, without the length
+ *  \param[in] headroom headroom reserved in front of each frame
+ *  \param[in] name name of the msgbs handed out
+ *
+ * frame_cb and data are set by the caller afterwards.  The receive
+ * buffer is allocated on the first read.
+ */
+void osmo_frame_reader_init(struct osmo_frame_reader *fr, uint16_t max_len,
+			    uint16_t headroom, const char *name)
+{
+	memset(fr, 0, sizeof(*fr));
+	fr->name = name;
+	fr->max_len = max_len;
+	fr->headroom = headroom;
+	fr->buf_size = OSMO_FRAME_READER_BUF_SIZE;
+}
+
+/*! \brief Drop the receive buffer and a partially received frame
+ *
+ * To be called when the stream is closed.
+ */
+void osmo_frame_reader_reset(struct osmo_frame_reader *fr)
+{
+	if (fr->msg) {
+		msgb_free(fr->msg);
+		fr->msg = NULL;
+	}
+}
+
+static struct msgb *reader_alloc(struct osmo_frame_reader *fr)
+{
+	unsigned int size = fr->buf_size;
+
+	/* the headroom and at least one frame must fit */
+	if (size < fr->headroom + LEN_SIZE + fr->max_len)
+		size = fr->headroom + LEN_SIZE + fr->max_len;
+
+	return msgb_alloc_headroom(size, fr->headroom, fr->name);
+}
+
+/* hand out all complete frames in the receive buffer */
+static int reader_drain(struct osmo_frame_reader *fr)
+{
+	struct msgb *msg = fr->msg, *out;
+	unsigned int len;
+	int rc;
+
+	while (msg->len >= LEN_SIZE) {
+		len = (msg->data[0] << 8) | msg->data[1];
+		if (len == 0 || len > fr->max_len)
+			return -EBADMSG;
+		if (msg->len < LEN_SIZE + len)
+			break;
+
+		fr->stats.frames++;
+
+		/* the last frame read takes the buffer with it */
+		if (msg->len == LEN_SIZE + len) {
+			fr->msg = NULL;
+			msgb_pull(msg, LEN_SIZE);
+			msg->l1h = msg->data;
+			return fr->frame_cb(fr, msg);
+		}
+
+		out = msgb_alloc_headroom(fr->headroom + fr->max_len,
+					  fr->headroom, fr->name);
+		if (!out)
+			return -ENOMEM;
+		out->l1h = msgb_put(out, len);
+		memcpy(out->l1h, msg->data + LEN_SIZE, len);
+		msgb_pull(msg, LEN_SIZE + len);
+		fr->stats.copies++;
+
+		rc = fr->frame_cb(fr, out);
+		if (rc < 0)
+			return rc;
+		/* the callback has reset the reader */
+		if (fr->msg != msg)
+			return 0;
+	}
+
+	/* move a partial frame to the front, so all of it fits */
+	if (msg->data != msg->head + fr->headroom) {
+		memmove(msg->head + fr->headroom, msg->data, msg->len);
+		msg->data = msg->head + fr->headroom;
+		msg->tail = msg->data + msg->len;
+	}
+
+	return 0;
+}
+
+/*! \brief Read from a stream and hand out the complete frames
+ *  \param[in] fr the reader
+ *  \param[in] fd file descriptor of the stream
+ *  \returns 0 on success, also when no data was ready; -EIO when the
+ *  peer closed the stream, -EBADMSG on an invalid length, a negative
+ *  return of frame_cb or another negative errno
+ *
+ * One read() per call, meant to be called when select() reports the
+ * file descriptor readable.  On a negative return the stream can not
+ * be continued and should be closed.
+ */
+int osmo_frame_reader_read(struct osmo_frame_reader *fr, int fd)
+{
+	struct msgb *msg;
+	int rc;
+
+	if (!fr->msg) {
+		fr->msg = reader_alloc(fr);
+		if (!fr->msg)
+			return -ENOMEM;
+	}
+	msg = fr->msg;
+
+	rc = read(fd, msg->tail, msgb_tailroom(msg));
+	if (rc < 0) {
+		if (errno == EAGAIN || errno == EINTR)
+			return 0;
+		return -errno;
+	}
+	if (rc == 0)
+		return -EIO;
+
+	msgb_put(msg, rc);
+	fr->stats.reads++;
+
+	return reader_drain(fr);
+}
+
+/*! @} */
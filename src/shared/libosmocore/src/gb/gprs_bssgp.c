@@ -24,6 +24,7 @@
 
 #include <errno.h>
 #include <stdint.h>
+#include <time.h>
 
 #include <netinet/in.h>
 
@@ -60,12 +61,74 @@ LLIST_HEAD(bssgp_bvc_ctxts);
 static int _bssgp_tx_dl_ud(struct bssgp_flow_control *fc, struct msgb *msg,
 			   uint32_t llc_pdu_len, void *priv);
 
+#define BVC_HASH_BITS	12
+#define BVC_HASH_SIZE	(1 << BVC_HASH_BITS)
+
+/* hash buckets indexing bssgp_bvc_ctxts by (BVCI, NSEI) and (RA ID, CI) */
+static struct {
+	int initialized;
+	struct llist_head bvci_nsei[BVC_HASH_SIZE];
+	struct llist_head raid_cid[BVC_HASH_SIZE];
+} bvc_hash;
+
+static void bvc_hash_init(void)
+{
+	int i;
+
+	for (i = 0; i < BVC_HASH_SIZE; i++) {
+		INIT_LLIST_HEAD(&bvc_hash.bvci_nsei[i]);
+		INIT_LLIST_HEAD(&bvc_hash.raid_cid[i]);
+	}
+	bvc_hash.initialized = 1;
+}
+
+/* Fibonacci hashing of a 32bit key into BVC_HASH_BITS */
+static inline unsigned int bvc_hash32(uint32_t key)
+{
+	return (key * 0x9E3779B1U) >> (32 - BVC_HASH_BITS);
+}
+
+static inline unsigned int bvc_hash_bvci_nsei(uint16_t bvci, uint16_t nsei)
+{
+	return bvc_hash32(((uint32_t) nsei << 16) | bvci);
+}
+
+static inline unsigned int bvc_hash_raid_cid(const struct gprs_ra_id *raid,
+					     uint16_t cid)
+{
+	uint32_t key;
+
+	key = bvc_hash32(((uint32_t) raid->mcc << 16) | raid->mnc);
+	key = bvc_hash32(key ^ ((uint32_t) raid->lac << 16) ^ (raid->rac << 8));
+	return bvc_hash32(key ^ cid);
+}
+
+/*! \brief Re-index a BTS context in the lookup hashes
+ *  \param[in] bctx BTS context whose RA ID or Cell ID changed
+ *
+ *  Must be called whenever ra_id or cell_id of a BTS context allocated by
+ *  btsctx_alloc() is modified, otherwise btsctx_by_raid_cid() will not
+ *  find it.
+ */
+void btsctx_rehash(struct bssgp_bvc_ctx *bctx)
+{
+	llist_del(&bctx->hash.raid_cid);
+	llist_add(&bctx->hash.raid_cid,
+		  &bvc_hash.raid_cid[bvc_hash_raid_cid(&bctx->ra_id,
+						       bctx->cell_id)]);
+}
+
 /* Find a BTS Context based on parsed RA ID and Cell ID */
 struct bssgp_bvc_ctx *btsctx_by_raid_cid(const struct gprs_ra_id *raid, uint16_t cid)
 {
+	struct llist_head *bucket;
 	struct bssgp_bvc_ctx *bctx;
 
-	llist_for_each_entry(bctx, &bssgp_bvc_ctxts, list) {
+	if (!bvc_hash.initialized)
+		return NULL;
+
+	bucket = &bvc_hash.raid_cid[bvc_hash_raid_cid(raid, cid)];
+	llist_for_each_entry(bctx, bucket, hash.raid_cid) {
 		if (!memcmp(&bctx->ra_id, raid, sizeof(bctx->ra_id)) &&
 		    bctx->cell_id == cid)
 			return bctx;
@@ -76,9 +139,14 @@ struct bssgp_bvc_ctx *btsctx_by_raid_cid(const struct gprs_ra_id *raid, uint16_t
 /* Find a BTS context based on BVCI+NSEI tuple */
 struct bssgp_bvc_ctx *btsctx_by_bvci_nsei(uint16_t bvci, uint16_t nsei)
 {
+	struct llist_head *bucket;
 	struct bssgp_bvc_ctx *bctx;
 
-	llist_for_each_entry(bctx, &bssgp_bvc_ctxts, list) {
+	if (!bvc_hash.initialized)
+		return NULL;
+
+	bucket = &bvc_hash.bvci_nsei[bvc_hash_bvci_nsei(bvci, nsei)];
+	llist_for_each_entry(bctx, bucket, hash.bvci_nsei) {
 		if (bctx->nsei == nsei && bctx->bvci == bvci)
 			return bctx;
 	}
@@ -102,6 +170,14 @@ struct bssgp_bvc_ctx *btsctx_alloc(uint16_t bvci, uint16_t nsei)
 
 	llist_add(&ctx->list, &bssgp_bvc_ctxts);
 
+	if (!bvc_hash.initialized)
+		bvc_hash_init();
+	llist_add(&ctx->hash.bvci_nsei,
+		  &bvc_hash.bvci_nsei[bvc_hash_bvci_nsei(bvci, nsei)]);
+	llist_add(&ctx->hash.raid_cid,
+		  &bvc_hash.raid_cid[bvc_hash_raid_cid(&ctx->ra_id,
+						       ctx->cell_id)]);
+
 	return ctx;
 }
 
@@ -267,6 +343,7 @@ static int bssgp_rx_bvc_reset(struct msgb *msg, struct tlv_parsed *tp,
 		/* actually extract RAC / CID */
 		bctx->cell_id = bssgp_parse_cell_id(&bctx->ra_id,
 						TLVP_VAL(tp, BSSGP_IE_CELL_ID));
+		btsctx_rehash(bctx);
 		LOGP(DBSSGP, LOGL_NOTICE, "Cell %u-%u-%u-%u CI %u on BVCI %u\n",
 			bctx->ra_id.mcc, bctx->ra_id.mnc, bctx->ra_id.lac,
 			bctx->ra_id.rac, bctx->cell_id, bvci);
@@ -518,8 +595,6 @@ static int bssgp_rx_llc_disc(struct msgb *msg, struct tlv_parsed *tp,
 
 /* One element (msgb) in a BSSGP Flow Control queue */
 struct bssgp_fc_queue_element {
-	/* linked list of queue elements */
-	struct llist_head list;
 	/* The message that we have enqueued */
 	struct msgb *msg;
 	/* Length of the LLC PDU part of the contained message */
@@ -528,148 +603,148 @@ struct bssgp_fc_queue_element {
 	void *priv;
 };
 
-static int fc_queue_timer_cfg(struct bssgp_flow_control *fc);
-static int bssgp_fc_needs_queueing(struct bssgp_flow_control *fc, uint32_t pdu_len);
+#define NSEC_PER_SEC	1000000000ULL
 
-static void fc_timer_cb(void *data)
+static uint64_t fc_now(void)
 {
-	struct bssgp_flow_control *fc = data;
-	struct bssgp_fc_queue_element *fcqe;
-	struct timeval time_now;
-
-	/* if the queue is empty, we return without sending something
-	 * and without re-starting the timer */
-	if (llist_empty(&fc->queue))
-		return;
-
-	/* get the first entry from the queue */
-	fcqe = llist_entry(fc->queue.next, struct bssgp_fc_queue_element,
-			   list);
-
-	if (bssgp_fc_needs_queueing(fc, fcqe->llc_pdu_len)) {
-		LOGP(DBSSGP, LOGL_NOTICE, "BSSGP-FC: fc_timer_cb() but still "
-			"not able to send PDU of %u bytes\n", fcqe->llc_pdu_len);
-		/* make sure we re-start the timer */
-		fc_queue_timer_cfg(fc);
-		return;
-	}
+	struct timespec ts;
 
-	/* remove from the queue */
-	llist_del(&fcqe->list);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
 
-	fc->queue_depth--;
+/* According to Section 8.2: B' = B + L(p) - (Tc - Tp)*R must not exceed
+ * Bmax.  Instead of B and Tp we keep the time at which the bucket will
+ * have leaked empty, so B = (time_empty - Tc)*R and the PDU passes if
+ * max(time_empty, Tc) + L(p)/R - Tc <= Bmax/R.  Returns the number of
+ * nanoseconds until the PDU can pass, 0 if it can pass right now. */
+static uint64_t fc_delay(const struct bssgp_flow_control *fc,
+			 uint32_t pdu_len, uint64_t now, uint64_t *empty)
+{
+	uint64_t start, limit;
 
-	/* record the time we transmitted this PDU */
-	gettimeofday(&time_now, NULL);
-	fc->time_last_pdu = time_now;
+	/* a bucket that does not leak never lets anything pass, try
+	 * again once a second for a FLOW-CONTROL-BVC to change that */
+	if (!fc->bucket_leak_rate)
+		return NSEC_PER_SEC;
 
-	/* call the output callback for this FC instance */
-	fc->out_cb(fcqe->priv, fcqe->msg, fcqe->llc_pdu_len, NULL);
+	start = fc->time_empty > now ? fc->time_empty : now;
+	*empty = start + pdu_len * NSEC_PER_SEC / fc->bucket_leak_rate;
+	limit = fc->bucket_size_max * NSEC_PER_SEC / fc->bucket_leak_rate;
 
-	/* we expect that out_cb will in the end free the msgb once
-	 * it is no longer needed */
+	if (*empty - now <= limit)
+		return 0;
 
-	/* but we have to free the queue element ourselves */
-	talloc_free(fcqe);
+	return *empty - now - limit;
+}
 
-	/* re-configure the timer for the next PDU */
-	fc_queue_timer_cfg(fc);
+/* Account a PDU that fc_delay() has let pass */
+static void fc_pass(struct bssgp_flow_control *fc, uint64_t now,
+		    uint64_t empty)
+{
+	fc->time_empty = empty;
+	fc->bucket_counter = (empty - now) * fc->bucket_leak_rate / NSEC_PER_SEC;
 }
 
+static void fc_timer_cb(void *data);
+
 /* configure/schedule the flow control timer to expire once the bucket
  * will have leaked a sufficient number of bytes to transmit the next
  * PDU in the queue */
-static int fc_queue_timer_cfg(struct bssgp_flow_control *fc)
+static void fc_queue_timer_cfg(struct bssgp_flow_control *fc,
+			       uint64_t delay)
 {
-	struct bssgp_fc_queue_element *fcqe;
-	uint32_t msecs;
+	/* round up, an early timer would only have to be re-armed */
+	delay = (delay + 999) / 1000;
 
-	if (llist_empty(&fc->queue))
-		return 0;
+	fc->timer.data = fc;
+	fc->timer.cb = &fc_timer_cb;
+	osmo_timer_schedule(&fc->timer, delay / 1000000, delay % 1000000);
+}
 
-	fcqe = llist_entry(&fc->queue.next, struct bssgp_fc_queue_element,
-			   list);
+static void fc_timer_cb(void *data)
+{
+	struct bssgp_flow_control *fc = data;
+	struct bssgp_fc_queue_element fcqe;
+	uint64_t now = fc_now(), delay, empty;
+	int sent = 0;
+
+	/* send everything that has become due, if the queue is empty we
+	 * return without re-starting the timer */
+	while (fc->queue_depth) {
+		fcqe = fc->queue[fc->queue_head];
+
+		delay = fc_delay(fc, fcqe.llc_pdu_len, now, &empty);
+		if (delay) {
+			if (!sent)
+				LOGP(DBSSGP, LOGL_NOTICE, "BSSGP-FC: "
+					"fc_timer_cb() but still not able to "
+					"send PDU of %u bytes\n",
+					fcqe.llc_pdu_len);
+			/* re-configure the timer for the next PDU */
+			fc_queue_timer_cfg(fc, delay);
+			return;
+		}
 
-	/* Calculate the point in time at which we will have leaked
-	 * a sufficient number of bytes from the bucket to transmit
-	 * the first PDU in the queue */
-	msecs = (fcqe->llc_pdu_len * 1000) / fc->bucket_leak_rate;
-	/* FIXME: add that time to fc->time_last_pdu and subtract it from
-	 * current time */
+		/* remove from the queue */
+		if (++fc->queue_head == fc->queue_size)
+			fc->queue_head = 0;
+		fc->queue_depth--;
 
-	fc->timer.data = fc;
-	fc->timer.cb = &fc_timer_cb;
-	osmo_timer_schedule(&fc->timer, msecs / 1000, (msecs % 1000) * 1000);
+		fc_pass(fc, now, empty);
+		sent++;
+
+		/* call the output callback for this FC instance, we
+		 * expect that out_cb will in the end free the msgb once
+		 * it is no longer needed */
+		fc->out_cb(fcqe.priv, fcqe.msg, fcqe.llc_pdu_len, NULL);
+	}
+}
+
+/* Make room for max_queue_depth elements, preserving the queue order */
+static int fc_queue_grow(struct bssgp_flow_control *fc)
+{
+	struct bssgp_fc_queue_element *queue;
+	uint32_t i;
+
+	queue = talloc_array(fc, struct bssgp_fc_queue_element,
+			     fc->max_queue_depth);
+	if (!queue)
+		return -ENOMEM;
+
+	for (i = 0; i < fc->queue_depth; i++)
+		queue[i] = fc->queue[(fc->queue_head + i) % fc->queue_size];
+
+	talloc_free(fc->queue);
+	fc->queue = queue;
+	fc->queue_size = fc->max_queue_depth;
+	fc->queue_head = 0;
 
 	return 0;
 }
 
 /* Enqueue a PDU in the flow control queue for delayed transmission */
 static int fc_enqueue(struct bssgp_flow_control *fc, struct msgb *msg,
-		      uint32_t llc_pdu_len, void *priv)
+		      uint32_t llc_pdu_len, void *priv, uint64_t delay)
 {
 	struct bssgp_fc_queue_element *fcqe;
 
 	if (fc->queue_depth >= fc->max_queue_depth)
 		return -ENOSPC;
 
-	fcqe = talloc_zero(fc, struct bssgp_fc_queue_element);
-	if (!fcqe)
+	/* the ring is only (re)allocated when it has to grow */
+	if (fc->queue_depth == fc->queue_size && fc_queue_grow(fc) < 0)
 		return -ENOMEM;
+
+	fcqe = &fc->queue[(fc->queue_head + fc->queue_depth) % fc->queue_size];
 	fcqe->msg = msg;
 	fcqe->llc_pdu_len = llc_pdu_len;
 	fcqe->priv = priv;
 
-	llist_add_tail(&fcqe->list, &fc->queue);
-
-	fc->queue_depth++;
-
-	/* re-configure the timer for dequeueing the pdu */
-	fc_queue_timer_cfg(fc);
-
-	return 0;
-}
-
-/* According to Section 8.2 */
-static int bssgp_fc_needs_queueing(struct bssgp_flow_control *fc, uint32_t pdu_len)
-{
-	struct timeval time_now, time_diff;
-	int64_t bucket_predicted;
-	uint32_t csecs_elapsed, leaked;
-
-	/* B' = B + L(p) - (Tc - Tp)*R */
-
-	/* compute number of centi-seconds that have elapsed since transmitting
-	 * the last PDU (Tc - Tp) */
-	gettimeofday(&time_now, NULL);
-	timersub(&time_now, &fc->time_last_pdu, &time_diff);
-	csecs_elapsed = time_diff.tv_sec*100 + time_diff.tv_usec/10000;
-
-	/* compute number of bytes that have leaked in the elapsed number
-	 * of centi-seconds */
-	leaked = csecs_elapsed * (fc->bucket_leak_rate / 100);
-	/* add the current PDU length to the last bucket level */
-	bucket_predicted = fc->bucket_counter + pdu_len;
-	/* ... and subtract the number of leaked bytes */
-	bucket_predicted -= leaked;
-
-	if (bucket_predicted < pdu_len) {
-		/* this is just to make sure the bucket doesn't underflow */
-		bucket_predicted = pdu_len;
-		goto pass;
-	}
-
-	if (bucket_predicted <= fc->bucket_size_max) {
-		/* the bucket is not full yet, we can pass the packet */
-		fc->bucket_counter = bucket_predicted;
-		goto pass;
-	}
+	/* the timer only needs to be started for the head of the queue */
+	if (fc->queue_depth++ == 0)
+		fc_queue_timer_cfg(fc, delay);
 
-	/* bucket is full, PDU needs to be delayed */
-	return 1;
-
-pass:
-	/* if we reach here, the PDU can pass */
 	return 0;
 }
 
@@ -686,7 +761,7 @@ static int _bssgp_tx_dl_ud(struct bssgp_flow_control *fc, struct msgb *msg,
 int bssgp_fc_in(struct bssgp_flow_control *fc, struct msgb *msg,
 		uint32_t llc_pdu_len, void *priv)
 {
-	struct timeval time_now;
+	uint64_t now, delay, empty;
 
 	if (llc_pdu_len > fc->bucket_size_max) {
 		LOGP(DBSSGP, LOGL_NOTICE, "Single PDU (size=%u) is larger "
@@ -695,18 +770,23 @@ int bssgp_fc_in(struct bssgp_flow_control *fc, struct msgb *msg,
 		return -EIO;
 	}
 
-	if (bssgp_fc_needs_queueing(fc, llc_pdu_len)) {
-		return fc_enqueue(fc, msg, llc_pdu_len, priv);
-	} else {
-		/* record the time we transmitted this PDU */
-		gettimeofday(&time_now, NULL);
-		fc->time_last_pdu = time_now;
-		return fc->out_cb(priv, msg, llc_pdu_len, NULL);
-	}
+	now = fc_now();
+
+	/* PDUs must not overtake those already waiting in the queue */
+	if (fc->queue_depth)
+		return fc_enqueue(fc, msg, llc_pdu_len, priv, 0);
+
+	delay = fc_delay(fc, llc_pdu_len, now, &empty);
+	if (delay)
+		return fc_enqueue(fc, msg, llc_pdu_len, priv, delay);
+
+	fc_pass(fc, now, empty);
+	return fc->out_cb(priv, msg, llc_pdu_len, NULL);
 }
 
 
-/* Initialize the Flow Control structure */
+/* Initialize the Flow Control structure, an already allocated queue
+ * is kept */
 void bssgp_fc_init(struct bssgp_flow_control *fc,
 		   uint32_t bucket_size_max, uint32_t bucket_leak_rate,
 		   uint32_t max_queue_depth,
@@ -717,8 +797,8 @@ void bssgp_fc_init(struct bssgp_flow_control *fc,
 	fc->bucket_size_max = bucket_size_max;
 	fc->bucket_leak_rate = bucket_leak_rate;
 	fc->max_queue_depth = max_queue_depth;
-	INIT_LLIST_HEAD(&fc->queue);
-	gettimeofday(&fc->time_last_pdu, NULL);
+	fc->bucket_counter = 0;
+	fc->time_empty = 0;
 }
 
 /* Initialize the Flow Control parameters for a new MS according to
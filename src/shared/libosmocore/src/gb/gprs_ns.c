@@ -61,11 +61,15 @@
  *  o There are no BLOCK and UNBLOCK timers (yet?)
  */
 
+#define _GNU_SOURCE	/* recvmmsg(), sendmmsg() */
+
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
 #include <stdint.h>
 
+#include "config.h"
+
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
@@ -100,6 +104,8 @@ enum ns_ctr {
 	NS_CTR_BYTES_OUT,
 	NS_CTR_BLOCKED,
 	NS_CTR_DEAD,
+	NS_CTR_PKTS_OUT_DELAYED,
+	NS_CTR_PKTS_OUT_DROP,
 };
 
 static const struct rate_ctr_desc nsvc_ctr_description[] = {
@@ -109,6 +115,8 @@ static const struct rate_ctr_desc nsvc_ctr_description[] = {
 	{ "bytes.out",	"Bytes at NS Level   (Out)" },
 	{ "blocked",	"NS-VC Block count        " },
 	{ "dead",	"NS-VC gone dead count    " },
+	{ "packets.out.delayed", "Packets queued on blocked socket" },
+	{ "packets.out.drop", "Packets dropped at queue limit" },
 };
 
 static const struct rate_ctr_group_desc nsvc_ctrg_desc = {
@@ -118,6 +126,54 @@ static const struct rate_ctr_group_desc nsvc_ctrg_desc = {
 	.ctr_desc = nsvc_ctr_description,
 };
 
+/* Fibonacci hashing of a 32bit key into GPRS_NS_HASH_BITS */
+static inline unsigned int ns_hash(uint32_t key)
+{
+	return (key * 0x9E3779B1U) >> (32 - GPRS_NS_HASH_BITS);
+}
+
+static inline unsigned int ns_hash_addr(const struct sockaddr_in *sin)
+{
+	return ns_hash(sin->sin_addr.s_addr
+		       ^ ((uint32_t) sin->sin_port << 16));
+}
+
+static void nsvc_hash_add(struct gprs_nsvc *nsvc)
+{
+	struct gprs_ns_inst *nsi = nsvc->nsi;
+
+	llist_add(&nsvc->hash.nsvci, &nsi->hash.nsvci[ns_hash(nsvc->nsvci)]);
+	llist_add(&nsvc->hash.nsei, &nsi->hash.nsei[ns_hash(nsvc->nsei)]);
+	llist_add(&nsvc->hash.addr,
+		  &nsi->hash.addr[ns_hash_addr(&nsvc->ip.bts_addr)]);
+}
+
+/* Remove a NS-VC from the hash buckets.  Entries are re-initialized, so
+ * a NS-VC that is not (or no longer) indexed has empty hash entries */
+static void nsvc_hash_del(struct gprs_nsvc *nsvc)
+{
+	llist_del_init(&nsvc->hash.nsvci);
+	llist_del_init(&nsvc->hash.nsei);
+	llist_del_init(&nsvc->hash.addr);
+}
+
+/*! \brief Re-index a NS-VC in the lookup hashes of its NS instance
+ *  \param[in] nsvc gprs_nsvc whose NSEI, NSVCI or remote address changed
+ *
+ *  Must be called whenever one of the lookup keys of a NS-VC is modified
+ *  outside of this library, otherwise gprs_nsvc_by_nsvci(),
+ *  gprs_nsvc_by_nsei() and the lookup of incoming frames will not find it.
+ */
+void gprs_nsvc_rehash(struct gprs_nsvc *nsvc)
+{
+	/* the unknown_nsvc is never indexed */
+	if (llist_empty(&nsvc->hash.nsvci))
+		return;
+
+	nsvc_hash_del(nsvc);
+	nsvc_hash_add(nsvc);
+}
+
 /*! \brief Lookup struct gprs_nsvc based on NSVCI
  *  \param[in] nsi NS instance in which to search
  *  \param[in] nsvci NSVCI to be searched
@@ -126,7 +182,8 @@ static const struct rate_ctr_group_desc nsvc_ctrg_desc = {
 struct gprs_nsvc *gprs_nsvc_by_nsvci(struct gprs_ns_inst *nsi, uint16_t nsvci)
 {
 	struct gprs_nsvc *nsvc;
-	llist_for_each_entry(nsvc, &nsi->gprs_nsvcs, list) {
+	llist_for_each_entry(nsvc, &nsi->hash.nsvci[ns_hash(nsvci)],
+			     hash.nsvci) {
 		if (nsvc->nsvci == nsvci)
 			return nsvc;
 	}
@@ -141,7 +198,8 @@ struct gprs_nsvc *gprs_nsvc_by_nsvci(struct gprs_ns_inst *nsi, uint16_t nsvci)
 struct gprs_nsvc *gprs_nsvc_by_nsei(struct gprs_ns_inst *nsi, uint16_t nsei)
 {
 	struct gprs_nsvc *nsvc;
-	llist_for_each_entry(nsvc, &nsi->gprs_nsvcs, list) {
+	llist_for_each_entry(nsvc, &nsi->hash.nsei[ns_hash(nsei)],
+			     hash.nsei) {
 		if (nsvc->nsei == nsei)
 			return nsvc;
 	}
@@ -153,7 +211,8 @@ static struct gprs_nsvc *nsvc_by_rem_addr(struct gprs_ns_inst *nsi,
 					  struct sockaddr_in *sin)
 {
 	struct gprs_nsvc *nsvc;
-	llist_for_each_entry(nsvc, &nsi->gprs_nsvcs, list) {
+	llist_for_each_entry(nsvc, &nsi->hash.addr[ns_hash_addr(sin)],
+			     hash.addr) {
 		if (nsvc->ip.bts_addr.sin_addr.s_addr ==
 					sin->sin_addr.s_addr &&
 		    nsvc->ip.bts_addr.sin_port == sin->sin_port)
@@ -163,6 +222,7 @@ static struct gprs_nsvc *nsvc_by_rem_addr(struct gprs_ns_inst *nsi,
 }
 
 static void gprs_ns_timer_cb(void *data);
+static void nsip_purge(struct gprs_nsvc *nsvc);
 
 struct gprs_nsvc *gprs_nsvc_create(struct gprs_ns_inst *nsi, uint16_t nsvci)
 {
@@ -180,6 +240,7 @@ struct gprs_nsvc *gprs_nsvc_create(struct gprs_ns_inst *nsi, uint16_t nsvci)
 	nsvc->ctrg = rate_ctr_group_alloc(nsvc, &nsvc_ctrg_desc, nsvci);
 
 	llist_add(&nsvc->list, &nsi->gprs_nsvcs);
+	nsvc_hash_add(nsvc);
 
 	return nsvc;
 }
@@ -192,6 +253,8 @@ void gprs_nsvc_delete(struct gprs_nsvc *nsvc)
 	if (osmo_timer_pending(&nsvc->timer))
 		osmo_timer_del(&nsvc->timer);
 	llist_del(&nsvc->list);
+	nsvc_hash_del(nsvc);
+	nsip_purge(nsvc);
 	talloc_free(nsvc);
 }
 
@@ -683,6 +746,7 @@ static int gprs_ns_rx_reset(struct gprs_nsvc *nsvc, struct msgb *msg)
 
 	nsvc->nsei = ntohs(*nsei);
 	nsvc->nsvci = ntohs(*nsvci);
+	gprs_nsvc_rehash(nsvc);
 
 	/* start the test procedure */
 	gprs_ns_tx_simple(nsvc, NS_PDUT_ALIVE);
@@ -807,6 +871,7 @@ int gprs_ns_rcvmsg(struct gprs_ns_inst *nsi, struct msgb *msg,
 		}
 		/* Update the remote peer IP address/port */
 		nsvc->ip.bts_addr = *saddr;
+		gprs_nsvc_rehash(nsvc);
 	} else
 		msgb_nsei(msg) = nsvc->nsei;
 
@@ -898,9 +963,17 @@ int gprs_ns_rcvmsg(struct gprs_ns_inst *nsi, struct msgb *msg,
 struct gprs_ns_inst *gprs_ns_instantiate(gprs_ns_cb_t *cb, void *ctx)
 {
 	struct gprs_ns_inst *nsi = talloc_zero(ctx, struct gprs_ns_inst);
+	int i;
 
 	nsi->cb = cb;
 	INIT_LLIST_HEAD(&nsi->gprs_nsvcs);
+	INIT_LLIST_HEAD(&nsi->nsip.tx_queue);
+	nsi->nsip.tx_queue_max = GPRS_NSIP_TXQ_MAX;
+	for (i = 0; i < GPRS_NS_HASH_SIZE; i++) {
+		INIT_LLIST_HEAD(&nsi->hash.nsvci[i]);
+		INIT_LLIST_HEAD(&nsi->hash.nsei[i]);
+		INIT_LLIST_HEAD(&nsi->hash.addr[i]);
+	}
 	nsi->timeout[NS_TOUT_TNS_BLOCK] = 3;
 	nsi->timeout[NS_TOUT_TNS_BLOCK_RETRIES] = 3;
 	nsi->timeout[NS_TOUT_TNS_RESET] = 3;
@@ -913,6 +986,7 @@ struct gprs_ns_inst *gprs_ns_instantiate(gprs_ns_cb_t *cb, void *ctx)
 	 * messages to non-existant/unknown NS-VC's */
 	nsi->unknown_nsvc = gprs_nsvc_create(nsi, 0xfffe);
 	llist_del(&nsi->unknown_nsvc->list);
+	nsvc_hash_del(nsi->unknown_nsvc);
 
 	return nsi;
 }
@@ -926,11 +1000,16 @@ struct gprs_ns_inst *gprs_ns_instantiate(gprs_ns_cb_t *cb, void *ctx)
 void gprs_ns_destroy(struct gprs_ns_inst *nsi)
 {
 	struct gprs_nsvc *nsvc, *nsvc2;
+	int i;
 
-	/* delete all NSVCs and clear their timers */
+	/* delete all NSVCs and clear their timers, this also drops
+	 * whatever they still had in the tx queue */
 	llist_for_each_entry_safe(nsvc, nsvc2, &nsi->gprs_nsvcs, list)
 		gprs_nsvc_delete(nsvc);
 
+	for (i = 0; i < GPRS_NSIP_BATCH; i++)
+		msgb_free(nsi->nsip.rx_msgs[i]);
+
 	/* close socket and unregister */
 	if (nsi->nsip.fd.data) {
 		close(nsi->nsip.fd.fd);
@@ -945,60 +1024,243 @@ void gprs_ns_destroy(struct gprs_ns_inst *nsi)
 /* NS-over-IP code, according to 3GPP TS 48.016 Chapter 6.2
  * We don't support Size Procedure, Configuration Procedure, ChangeWeight Procedure */
 
-/* Read a single NS-over-IP message */
-static struct msgb *read_nsip_msg(struct osmo_fd *bfd, int *error,
-				  struct sockaddr_in *saddr)
+static inline unsigned int nsip_batch_hist(unsigned int n)
 {
-	struct msgb *msg = gprs_ns_msgb_alloc();
-	int ret = 0;
-	socklen_t saddr_len = sizeof(*saddr);
+	unsigned int b = 0;
+
+	while (n >>= 1)
+		b++;
+
+	return b < GPRS_NSIP_BATCH_HIST ? b : GPRS_NSIP_BATCH_HIST - 1;
+}
+
+/* Make sure every receive slot holds an empty NS msgb, returns the
+ * number of usable slots */
+static int nsip_rx_refill(struct gprs_ns_inst *nsi)
+{
+	int i;
+
+	for (i = 0; i < GPRS_NSIP_BATCH; i++) {
+		struct msgb *msg = nsi->nsip.rx_msgs[i];
+
+		if (!msg) {
+			msg = gprs_ns_msgb_alloc();
+			if (!msg)
+				break;
+			nsi->nsip.rx_msgs[i] = msg;
+		} else {
+			/* gprs_ns_rcvmsg() never keeps the msgb, but the
+			 * upper layer may have pulled it, even to length 0 */
+			msgb_reset(msg);
+			msgb_reserve(msg, NS_ALLOC_HEADROOM);
+		}
+	}
+
+	return i ? i : -ENOMEM;
+}
+
+/* Receive up to GPRS_NSIP_BATCH datagrams into the receive slots */
+static int nsip_recv_batch(struct gprs_ns_inst *nsi, int num,
+			   struct sockaddr_in *saddr, int *len)
+{
+	struct osmo_fd *bfd = &nsi->nsip.fd;
+	int i;
+#ifdef HAVE_RECVMMSG
+	struct mmsghdr mmsg[GPRS_NSIP_BATCH];
+	struct iovec iov[GPRS_NSIP_BATCH];
+	int n;
+
+	memset(mmsg, 0, sizeof(mmsg[0]) * num);
+	for (i = 0; i < num; i++) {
+		iov[i].iov_base = nsi->nsip.rx_msgs[i]->data;
+		iov[i].iov_len = msgb_tailroom(nsi->nsip.rx_msgs[i]);
+		mmsg[i].msg_hdr.msg_iov = &iov[i];
+		mmsg[i].msg_hdr.msg_iovlen = 1;
+		mmsg[i].msg_hdr.msg_name = &saddr[i];
+		mmsg[i].msg_hdr.msg_namelen = sizeof(saddr[i]);
+	}
+
+	n = recvmmsg(bfd->fd, mmsg, num, MSG_DONTWAIT, NULL);
+	for (i = 0; i < n; i++)
+		len[i] = mmsg[i].msg_len;
 
-	if (!msg) {
-		*error = -ENOMEM;
-		return NULL;
+	return n;
+#else
+	for (i = 0; i < num; i++) {
+		socklen_t saddr_len = sizeof(saddr[i]);
+
+		len[i] = recvfrom(bfd->fd, nsi->nsip.rx_msgs[i]->data,
+				  msgb_tailroom(nsi->nsip.rx_msgs[i]),
+				  MSG_DONTWAIT, (struct sockaddr *)&saddr[i],
+				  &saddr_len);
+		if (len[i] < 0)
+			break;
 	}
 
-	ret = recvfrom(bfd->fd, msg->data, NS_ALLOC_SIZE - NS_ALLOC_HEADROOM, 0,
-			(struct sockaddr *)saddr, &saddr_len);
-	if (ret < 0) {
+	return i ? i : -1;
+#endif
+}
+
+static void nsip_flush(struct gprs_ns_inst *nsi);
+
+/* Drain the socket in batches and dispatch every datagram; anything sent
+ * in response is queued and flushed together after the batch */
+static int handle_nsip_read(struct osmo_fd *bfd)
+{
+	struct gprs_ns_inst *nsi = bfd->data;
+	struct sockaddr_in saddr[GPRS_NSIP_BATCH];
+	int len[GPRS_NSIP_BATCH];
+	int i, n, rc = 0;
+
+	n = nsip_rx_refill(nsi);
+	if (n < 0)
+		return n;
+
+	n = nsip_recv_batch(nsi, n, saddr, len);
+	if (n < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return 0;
 		LOGP(DNS, LOGL_ERROR, "recv error %s during NSIP recv\n",
 			strerror(errno));
+		return -errno;
+	}
+
+	nsi->nsip.stats.rx_calls++;
+	nsi->nsip.stats.rx_msgs += n;
+	nsi->nsip.stats.rx_batch[nsip_batch_hist(n)]++;
+
+	nsi->nsip.in_rx = 1;
+	for (i = 0; i < n; i++) {
+		struct msgb *msg = nsi->nsip.rx_msgs[i];
+
+		if (len[i] == 0)
+			continue;
+
+		msg->l2h = msg->data;
+		msgb_put(msg, len[i]);
+
+		rc = gprs_ns_rcvmsg(nsi, msg, &saddr[i], GPRS_NS_LL_UDP);
+	}
+	nsi->nsip.in_rx = 0;
+
+	nsip_flush(nsi);
+
+	return rc;
+}
+
+static void nsip_dequeue(struct gprs_ns_inst *nsi, struct msgb *msg)
+{
+	struct gprs_nsvc *nsvc = msg->dst;
+
+	llist_del(&msg->list);
+	nsi->nsip.tx_queue_len--;
+	nsvc->tx_queued--;
+}
+
+/* Drop all queued PDUs of a NS-VC that is going away */
+static void nsip_purge(struct gprs_nsvc *nsvc)
+{
+	struct gprs_ns_inst *nsi = nsvc->nsi;
+	struct msgb *msg, *msg2;
+
+	if (!nsvc->tx_queued)
+		return;
+
+	llist_for_each_entry_safe(msg, msg2, &nsi->nsip.tx_queue, list) {
+		if (msg->dst != nsvc)
+			continue;
+		nsip_dequeue(nsi, msg);
 		msgb_free(msg);
-		*error = ret;
-		return NULL;
-	} else if (ret == 0) {
-		msgb_free(msg);
-		*error = ret;
-		return NULL;
 	}
+}
+
+/* Send up to num queued PDUs, returns the number sent or -1 with errno */
+static int nsip_send_batch(struct gprs_ns_inst *nsi, struct msgb **msgs,
+			   int num)
+{
+	int i;
+#ifdef HAVE_SENDMMSG
+	struct mmsghdr mmsg[GPRS_NSIP_BATCH];
+	struct iovec iov[GPRS_NSIP_BATCH];
+
+	memset(mmsg, 0, sizeof(mmsg[0]) * num);
+	for (i = 0; i < num; i++) {
+		struct gprs_nsvc *nsvc = msgs[i]->dst;
+
+		iov[i].iov_base = msgs[i]->data;
+		iov[i].iov_len = msgs[i]->len;
+		mmsg[i].msg_hdr.msg_iov = &iov[i];
+		mmsg[i].msg_hdr.msg_iovlen = 1;
+		mmsg[i].msg_hdr.msg_name = &nsvc->ip.bts_addr;
+		mmsg[i].msg_hdr.msg_namelen = sizeof(nsvc->ip.bts_addr);
+	}
+
+	return sendmmsg(nsi->nsip.fd.fd, mmsg, num, MSG_DONTWAIT);
+#else
+	for (i = 0; i < num; i++) {
+		struct gprs_nsvc *nsvc = msgs[i]->dst;
 
-	msg->l2h = msg->data;
-	msgb_put(msg, ret);
+		if (sendto(nsi->nsip.fd.fd, msgs[i]->data, msgs[i]->len,
+			   MSG_DONTWAIT, (struct sockaddr *)&nsvc->ip.bts_addr,
+			   sizeof(nsvc->ip.bts_addr)) < 0)
+			break;
+	}
 
-	return msg;
+	return i ? i : -1;
+#endif
 }
 
-static int handle_nsip_read(struct osmo_fd *bfd)
+/* Flush the tx queue until it is empty or the socket blocks.  A blocked
+ * socket keeps the PDUs queued and waits for BSC_FD_WRITE. */
+static void nsip_flush(struct gprs_ns_inst *nsi)
 {
-	int error;
-	struct sockaddr_in saddr;
-	struct gprs_ns_inst *nsi = bfd->data;
-	struct msgb *msg = read_nsip_msg(bfd, &error, &saddr);
+	struct msgb *msgs[GPRS_NSIP_BATCH];
+	struct msgb *msg;
+	int i, n, rc;
+
+	while (!llist_empty(&nsi->nsip.tx_queue)) {
+		n = 0;
+		llist_for_each_entry(msg, &nsi->nsip.tx_queue, list) {
+			msgs[n++] = msg;
+			if (n == GPRS_NSIP_BATCH)
+				break;
+		}
 
-	if (!msg)
-		return error;
+		rc = nsip_send_batch(nsi, msgs, n);
+		if (rc < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK ||
+			    errno == ENOBUFS) {
+				nsi->nsip.stats.tx_blocked++;
+				osmo_fd_write_enable(&nsi->nsip.fd);
+				return;
+			}
+			/* the error belongs to the first PDU, drop it */
+			LOGP(DNS, LOGL_ERROR, "NSEI=%u send error %s during "
+				"NSIP send\n",
+				((struct gprs_nsvc *)msgs[0]->dst)->nsei,
+				strerror(errno));
+			nsip_dequeue(nsi, msgs[0]);
+			msgb_free(msgs[0]);
+			continue;
+		}
 
-	error = gprs_ns_rcvmsg(nsi, msg, &saddr, GPRS_NS_LL_UDP);
+		nsi->nsip.stats.tx_calls++;
+		nsi->nsip.stats.tx_msgs += rc;
+		nsi->nsip.stats.tx_batch[nsip_batch_hist(rc)]++;
 
-	msgb_free(msg);
+		for (i = 0; i < rc; i++) {
+			nsip_dequeue(nsi, msgs[i]);
+			msgb_free(msgs[i]);
+		}
+	}
 
-	return error;
+	osmo_fd_write_disable(&nsi->nsip.fd);
 }
 
 static int handle_nsip_write(struct osmo_fd *bfd)
 {
-	/* FIXME: actually send the data here instead of nsip_sendmsg() */
-	return -EIO;
+	nsip_flush(bfd->data);
+	return 0;
 }
 
 static int nsip_sendmsg(struct gprs_nsvc *nsvc, struct msgb *msg)
@@ -1007,10 +1269,41 @@ static int nsip_sendmsg(struct gprs_nsvc *nsvc, struct msgb *msg)
 	struct gprs_ns_inst *nsi = nsvc->nsi;
 	struct sockaddr_in *daddr = &nsvc->ip.bts_addr;
 
-	rc = sendto(nsi->nsip.fd.fd, msg->data, msg->len, 0,
-		  (struct sockaddr *)daddr, sizeof(*daddr));
+	/* the unknown_nsvc changes its peer address with every PDU,
+	 * so its PDUs cannot wait in the queue */
+	if (nsvc == nsi->unknown_nsvc) {
+		rc = sendto(nsi->nsip.fd.fd, msg->data, msg->len, MSG_DONTWAIT,
+			    (struct sockaddr *)daddr, sizeof(*daddr));
+		msgb_free(msg);
+		return rc;
+	}
+
+	if (nsi->nsip.tx_queue_len >= nsi->nsip.tx_queue_max) {
+		LOGP(DNS, LOGL_ERROR, "NSEI=%u NSIP tx queue full (%u), "
+			"dropping PDU\n", nsvc->nsei, nsi->nsip.tx_queue_len);
+		nsi->nsip.stats.tx_dropped++;
+		rate_ctr_inc(&nsvc->ctrg->ctr[NS_CTR_PKTS_OUT_DROP]);
+		msgb_free(msg);
+		return -ENOBUFS;
+	}
+
+	rc = msg->len;
+	msg->dst = nsvc;
+	llist_add_tail(&msg->list, &nsi->nsip.tx_queue);
+	if (++nsi->nsip.tx_queue_len > nsi->nsip.stats.tx_queue_hwm)
+		nsi->nsip.stats.tx_queue_hwm = nsi->nsip.tx_queue_len;
+	if (++nsvc->tx_queued > nsvc->tx_queued_hwm)
+		nsvc->tx_queued_hwm = nsvc->tx_queued;
+
+	/* the socket is blocked: wait until it becomes writable */
+	if (nsi->nsip.fd.when & BSC_FD_WRITE) {
+		rate_ctr_inc(&nsvc->ctrg->ctr[NS_CTR_PKTS_OUT_DELAYED]);
+		return rc;
+	}
 
-	msgb_free(msg);
+	/* responses to a received batch leave together after it */
+	if (!nsi->nsip.in_rx)
+		nsip_flush(nsi);
 
 	return rc;
 }
@@ -1102,6 +1395,7 @@ struct gprs_nsvc *gprs_ns_nsip_connect(struct gprs_ns_inst *nsi,
 	nsvc->nsei = nsei;
 	nsvc->nsvci = nsvci;
 	nsvc->remote_end_is_sgsn = 1;
+	gprs_nsvc_rehash(nsvc);
 
 	gprs_nsvc_reset(nsvc, NS_CAUSE_OM_INTERVENTION);
 	return nsvc;
@@ -131,6 +131,9 @@ static int config_write_ns(struct vty *vty)
 	if (vty_nsi->nsip.local_port)
 		vty_out(vty, " encapsulation udp local-port %u%s",
 			vty_nsi->nsip.local_port, VTY_NEWLINE);
+	if (vty_nsi->nsip.tx_queue_max != GPRS_NSIP_TXQ_MAX)
+		vty_out(vty, " encapsulation udp tx-queue-max %u%s",
+			vty_nsi->nsip.tx_queue_max, VTY_NEWLINE);
 
 	vty_out(vty, " encapsulation framerelay-gre enabled %u%s",
 		vty_nsi->frgre.enabled ? 1 : 0, VTY_NEWLINE);
@@ -164,8 +167,31 @@ static void dump_nse(struct vty *vty, struct gprs_nsvc *nsvc, int stats)
 			inet_ntoa(nsvc->ip.bts_addr.sin_addr),
 			ntohs(nsvc->ip.bts_addr.sin_port));
 	vty_out(vty, "%s", VTY_NEWLINE);
-	if (stats)
+	if (stats) {
 		vty_out_rate_ctr_group(vty, " ", nsvc->ctrg);
+		vty_out(vty, " Tx queue depth: %u (max %u)%s",
+			nsvc->tx_queued, nsvc->tx_queued_hwm, VTY_NEWLINE);
+	}
+}
+
+static void dump_nsip_stats(struct vty *vty, struct gprs_ns_inst *nsi)
+{
+	const struct gprs_nsip_stats *st = &nsi->nsip.stats;
+	static const char *hist[GPRS_NSIP_BATCH_HIST] = {
+		"1", "2-3", "4-7", "8-15", "16-31", "32" };
+	int i;
+
+	vty_out(vty, " NS-UDP rx: %lu datagrams in %lu calls, tx: %lu "
+		"datagrams in %lu calls%s", st->rx_msgs, st->rx_calls,
+		st->tx_msgs, st->tx_calls, VTY_NEWLINE);
+	vty_out(vty, " NS-UDP batch size   rx        tx%s", VTY_NEWLINE);
+	for (i = 0; i < GPRS_NSIP_BATCH_HIST; i++)
+		vty_out(vty, "  %-5s %14lu %9lu%s", hist[i], st->rx_batch[i],
+			st->tx_batch[i], VTY_NEWLINE);
+	vty_out(vty, " NS-UDP tx queue: %u/%u (max %u), blocked %lu, "
+		"dropped %lu%s", nsi->nsip.tx_queue_len,
+		nsi->nsip.tx_queue_max, st->tx_queue_hwm, st->tx_blocked,
+		st->tx_dropped, VTY_NEWLINE);
 }
 
 static void dump_ns(struct vty *vty, struct gprs_ns_inst *nsi, int stats)
@@ -176,6 +202,8 @@ static void dump_ns(struct vty *vty, struct gprs_ns_inst *nsi, int stats)
 	ia.s_addr = htonl(vty_nsi->nsip.local_ip);
 	vty_out(vty, "Encapsulation NS-UDP-IP     Local IP: %s, UDP Port: %u%s",
 		inet_ntoa(ia), vty_nsi->nsip.local_port, VTY_NEWLINE);
+	if (stats)
+		dump_nsip_stats(vty, nsi);
 
 	ia.s_addr = htonl(vty_nsi->frgre.local_ip);
 	vty_out(vty, "Encapsulation NS-FR-GRE-IP  Local IP: %s%s",
@@ -254,6 +282,7 @@ DEFUN(cfg_nse_nsvc, cfg_nse_nsvci_cmd,
 		nsvc->nsei = nsei;
 	}
 	nsvc->nsvci = nsvci;
+	gprs_nsvc_rehash(nsvc);
 	/* All NSVCs that are explicitly configured by VTY are
 	 * marked as persistent so we can write them to the config
 	 * file at some later point */
@@ -277,6 +306,7 @@ DEFUN(cfg_nse_remoteip, cfg_nse_remoteip_cmd,
 		return CMD_WARNING;
 	}
 	inet_aton(argv[1], &nsvc->ip.bts_addr.sin_addr);
+	gprs_nsvc_rehash(nsvc);
 
 	return CMD_SUCCESS;
 
@@ -305,6 +335,7 @@ DEFUN(cfg_nse_remoteport, cfg_nse_remoteport_cmd,
 	}
 
 	nsvc->ip.bts_addr.sin_port = htons(port);
+	gprs_nsvc_rehash(nsvc);
 
 	return CMD_SUCCESS;
 }
@@ -332,6 +363,7 @@ DEFUN(cfg_nse_fr_dlci, cfg_nse_fr_dlci_cmd,
 	}
 
 	nsvc->frgre.bts_addr.sin_port = htons(dlci);
+	gprs_nsvc_rehash(nsvc);
 
 	return CMD_SUCCESS;
 }
@@ -454,6 +486,17 @@ DEFUN(cfg_nsip_local_port, cfg_nsip_local_port_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(cfg_nsip_txq_max, cfg_nsip_txq_max_cmd,
+      "encapsulation udp tx-queue-max <1-65535>",
+	ENCAPS_STR "NS over UDP Encapsulation\n"
+	"Set the number of PDUs queued while the socket is blocked\n"
+	"Maximum number of queued PDUs\n")
+{
+	vty_nsi->nsip.tx_queue_max = atoi(argv[0]);
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(cfg_frgre_local_ip, cfg_frgre_local_ip_cmd,
       "encapsulation framerelay-gre local-ip A.B.C.D",
 	ENCAPS_STR "NS over Frame Relay over GRE Encapsulation\n"
@@ -572,6 +615,7 @@ int gprs_ns_vty_init(struct gprs_ns_inst *nsi)
 	install_element(L_NS_NODE, &cfg_ns_timer_cmd);
 	install_element(L_NS_NODE, &cfg_nsip_local_ip_cmd);
 	install_element(L_NS_NODE, &cfg_nsip_local_port_cmd);
+	install_element(L_NS_NODE, &cfg_nsip_txq_max_cmd);
 	install_element(L_NS_NODE, &cfg_frgre_enable_cmd);
 	install_element(L_NS_NODE, &cfg_frgre_local_ip_cmd);
 
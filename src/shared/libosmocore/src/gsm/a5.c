@@ -34,10 +34,19 @@
  *  \brief Osmocom GSM A5 ciphering algorithm implementation
  */
 
+#include "config.h"
+
+#include <errno.h>
+#include <stdint.h>
 #include <string.h>
 
+#include <osmocom/core/utils.h>
 #include <osmocom/gsm/a5.h>
 
+#if defined(HAVE_X86_SIMD_TARGETS) && (defined(__x86_64__) || defined(__i386__))
+#define A5_BATCH_X86 1
+#endif
+
 /*! \brief Main method to generate a A5/x cipher stream
  *  \param[in] n Which A5/x method to use
  *  \param[in] key 8 byte array for the key (as received from the SIM)
@@ -364,4 +373,326 @@ osmo_a5_2(const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul)
 	}
 }
 
+
+/* ------------------------------------------------------------------------ */
+/* Bitsliced batch A5/1&2                                                   */
+/* ------------------------------------------------------------------------ */
+
+/* Each register bit is held in one lane word, bit 'l' of that word
+ * belonging to keystream 'l' of the batch. The conditional clocking
+ * turns into a masked select, so all lanes advance in lock step without
+ * any data dependent branch.
+ *
+ * The cores exchange data with the common code as arrays of 'w' 64-bit
+ * words per bit position: key bits kp[64][w], frame count bits
+ * fp[22][w] and keystream bits ks[nout][w].
+ */
+typedef void (*a5_batch_core_t)(int n, const uint64_t *kp, const uint64_t *fp,
+                                uint64_t *ks, int nout);
+
+#define A5B_T		uint64_t
+#define A5B_NAME	a5_batch_u64
+#define A5B_ATTR
+#include "a5_batch_impl.h"
+#undef A5B_T
+#undef A5B_NAME
+#undef A5B_ATTR
+
+#ifdef A5_BATCH_X86
+typedef uint64_t a5b_v128_t __attribute__((vector_size(16)));
+typedef uint64_t a5b_v256_t __attribute__((vector_size(32)));
+
+#define A5B_T		a5b_v128_t
+#define A5B_NAME	a5_batch_sse2
+#define A5B_ATTR	__attribute__((target("sse2")))
+#include "a5_batch_impl.h"
+#undef A5B_T
+#undef A5B_NAME
+#undef A5B_ATTR
+
+#define A5B_T		a5b_v256_t
+#define A5B_NAME	a5_batch_avx2
+#define A5B_ATTR	__attribute__((target("avx2")))
+#include "a5_batch_impl.h"
+#undef A5B_T
+#undef A5B_NAME
+#undef A5B_ATTR
+#endif /* A5_BATCH_X86 */
+
+#define A5_BATCH_MAX_W	4	/* 256 lanes */
+
+static const struct value_string batch_names[] = {
+	{ A5_BATCH_U64,		"u64" },
+	{ A5_BATCH_SSE2,	"sse2" },
+	{ A5_BATCH_AVX2,	"avx2" },
+	{ 0, NULL }
+};
+
+static enum osmo_a5_batch_impl batch_impl;
+static a5_batch_core_t batch_fn;
+
+static a5_batch_core_t
+batch_impl_fn(enum osmo_a5_batch_impl impl)
+{
+	switch (impl) {
+	case A5_BATCH_U64:
+		return a5_batch_u64;
+#ifdef A5_BATCH_X86
+	case A5_BATCH_SSE2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("sse2") ? a5_batch_sse2 : NULL;
+	case A5_BATCH_AVX2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") ? a5_batch_avx2 : NULL;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+static void
+batch_select_default(void)
+{
+	enum osmo_a5_batch_impl impl;
+
+	if (batch_fn)
+		return;
+
+	for (impl=A5_BATCH_AVX2; impl>A5_BATCH_U64; impl--) {
+		if (batch_impl_fn(impl))
+			break;
+	}
+
+	osmo_a5_batch_impl_set(impl);
+}
+
+/*! \brief Check if a batch A5 implementation can be used
+ *  \param[in] impl implementation
+ *  \returns 1 if supported by the build and the CPU, 0 otherwise
+ */
+int
+osmo_a5_batch_impl_available(enum osmo_a5_batch_impl impl)
+{
+	return batch_impl_fn(impl) != NULL;
+}
+
+/*! \brief Select the implementation used by \ref osmo_a5_batch
+ *  \param[in] impl implementation to be used from now on
+ *  \returns 0 on success, -ENOTSUP if it is not available
+ *
+ * By default, the widest implementation supported by the CPU is used.
+ */
+int
+osmo_a5_batch_impl_set(enum osmo_a5_batch_impl impl)
+{
+	a5_batch_core_t fn = batch_impl_fn(impl);
+
+	if (!fn)
+		return -ENOTSUP;
+
+	batch_impl = impl;
+	batch_fn = fn;
+
+	return 0;
+}
+
+/*! \brief Get the implementation used by \ref osmo_a5_batch */
+enum osmo_a5_batch_impl
+osmo_a5_batch_impl_get(void)
+{
+	batch_select_default();
+	return batch_impl;
+}
+
+/*! \brief Get a human readable name of a batch A5 implementation */
+const char *
+osmo_a5_batch_impl_name(enum osmo_a5_batch_impl impl)
+{
+	return get_value_string(batch_names, impl);
+}
+
+/*! \brief Get the number of keystreams computed in parallel
+ *  \param[in] impl implementation
+ *  \returns number of lanes (64, 128 or 256)
+ */
+unsigned int
+osmo_a5_batch_impl_lanes(enum osmo_a5_batch_impl impl)
+{
+	return 64 << impl;
+}
+
+/* transpose the keys and frame counts of lanes [0..cnt) into bit planes */
+static void
+batch_load(const uint8_t *keys, const uint32_t *fn, unsigned int cnt,
+           int w, uint64_t *kp, uint64_t *fp)
+{
+	unsigned int l;
+	int i;
+
+	memset(kp, 0x00, 64 * w * sizeof(uint64_t));
+	memset(fp, 0x00, 22 * w * sizeof(uint64_t));
+
+	for (l=0; l<cnt; l++)
+	{
+		const uint8_t *key = &keys[l * 8];
+		uint64_t m = 1ULL << (l & 63);
+		uint64_t k = 0;
+		uint32_t fn_count = osmo_a5_fn_count(fn[l]);
+		int lw = l >> 6;
+
+		/* bit i of 'k' is the i-th key bit loaded */
+		for (i=0; i<8; i++)
+			k |= (uint64_t)key[7-i] << (8 * i);
+
+		for (i=0; i<64; i++)
+			if ((k >> i) & 1)
+				kp[i * w + lw] |= m;
+
+		for (i=0; i<22; i++)
+			if ((fn_count >> i) & 1)
+				fp[i * w + lw] |= m;
+	}
+}
+
+/* transpose a 64x64 bit matrix, bit 63 being column 0 of each row */
+static void
+batch_transpose(uint64_t a[64])
+{
+	uint64_t m, t;
+	int j, k;
+
+	for (j=32, m=0x00000000ffffffffULL; j; j>>=1, m^=m<<j) {
+		for (k=0; k<64; k=((k|j)+1)&~j) {
+			t = (a[k] ^ (a[k|j] >> j)) & m;
+			a[k] ^= t;
+			a[k|j] ^= t << j;
+		}
+	}
+}
+
+/* scatter keystream bits [ofs..ofs+114) of lanes [0..cnt) to 'out' */
+static void
+batch_store(const uint64_t *ks, unsigned int cnt, int w, int ofs,
+            uint8_t *out, int packed)
+{
+	uint64_t t[2][64];
+	unsigned int l, lw, nl;
+	int blk, i;
+
+	for (lw=0; lw*64<cnt; lw++)
+	{
+		/* afterwards t[blk][63-l] holds bits blk*64.. of lane l,
+		 * MSB first */
+		for (blk=0; blk<2; blk++) {
+			for (i=0; i<64; i++) {
+				int b = blk * 64 + i;
+				t[blk][i] = b < 114 ? ks[(ofs + b) * w + lw] : 0;
+			}
+			batch_transpose(t[blk]);
+		}
+
+		nl = cnt - lw * 64 < 64 ? cnt - lw * 64 : 64;
+
+		for (l=0; l<nl; l++)
+		{
+			uint64_t v0 = t[0][63-l], v1 = t[1][63-l];
+			uint8_t *o = &out[(lw * 64 + l) * (packed ? 15 : 114)];
+
+			if (packed) {
+				for (i=0; i<8; i++)
+					o[i] = v0 >> (56 - 8 * i);
+				for (i=0; i<7; i++)
+					o[8+i] = v1 >> (56 - 8 * i);
+			} else {
+				for (i=0; i<64; i++)
+					o[i] = (v0 >> (63 - i)) & 1;
+				for (i=0; i<50; i++)
+					o[64+i] = (v1 >> (63 - i)) & 1;
+			}
+		}
+	}
+}
+
+/*! \brief Generate many A5/x cipher streams at once
+ *  \param[in] n Which A5/x method to use
+ *  \param[in] keys \a count keys of 8 bytes each, back to back
+ *  \param[in] fn \a count frame numbers, one per key
+ *  \param[in] count Number of cipher streams to generate
+ *  \param[out] dl Downlink cipher streams, or NULL
+ *  \param[out] ul Uplink cipher streams, or NULL
+ *  \param[in] flags OSMO_A5_BATCH_F_* flags
+ *  \returns 0 on success, -ENOTSUP for an unsupported A5/x method
+ *
+ * Produces exactly the same output as calling \ref osmo_a5 for each
+ * (keys[i], fn[i]) pair, but computes up to 256 streams in parallel
+ * (see \ref osmo_a5_batch_impl_set). Stream i is written at offset
+ * i * 114 of dl/ul as unpacked bits, or at offset i * 15 as packed
+ * bits (MSB first) with \ref OSMO_A5_BATCH_F_PACKED.
+ */
+int
+osmo_a5_batch(int n, const uint8_t *keys, const uint32_t *fn,
+              unsigned int count, uint8_t *dl, uint8_t *ul,
+              unsigned int flags)
+{
+	uint64_t kp[64 * A5_BATCH_MAX_W];
+	uint64_t fp[22 * A5_BATCH_MAX_W];
+	uint64_t ks[228 * A5_BATCH_MAX_W];
+	int packed = !!(flags & OSMO_A5_BATCH_F_PACKED);
+	int stride = packed ? 15 : 114;
+	int nout = ul ? 228 : 114;
+	a5_batch_core_t fn_core;
+	unsigned int lanes, cnt;
+	int w;
+
+	if (n == 0) {
+		if (dl)
+			memset(dl, 0x00, count * stride);
+		if (ul)
+			memset(ul, 0x00, count * stride);
+		return 0;
+	}
+
+	if (n != 1 && n != 2)
+		return -ENOTSUP;
+
+	if (!dl && !ul)
+		return 0;
+
+	batch_select_default();
+
+	while (count)
+	{
+		/* a partial batch costs as much as a full one: finish with
+		 * 64-lane batches rather than one mostly empty wide one */
+		if (count >= osmo_a5_batch_impl_lanes(batch_impl)) {
+			fn_core = batch_fn;
+			lanes = osmo_a5_batch_impl_lanes(batch_impl);
+		} else {
+			fn_core = a5_batch_u64;
+			lanes = 64;
+		}
+
+		w = lanes / 64;
+		cnt = count < lanes ? count : lanes;
+
+		batch_load(keys, fn, cnt, w, kp, fp);
+		fn_core(n, kp, fp, ks, nout);
+
+		if (dl) {
+			batch_store(ks, cnt, w, 0, dl, packed);
+			dl += cnt * stride;
+		}
+		if (ul) {
+			batch_store(ks, cnt, w, 114, ul, packed);
+			ul += cnt * stride;
+		}
+
+		keys += cnt * 8;
+		fn += cnt;
+		count -= cnt;
+	}
+
+	return 0;
+}
+
 /*! @} */
@@ -0,0 +1,138 @@
+/*
+ * a5_batch_impl.h
+ *
+ * Bitsliced A5/1 and A5/2 core, instantiated once per lane word type
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Not protected against multiple inclusion on purpose. The includer
+ * defines:
+ *
+ *  A5B_T      lane word type, a multiple of 64 bits supporting ~ & ^ |
+ *  A5B_NAME   name of the generated function
+ *  A5B_ATTR   function attributes (target selection)
+ *
+ * The generated function has the a5_batch_core_t signature, see a5_batch.c
+ */
+
+#define A5B_W	(sizeof(A5B_T) / sizeof(uint64_t))
+
+/* clock register 'r' of length 'len' in the lanes set in 'clk',
+ * 'fb' is the feedback computed from the state before clocking */
+#define A5B_CLOCK(r, len, clk, fb)					\
+do {									\
+	int _i;								\
+	for (_i=(len)-1; _i>0; _i--)					\
+		r[_i] ^= (clk) & (r[_i] ^ r[_i-1]);			\
+	r[0] ^= (clk) & (r[0] ^ (fb));					\
+} while (0)
+
+#define A5B_MAJ(a, b, c)	(((a) & (b)) | ((a) & (c)) | ((b) & (c)))
+
+A5B_ATTR
+static void
+A5B_NAME(int n, const uint64_t *kp, const uint64_t *fp, uint64_t *ks,
+         int nout)
+{
+	A5B_T r1[A5_R1_LEN], r2[A5_R2_LEN], r3[A5_R3_LEN], r4[A5_R4_LEN];
+	A5B_T zero, ones, b, c1, c2, c3, maj, f1, f2, f3, f4, o;
+	int i, a52 = (n == 2);
+
+	memset(&zero, 0x00, sizeof(zero));
+	memset(&ones, 0xff, sizeof(ones));
+
+	for (i=0; i<A5_R1_LEN; i++) r1[i] = zero;
+	for (i=0; i<A5_R2_LEN; i++) r2[i] = zero;
+	for (i=0; i<A5_R3_LEN; i++) r3[i] = zero;
+	for (i=0; i<A5_R4_LEN; i++) r4[i] = zero;
+
+	/* Key and frame count load, with forced clocking */
+	for (i=0; i<64+22; i++)
+	{
+		if (i < 64)
+			memcpy(&b, &kp[i * A5B_W], sizeof(b));
+		else
+			memcpy(&b, &fp[(i - 64) * A5B_W], sizeof(b));
+
+		f1 = r1[13] ^ r1[16] ^ r1[17] ^ r1[18];
+		f2 = r2[20] ^ r2[21];
+		f3 = r3[7] ^ r3[20] ^ r3[21] ^ r3[22];
+		A5B_CLOCK(r1, A5_R1_LEN, ones, f1);
+		A5B_CLOCK(r2, A5_R2_LEN, ones, f2);
+		A5B_CLOCK(r3, A5_R3_LEN, ones, f3);
+		r1[0] ^= b;
+		r2[0] ^= b;
+		r3[0] ^= b;
+
+		if (a52) {
+			f4 = r4[11] ^ r4[16];
+			A5B_CLOCK(r4, A5_R4_LEN, ones, f4);
+			r4[0] ^= b;
+		}
+	}
+
+	if (a52) {
+		r1[15] = ones;
+		r2[16] = ones;
+		r3[18] = ones;
+		r4[10] = ones;
+	}
+
+	/* Mix and output: 100 (A5/1) or 99 (A5/2) clocks without output */
+	for (i=-(100-a52); i<nout; i++)
+	{
+		if (a52) {
+			c1 = r4[10];
+			c2 = r4[3];
+			c3 = r4[7];
+		} else {
+			c1 = r1[8];
+			c2 = r2[10];
+			c3 = r3[10];
+		}
+
+		maj = A5B_MAJ(c1, c2, c3);
+
+		f1 = r1[13] ^ r1[16] ^ r1[17] ^ r1[18];
+		f2 = r2[20] ^ r2[21];
+		f3 = r3[7] ^ r3[20] ^ r3[21] ^ r3[22];
+		A5B_CLOCK(r1, A5_R1_LEN, ~(c1 ^ maj), f1);
+		A5B_CLOCK(r2, A5_R2_LEN, ~(c2 ^ maj), f2);
+		A5B_CLOCK(r3, A5_R3_LEN, ~(c3 ^ maj), f3);
+
+		if (a52) {
+			f4 = r4[11] ^ r4[16];
+			A5B_CLOCK(r4, A5_R4_LEN, ones, f4);
+		}
+
+		if (i < 0)
+			continue;
+
+		o = r1[A5_R1_LEN-1] ^ r2[A5_R2_LEN-1] ^ r3[A5_R3_LEN-1];
+
+		if (a52) {
+			o ^= A5B_MAJ(r1[15], ~r1[14], r1[12]);
+			o ^= A5B_MAJ(~r2[16], r2[13], r2[9]);
+			o ^= A5B_MAJ(r3[18], r3[16], ~r3[13]);
+		}
+
+		memcpy(&ks[i * A5B_W], &o, sizeof(o));
+	}
+}
+
+#undef A5B_MAJ
+#undef A5B_CLOCK
+#undef A5B_W
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <osmocom/core/utils.h>
 #include <osmocom/gsm/tlv.h>
 
@@ -124,30 +125,22 @@ tlv:		/* GSM TS 04.07 11.2.4: Type 4 TLV */
 	return len;
 }
 
-/*! \brief Parse an entire buffer of TLV encoded Information Eleemnts
- *  \param[out] dec caller-allocated pointer to \ref tlv_parsed
- *  \param[in] def structure defining the valid TLV tags / configurations
- *  \param[in] buf the input data buffer to be parsed
- *  \param[in] buf_len length of the input data buffer
- *  \param[in] lv_tag an initial LV tag at the start of the buffer
- *  \param[in] lv_tag2 a second initial LV tag following the \a lv_tag
- *  \returns number of bytes consumed by the TLV entry / IE parsed
- */
-int tlv_parse(struct tlv_parsed *dec, const struct tlv_definition *def,
-	      const uint8_t *buf, int buf_len, uint8_t lv_tag,
-	      uint8_t lv_tag2)
+typedef void tlv_store_fn(void *dec, uint8_t tag, uint16_t len, const uint8_t *val);
+
+/* common part of the parsers, 'store' is a constant at each call site so
+ * the compiler can inline it */
+static inline __attribute__((always_inline))
+int _tlv_parse(void *dec, tlv_store_fn *store, const struct tlv_definition *def,
+	       const uint8_t *buf, int buf_len, uint8_t lv_tag, uint8_t lv_tag2)
 {
 	int ofs = 0, num_parsed = 0;
 	uint16_t len;
 
-	memset(dec, 0, sizeof(*dec));
-
 	if (lv_tag) {
 		if (ofs > buf_len)
 			return -1;
-		dec->lv[lv_tag].val = &buf[ofs+1];
-		dec->lv[lv_tag].len = buf[ofs];
-		len = dec->lv[lv_tag].len + 1;
+		store(dec, lv_tag, buf[ofs], &buf[ofs+1]);
+		len = buf[ofs] + 1;
 		if (ofs + len > buf_len)
 			return -2;
 		num_parsed++;
@@ -156,9 +149,8 @@ int tlv_parse(struct tlv_parsed *dec, const struct tlv_definition *def,
 	if (lv_tag2) {
 		if (ofs > buf_len)
 			return -1;
-		dec->lv[lv_tag2].val = &buf[ofs+1];
-		dec->lv[lv_tag2].len = buf[ofs];
-		len = dec->lv[lv_tag2].len + 1;
+		store(dec, lv_tag2, buf[ofs], &buf[ofs+1]);
+		len = buf[ofs] + 1;
 		if (ofs + len > buf_len)
 			return -2;
 		num_parsed++;
@@ -174,15 +166,96 @@ int tlv_parse(struct tlv_parsed *dec, const struct tlv_definition *def,
 		                   &buf[ofs], buf_len-ofs);
 		if (rv < 0)
 			return rv;
-		dec->lv[tag].val = val;
-		dec->lv[tag].len = len;
+		store(dec, tag, len, val);
 		ofs += rv;
 		num_parsed++;
 	}
-	//tlv_dump(dec);
 	return num_parsed;
 }
 
+static inline void store_parsed(void *_dec, uint8_t tag, uint16_t len, const uint8_t *val)
+{
+	struct tlv_parsed *dec = _dec;
+
+	dec->lv[tag].val = val;
+	dec->lv[tag].len = len;
+}
+
+static inline void store_sparse(void *_dec, uint8_t tag, uint16_t len, const uint8_t *val)
+{
+	struct tlv_parsed_sparse *dec = _dec;
+	uint32_t bit = 1U << (tag & 31);
+
+	/* like tlv_parse(), a repeated IE overwrites the earlier one */
+	if (!(dec->present[tag >> 5] & bit)) {
+		dec->present[tag >> 5] |= bit;
+		dec->idx[tag] = dec->num++;
+	}
+	dec->ie[dec->idx[tag]].val = val;
+	dec->ie[dec->idx[tag]].len = len;
+}
+
+/*! \brief Parse an entire buffer of TLV encoded Information Eleemnts
+ *  \param[out] dec caller-allocated pointer to \ref tlv_parsed
+ *  \param[in] def structure defining the valid TLV tags / configurations
+ *  \param[in] buf the input data buffer to be parsed
+ *  \param[in] buf_len length of the input data buffer
+ *  \param[in] lv_tag an initial LV tag at the start of the buffer
+ *  \param[in] lv_tag2 a second initial LV tag following the \a lv_tag
+ *  \returns number of bytes consumed by the TLV entry / IE parsed
+ */
+int tlv_parse(struct tlv_parsed *dec, const struct tlv_definition *def,
+	      const uint8_t *buf, int buf_len, uint8_t lv_tag,
+	      uint8_t lv_tag2)
+{
+	memset(dec, 0, sizeof(*dec));
+
+	return _tlv_parse(dec, store_parsed, def, buf, buf_len, lv_tag, lv_tag2);
+}
+
+/*! \brief Parse an entire buffer of TLV encoded IEs into a sparse result
+ *  \param[out] dec caller-allocated pointer to \ref tlv_parsed_sparse
+ *  \param[in] def structure defining the valid TLV tags / configurations
+ *  \param[in] buf the input data buffer to be parsed
+ *  \param[in] buf_len length of the input data buffer
+ *  \param[in] lv_tag an initial LV tag at the start of the buffer
+ *  \param[in] lv_tag2 a second initial LV tag following the \a lv_tag
+ *  \returns number of IEs parsed, negative on error
+ *
+ * Same as \ref tlv_parse, but only 32 bytes of \a dec are cleared instead
+ * of the whole 4 KiB \ref tlv_parsed. Use \ref TLVS_PRESENT,
+ * \ref TLVS_LEN and \ref TLVS_VAL to access the result.
+ */
+int tlv_parse_sparse(struct tlv_parsed_sparse *dec, const struct tlv_definition *def,
+		     const uint8_t *buf, int buf_len, uint8_t lv_tag, uint8_t lv_tag2)
+{
+	memset(dec->present, 0, sizeof(dec->present));
+	dec->num = 0;
+
+	return _tlv_parse(dec, store_sparse, def, buf, buf_len, lv_tag, lv_tag2);
+}
+
+/*! \brief Convert a sparse TLV parser result for functions taking \ref tlv_parsed
+ *  \param[out] dst the converted result
+ *  \param[in] src sparse result from \ref tlv_parse_sparse
+ */
+void tlv_sparse_to_parsed(struct tlv_parsed *dst, const struct tlv_parsed_sparse *src)
+{
+	int i;
+
+	memset(dst, 0, sizeof(*dst));
+
+	for (i = 0; i < ARRAY_SIZE(src->present); i++) {
+		uint32_t bits = src->present[i];
+
+		while (bits) {
+			int tag = i * 32 + __builtin_ctz(bits);
+			dst->lv[tag] = src->ie[src->idx[tag]];
+			bits &= bits - 1;
+		}
+	}
+}
+
 /*! \brief take a master (src) tlvdev and fill up all empty slots in 'dst' */
 void tlv_def_patch(struct tlv_definition *dst, const struct tlv_definition *src)
 {
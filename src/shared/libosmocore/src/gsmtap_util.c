@@ -352,6 +352,10 @@ struct gsmtap_inst *gsmtap_source_init(const char *host, uint16_t port,
 	if (ofd_wq_mode) {
 		osmo_wqueue_init(&gti->wq, 64);
 		gti->wq.write_cb = &gsmtap_wq_w_cb;
+		/* drain the queue in one go, and rather lose old frames
+		 * than new ones when the receiver does not keep up */
+		gti->wq.flags = OSMO_WQUEUE_F_SENDMMSG;
+		gti->wq.drop_policy = OSMO_WQUEUE_DROP_OLDEST;
 
 		osmo_fd_register(&gti->wq.bfd);
 	}
@@ -49,6 +49,10 @@
 struct log_info *osmo_log_info;
 
 static struct log_context log_context;
+
+/* per category: lowest level logged by any target, see log_check_level() */
+static uint8_t *log_min_level;
+#define LOG_MIN_LEVEL_NONE	0xff
 static void *tall_log_ctx = NULL;
 LLIST_HEAD(osmo_log_target_list);
 
@@ -125,6 +129,63 @@ static int subsys_lib2index(int subsys)
 	return (subsys * -1) + (osmo_log_info->num_cat_user-1);
 }
 
+/* map a (possibly library-internal) subsystem to a category index */
+static int subsys_index(int subsys)
+{
+	if (subsys < 0)
+		subsys = subsys_lib2index(subsys);
+
+	if (subsys >= osmo_log_info->num_cat)
+		subsys = subsys_lib2index(DLGLOBAL);
+
+	return subsys;
+}
+
+/* recompute log_min_level[] after targets or their levels changed */
+static void log_min_level_update(void)
+{
+	struct log_target *tar;
+	int i;
+
+	if (!log_min_level)
+		return;
+
+	memset(log_min_level, LOG_MIN_LEVEL_NONE, osmo_log_info->num_cat);
+
+	llist_for_each_entry(tar, &osmo_log_target_list, entry) {
+		for (i = 0; i < osmo_log_info->num_cat; i++) {
+			const struct log_category *cat = &tar->categories[i];
+			uint8_t min;
+
+			if (!cat->enabled)
+				continue;
+
+			/* same rules as in osmo_vlogp() */
+			min = tar->loglevel ? tar->loglevel : cat->loglevel;
+			if (min < log_min_level[i])
+				log_min_level[i] = min;
+		}
+	}
+}
+
+/*! \brief Check if a message could be logged by any target
+ *  \param[in] subsys logging subsystem
+ *  \param[in] level log level
+ *  \returns 1 if at least one target logs this level for this
+ *  subsystem, 0 otherwise
+ *
+ * Only the category and level settings are taken into account, filters
+ * are applied later by \ref osmo_vlogp. Used by the LOGP() and DEBUGP()
+ * macros to skip the evaluation of their arguments.
+ */
+int log_check_level(int subsys, unsigned int level)
+{
+	if (!log_min_level)
+		return 1;
+
+	return level >= log_min_level[subsys_index(subsys)];
+}
+
 /*! \brief Parse a human-readable log level into a numeric value */
 int log_parse_level(const char *lvl)
 {
@@ -205,6 +266,7 @@ void log_parse_category_mask(struct log_target* target, const char *_mask)
 	} while ((category_token = strtok(NULL, ":")));
 
 	free(mask);
+	log_min_level_update();
 }
 
 static const char* color(int subsys)
@@ -215,6 +277,26 @@ static const char* color(int subsys)
 	return NULL;
 }
 
+/* ctime() of the current second, formatted only once per second */
+static const char *log_timestamp(void)
+{
+	static time_t cached_tm = (time_t) -1;
+	static char cached_str[32];
+	time_t tm = time(NULL);
+
+	if (tm != cached_tm) {
+		char *nl;
+
+		ctime_r(&tm, cached_str);
+		nl = strchr(cached_str, '\n');
+		if (nl)
+			*nl = '\0';
+		cached_tm = tm;
+	}
+
+	return cached_str;
+}
+
 static void _output(struct log_target *target, unsigned int subsys,
 		    unsigned int level, const char *file, int line, int cont,
 		    const char *format, va_list ap)
@@ -234,12 +316,8 @@ static void _output(struct log_target *target, unsigned int subsys,
 	}
 	if (!cont) {
 		if (target->print_timestamp) {
-			char *timestr;
-			time_t tm;
-			tm = time(NULL);
-			timestr = ctime(&tm);
-			timestr[strlen(timestr)-1] = '\0';
-			ret = snprintf(buf + offset, rem, "%s ", timestr);
+			ret = snprintf(buf + offset, rem, "%s ",
+					log_timestamp());
 			if (ret < 0)
 				goto err;
 			OSMO_SNPRINTF_RET(ret, rem, offset, len);
@@ -273,11 +351,7 @@ void osmo_vlogp(int subsys, int level, const char *file, int line,
 {
 	struct log_target *tar;
 
-	if (subsys < 0)
-		subsys = subsys_lib2index(subsys);
-
-	if (subsys > osmo_log_info->num_cat)
-		subsys = DLGLOBAL;
+	subsys = subsys_index(subsys);
 
 	llist_for_each_entry(tar, &osmo_log_target_list, entry) {
 		struct log_category *category;
@@ -343,6 +417,7 @@ void logp2(int subsys, unsigned int level, const char *file, int line, int cont,
 void log_add_target(struct log_target *target)
 {
 	llist_add_tail(&target->entry, &osmo_log_target_list);
+	log_min_level_update();
 }
 
 /*! \brief Unregister a log target from the logging core
@@ -351,6 +426,8 @@ void log_add_target(struct log_target *target)
 void log_del_target(struct log_target *target)
 {
 	llist_del(&target->entry);
+	INIT_LLIST_HEAD(&target->entry);
+	log_min_level_update();
 }
 
 /*! \brief Reset (clear) the logging context */
@@ -429,6 +506,7 @@ void log_set_print_filename(struct log_target *target, int print_filename)
 void log_set_log_level(struct log_target *target, int log_level)
 {
 	target->loglevel = log_level;
+	log_min_level_update();
 }
 
 void log_set_category_filter(struct log_target *target, int category,
@@ -438,6 +516,7 @@ void log_set_category_filter(struct log_target *target, int category,
 		return;
 	target->categories[category].enabled = !!enable;
 	target->categories[category].loglevel = level;
+	log_min_level_update();
 }
 
 static void _file_output(struct log_target *target, unsigned int level,
@@ -556,6 +635,10 @@ void log_target_destroy(struct log_target *target)
 	/* just in case, to make sure we don't have any references */
 	log_del_target(target);
 
+	/* write out what is still queued and stop the writer thread */
+	if (target->async)
+		log_target_set_async(target, 0);
+
 	if (target->output == &_file_output) {
 /* since C89/C99 says stderr is a macro, we can safely do this! */
 #ifdef stderr
@@ -574,6 +657,15 @@ void log_target_destroy(struct log_target *target)
 /*! \brief close and re-open a log file (for log file rotation) */
 int log_target_file_reopen(struct log_target *target)
 {
+	struct log_async_stats stats;
+	int async = 0;
+
+	/* the writer thread must not use the file while it is swapped */
+	if (log_target_async_stats(target, &stats) == 0) {
+		async = stats.size;
+		log_target_set_async(target, 0);
+	}
+
 	fclose(target->tgt_file.out);
 
 	target->tgt_file.out = fopen(target->tgt_file.fname, "a");
@@ -582,6 +674,9 @@ int log_target_file_reopen(struct log_target *target)
 
 	/* we assume target->output already to be set */
 
+	if (async)
+		return log_target_set_async(target, async);
+
 	return 0;
 }
 
@@ -766,6 +861,12 @@ int log_init(const struct log_info *inf, void *ctx)
 			&internal_cat[i], sizeof(struct log_info_cat));
 	}
 
+	log_min_level = talloc_zero_array(osmo_log_info, uint8_t,
+					  osmo_log_info->num_cat);
+	if (!log_min_level)
+		return -ENOMEM;
+	log_min_level_update();
+
 	return 0;
 }
 
@@ -0,0 +1,339 @@
+/* Asynchronous output of log targets through a writer thread */
+
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* \addtogroup logging
+ * @{
+ */
+
+/* \file logging_async.c
+ *
+ * The formatted log lines are copied into a single-producer,
+ * single-consumer ring of records and written out by a thread, so the
+ * select loop never blocks on disk, terminal or syslog I/O. Like the
+ * rest of libosmocore, logging itself must only be done from one
+ * thread; the writer thread is the only consumer.
+ */
+
+#include "../config.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/logging.h>
+
+#ifdef HAVE_PTHREAD
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+
+/* record header in the ring, followed by the NUL terminated string and
+ * padded to a multiple of the header size */
+struct log_async_rec {
+	uint32_t len;		/* string length incl. NUL, 0: wrap marker */
+	uint32_t level;
+};
+
+#define REC_HDR		sizeof(struct log_async_rec)
+#define REC_SIZE(len)	((REC_HDR + (len) + REC_HDR - 1) & ~(REC_HDR - 1))
+
+struct log_async {
+	struct log_target *target;
+	void (*output)(struct log_target *target, unsigned int level,
+		       const char *string);
+
+	uint8_t *ring;
+	uint32_t size;		/* power of two */
+
+	/* free running byte positions, head is only written by the
+	 * producer and tail only by the writer thread */
+	uint32_t head;
+	uint32_t tail;
+
+	/* producer side */
+	unsigned long dropped;
+	unsigned long dropped_reported;
+
+	/* writer side */
+	unsigned long written;
+
+	int waiting;		/* writer sleeps on 'sem' */
+	int stop;
+	sem_t sem;
+	pthread_t thread;
+};
+
+static uint32_t ring_used(struct log_async *as)
+{
+	return __atomic_load_n(&as->head, __ATOMIC_ACQUIRE) -
+	       __atomic_load_n(&as->tail, __ATOMIC_ACQUIRE);
+}
+
+static void wake_writer(struct log_async *as)
+{
+	if (__atomic_exchange_n(&as->waiting, 0, __ATOMIC_SEQ_CST))
+		sem_post(&as->sem);
+}
+
+/* copy one record into the ring, returns -ENOSPC if it doesn't fit */
+static int ring_put(struct log_async *as, unsigned int level,
+		    const char *str, uint32_t len)
+{
+	uint32_t head = as->head;
+	uint32_t tail = __atomic_load_n(&as->tail, __ATOMIC_ACQUIRE);
+	uint32_t ofs = head & (as->size - 1);
+	uint32_t need = REC_SIZE(len);
+	uint32_t pad = 0;
+	struct log_async_rec *rec;
+
+	/* records never wrap, skip the end of the ring instead */
+	if (ofs + need > as->size)
+		pad = as->size - ofs;
+
+	if (need + pad > as->size - (head - tail))
+		return -ENOSPC;
+
+	if (pad) {
+		rec = (struct log_async_rec *) &as->ring[ofs];
+		rec->len = 0;
+		head += pad;
+		ofs = 0;
+	}
+
+	rec = (struct log_async_rec *) &as->ring[ofs];
+	rec->len = len;
+	rec->level = level;
+	memcpy(rec + 1, str, len);
+
+	__atomic_store_n(&as->head, head + need, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+static void _async_output(struct log_target *target, unsigned int level,
+			  const char *string)
+{
+	struct log_async *as = target->async;
+	char note[64];
+
+	if (as->dropped != as->dropped_reported) {
+		snprintf(note, sizeof(note), "<%lu log messages dropped>\n",
+			 as->dropped - as->dropped_reported);
+		if (ring_put(as, LOGL_NOTICE, note, strlen(note) + 1) < 0) {
+			as->dropped++;
+			return;
+		}
+		as->dropped_reported = as->dropped;
+	}
+
+	if (ring_put(as, level, string, strlen(string) + 1) < 0)
+		as->dropped++;
+
+	wake_writer(as);
+}
+
+static void *writer_thread(void *data)
+{
+	struct log_async *as = data;
+	struct log_target *target = as->target;
+	int is_file = target->type == LOG_TGT_TYPE_FILE ||
+		      target->type == LOG_TGT_TYPE_STDERR;
+
+	while (1) {
+		uint32_t tail = as->tail;
+		uint32_t head = __atomic_load_n(&as->head, __ATOMIC_ACQUIRE);
+
+		if (tail == head) {
+			/* flush once per burst rather than once per line */
+			if (is_file)
+				fflush(target->tgt_file.out);
+
+			__atomic_store_n(&as->waiting, 1, __ATOMIC_SEQ_CST);
+			if (__atomic_load_n(&as->head, __ATOMIC_SEQ_CST) != tail)
+				continue;
+			if (__atomic_load_n(&as->stop, __ATOMIC_ACQUIRE))
+				break;
+			while (sem_wait(&as->sem) < 0 && errno == EINTR)
+				;
+			continue;
+		}
+
+		while (tail != head) {
+			struct log_async_rec *rec = (struct log_async_rec *)
+				&as->ring[tail & (as->size - 1)];
+
+			if (rec->len == 0) {
+				tail += as->size - (tail & (as->size - 1));
+				continue;
+			}
+
+			if (is_file)
+				fputs((const char *)(rec + 1),
+				      target->tgt_file.out);
+			else
+				as->output(target, rec->level,
+					   (const char *)(rec + 1));
+
+			tail += REC_SIZE(rec->len);
+			__atomic_add_fetch(&as->written, 1, __ATOMIC_RELAXED);
+			__atomic_store_n(&as->tail, tail, __ATOMIC_RELEASE);
+		}
+	}
+
+	return NULL;
+}
+
+static void async_stop(struct log_target *target)
+{
+	struct log_async *as = target->async;
+
+	__atomic_store_n(&as->stop, 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&as->waiting, 1, __ATOMIC_SEQ_CST);
+	wake_writer(as);
+	pthread_join(as->thread, NULL);
+
+	sem_destroy(&as->sem);
+	target->output = as->output;
+	target->async = NULL;
+	talloc_free(as);
+}
+
+/*! \brief Enable or disable asynchronous output of a log target
+ *  \param[in] target Log target to be affected
+ *  \param[in] size Size of the ring buffer in bytes, 0 to disable
+ *  \returns 0 on success, negative in case of error
+ *
+ * Log lines are still formatted (and timestamped) when they are
+ * logged, but written by a separate thread. If the ring buffer is
+ * full, lines are dropped and counted, see \ref log_target_async_stats.
+ * Disabling waits until all queued lines have been written. VTY
+ * targets cannot be made asynchronous.
+ */
+int log_target_set_async(struct log_target *target, unsigned int size)
+{
+	struct log_async *as;
+	uint32_t sz;
+
+	if (target->async)
+		async_stop(target);
+
+	if (!size)
+		return 0;
+
+	if (target->type == LOG_TGT_TYPE_VTY || !target->output)
+		return -EINVAL;
+
+	/* room for at least two maximum sized lines */
+	for (sz = 16384; sz < size && sz < (1U << 30); sz <<= 1)
+		;
+
+	as = talloc_zero(target, struct log_async);
+	if (!as)
+		return -ENOMEM;
+
+	as->ring = talloc_size(as, sz);
+	if (!as->ring) {
+		talloc_free(as);
+		return -ENOMEM;
+	}
+
+	as->target = target;
+	as->output = target->output;
+	as->size = sz;
+
+	if (sem_init(&as->sem, 0, 0) < 0) {
+		talloc_free(as);
+		return -errno;
+	}
+
+	if (pthread_create(&as->thread, NULL, writer_thread, as)) {
+		sem_destroy(&as->sem);
+		talloc_free(as);
+		return -EAGAIN;
+	}
+
+	target->async = as;
+	target->output = _async_output;
+
+	return 0;
+}
+
+/*! \brief Wait until all queued log lines of a target have been written
+ *  \param[in] target Log target to be flushed
+ */
+void log_target_async_flush(struct log_target *target)
+{
+	struct log_async *as = target->async;
+
+	if (!as)
+		return;
+
+	/* the writer flushes its stream before going to sleep */
+	wake_writer(as);
+	while (ring_used(as) ||
+	       !__atomic_load_n(&as->waiting, __ATOMIC_SEQ_CST))
+		usleep(1000);
+}
+
+/*! \brief Get the counters of an asynchronous log target
+ *  \param[in] target Log target
+ *  \param[out] stats Counters
+ *  \returns 0 on success, -EINVAL if the target is not asynchronous
+ */
+int log_target_async_stats(struct log_target *target,
+			   struct log_async_stats *stats)
+{
+	struct log_async *as = target->async;
+
+	if (!as)
+		return -EINVAL;
+
+	stats->written = __atomic_load_n(&as->written, __ATOMIC_RELAXED);
+	stats->dropped = as->dropped;
+	stats->queued = ring_used(as);
+	stats->size = as->size;
+
+	return 0;
+}
+
+#else /* HAVE_PTHREAD */
+
+int log_target_set_async(struct log_target *target, unsigned int size)
+{
+	return size ? -ENOTSUP : 0;
+}
+
+void log_target_async_flush(struct log_target *target)
+{
+}
+
+int log_target_async_stats(struct log_target *target,
+			   struct log_async_stats *stats)
+{
+	return -EINVAL;
+}
+
+#endif /* HAVE_PTHREAD */
+
+/* @} */
@@ -25,6 +25,7 @@
 /*! \file msgb.c
  */
 
+#include <errno.h>
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
@@ -36,6 +37,114 @@
 
 void *tall_msgb_ctx;
 
+/* msgb pool, see msgb_pool_init() */
+static const uint16_t pool_sizes[MSGB_POOL_NUM_CLASSES] = { 256, 512, 2048, 4096 };
+
+struct msgb_pool_class {
+	struct llist_head free;
+	unsigned int cached;
+	unsigned long allocs;
+	unsigned long reused;
+};
+
+static struct {
+	int enabled;
+	unsigned int flags;
+	unsigned int max_cached;
+	void *ctx;
+	struct msgb_pool_class cls[MSGB_POOL_NUM_CLASSES];
+} pool;
+
+static struct msgb_pool_class *pool_class(size_t size, uint16_t *cls_size)
+{
+	int i;
+
+	for (i = 0; i < MSGB_POOL_NUM_CLASSES; i++) {
+		if (size <= pool_sizes[i]) {
+			*cls_size = pool_sizes[i];
+			return &pool.cls[i];
+		}
+	}
+	return NULL;
+}
+
+/* called by talloc_free() for pooled msgbs, returning -1 keeps the chunk */
+static int msgb_pool_destructor(struct msgb *msg)
+{
+	struct msgb_pool_class *c;
+	uint16_t cls_size;
+
+	c = pool_class(talloc_get_size(msg) - sizeof(*msg), &cls_size);
+
+	/* a cached msgb is only freed with the pool (or its parent) */
+	if (!msg->head) {
+		llist_del(&msg->list);
+		c->cached--;
+		return 0;
+	}
+
+	if (!pool.enabled || c->cached >= pool.max_cached)
+		return 0;
+
+	talloc_free_children(msg);
+	talloc_steal(pool.ctx, msg);
+	msg->head = NULL;
+	llist_add(&msg->list, &c->free);
+	c->cached++;
+
+	return -1;
+}
+
+/* release the free msgbs, even those that were moved out of the pool
+ * context by talloc when their former parent got freed */
+static int msgb_pool_ctx_destructor(void *ctx)
+{
+	int i;
+
+	pool.enabled = 0;
+	for (i = 0; i < MSGB_POOL_NUM_CLASSES; i++) {
+		while (!llist_empty(&pool.cls[i].free))
+			talloc_free(llist_entry(pool.cls[i].free.next, struct msgb, list));
+	}
+	pool.ctx = NULL;
+
+	return 0;
+}
+
+static struct msgb *msgb_pool_alloc(uint16_t size, const char *name)
+{
+	struct msgb_pool_class *c;
+	struct msgb *msg;
+	uint16_t cls_size;
+
+	c = pool_class(size, &cls_size);
+	if (!c)
+		return NULL;
+
+	c->allocs++;
+
+	if (llist_empty(&c->free)) {
+		msg = _talloc_zero(tall_msgb_ctx, sizeof(*msg) + cls_size, name);
+		if (msg)
+			talloc_set_destructor(msg, msgb_pool_destructor);
+		return msg;
+	}
+
+	msg = llist_entry(c->free.next, struct msgb, list);
+	llist_del(&msg->list);
+	c->cached--;
+	c->reused++;
+
+	talloc_steal(tall_msgb_ctx, msg);
+	talloc_set_name_const(msg, name);
+	if (pool.flags & MSGB_POOL_F_NO_ZERO)
+		memset(msg, 0, sizeof(*msg));
+	else
+		memset(msg, 0, sizeof(*msg) + size);
+
+	return msg;
+}
+
 /*! \brief Allocate a new message buffer
  * \param[in] size Length in octets, including headroom
  * \param[in] name Human-readable name to be associated with msgb
@@ -46,9 +155,12 @@ void *tall_msgb_ctx;
  */
 struct msgb *msgb_alloc(uint16_t size, const char *name)
 {
-	struct msgb *msg;
+	struct msgb *msg = NULL;
 
-	msg = _talloc_zero(tall_msgb_ctx, sizeof(*msg) + size, name);
+	if (pool.enabled)
+		msg = msgb_pool_alloc(size, name);
+	if (!msg)
+		msg = _talloc_zero(tall_msgb_ctx, sizeof(*msg) + size, name);
 
 	if (!msg) {
 		//LOGP(DRSL, LOGL_FATAL, "unable to allocate msgb\n");
@@ -72,6 +184,68 @@ void msgb_free(struct msgb *m)
 	talloc_free(m);
 }
 
+/*! \brief Enable recycling of message buffers
+ * \param[in] max_cached Maximum number of free msgbs kept per size class
+ * \param[in] flags Bitmask of MSGB_POOL_F_*
+ * \returns 0 on success, negative on error
+ *
+ * Message buffers of up to 4096 octets are then allocated in one of
+ * the size classes 256, 512, 2048 and 4096, and put on a free list of
+ * their class instead of being released. They are still talloc chunks
+ * in the context set by \ref msgb_set_talloc_ctx while in use, so
+ * releasing them by \ref msgb_free or talloc_free() and the talloc
+ * report work as before; the free ones show up in a "msgb_pool"
+ * context below it. With \ref MSGB_POOL_F_NO_ZERO, only the msgb
+ * header of a recycled msgb is cleared, not its data.
+ */
+int msgb_pool_init(unsigned int max_cached, unsigned int flags)
+{
+	int i;
+
+	if (pool.ctx)
+		msgb_pool_destroy();
+
+	pool.ctx = talloc_named_const(tall_msgb_ctx, 0, "msgb_pool");
+	if (!pool.ctx)
+		return -ENOMEM;
+	talloc_set_destructor(pool.ctx, msgb_pool_ctx_destructor);
+
+	for (i = 0; i < MSGB_POOL_NUM_CLASSES; i++) {
+		memset(&pool.cls[i], 0, sizeof(pool.cls[i]));
+		INIT_LLIST_HEAD(&pool.cls[i].free);
+	}
+	pool.max_cached = max_cached;
+	pool.flags = flags;
+	pool.enabled = 1;
+
+	return 0;
+}
+
+/*! \brief Disable recycling of message buffers and release the free ones
+ *
+ * Message buffers still in use are released normally later on.
+ */
+void msgb_pool_destroy(void)
+{
+	if (pool.ctx)
+		talloc_free(pool.ctx);
+}
+
+/*! \brief Get the counters of the message buffer pool
+ *  \param[out] stats Array of \ref MSGB_POOL_NUM_CLASSES entries
+ */
+void msgb_pool_get_stats(struct msgb_pool_stats *stats)
+{
+	int i;
+
+	for (i = 0; i < MSGB_POOL_NUM_CLASSES; i++) {
+		stats[i].size = pool_sizes[i];
+		stats[i].allocs = pool.cls[i].allocs;
+		stats[i].reused = pool.cls[i].reused;
+		stats[i].cached = pool.cls[i].cached;
+	}
+}
+
 /*! \brief Enqueue message buffer to tail of a queue
  * \param[in] queue linked list header of queue
  * \param[in] msgb message buffer to be added to the queue
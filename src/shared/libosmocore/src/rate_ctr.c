@@ -24,8 +24,21 @@
  *  @{
  */
 
-/*! \file rate_ctr.c */
+/*! \file rate_ctr.c
+ *
+ * Increments are not added to \ref rate_ctr::current directly but to a
+ * row of deltas in the group, which the one-second tick folds into the
+ * counters.  A group allocated with \ref rate_ctr_group_alloc_sharded has
+ * one row per thread shard, updated atomically, so the same counters can
+ * be incremented from several threads.
+ *
+ * The tick only visits the groups that have been incremented since the
+ * previous tick.  An idle group is brought up to date in closed form the
+ * next time it is touched or read, so the cost of the tick depends on the
+ * number of busy groups, not on the number of groups in the system.
+ */
 
+#include "../config.h"
 
 #include <stdint.h>
 #include <string.h>
@@ -36,21 +49,62 @@
 #include <osmocom/core/timer.h>
 #include <osmocom/core/rate_ctr.h>
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+
+static pthread_mutex_t touched_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread unsigned int thread_shard;
+static unsigned int next_shard;
+
+static inline void touched_list_lock(void)
+{
+	pthread_mutex_lock(&touched_lock);
+}
+
+static inline void touched_list_unlock(void)
+{
+	pthread_mutex_unlock(&touched_lock);
+}
+
+/* threads are spread round robin over the shards */
+static inline unsigned int shard_id(void)
+{
+	if (!thread_shard)
+		thread_shard = __atomic_add_fetch(&next_shard, 1,
+						  __ATOMIC_RELAXED);
+	return thread_shard;
+}
+#else
+static inline void touched_list_lock(void) { }
+static inline void touched_list_unlock(void) { }
+static inline unsigned int shard_id(void) { return 0; }
+#endif
+
+/* number of uint64_t in a cache line */
+#define SHARD_ALIGN	8
+
 static LLIST_HEAD(rate_ctr_groups);
+static LLIST_HEAD(touched_groups);
 
 static void *tall_rate_ctr_ctx;
 
-/*! \brief Allocate a new group of counters according to description
- *  \param[in] ctx \ref talloc context
- *  \param[in] desc Rate counter group description
- *  \param[in] idx Index of new counter group
- */
-struct rate_ctr_group *rate_ctr_group_alloc(void *ctx,
-					    const struct rate_ctr_group_desc *desc,
-					    unsigned int idx)
+static struct osmo_timer_list rate_ctr_timer;
+static uint64_t timer_ticks;
+
+static const uint64_t intv_ticks[RATE_CTR_INTV_NUM] = {
+	[RATE_CTR_INTV_SEC]	= 1,
+	[RATE_CTR_INTV_MIN]	= 60,
+	[RATE_CTR_INTV_HOUR]	= 60 * 60,
+	[RATE_CTR_INTV_DAY]	= 24 * 60 * 60,
+};
+
+static struct rate_ctr_group *group_alloc(void *ctx,
+					  const struct rate_ctr_group_desc *desc,
+					  unsigned int idx, unsigned int shards)
 {
-	unsigned int size;
+	unsigned int size, i;
 	struct rate_ctr_group *group;
+	uint8_t *mem;
 
 	size = sizeof(struct rate_ctr_group) +
 			desc->num_ctr * sizeof(struct rate_ctr);
@@ -65,22 +119,105 @@ struct rate_ctr_group *rate_ctr_group_alloc(void *ctx,
 	group->desc = desc;
 	group->idx = idx;
 
+	/* shard rows are written by different threads, keep them apart */
+	if (shards > 1) {
+		group->shard_stride = (desc->num_ctr + SHARD_ALIGN - 1) &
+				      ~(SHARD_ALIGN - 1);
+		mem = talloc_zero_size(group, shards * group->shard_stride *
+				       sizeof(uint64_t) + 64);
+		if (mem)
+			mem += -(uintptr_t) mem & 63;
+	} else {
+		group->shard_stride = desc->num_ctr;
+		mem = talloc_zero_size(group, desc->num_ctr * sizeof(uint64_t));
+	}
+	if (!mem) {
+		talloc_free(group);
+		return NULL;
+	}
+	group->shard = (uint64_t *) mem;
+	group->shard_mask = shards - 1;
+
+	for (i = 0; i < desc->num_ctr; i++)
+		group->ctr[i].grp = group;
+	group->tick = timer_ticks;
+	INIT_LLIST_HEAD(&group->touched_list);
+
 	llist_add(&group->list, &rate_ctr_groups);
 
 	return group;
 }
 
+/*! \brief Allocate a new group of counters according to description
+ *  \param[in] ctx \ref talloc context
+ *  \param[in] desc Rate counter group description
+ *  \param[in] idx Index of new counter group
+ *
+ * The counters of the group may only be updated from the thread running
+ * the select loop.
+ */
+struct rate_ctr_group *rate_ctr_group_alloc(void *ctx,
+					    const struct rate_ctr_group_desc *desc,
+					    unsigned int idx)
+{
+	return group_alloc(ctx, desc, idx, 1);
+}
+
+/*! \brief Allocate a new group of counters updated from several threads
+ *  \param[in] ctx \ref talloc context
+ *  \param[in] desc Rate counter group description
+ *  \param[in] idx Index of new counter group
+ *
+ * Each thread adds to its own shard of \ref RATE_CTR_SHARDS, the shards
+ * are summed up when the counters are read.  Allocating and freeing the
+ * group remains the job of the thread running the select loop.
+ */
+struct rate_ctr_group *rate_ctr_group_alloc_sharded(void *ctx,
+					const struct rate_ctr_group_desc *desc,
+					unsigned int idx)
+{
+	return group_alloc(ctx, desc, idx, RATE_CTR_SHARDS);
+}
+
 /*! \brief Free the memory for the specified group of counters */
 void rate_ctr_group_free(struct rate_ctr_group *grp)
 {
+	touched_list_lock();
+	if (grp->touched)
+		llist_del(&grp->touched_list);
+	touched_list_unlock();
+
 	llist_del(&grp->list);
 	talloc_free(grp);
 }
 
+/* queue the group for the next tick */
+static void group_touch(struct rate_ctr_group *grp)
+{
+	touched_list_lock();
+	if (!grp->touched) {
+		__atomic_store_n(&grp->touched, 1, __ATOMIC_SEQ_CST);
+		llist_add_tail(&grp->touched_list, &touched_groups);
+	}
+	touched_list_unlock();
+}
+
 /*! \brief Add a number to the counter */
 void rate_ctr_add(struct rate_ctr *ctr, int inc)
 {
-	ctr->current += inc;
+	struct rate_ctr_group *grp = ctr->grp;
+	uint64_t *delta = &grp->shard[ctr - grp->ctr];
+
+	if (grp->shard_mask) {
+		delta += (shard_id() & grp->shard_mask) * grp->shard_stride;
+		__atomic_fetch_add(delta, inc, __ATOMIC_SEQ_CST);
+	} else
+		*delta += inc;
+
+	/* the tick clears the flag before it folds the deltas, so seeing
+	 * it set means our delta is folded by the tick that clears it */
+	if (!__atomic_load_n(&grp->touched, __ATOMIC_SEQ_CST))
+		group_touch(grp);
 }
 
 static void interval_expired(struct rate_ctr *ctr, enum rate_ctr_intv intv)
@@ -96,41 +233,154 @@ static void interval_expired(struct rate_ctr *ctr, enum rate_ctr_intv intv)
 		ctr->intv[intv+1].rate += ctr->intv[intv].rate;
 }
 
-static struct osmo_timer_list rate_ctr_timer;
-static uint64_t timer_ticks;
+/* Compute the intervals of a counter that did not change between the
+ * ticks t0 and t1, the same as running every tick in between */
+static void intervals_catch_up(struct rate_ctr *ctr, uint64_t t0, uint64_t t1)
+{
+	uint64_t n;
+	int i;
+
+	if (t1 <= t0)
+		return;
+
+	for (i = 0; i < RATE_CTR_INTV_NUM; i++) {
+		n = t1 / intv_ticks[i] - t0 / intv_ticks[i];
+		if (!n)
+			continue;
+		interval_expired(ctr, i);
+		/* the counter stood still during the later intervals */
+		if (n > 1)
+			ctr->intv[i].rate = 0;
+	}
+}
+
+/* Take the deltas of all shards of one counter */
+static uint64_t shards_fold(struct rate_ctr_group *grp, unsigned int i)
+{
+	uint64_t sum = 0;
+	unsigned int s;
+
+	for (s = 0; s <= grp->shard_mask; s++)
+		sum += __atomic_exchange_n(&grp->shard[s * grp->shard_stride + i],
+					   0, __ATOMIC_SEQ_CST);
+	return sum;
+}
 
-/* The one-second interval has expired */
-static void rate_ctr_group_intv(struct rate_ctr_group *grp)
+static uint64_t shards_sum(const struct rate_ctr_group *grp, unsigned int i)
+{
+	uint64_t sum = 0;
+	unsigned int s;
+
+	for (s = 0; s <= grp->shard_mask; s++)
+		sum += __atomic_load_n(&grp->shard[s * grp->shard_stride + i],
+				       __ATOMIC_RELAXED);
+	return sum;
+}
+
+/* The one-second interval has expired for a group that changed */
+static void rate_ctr_group_intv(struct rate_ctr_group *grp, uint64_t tick)
 {
 	unsigned int i;
 
+	__atomic_store_n(&grp->seq, grp->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
 	for (i = 0; i < grp->desc->num_ctr; i++) {
 		struct rate_ctr *ctr = &grp->ctr[i];
 
-		interval_expired(ctr, RATE_CTR_INTV_SEC);
-		if ((timer_ticks % 60) == 0)
-			interval_expired(ctr, RATE_CTR_INTV_MIN);
-		if ((timer_ticks % (60*60)) == 0)
-			interval_expired(ctr, RATE_CTR_INTV_HOUR);
-		if ((timer_ticks % (24*60*60)) == 0)
-			interval_expired(ctr, RATE_CTR_INTV_DAY);
+		/* the group may have been idle before the last second */
+		intervals_catch_up(ctr, grp->tick, tick - 1);
+		ctr->current += shards_fold(grp, i);
+		intervals_catch_up(ctr, tick - 1, tick);
 	}
+	grp->tick = tick;
+
+	__atomic_store_n(&grp->seq, grp->seq + 1, __ATOMIC_RELEASE);
 }
 
 static void rate_ctr_timer_cb(void *data)
 {
-	struct rate_ctr_group *ctrg;
-
+	struct rate_ctr_group *ctrg, *ctrg2;
 	/* Increment number of ticks before we calculate intervals,
 	 * as a counter value of 0 would already wrap all counters */
-	timer_ticks++;
+	uint64_t tick = timer_ticks + 1;
+
+	touched_list_lock();
+	llist_for_each_entry_safe(ctrg, ctrg2, &touched_groups, touched_list) {
+		llist_del(&ctrg->touched_list);
+		__atomic_store_n(&ctrg->touched, 0, __ATOMIC_SEQ_CST);
+		rate_ctr_group_intv(ctrg, tick);
+	}
+	touched_list_unlock();
 
-	llist_for_each_entry(ctrg, &rate_ctr_groups, list)
-		rate_ctr_group_intv(ctrg);
+	/* readers bring idle groups up to this tick themselves */
+	__atomic_store_n(&timer_ticks, tick, __ATOMIC_RELEASE);
 
 	osmo_timer_schedule(&rate_ctr_timer, 1, 0);
 }
 
+/* Read counters [first, first + num) of a group, consistent with one tick */
+static void group_read(const struct rate_ctr_group *grp, unsigned int first,
+		       unsigned int num, struct rate_ctr_snapshot *snap)
+{
+	struct rate_ctr ctr;
+	unsigned int seq, i, j;
+	uint64_t now;
+
+	do {
+		seq = __atomic_load_n(&grp->seq, __ATOMIC_ACQUIRE);
+		now = __atomic_load_n(&timer_ticks, __ATOMIC_ACQUIRE);
+
+		for (i = 0; i < num; i++) {
+			memcpy(&ctr, &grp->ctr[first + i], sizeof(ctr));
+			intervals_catch_up(&ctr, grp->tick, now);
+
+			snap[i].value = ctr.current + shards_sum(grp, first + i);
+			for (j = 0; j < RATE_CTR_INTV_NUM; j++)
+				snap[i].rate[j] = ctr.intv[j].rate;
+		}
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((seq & 1) ||
+		 seq != __atomic_load_n(&grp->seq, __ATOMIC_RELAXED));
+}
+
+/*! \brief Read the value and the rates of a counter
+ *  \param[in] ctr counter to read
+ *  \param[out] snap value including increments since the last tick and
+ *	       the per-interval rates
+ *
+ * Safe to call from any thread.
+ */
+void rate_ctr_snapshot(const struct rate_ctr *ctr,
+		       struct rate_ctr_snapshot *snap)
+{
+	group_read(ctr->grp, ctr - ctr->grp->ctr, 1, snap);
+}
+
+/*! \brief Get the current value of a counter, safe from any thread */
+uint64_t rate_ctr_get(const struct rate_ctr *ctr)
+{
+	struct rate_ctr_snapshot snap;
+
+	rate_ctr_snapshot(ctr, &snap);
+	return snap.value;
+}
+
+/*! \brief Read all counters of a group at once
+ *  \param[in] grp counter group to read
+ *  \param[out] snap array of grp->desc->num_ctr entries
+ *
+ * All values and rates belong to the same one-second tick, which makes
+ * this the function of choice for exporters.  Safe to call from any
+ * thread.
+ */
+void rate_ctr_group_snapshot(const struct rate_ctr_group *grp,
+			     struct rate_ctr_snapshot *snap)
+{
+	group_read(grp, 0, grp->desc->num_ctr, snap);
+}
+
 /*! \brief Initialize the counter module */
 int rate_ctr_init(void *tall_ctx)
 {
@@ -141,6 +391,27 @@ int rate_ctr_init(void *tall_ctx)
 	return 0;
 }
 
+/*! \brief Iterate over all counter groups
+ *  \param[in] handle_group call-back for each group, a negative return
+ *	       value stops the iteration
+ *  \param[in] data opaque pointer passed to the call-back
+ *  \returns the last value returned by the call-back
+ */
+int rate_ctr_for_each_group(int (*handle_group)(struct rate_ctr_group *,
+						 void *), void *data)
+{
+	struct rate_ctr_group *ctrg;
+	int rc = 0;
+
+	llist_for_each_entry(ctrg, &rate_ctr_groups, list) {
+		rc = handle_group(ctrg, data);
+		if (rc < 0)
+			return rc;
+	}
+
+	return rc;
+}
+
 /*! \brief Search for counter group based on group name and index */
 struct rate_ctr_group *rate_ctr_get_group_by_name_idx(const char *name, const unsigned int idx)
 {
@@ -21,15 +21,22 @@
 
 #include <fcntl.h>
 #include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
 
 #include <osmocom/core/select.h>
 #include <osmocom/core/linuxlist.h>
 #include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
 
 #include "../config.h"
 
 #ifdef HAVE_SYS_SELECT_H
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 /*! \addtogroup select
  *  @{
  */
@@ -38,9 +45,195 @@
  *  \brief select loop abstraction
  */
 
+/* bits of osmo_fd._state, the lower bits hold the armed BSC_FD_* mask */
+#define FD_S_WHEN_MASK		(BSC_FD_READ | BSC_FD_WRITE | BSC_FD_EXCEPT)
+#define FD_S_REGISTERED		0x0100
+/* fd cannot be handled by epoll (e.g. regular file), always ready */
+#define FD_S_NOPOLL		0x0200
+
 static int maxfd = 0;
 static LLIST_HEAD(osmo_fds);
 static int unregistered_count;
+static enum osmo_select_backend select_backend = OSMO_SELECT_BACKEND_SELECT;
+
+#ifdef HAVE_SYS_EPOLL_H
+/* maximum number of events fetched by one epoll_wait() call */
+#define EP_MAX_EVENTS		64
+
+static int ep_fd = -1;
+static struct epoll_event ep_events[EP_MAX_EVENTS];
+/* events of the current iteration that are not yet dispatched */
+static int ep_cur, ep_nevents;
+static unsigned int ep_nopoll_count;
+
+static uint32_t ep_events_from_when(unsigned int when)
+{
+	uint32_t events = 0;
+
+	if (when & BSC_FD_READ)
+		events |= EPOLLIN;
+	if (when & BSC_FD_WRITE)
+		events |= EPOLLOUT;
+	if (when & BSC_FD_EXCEPT)
+		events |= EPOLLPRI;
+
+	return events;
+}
+
+/* bring the kernel-side event mask of an fd in line with fd->when */
+static int ep_update(struct osmo_fd *fd)
+{
+	unsigned int armed = fd->_state & FD_S_WHEN_MASK;
+	unsigned int when = fd->when & FD_S_WHEN_MASK;
+	struct epoll_event ev;
+	int op, rc;
+
+	if (fd->_state & FD_S_NOPOLL) {
+		fd->_state = (fd->_state & ~FD_S_WHEN_MASK) | when;
+		return 0;
+	}
+
+	if (armed == when)
+		return 0;
+
+	/* an fd without any interest is removed from the epoll set, as
+	 * EPOLLHUP/EPOLLERR would otherwise still be reported for it */
+	if (!when)
+		op = EPOLL_CTL_DEL;
+	else if (!armed)
+		op = EPOLL_CTL_ADD;
+	else
+		op = EPOLL_CTL_MOD;
+
+	ev.events = ep_events_from_when(when);
+	ev.data.ptr = fd;
+	rc = epoll_ctl(ep_fd, op, fd->fd, &ev);
+	if (rc < 0) {
+		if (op == EPOLL_CTL_ADD && errno == EPERM) {
+			/* regular files are always readable/writable */
+			fd->_state |= FD_S_NOPOLL;
+			ep_nopoll_count++;
+		} else if (op != EPOLL_CTL_DEL)
+			return -errno;
+	}
+
+	fd->_state = (fd->_state & ~FD_S_WHEN_MASK) | when;
+	return 0;
+}
+
+/* remove an fd from the epoll set and from the pending events */
+static void ep_remove(struct osmo_fd *fd)
+{
+	struct epoll_event ev = { 0 };
+	int i;
+
+	if (fd->_state & FD_S_NOPOLL) {
+		ep_nopoll_count--;
+		fd->_state &= ~FD_S_NOPOLL;
+	} else if (fd->_state & FD_S_WHEN_MASK) {
+		/* may fail if the fd has been closed already, in which
+		 * case the kernel has removed it from the set anyway */
+		epoll_ctl(ep_fd, EPOLL_CTL_DEL, fd->fd, &ev);
+	}
+	fd->_state &= ~FD_S_WHEN_MASK;
+
+	/* don't dispatch events to an fd that is gone */
+	for (i = ep_cur; i < ep_nevents; i++) {
+		if (ep_events[i].data.ptr == fd)
+			ep_events[i].data.ptr = NULL;
+	}
+}
+
+static unsigned int ep_revents_to_flags(struct osmo_fd *fd, uint32_t revents)
+{
+	unsigned int flags = 0;
+
+	if (revents & (EPOLLIN | EPOLLHUP | EPOLLERR))
+		flags |= BSC_FD_READ;
+	if (revents & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+		flags |= BSC_FD_WRITE;
+	if (revents & EPOLLPRI)
+		flags |= BSC_FD_EXCEPT;
+
+	flags &= fd->when;
+
+	/* make sure an error is not silently ignored (and reported again
+	 * and again by the level-triggered epoll) */
+	if (!flags && (revents & (EPOLLHUP | EPOLLERR)))
+		flags = fd->when;
+
+	return flags;
+}
+
+static int ep_select_main(int polling)
+{
+	struct osmo_fd *ufd, *tmp;
+	struct timeval *tv;
+	int work = 0, timeout, rc;
+
+	osmo_timers_check();
+
+	if (polling || ep_nopoll_count)
+		timeout = 0;
+	else {
+		osmo_timers_prepare();
+		tv = osmo_timers_nearest();
+		if (!tv)
+			timeout = -1;
+		else
+			/* round up so we don't wake before the timer expired */
+			timeout = tv->tv_sec * 1000 + (tv->tv_usec + 999) / 1000;
+	}
+
+	rc = epoll_wait(ep_fd, ep_events, ARRAY_SIZE(ep_events), timeout);
+	if (rc < 0)
+		return 0;
+
+	/* fire timers */
+	osmo_timers_update();
+
+	/* call registered callback functions */
+	ep_nevents = rc;
+	for (ep_cur = 0; ep_cur < ep_nevents; ) {
+		struct epoll_event *ev = &ep_events[ep_cur++];
+		unsigned int flags;
+
+		ufd = ev->data.ptr;
+		if (!ufd)
+			continue;
+
+		flags = ep_revents_to_flags(ufd, ev->events);
+		if (flags) {
+			work = 1;
+			ufd->cb(ufd, flags);
+		}
+	}
+	ep_cur = ep_nevents = 0;
+
+	if (!ep_nopoll_count)
+		return work;
+
+	/* fds that epoll doesn't support are always ready.  If one gets
+	 * unregistered, the remaining ones are served in the next iteration */
+	unregistered_count = 0;
+	llist_for_each_entry_safe(ufd, tmp, &osmo_fds, list) {
+		unsigned int flags;
+
+		if (!(ufd->_state & FD_S_NOPOLL))
+			continue;
+
+		flags = ufd->when & (BSC_FD_READ | BSC_FD_WRITE);
+		if (flags) {
+			work = 1;
+			ufd->cb(ufd, flags);
+		}
+		if (unregistered_count >= 1)
+			break;
+	}
+
+	return work;
+}
+#endif /* HAVE_SYS_EPOLL_H */
 
 /*! \brief Register a new file descriptor with select loop abstraction
  *  \param[in] fd osmocom file descriptor to be registered
@@ -67,10 +260,6 @@ int osmo_fd_register(struct osmo_fd *fd)
 	if (flags < 0)
 		return flags;
 
-	/* Register FD */
-	if (fd->fd > maxfd)
-		maxfd = fd->fd;
-
 #ifdef BSC_FD_CHECK
 	struct osmo_fd *entry;
 	llist_for_each_entry(entry, &osmo_fds, list) {
@@ -81,6 +270,22 @@ int osmo_fd_register(struct osmo_fd *fd)
 	}
 #endif
 
+	fd->_state = FD_S_REGISTERED;
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (select_backend == OSMO_SELECT_BACKEND_EPOLL) {
+		int rc = ep_update(fd);
+		if (rc < 0) {
+			fd->_state = 0;
+			return rc;
+		}
+	}
+#endif
+
+	/* Register FD */
+	if (fd->fd > maxfd)
+		maxfd = fd->fd;
+
 	llist_add_tail(&fd->list, &osmo_fds);
 
 	return 0;
@@ -91,10 +296,88 @@ int osmo_fd_register(struct osmo_fd *fd)
  */
 void osmo_fd_unregister(struct osmo_fd *fd)
 {
+#ifdef HAVE_SYS_EPOLL_H
+	if (select_backend == OSMO_SELECT_BACKEND_EPOLL)
+		ep_remove(fd);
+#endif
+	fd->_state = 0;
 	unregistered_count++;
 	llist_del(&fd->list);
 }
 
+/*! \brief Change the events a file descriptor is interested in
+ *  \param[in] fd osmocom file descriptor
+ *  \param[in] and_mask bit-mask to be AND-ed with \ref osmo_fd::when
+ *  \param[in] or_mask bit-mask to be OR-ed with \ref osmo_fd::when
+ *
+ * Unlike assigning \ref osmo_fd::when directly, this immediately pushes
+ * the change to the kernel when the epoll back-end is in use.  The epoll
+ * back-end does not look at \ref osmo_fd::when of a registered fd
+ * otherwise, so once registered, it must only be changed this way.
+ */
+void osmo_fd_update_when(struct osmo_fd *fd, unsigned int and_mask,
+			 unsigned int or_mask)
+{
+	fd->when = (fd->when & and_mask) | or_mask;
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (select_backend == OSMO_SELECT_BACKEND_EPOLL
+	 && (fd->_state & FD_S_REGISTERED))
+		ep_update(fd);
+#endif
+}
+
+/*! \brief Select the back-end used by \ref osmo_select_main
+ *  \param[in] backend back-end to be used from now on
+ *  \returns 0 on success, negative errno otherwise
+ *
+ * File descriptors that are already registered are moved over to the new
+ * back-end.  Must not be called from within a file descriptor call-back.
+ */
+int osmo_select_set_backend(enum osmo_select_backend backend)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	struct osmo_fd *ufd;
+
+	if (backend == select_backend)
+		return 0;
+
+	switch (backend) {
+	case OSMO_SELECT_BACKEND_EPOLL:
+		ep_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (ep_fd < 0)
+			return -errno;
+		ep_nopoll_count = 0;
+		llist_for_each_entry(ufd, &osmo_fds, list) {
+			ufd->_state &= ~(FD_S_WHEN_MASK | FD_S_NOPOLL);
+			ep_update(ufd);
+		}
+		break;
+	case OSMO_SELECT_BACKEND_SELECT:
+		close(ep_fd);
+		ep_fd = -1;
+		llist_for_each_entry(ufd, &osmo_fds, list)
+			ufd->_state &= ~(FD_S_WHEN_MASK | FD_S_NOPOLL);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	select_backend = backend;
+	return 0;
+#else
+	if (backend != OSMO_SELECT_BACKEND_SELECT)
+		return -ENOTSUP;
+	return 0;
+#endif
+}
+
+/*! \brief Get the back-end currently used by \ref osmo_select_main */
+enum osmo_select_backend osmo_select_get_backend(void)
+{
+	return select_backend;
+}
+
 /*! \brief select main loop integration
  *  \param[in] polling should we pollonly (1) or block on select (0)
  */
@@ -105,6 +388,11 @@ int osmo_select_main(int polling)
 	int work = 0, rc;
 	struct timeval no_time = {0, 0};
 
+#ifdef HAVE_SYS_EPOLL_H
+	if (select_backend == OSMO_SELECT_BACKEND_EPOLL)
+		return ep_select_main(polling);
+#endif
+
 	FD_ZERO(&readset);
 	FD_ZERO(&writeset);
 	FD_ZERO(&exceptset);
@@ -0,0 +1,391 @@
+/* periodic export of counters to a statistics collector */
+
+/* (C) 2026 by the osmocom-bb contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*! \addtogroup stats
+ *  @{
+ */
+
+/*! \file stats.c */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/socket.h>
+#include <osmocom/core/statistics.h>
+#include <osmocom/core/stats.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+
+/*! \brief all reporters, see \ref osmo_stats_reporter_create */
+LLIST_HEAD(osmo_stats_reporters);
+
+static struct osmo_timer_list stats_timer;
+static int stats_interval;
+static unsigned int report_count;
+
+/* report index of the next counter announced, 0 means none */
+static uint32_t next_idx = 1;
+
+/* snapshot of the group being reported, grows to the largest group */
+static struct rate_ctr_snapshot *group_snap;
+static unsigned int group_snap_len;
+
+/* records are not aligned */
+static void put_u32(uint8_t *p, uint32_t val)
+{
+	p[0] = val >> 24;
+	p[1] = val >> 16;
+	p[2] = val >> 8;
+	p[3] = val;
+}
+
+static void stats_buffer_reset(struct osmo_stats_reporter *rep)
+{
+	msgb_reset(rep->buffer);
+	rep->num_records = 0;
+	if (rep->type == OSMO_STATS_REPORTER_BINARY)
+		msgb_put(rep->buffer, sizeof(struct osmo_stats_bin_hdr));
+}
+
+static void stats_flush(struct osmo_stats_reporter *rep)
+{
+	struct msgb *msg = rep->buffer;
+	struct osmo_stats_bin_hdr *hdr;
+
+	if (!rep->num_records)
+		return;
+
+	if (rep->type == OSMO_STATS_REPORTER_BINARY) {
+		hdr = (struct osmo_stats_bin_hdr *) msg->data;
+		hdr->version = OSMO_STATS_BIN_VERSION;
+		hdr->flags = rep->full ? OSMO_STATS_BIN_F_FULL : 0;
+		hdr->num_records = htons(rep->num_records);
+		hdr->seq = htonl(rep->seq);
+	}
+	rep->seq++;
+
+	/* a collector that is not running is not our problem */
+	if (send(rep->fd, msg->data, msg->len, MSG_DONTWAIT) < 0)
+		rep->errors++;
+	else {
+		rep->packets++;
+		rep->bytes += msg->len;
+	}
+
+	stats_buffer_reset(rep);
+}
+
+/* make room for a record of len bytes */
+static uint8_t *stats_put(struct osmo_stats_reporter *rep, unsigned int len)
+{
+	if (msgb_tailroom(rep->buffer) < len)
+		stats_flush(rep);
+	if (msgb_tailroom(rep->buffer) < len)
+		return NULL;
+
+	rep->num_records++;
+	return msgb_put(rep->buffer, len);
+}
+
+static void bin_put_name(struct osmo_stats_reporter *rep, uint32_t idx,
+			 const char *name)
+{
+	unsigned int len = strlen(name);
+	uint8_t *rec;
+
+	if (len > 255)
+		len = 255;
+
+	rec = stats_put(rep, 1 + 4 + 1 + len);
+	if (!rec)
+		return;
+	rec[0] = OSMO_STATS_BIN_NAME;
+	put_u32(rec + 1, idx);
+	rec[5] = len;
+	memcpy(rec + 6, name, len);
+}
+
+static void bin_put_value(struct osmo_stats_reporter *rep, uint32_t idx,
+			  uint64_t value)
+{
+	uint8_t *rec = stats_put(rep, 1 + 4 + 8);
+
+	if (!rec)
+		return;
+	rec[0] = OSMO_STATS_BIN_VALUE;
+	put_u32(rec + 1, idx);
+	put_u32(rec + 5, value >> 32);
+	put_u32(rec + 9, value);
+}
+
+static void statsd_put(struct osmo_stats_reporter *rep, const char *name,
+		       uint64_t delta)
+{
+	char line[256];
+	uint8_t *rec;
+	int len;
+
+	len = snprintf(line, sizeof(line), "%s%s%s:%" PRIu64 "|c\n",
+		       rep->prefix ? rep->prefix : "", rep->prefix ? "." : "",
+		       name, delta);
+	if (len < 0 || len >= sizeof(line))
+		return;
+
+	rec = stats_put(rep, len);
+	if (rec)
+		memcpy(rec, line, len);
+}
+
+/* hand one counter to all reporters */
+static void stats_counter(uint32_t idx, const char *name, uint64_t value,
+			  uint64_t delta, int announce)
+{
+	struct osmo_stats_reporter *rep;
+
+	llist_for_each_entry(rep, &osmo_stats_reporters, list) {
+		switch (rep->type) {
+		case OSMO_STATS_REPORTER_BINARY:
+			if (announce || rep->full)
+				bin_put_name(rep, idx, name);
+			if (delta || announce || rep->full)
+				bin_put_value(rep, idx, value);
+			break;
+		case OSMO_STATS_REPORTER_STATSD:
+			if (delta)
+				statsd_put(rep, name, delta);
+			break;
+		}
+	}
+}
+
+static int stats_rate_ctr_group(struct rate_ctr_group *ctrg, void *data)
+{
+	const struct rate_ctr_group_desc *desc = ctrg->desc;
+	int any_full = *(int *) data;
+	int announce = !ctrg->stats_idx;
+	char name[128];
+	unsigned int i;
+
+	if (group_snap_len < desc->num_ctr) {
+		struct rate_ctr_snapshot *snap;
+
+		snap = talloc_realloc(NULL, group_snap,
+				      struct rate_ctr_snapshot, desc->num_ctr);
+		if (!snap)
+			return -ENOMEM;
+		group_snap = snap;
+		group_snap_len = desc->num_ctr;
+	}
+
+	if (announce) {
+		ctrg->stats_idx = next_idx;
+		next_idx += desc->num_ctr;
+	}
+
+	/* all counters of the group from the same tick */
+	rate_ctr_group_snapshot(ctrg, group_snap);
+
+	for (i = 0; i < desc->num_ctr; i++) {
+		struct rate_ctr *ctr = &ctrg->ctr[i];
+		uint64_t value = group_snap[i].value;
+		uint64_t delta;
+
+		delta = value - ctr->reported;
+		if (!delta && !announce && !any_full)
+			continue;
+		ctr->reported = value;
+
+		snprintf(name, sizeof(name), "%s.%u.%s",
+			 desc->group_name_prefix, ctrg->idx,
+			 desc->ctr_desc[i].name);
+		stats_counter(ctrg->stats_idx + i, name, value, delta,
+			      announce);
+	}
+
+	return 0;
+}
+
+static int stats_osmo_counter(struct osmo_counter *ctr, void *data)
+{
+	int any_full = *(int *) data;
+	int announce = !ctr->stats_idx;
+	unsigned long value = ctr->value;
+	unsigned long delta = value - ctr->reported;
+
+	if (announce)
+		ctr->stats_idx = next_idx++;
+	if (!delta && !announce && !any_full)
+		return 0;
+	ctr->reported = value;
+
+	stats_counter(ctr->stats_idx, ctr->name, value, delta, announce);
+	return 0;
+}
+
+/*! \brief Send one report to all reporters now
+ *  \returns number of reporters
+ *
+ * Called from the report timer, see \ref osmo_stats_set_interval.
+ */
+int osmo_stats_report(void)
+{
+	struct osmo_stats_reporter *rep;
+	int full = (report_count++ % OSMO_STATS_FULL_EVERY) == 0;
+	int any_full = 0, num = 0;
+
+	/* nobody listens, keep the changes for the first reporter */
+	if (llist_empty(&osmo_stats_reporters))
+		return 0;
+
+	llist_for_each_entry(rep, &osmo_stats_reporters, list) {
+		rep->full = full || rep->force_full;
+		rep->force_full = 0;
+		any_full |= rep->full;
+		num++;
+	}
+
+	rate_ctr_for_each_group(stats_rate_ctr_group, &any_full);
+	osmo_counters_for_each(stats_osmo_counter, &any_full);
+
+	llist_for_each_entry(rep, &osmo_stats_reporters, list)
+		stats_flush(rep);
+
+	return num;
+}
+
+static void stats_timer_cb(void *data)
+{
+	osmo_stats_report();
+	osmo_timer_schedule(&stats_timer, stats_interval, 0);
+}
+
+/*! \brief Set the interval of the periodic report
+ *  \param[in] interval seconds between two reports, 0 to stop reporting
+ *  \returns 0 on success, -EINVAL for a negative interval
+ */
+int osmo_stats_set_interval(int interval)
+{
+	if (interval < 0)
+		return -EINVAL;
+
+	stats_interval = interval;
+	stats_timer.cb = stats_timer_cb;
+	if (interval)
+		osmo_timer_schedule(&stats_timer, interval, 0);
+	else
+		osmo_timer_del(&stats_timer);
+
+	return 0;
+}
+
+/*! \brief Interval of the periodic report in seconds, 0 if stopped */
+int osmo_stats_get_interval(void)
+{
+	return stats_interval;
+}
+
+/*! \brief Create a reporter sending to a UDP collector
+ *  \param[in] ctx talloc context
+ *  \param[in] type wire format
+ *  \param[in] host address of the collector
+ *  \param[in] port UDP port of the collector
+ *  \param[in] prefix prefix of the StatsD names, may be NULL
+ *  \returns reporter or NULL on error
+ *
+ * The first report of a new reporter is a full one.
+ */
+struct osmo_stats_reporter *
+osmo_stats_reporter_create(void *ctx, enum osmo_stats_reporter_type type,
+			   const char *host, uint16_t port,
+			   const char *prefix)
+{
+	struct osmo_stats_reporter *rep;
+
+	rep = talloc_zero(ctx, struct osmo_stats_reporter);
+	if (!rep)
+		return NULL;
+
+	rep->type = type;
+	rep->mtu = OSMO_STATS_DEFAULT_MTU;
+	rep->force_full = 1;
+	rep->host = talloc_strdup(rep, host);
+	rep->port = port;
+	if (prefix)
+		rep->prefix = talloc_strdup(rep, prefix);
+
+	rep->buffer = msgb_alloc(rep->mtu, "stats report");
+	if (!rep->buffer) {
+		talloc_free(rep);
+		return NULL;
+	}
+
+	rep->fd = osmo_sock_init(AF_UNSPEC, SOCK_DGRAM, IPPROTO_UDP, host,
+				 port, OSMO_SOCK_F_CONNECT);
+	if (rep->fd < 0) {
+		msgb_free(rep->buffer);
+		talloc_free(rep);
+		return NULL;
+	}
+
+	stats_buffer_reset(rep);
+	llist_add_tail(&rep->list, &osmo_stats_reporters);
+
+	return rep;
+}
+
+/*! \brief Find a reporter by its destination
+ *  \returns reporter or NULL if there is none
+ */
+struct osmo_stats_reporter *
+osmo_stats_reporter_find(enum osmo_stats_reporter_type type,
+			 const char *host, uint16_t port)
+{
+	struct osmo_stats_reporter *rep;
+
+	llist_for_each_entry(rep, &osmo_stats_reporters, list) {
+		if (rep->type == type && rep->port == port
+		 && !strcmp(rep->host, host))
+			return rep;
+	}
+
+	return NULL;
+}
+
+/*! \brief Close and free a reporter */
+void osmo_stats_reporter_free(struct osmo_stats_reporter *rep)
+{
+	llist_del(&rep->list);
+	close(rep->fd);
+	msgb_free(rep->buffer);
+	talloc_free(rep);
+}
+
+/*! @} */
@@ -266,15 +266,64 @@ const char *talloc_parent_name(const void *ptr)
   The object count is not put into "struct talloc_chunk" because it is only
   relevant for talloc pools and the alignment to 16 bytes would increase the
   memory footprint of each talloc chunk by those 16 bytes.
+
+  The second half of those 16 bytes holds the list of freed pool members.
+  They are handed out again to allocations of the same size, so that a
+  long lived pool does not run dry under allocation churn.
 */
 
 #define TALLOC_POOL_HDR_SIZE 16
 
+/* size of a pool member including header and alignment */
+#define TC_POOL_CHUNK_SIZE(size) ((TC_HDR_SIZE + (size) + 15) & ~15)
+
 static unsigned int *talloc_pool_objectcount(struct talloc_chunk *tc)
 {
 	return (unsigned int *)((char *)tc + sizeof(struct talloc_chunk));
 }
 
+static struct talloc_chunk **talloc_pool_freelist(struct talloc_chunk *tc)
+{
+	return (struct talloc_chunk **)((char *)TC_PTR_FROM_CHUNK(tc) + 8);
+}
+
+static void *talloc_pool_start(struct talloc_chunk *tc)
+{
+	return (char *)TC_PTR_FROM_CHUNK(tc) + TALLOC_POOL_HDR_SIZE;
+}
+
+/*
+  Give the memory of a freed pool member back to its pool. The object
+  count has already been decremented.
+*/
+
+static void talloc_pool_release(struct talloc_chunk *pool,
+				struct talloc_chunk *tc)
+{
+	struct talloc_chunk **freelist = talloc_pool_freelist(pool);
+
+	/* the pool itself is gone, it is freed with its last member */
+	if (pool->flags & TALLOC_FLAG_FREE) {
+		return;
+	}
+
+	if (*talloc_pool_objectcount(pool) == 1) {
+		/* nothing left in the pool, start over */
+		pool->pool = talloc_pool_start(pool);
+		*freelist = NULL;
+		return;
+	}
+
+	if ((char *)tc + TC_POOL_CHUNK_SIZE(tc->size) == (char *)pool->pool) {
+		/* the most recent allocation */
+		pool->pool = tc;
+		return;
+	}
+
+	tc->next = *freelist;
+	*freelist = tc;
+}
+
 /*
   Allocate from a pool
 */
@@ -284,7 +333,7 @@ static struct talloc_chunk *talloc_alloc_pool(struct talloc_chunk *parent,
 {
 	struct talloc_chunk *pool_ctx = NULL;
 	size_t space_left;
-	struct talloc_chunk *result;
+	struct talloc_chunk *result, **prev;
 	size_t chunk_size;
 
 	if (parent == NULL) {
@@ -310,18 +359,30 @@ static struct talloc_chunk *talloc_alloc_pool(struct talloc_chunk *parent,
 	 */
 	chunk_size = ((size + 15) & ~15);
 
+	/*
+	 * Reuse a freed member of the same size
+	 */
+	for (prev = talloc_pool_freelist(pool_ctx); *prev; prev = &(*prev)->next) {
+		if (TC_POOL_CHUNK_SIZE((*prev)->size) == chunk_size) {
+			result = *prev;
+			*prev = result->next;
+			goto found;
+		}
+	}
+
 	if (space_left < chunk_size) {
 		return NULL;
 	}
 
 	result = (struct talloc_chunk *)pool_ctx->pool;
+	pool_ctx->pool = (void *)((char *)result + chunk_size);
+
+found:
 
 #if defined(DEVELOPER) && defined(VALGRIND_MAKE_MEM_UNDEFINED)
 	VALGRIND_MAKE_MEM_UNDEFINED(result, size);
 #endif
 
-	pool_ctx->pool = (void *)((char *)result + chunk_size);
-
 	result->flags = TALLOC_MAGIC | TALLOC_FLAG_POOLMEM;
 	result->pool = pool_ctx;
 
@@ -333,7 +394,8 @@ static struct talloc_chunk *talloc_alloc_pool(struct talloc_chunk *parent,
 /* 
    Allocate a bit of memory as a child of an existing pointer
 */
-static inline void *__talloc(const void *context, size_t size)
+static inline void *__talloc_ex(const void *context, size_t size,
+				bool from_pool)
 {
 	struct talloc_chunk *tc = NULL;
 
@@ -345,7 +407,7 @@ static inline void *__talloc(const void *context, size_t size)
 		return NULL;
 	}
 
-	if (context != NULL) {
+	if (context != NULL && from_pool) {
 		tc = talloc_alloc_pool(talloc_chunk_from_ptr(context),
 				       TC_HDR_SIZE+size);
 	}
@@ -383,13 +445,21 @@ static inline void *__talloc(const void *context, size_t size)
 	return TC_PTR_FROM_CHUNK(tc);
 }
 
+static inline void *__talloc(const void *context, size_t size)
+{
+	return __talloc_ex(context, size, true);
+}
+
 /*
  * Create a talloc pool
+ *
+ * A pool is never carved out of another pool, the "pool" pointer of its
+ * chunk cannot point to both.
  */
 
 void *talloc_pool(const void *context, size_t size)
 {
-	void *result = __talloc(context, size + TALLOC_POOL_HDR_SIZE);
+	void *result = __talloc_ex(context, size + TALLOC_POOL_HDR_SIZE, false);
 	struct talloc_chunk *tc;
 
 	if (unlikely(result == NULL)) {
@@ -402,6 +472,7 @@ void *talloc_pool(const void *context, size_t size)
 	tc->pool = (char *)result + TALLOC_POOL_HDR_SIZE;
 
 	*talloc_pool_objectcount(tc) = 1;
+	*talloc_pool_freelist(tc) = NULL;
 
 #if defined(DEVELOPER) && defined(VALGRIND_MAKE_MEM_NOACCESS)
 	VALGRIND_MAKE_MEM_NOACCESS(tc->pool, size);
@@ -603,6 +674,8 @@ static inline int _talloc_free(void *ptr)
 
 		if (*pool_object_count == 0) {
 			free(pool);
+		} else if (tc != pool) {
+			talloc_pool_release(pool, tc);
 		}
 	}
 	else {
@@ -1046,10 +1119,10 @@ void *_talloc_realloc(const void *context, void *ptr, size_t size, const char *n
 	}
 #else
 	if (tc->flags & TALLOC_FLAG_POOLMEM) {
+		struct talloc_chunk *pool = (struct talloc_chunk *)tc->pool;
 
 		new_ptr = talloc_alloc_pool(tc, size + TC_HDR_SIZE);
-		*talloc_pool_objectcount((struct talloc_chunk *)
-					 (tc->pool)) -= 1;
+		*talloc_pool_objectcount(pool) -= 1;
 
 		if (new_ptr == NULL) {
 			new_ptr = malloc(TC_HDR_SIZE+size);
@@ -1058,6 +1131,7 @@ void *_talloc_realloc(const void *context, void *ptr, size_t size, const char *n
 
 		if (new_ptr) {
 			memcpy(new_ptr, tc, MIN(tc->size,size) + TC_HDR_SIZE);
+			talloc_pool_release(pool, tc);
 		}
 	}
 	else {
@@ -1163,6 +1237,56 @@ size_t talloc_total_blocks(const void *ptr)
 	return total;
 }
 
+/*
+  return the number of bytes a talloc pool can hand out, 0 if ptr is not
+  a pool
+*/
+size_t talloc_pool_size(const void *ptr)
+{
+	struct talloc_chunk *tc = talloc_chunk_from_ptr(ptr);
+
+	if (!(tc->flags & TALLOC_FLAG_POOL)) {
+		return 0;
+	}
+
+	return tc->size - TALLOC_POOL_HDR_SIZE;
+}
+
+/*
+  return the number of bytes of a talloc pool in use by its members,
+  including their headers
+*/
+size_t talloc_pool_used(const void *ptr)
+{
+	struct talloc_chunk *c, *tc = talloc_chunk_from_ptr(ptr);
+	size_t used;
+
+	if (!(tc->flags & TALLOC_FLAG_POOL)) {
+		return 0;
+	}
+
+	used = (char *)tc->pool - (char *)talloc_pool_start(tc);
+	for (c = *talloc_pool_freelist(tc); c; c = c->next) {
+		used -= TC_POOL_CHUNK_SIZE(c->size);
+	}
+
+	return used;
+}
+
+/*
+  return the number of members allocated from a talloc pool
+*/
+size_t talloc_pool_objects(const void *ptr)
+{
+	struct talloc_chunk *tc = talloc_chunk_from_ptr(ptr);
+
+	if (!(tc->flags & TALLOC_FLAG_POOL)) {
+		return 0;
+	}
+
+	return *talloc_pool_objectcount(tc) - 1;
+}
+
 /*
   return the number of external references to a pointer
 */
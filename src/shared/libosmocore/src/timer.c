@@ -35,13 +35,230 @@ static struct timeval *nearest_p;
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <string.h>
 #include <limits.h>
+#include <stdint.h>
+#include <time.h>
 #include <osmocom/core/timer.h>
 #include <osmocom/core/timer_compat.h>
 #include <osmocom/core/linuxlist.h>
+#include <osmocom/core/utils.h>
 
 static struct rb_root timer_root = RB_ROOT;
+static enum osmo_timer_mode timer_mode = OSMO_TIMER_MODE_RBTREE;
+/* number of pending timers, in either mode */
+static unsigned int timer_count;
+
+/*
+ * Hierarchical timing wheel (OSMO_TIMER_MODE_WHEEL)
+ *
+ * Time is counted in ticks of WHEEL_TICK_US on the monotonic clock.
+ * Level 0 has one slot per tick, each further level covers WHEEL_SLOTS
+ * slots of the level below.  A timer is put into the level/slot that
+ * is processed before it expires, and moved down ("cascaded") whenever
+ * the slot of a higher level comes up.  Timers beyond the range of the
+ * wheel are parked in the last level and re-inserted on cascade.
+ *
+ * Each level keeps a bitmap of non-empty slots, so that the next tick
+ * with any work can be found without walking empty slots.
+ */
+#define WHEEL_TICK_US		1000
+#define WHEEL_BITS		8
+#define WHEEL_SLOTS		(1 << WHEEL_BITS)
+#define WHEEL_MASK		(WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS		4
+#define WHEEL_MAP_WORDS		(WHEEL_SLOTS / 64)
+#define WHEEL_RANGE		((uint64_t)1 << (WHEEL_BITS * WHEEL_LEVELS))
+
+struct timer_wheel {
+	struct llist_head slot[WHEEL_LEVELS][WHEEL_SLOTS];
+	uint64_t map[WHEEL_LEVELS][WHEEL_MAP_WORDS];
+	/* next tick to be processed */
+	uint64_t now;
+	int initialized;
+};
+
+static struct timer_wheel wheel;
+
+/* current time of the clock the active mode is based on */
+static void timers_gettime(struct timeval *tv)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	if (timer_mode == OSMO_TIMER_MODE_WHEEL
+	 && clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+		tv->tv_sec = ts.tv_sec;
+		tv->tv_usec = ts.tv_nsec / 1000;
+		return;
+	}
+#endif
+	gettimeofday(tv, NULL);
+}
+
+static uint64_t tv_to_us(const struct timeval *tv)
+{
+	return (uint64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+static void wheel_init(void)
+{
+	int l, i;
+
+	for (l = 0; l < WHEEL_LEVELS; l++) {
+		for (i = 0; i < WHEEL_SLOTS; i++)
+			INIT_LLIST_HEAD(&wheel.slot[l][i]);
+	}
+	memset(wheel.map, 0, sizeof(wheel.map));
+	wheel.initialized = 1;
+}
+
+static void wheel_add(struct osmo_timer_list *timer)
+{
+	/* round up, a timer must never fire before its timeout */
+	uint64_t expires = (tv_to_us(&timer->timeout) + WHEEL_TICK_US - 1)
+				/ WHEEL_TICK_US;
+	uint64_t delta;
+	int level, idx;
+
+	if (expires < wheel.now)
+		expires = wheel.now;
+	delta = expires - wheel.now;
+	if (delta >= WHEEL_RANGE) {
+		expires = wheel.now + WHEEL_RANGE - 1;
+		delta = WHEEL_RANGE - 1;
+	}
+
+	for (level = 0; level < WHEEL_LEVELS - 1; level++) {
+		if (delta < ((uint64_t)1 << (WHEEL_BITS * (level + 1))))
+			break;
+	}
+	idx = (expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+
+	llist_add_tail(&timer->list, &wheel.slot[level][idx]);
+	wheel.map[level][idx / 64] |= (uint64_t)1 << (idx % 64);
+}
+
+static void wheel_del(struct osmo_timer_list *timer)
+{
+	struct llist_head *slots = &wheel.slot[0][0];
+	struct llist_head *next = timer->list.next;
+	int off, level, idx;
+
+	llist_del_init(&timer->list);
+
+	/* if the timer was the last one in its slot, 'next' is the now
+	 * empty slot head, whose bit must be cleared */
+	if (next < slots || next >= slots + WHEEL_LEVELS * WHEEL_SLOTS
+	 || !llist_empty(next))
+		return;
+
+	off = next - slots;
+	level = off / WHEEL_SLOTS;
+	idx = off % WHEEL_SLOTS;
+	wheel.map[level][idx / 64] &= ~((uint64_t)1 << (idx % 64));
+}
+
+/* move all timers of a slot to the given list */
+static void wheel_take_slot(int level, int idx, struct llist_head *list)
+{
+	llist_splice_init(&wheel.slot[level][idx], list);
+	wheel.map[level][idx / 64] &= ~((uint64_t)1 << (idx % 64));
+}
+
+/* first non-empty slot of a level at or after 'idx', circularly.
+ * Returns the distance from 'idx', or -1 if the level is empty */
+static int wheel_next_slot(int level, int idx)
+{
+	int i;
+
+	for (i = 0; i <= WHEEL_MAP_WORDS; i++) {
+		int w = ((idx / 64) + i) % WHEEL_MAP_WORDS;
+		uint64_t bits = wheel.map[level][w];
+
+		if (i == 0)
+			bits &= ~0ULL << (idx % 64);
+		else if (i == WHEEL_MAP_WORDS)
+			bits &= ~(~0ULL << (idx % 64));
+		if (bits) {
+			int slot = w * 64 + __builtin_ctzll(bits);
+			return (slot - idx) & WHEEL_MASK;
+		}
+	}
+
+	return -1;
+}
+
+/* next tick at which the wheel has work (expiry or cascade) */
+static uint64_t wheel_next_tick(void)
+{
+	uint64_t next = UINT64_MAX;
+	int level, dist;
+
+	dist = wheel_next_slot(0, wheel.now & WHEEL_MASK);
+	if (dist >= 0)
+		next = wheel.now + dist;
+
+	for (level = 1; level < WHEEL_LEVELS; level++) {
+		int shift = WHEEL_BITS * level;
+		/* first slot boundary of this level not processed yet */
+		uint64_t base = (wheel.now + ((uint64_t)1 << shift) - 1) >> shift;
+		uint64_t cand;
+
+		dist = wheel_next_slot(level, base & WHEEL_MASK);
+		if (dist < 0)
+			continue;
+		cand = (base + dist) << shift;
+		if (cand < next)
+			next = cand;
+	}
+
+	return next;
+}
+
+/* re-insert all timers of a higher level slot further down */
+static void wheel_cascade(int level, int idx)
+{
+	struct osmo_timer_list *this, *tmp;
+	LLIST_HEAD(list);
+
+	wheel_take_slot(level, idx, &list);
+	llist_for_each_entry_safe(this, tmp, &list, list) {
+		llist_del(&this->list);
+		wheel_add(this);
+	}
+}
+
+/* move all timers expiring up to the current time to the eviction list */
+static void wheel_collect(const struct timeval *current,
+			  struct llist_head *eviction_list)
+{
+	uint64_t now = tv_to_us(current) / WHEEL_TICK_US;
+
+	while (wheel.now <= now) {
+		uint64_t next = wheel_next_tick();
+		int level;
+
+		if (next > now) {
+			wheel.now = now + 1;
+			break;
+		}
+		wheel.now = next;
+
+		/* cascade higher levels whose slot boundary we've reached */
+		for (level = 1; level < WHEEL_LEVELS; level++) {
+			int shift = WHEEL_BITS * level;
+
+			if (wheel.now & (((uint64_t)1 << shift) - 1))
+				break;
+			wheel_cascade(level, (wheel.now >> shift) & WHEEL_MASK);
+		}
+
+		wheel_take_slot(0, wheel.now & WHEEL_MASK, eviction_list);
+		wheel.now++;
+	}
+}
 
 static void __add_timer(struct osmo_timer_list *timer)
 {
@@ -64,6 +281,49 @@ static void __add_timer(struct osmo_timer_list *timer)
         rb_insert_color(&timer->node, &timer_root);
 }
 
+/*! \brief select the data structure and clock used for timers
+ *  \param[in] mode timer mode to be used from now on
+ *  \returns 0 on success, -EBUSY if any timer is pending
+ *
+ * \ref OSMO_TIMER_MODE_WHEEL is based on the monotonic clock, so the
+ * expiration times of timers are no longer wall-clock times.  The mode
+ * can only be changed while no timer is pending, i.e. it should be
+ * selected at start-up.
+ */
+int osmo_timers_set_mode(enum osmo_timer_mode mode)
+{
+	struct timeval current;
+
+	if (timer_count)
+		return -EBUSY;
+
+	switch (mode) {
+	case OSMO_TIMER_MODE_RBTREE:
+		break;
+	case OSMO_TIMER_MODE_WHEEL:
+		if (!wheel.initialized)
+			wheel_init();
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	timer_mode = mode;
+
+	if (mode == OSMO_TIMER_MODE_WHEEL) {
+		timers_gettime(&current);
+		wheel.now = tv_to_us(&current) / WHEEL_TICK_US;
+	}
+
+	return 0;
+}
+
+/*! \brief get the currently used timer mode */
+enum osmo_timer_mode osmo_timers_get_mode(void)
+{
+	return timer_mode;
+}
+
 /*! \brief add a new timer to the timer management
  *  \param[in] timer the timer that should be added
  */
@@ -71,8 +331,12 @@ void osmo_timer_add(struct osmo_timer_list *timer)
 {
 	osmo_timer_del(timer);
 	timer->active = 1;
+	timer_count++;
 	INIT_LLIST_HEAD(&timer->list);
-	__add_timer(timer);
+	if (timer_mode == OSMO_TIMER_MODE_WHEEL)
+		wheel_add(timer);
+	else
+		__add_timer(timer);
 }
 
 /*! \brief schedule a timer at a given future relative time
@@ -90,7 +354,7 @@ osmo_timer_schedule(struct osmo_timer_list *timer, int seconds, int microseconds
 {
 	struct timeval current_time;
 
-	gettimeofday(&current_time, NULL);
+	timers_gettime(&current_time);
 	timer->timeout.tv_sec = seconds;
 	timer->timeout.tv_usec = microseconds;
 	timeradd(&timer->timeout, &current_time, &timer->timeout);
@@ -107,6 +371,11 @@ void osmo_timer_del(struct osmo_timer_list *timer)
 {
 	if (timer->active) {
 		timer->active = 0;
+		timer_count--;
+		if (timer_mode == OSMO_TIMER_MODE_WHEEL) {
+			wheel_del(timer);
+			return;
+		}
 		rb_erase(&timer->node, &timer_root);
 		/* make sure this is not already scheduled for removal. */
 		if (!llist_empty(&timer->list))
@@ -133,7 +402,9 @@ int osmo_timer_pending(struct osmo_timer_list *timer)
  *  \return 0 if timer has not expired yet, -1 if it has
  *
  *  This function can be used to determine the amount of time
- *  remaining until the expiration of the timer.
+ *  remaining until the expiration of the timer.  In
+ *  \ref OSMO_TIMER_MODE_WHEEL, \a now must be taken from the monotonic
+ *  clock.
  */
 int osmo_timer_remaining(const struct osmo_timer_list *timer,
 			 const struct timeval *now,
@@ -142,11 +413,11 @@ int osmo_timer_remaining(const struct osmo_timer_list *timer,
 	struct timeval current_time;
 
 	if (!now) {
-		gettimeofday(&current_time, NULL);
+		timers_gettime(&current_time);
 		now = &current_time;
 	}
 
-	timersub(&timer->timeout, &current_time, remaining);
+	timersub(&timer->timeout, now, remaining);
 
 	if (remaining->tv_sec < 0)
 		return -1;
@@ -192,7 +463,22 @@ void osmo_timers_prepare(void)
 	struct rb_node *node;
 	struct timeval current;
 
-	gettimeofday(&current, NULL);
+	timers_gettime(&current);
+
+	if (timer_mode == OSMO_TIMER_MODE_WHEEL) {
+		uint64_t next;
+		struct timeval cand;
+
+		if (!timer_count) {
+			nearest_p = NULL;
+			return;
+		}
+		next = wheel_next_tick() * WHEEL_TICK_US;
+		cand.tv_sec = next / 1000000;
+		cand.tv_usec = next % 1000000;
+		update_nearest(&cand, &current);
+		return;
+	}
 
 	node = rb_first(&timer_root);
 	if (node) {
@@ -215,16 +501,20 @@ int osmo_timers_update(void)
 	struct osmo_timer_list *this;
 	int work = 0;
 
-	gettimeofday(&current_time, NULL);
+	timers_gettime(&current_time);
 
 	INIT_LLIST_HEAD(&timer_eviction_list);
-	for (node = rb_first(&timer_root); node; node = rb_next(node)) {
-		this = container_of(node, struct osmo_timer_list, node);
+	if (timer_mode == OSMO_TIMER_MODE_WHEEL)
+		wheel_collect(&current_time, &timer_eviction_list);
+	else {
+		for (node = rb_first(&timer_root); node; node = rb_next(node)) {
+			this = container_of(node, struct osmo_timer_list, node);
 
-		if (timercmp(&this->timeout, &current_time, >))
-			break;
+			if (timercmp(&this->timeout, &current_time, >))
+				break;
 
-		llist_add(&this->list, &timer_eviction_list);
+			llist_add(&this->list, &timer_eviction_list);
+		}
 	}
 
 	/*
@@ -250,15 +540,10 @@ restart:
 	return work;
 }
 
+/*! \brief number of pending timers */
 int osmo_timers_check(void)
 {
-	struct rb_node *node;
-	int i = 0;
-
-	for (node = rb_first(&timer_root); node; node = rb_next(node)) {
-		i++;
-	}
-	return i;
+	return timer_count;
 }
 
 /*! @} */
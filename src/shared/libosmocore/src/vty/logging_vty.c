@@ -177,8 +177,7 @@ DEFUN(logging_level,
 		return CMD_WARNING;
 	}
 
-	tgt->categories[category].enabled = 1;
-	tgt->categories[category].loglevel = level;
+	log_set_category_filter(tgt, category, 1, level);
 
 	return CMD_SUCCESS;
 }
@@ -267,6 +266,65 @@ DEFUN(show_logging_vty,
 	return CMD_SUCCESS;
 }
 
+DEFUN(logging_async,
+      logging_async_cmd,
+      "logging async (0|1)",
+	LOGGING_STR "Configure asynchronous writing of log messages\n"
+	"Write log messages directly\n"
+	"Write log messages from a separate thread\n")
+{
+	struct log_target *tgt = osmo_log_vty2tgt(vty);
+	int rc;
+
+	if (!tgt)
+		return CMD_WARNING;
+
+	rc = log_target_set_async(tgt,
+			atoi(argv[0]) ? LOG_ASYNC_DEFAULT_SIZE : 0);
+	if (rc < 0) {
+		vty_out(vty, "%% Unable to configure asynchronous logging "
+			"(%s)%s", strerror(-rc), VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_logging_async,
+      show_logging_async_cmd,
+      "show logging async",
+	SHOW_STR SHOW_LOG_STR
+	"Show counters of asynchronous log targets\n")
+{
+	struct log_async_stats st;
+	struct log_target *tgt;
+
+	llist_for_each_entry(tgt, &osmo_log_target_list, entry) {
+		if (log_target_async_stats(tgt, &st) < 0)
+			continue;
+
+		switch (tgt->type) {
+		case LOG_TGT_TYPE_FILE:
+			vty_out(vty, "file %s:", tgt->tgt_file.fname);
+			break;
+		case LOG_TGT_TYPE_STDERR:
+			vty_out(vty, "stderr:");
+			break;
+		case LOG_TGT_TYPE_SYSLOG:
+			vty_out(vty, "syslog:");
+			break;
+		default:
+			vty_out(vty, "target %d:", tgt->type);
+			break;
+		}
+		vty_out(vty, " %lu written, %lu dropped, %u of %u bytes "
+			"queued%s", st.written, st.dropped, st.queued, st.size,
+			VTY_NEWLINE);
+	}
+
+	return CMD_SUCCESS;
+}
+
 gDEFUN(cfg_description, cfg_description_cmd,
 	"description .TEXT",
 	"Save human-readable decription of the object\n"
@@ -543,6 +601,8 @@ static int config_write_log_single(struct vty *vty, struct log_target *tgt)
 		VTY_NEWLINE);
 	vty_out(vty, "  logging timestamp %u%s", tgt->print_timestamp ? 1 : 0,
 		VTY_NEWLINE);
+	if (tgt->async)
+		vty_out(vty, "  logging async 1%s", VTY_NEWLINE);
 
 	/* stupid old osmo logging API uses uppercase strings... */
 	osmo_str2lower(level_lower, log_level_str(tgt->loglevel));
@@ -590,6 +650,7 @@ void logging_vty_add_cmds(const struct log_info *cat)
 	logging_level_cmd.doc = log_vty_command_description(cat);
 	install_element_ve(&logging_level_cmd);
 	install_element_ve(&show_logging_vty_cmd);
+	install_element_ve(&show_logging_async_cmd);
 
 	install_node(&cfg_log_node, config_write_log);
 	install_default(CFG_LOG_NODE);
@@ -597,6 +658,7 @@ void logging_vty_add_cmds(const struct log_info *cat)
 	install_element(CFG_LOG_NODE, &logging_fltr_all_cmd);
 	install_element(CFG_LOG_NODE, &logging_use_clr_cmd);
 	install_element(CFG_LOG_NODE, &logging_prnt_timestamp_cmd);
+	install_element(CFG_LOG_NODE, &logging_async_cmd);
 	install_element(CFG_LOG_NODE, &logging_level_cmd);
 
 	install_element(CONFIG_NODE, &cfg_log_stderr_cmd);
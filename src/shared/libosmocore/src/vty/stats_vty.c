@@ -0,0 +1,150 @@
+/* VTY commands of the statistics reporter */
+/* (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <osmocom/core/stats.h>
+#include <osmocom/core/talloc.h>
+
+#include <osmocom/vty/command.h>
+#include <osmocom/vty/vty.h>
+#include <osmocom/vty/stats.h>
+
+#define REPORTER_STR \
+	"Send reports to a collector\n" \
+	"Binary records with indexed counter names\n" \
+	"StatsD counter lines\n" \
+	"IP address of the collector\n" \
+	"UDP port of the collector\n"
+
+static const char *type_names[] = {
+	[OSMO_STATS_REPORTER_BINARY]	= "binary",
+	[OSMO_STATS_REPORTER_STATSD]	= "statsd",
+};
+
+static enum osmo_stats_reporter_type type_by_name(const char *name)
+{
+	if (!strcmp(name, "statsd"))
+		return OSMO_STATS_REPORTER_STATSD;
+	return OSMO_STATS_REPORTER_BINARY;
+}
+
+DEFUN(cfg_stats_interval, cfg_stats_interval_cmd,
+	"stats interval <0-65535>",
+	STATS_STR "Set the report interval\n"
+	"Seconds between two reports, 0 to stop reporting\n")
+{
+	osmo_stats_set_interval(atoi(argv[0]));
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_stats_reporter, cfg_stats_reporter_cmd,
+	"stats reporter (binary|statsd) A.B.C.D <1-65535> [PREFIX]",
+	STATS_STR REPORTER_STR "Prefix of the StatsD names\n")
+{
+	enum osmo_stats_reporter_type type = type_by_name(argv[0]);
+	struct osmo_stats_reporter *rep;
+	uint16_t port = atoi(argv[2]);
+
+	rep = osmo_stats_reporter_find(type, argv[1], port);
+	if (rep)
+		osmo_stats_reporter_free(rep);
+
+	rep = osmo_stats_reporter_create(tall_vty_ctx, type, argv[1], port,
+					 argc > 3 ? argv[3] : NULL);
+	if (!rep) {
+		vty_out(vty, "%% Unable to create reporter%s", VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_no_stats_reporter, cfg_no_stats_reporter_cmd,
+	"no stats reporter (binary|statsd) A.B.C.D <1-65535>",
+	NO_STR STATS_STR REPORTER_STR)
+{
+	struct osmo_stats_reporter *rep;
+
+	rep = osmo_stats_reporter_find(type_by_name(argv[0]), argv[1],
+				       atoi(argv[2]));
+	if (!rep) {
+		vty_out(vty, "%% No such reporter%s", VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	osmo_stats_reporter_free(rep);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_stats, show_stats_cmd,
+	"show stats",
+	SHOW_STR "Show the statistics reporters\n")
+{
+	struct osmo_stats_reporter *rep;
+
+	vty_out(vty, "Report interval: %d s%s", osmo_stats_get_interval(),
+		VTY_NEWLINE);
+	llist_for_each_entry(rep, &osmo_stats_reporters, list) {
+		vty_out(vty, " %s %s:%u: %lu datagrams, %lu bytes, "
+			"%lu errors%s", type_names[rep->type], rep->host,
+			rep->port, rep->packets, rep->bytes, rep->errors,
+			VTY_NEWLINE);
+	}
+
+	return CMD_SUCCESS;
+}
+
+static struct cmd_node cfg_stats_node = {
+	CFG_STATS_NODE,
+	"%s(config-stats)# ",
+	1
+};
+
+static int config_write_stats(struct vty *vty)
+{
+	struct osmo_stats_reporter *rep;
+
+	llist_for_each_entry(rep, &osmo_stats_reporters, list) {
+		vty_out(vty, "stats reporter %s %s %u%s%s%s",
+			type_names[rep->type], rep->host, rep->port,
+			rep->prefix ? " " : "", rep->prefix ? rep->prefix : "",
+			VTY_NEWLINE);
+	}
+	if (osmo_stats_get_interval())
+		vty_out(vty, "stats interval %d%s", osmo_stats_get_interval(),
+			VTY_NEWLINE);
+
+	return 1;
+}
+
+/*! \brief Install the VTY commands of the statistics reporter */
+void stats_vty_add_cmds(void)
+{
+	install_element_ve(&show_stats_cmd);
+
+	install_node(&cfg_stats_node, config_write_stats);
+
+	install_element(CONFIG_NODE, &cfg_stats_interval_cmd);
+	install_element(CONFIG_NODE, &cfg_stats_reporter_cmd);
+	install_element(CONFIG_NODE, &cfg_no_stats_reporter_cmd);
+}
@@ -51,14 +51,16 @@ void vty_out_rate_ctr_group(struct vty *vty, const char *prefix,
 
 	vty_out(vty, "%s%s:%s", prefix, ctrg->desc->group_description, VTY_NEWLINE);
 	for (i = 0; i < ctrg->desc->num_ctr; i++) {
-		struct rate_ctr *ctr = &ctrg->ctr[i];
+		struct rate_ctr_snapshot snap;
+
+		rate_ctr_snapshot(&ctrg->ctr[i], &snap);
 		vty_out(vty, " %s%s: %8" PRIu64 " "
 			"(%" PRIu64 "/s %" PRIu64 "/m %" PRIu64 "/h %" PRIu64 "/d)%s",
-			prefix, ctrg->desc->ctr_desc[i].description, ctr->current,
-			ctr->intv[RATE_CTR_INTV_SEC].rate,
-			ctr->intv[RATE_CTR_INTV_MIN].rate,
-			ctr->intv[RATE_CTR_INTV_HOUR].rate,
-			ctr->intv[RATE_CTR_INTV_DAY].rate,
+			prefix, ctrg->desc->ctr_desc[i].description, snap.value,
+			snap.rate[RATE_CTR_INTV_SEC],
+			snap.rate[RATE_CTR_INTV_MIN],
+			snap.rate[RATE_CTR_INTV_HOUR],
+			snap.rate[RATE_CTR_INTV_DAY],
 			VTY_NEWLINE);
 	};
 }
@@ -21,14 +21,170 @@
  *
  */
 
+#define _GNU_SOURCE	/* sendmmsg() */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
 #include <osmocom/core/write_queue.h>
 
+#include "../config.h"
+
 /*! \addtogroup write_queue
  *  @{
  */
 
 /*! \file write_queue.c */
 
+/* Remove and free the first msgb of the queue */
+static void wqueue_drop_head(struct osmo_wqueue *queue)
+{
+	struct msgb *msg = msgb_dequeue(&queue->msg_queue);
+
+	--queue->current_length;
+	queue->head_offset = 0;
+	msgb_free(msg);
+}
+
+/* Retire msgbs that have been written completely */
+static void wqueue_written(struct osmo_wqueue *queue, int num)
+{
+	queue->stats.written += num;
+	while (num--) {
+		struct msgb *msg = msgb_dequeue(&queue->msg_queue);
+
+		--queue->current_length;
+		msgb_free(msg);
+	}
+	queue->head_offset = 0;
+}
+
+static inline int wqueue_blocked(void)
+{
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+static void wqueue_error(struct osmo_wqueue *queue, int err)
+{
+	queue->stats.write_errors++;
+	if (queue->error_cb)
+		queue->error_cb(&queue->bfd, err);
+}
+
+/* Write as much of a stream queue as the socket takes.  A partially
+ * written msgb stays at the head, head_offset tells how far we got.
+ * After a write error, the peer can't tell where the stream broke off,
+ * so nothing is dropped and the queue stalls until it is cleared */
+static void wqueue_write_vectored(struct osmo_wqueue *queue)
+{
+	struct iovec iov[OSMO_WQUEUE_BATCH];
+	struct msgb *msg;
+	ssize_t rc, total, done;
+	int n;
+
+	while (!llist_empty(&queue->msg_queue)) {
+		n = 0;
+		total = 0;
+		llist_for_each_entry(msg, &queue->msg_queue, list) {
+			iov[n].iov_base = msg->data;
+			iov[n].iov_len = msg->len;
+			total += msg->len;
+			if (++n == OSMO_WQUEUE_BATCH)
+				break;
+		}
+		iov[0].iov_base = (uint8_t *) iov[0].iov_base + queue->head_offset;
+		iov[0].iov_len -= queue->head_offset;
+		total -= queue->head_offset;
+
+		rc = writev(queue->bfd.fd, iov, n);
+		if (rc < 0) {
+			if (wqueue_blocked())
+				return;
+			queue->error = errno;
+			osmo_fd_write_disable(&queue->bfd);
+			wqueue_error(queue, queue->error);
+			return;
+		}
+		queue->stats.write_calls++;
+
+		/* retire what has been written completely, counting from
+		 * the start of the first msgb */
+		done = rc + queue->head_offset;
+		queue->head_offset = 0;
+		while (!llist_empty(&queue->msg_queue)) {
+			msg = llist_entry(queue->msg_queue.next, struct msgb,
+					  list);
+			if (done < msg->len) {
+				queue->head_offset = done;
+				break;
+			}
+			done -= msg->len;
+			wqueue_written(queue, 1);
+		}
+
+		/* the socket did not take everything, wait for it */
+		if (rc < total)
+			return;
+	}
+}
+
+/* Send the queue as individual datagrams until the socket is full */
+static void wqueue_write_datagrams(struct osmo_wqueue *queue)
+{
+	struct msgb *msgs[OSMO_WQUEUE_BATCH];
+	struct msgb *msg;
+	int i, n, rc;
+#ifdef HAVE_SENDMMSG
+	struct mmsghdr mmsg[OSMO_WQUEUE_BATCH];
+	struct iovec iov[OSMO_WQUEUE_BATCH];
+#endif
+
+	while (!llist_empty(&queue->msg_queue)) {
+		n = 0;
+		llist_for_each_entry(msg, &queue->msg_queue, list) {
+			msgs[n++] = msg;
+			if (n == OSMO_WQUEUE_BATCH)
+				break;
+		}
+
+#ifdef HAVE_SENDMMSG
+		memset(mmsg, 0, sizeof(mmsg[0]) * n);
+		for (i = 0; i < n; i++) {
+			iov[i].iov_base = msgs[i]->data;
+			iov[i].iov_len = msgs[i]->len;
+			mmsg[i].msg_hdr.msg_iov = &iov[i];
+			mmsg[i].msg_hdr.msg_iovlen = 1;
+		}
+		rc = sendmmsg(queue->bfd.fd, mmsg, n, MSG_DONTWAIT);
+#else
+		for (i = 0; i < n; i++) {
+			if (send(queue->bfd.fd, msgs[i]->data, msgs[i]->len,
+				 MSG_DONTWAIT) < 0)
+				break;
+		}
+		rc = i ? i : -1;
+#endif
+		if (rc < 0) {
+			if (wqueue_blocked())
+				return;
+			/* the error belongs to the first datagram, e.g. an
+			 * ICMP port unreachable on a connected socket */
+			rc = errno;
+			wqueue_drop_head(queue);
+			wqueue_error(queue, rc);
+			continue;
+		}
+		queue->stats.write_calls++;
+
+		wqueue_written(queue, rc);
+		if (rc < n)
+			return;
+	}
+}
+
 /*! \brief Select loop function for write queue handling
  *  \param[in] fd osmocom file descriptor
  *  \param[in] what bit-mask of events that have happened
@@ -51,19 +207,23 @@ int osmo_wqueue_bfd_cb(struct osmo_fd *fd, unsigned int what)
 	if (what & BSC_FD_WRITE) {
 		struct msgb *msg;
 
-		fd->when &= ~BSC_FD_WRITE;
-
+		if (queue->flags & OSMO_WQUEUE_F_WRITEV)
+			wqueue_write_vectored(queue);
+		else if (queue->flags & OSMO_WQUEUE_F_SENDMMSG)
+			wqueue_write_datagrams(queue);
 		/* the queue might have been emptied */
-		if (!llist_empty(&queue->msg_queue)) {
+		else if (!llist_empty(&queue->msg_queue)) {
 			--queue->current_length;
 
 			msg = msgb_dequeue(&queue->msg_queue);
 			queue->write_cb(fd, msg);
 			msgb_free(msg);
-
-			if (!llist_empty(&queue->msg_queue))
-				fd->when |= BSC_FD_WRITE;
+			queue->stats.written++;
+			queue->stats.write_calls++;
 		}
+
+		if (llist_empty(&queue->msg_queue))
+			osmo_fd_write_disable(fd);
 	}
 
 	return 0;
@@ -79,6 +239,12 @@ void osmo_wqueue_init(struct osmo_wqueue *queue, int max_length)
 	queue->current_length = 0;
 	queue->read_cb = NULL;
 	queue->write_cb = NULL;
+	queue->error_cb = NULL;
+	queue->flags = 0;
+	queue->drop_policy = OSMO_WQUEUE_DROP_NEW;
+	queue->head_offset = 0;
+	queue->error = 0;
+	memset(&queue->stats, 0, sizeof(queue->stats));
 	queue->bfd.cb = osmo_wqueue_bfd_cb;
 	INIT_LLIST_HEAD(&queue->msg_queue);
 }
@@ -86,15 +252,34 @@ void osmo_wqueue_init(struct osmo_wqueue *queue, int max_length)
 /*! \brief Enqueue a new \ref msgb into a write queue
  *  \param[in] queue Write queue to be used
  *  \param[in] data to-be-enqueued message buffer
+ *  \returns 0 on success, -ENOSPC if the queue is full, the negative
+ *	     \ref osmo_wqueue::error if it is stalled
+ *
+ * A full queue (max_length msgbs, 0 means unlimited) either refuses the
+ * new msgb, which then still belongs to the caller, or frees the oldest
+ * one, depending on \ref osmo_wqueue::drop_policy.  A stalled queue
+ * refuses every msgb.
  */
 int osmo_wqueue_enqueue(struct osmo_wqueue *queue, struct msgb *data)
 {
-//	if (queue->current_length + 1 >= queue->max_length)
-//		LOGP(DMSC, LOGL_ERROR, "The queue is full. Dropping not yet implemented.\n");
+	if (queue->error)
+		return -queue->error;
+
+	if (queue->max_length && queue->current_length >= queue->max_length) {
+		queue->stats.dropped++;
+		/* a partially written msgb must be completed, otherwise
+		 * the stream would get out of sync */
+		if (queue->drop_policy != OSMO_WQUEUE_DROP_OLDEST
+		 || queue->head_offset)
+			return -ENOSPC;
+		wqueue_drop_head(queue);
+	}
 
-	++queue->current_length;
+	queue->stats.enqueued++;
+	if (++queue->current_length > queue->stats.high_water)
+		queue->stats.high_water = queue->current_length;
 	msgb_enqueue(&queue->msg_queue, data);
-	queue->bfd.when |= BSC_FD_WRITE;
+	osmo_fd_write_enable(&queue->bfd);
 
 	return 0;
 }
@@ -102,7 +287,8 @@ int osmo_wqueue_enqueue(struct osmo_wqueue *queue, struct msgb *data)
 /*! \brief Clear a \ref osmo_wqueue
  *  \param[in] queue Write queue to be cleared
  *
- * This function will clear (remove/release) all messages in it.
+ * This function will clear (remove/release) all messages in it.  A
+ * queue stalled by a write error can be used again afterwards.
  */
 void osmo_wqueue_clear(struct osmo_wqueue *queue)
 {
@@ -112,7 +298,9 @@ void osmo_wqueue_clear(struct osmo_wqueue *queue)
 	}
 
 	queue->current_length = 0;
-	queue->bfd.when &= ~BSC_FD_WRITE;
+	queue->head_offset = 0;
+	queue->error = 0;
+	osmo_fd_write_disable(&queue->bfd);
 }
 
 /*! @} */
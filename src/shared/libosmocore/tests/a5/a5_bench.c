@@ -0,0 +1,97 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* Keystream throughput of osmo_a5_1/osmo_a5_2 against the bitsliced
+ * batch implementations, generating DL and UL for N (Kc, FN) pairs. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/gsm/a5.h>
+#include <osmocom/gsm/gsm_utils.h>
+
+#define NUM 16384
+
+static uint8_t keys[NUM * 8];
+static uint32_t fns[NUM];
+static uint8_t dl[NUM * 114], ul[NUM * 114];
+
+static double cpu_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(int n, const char *name, double t)
+{
+	printf("A5/%d %-12s %9.0f keystreams/s (%6.1f ns each)\n",
+		n, name, NUM / t, t * 1e9 / NUM);
+}
+
+static void bench(int n)
+{
+	enum osmo_a5_batch_impl impl;
+	char name[32];
+	double t0;
+	int i;
+
+	t0 = cpu_time();
+	for (i = 0; i < NUM; i++)
+		osmo_a5(n, &keys[i * 8], fns[i], &dl[i * 114], &ul[i * 114]);
+	report(n, "scalar", cpu_time() - t0);
+
+	for (impl = A5_BATCH_U64; impl <= A5_BATCH_AVX2; impl++) {
+		if (!osmo_a5_batch_impl_available(impl))
+			continue;
+		osmo_a5_batch_impl_set(impl);
+
+		t0 = cpu_time();
+		osmo_a5_batch(n, keys, fns, NUM, dl, ul, 0);
+		report(n, osmo_a5_batch_impl_name(impl), cpu_time() - t0);
+
+		t0 = cpu_time();
+		osmo_a5_batch(n, keys, fns, NUM, dl, ul,
+			      OSMO_A5_BATCH_F_PACKED);
+		snprintf(name, sizeof(name), "%s/packed",
+			 osmo_a5_batch_impl_name(impl));
+		report(n, name, cpu_time() - t0);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int i;
+
+	srandom(42);
+	for (i = 0; i < NUM * 8; i++)
+		keys[i] = random();
+	for (i = 0; i < NUM; i++)
+		fns[i] = random() % GSM_MAX_FN;
+
+	bench(1);
+	bench(2);
+
+	return EXIT_SUCCESS;
+}
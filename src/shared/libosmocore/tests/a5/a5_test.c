@@ -6,6 +6,7 @@
 #include <osmocom/core/bits.h>
 #include <osmocom/core/utils.h>
 #include <osmocom/gsm/a5.h>
+#include <osmocom/gsm/gsm_utils.h>
 
 static const uint8_t key[] = { 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef };
 static const uint32_t fn = 123456;
@@ -50,6 +51,72 @@ binstr(ubit_t *d, int n)
 	return str;
 }
 
+/* more than a full 256 lane batch, with a partial tail */
+#define BATCH_COUNT 300
+
+static void
+test_batch(int n)
+{
+	static uint8_t keys[BATCH_COUNT * 8];
+	static uint32_t fns[BATCH_COUNT];
+	static ubit_t dl[BATCH_COUNT * 114], ul[BATCH_COUNT * 114];
+	static pbit_t dlp[BATCH_COUNT * 15], ulp[BATCH_COUNT * 15];
+	ubit_t exp_dl[114], exp_ul[114];
+	pbit_t exp_p[15];
+	enum osmo_a5_batch_impl impl;
+	int i, rc;
+
+	for (i=0; i<BATCH_COUNT*8; i++)
+		keys[i] = rand();
+	for (i=0; i<BATCH_COUNT; i++)
+		fns[i] = rand() % GSM_MAX_FN;
+
+	for (impl=A5_BATCH_U64; impl<=A5_BATCH_AVX2; impl++)
+	{
+		if (!osmo_a5_batch_impl_available(impl))
+			continue;
+
+		osmo_a5_batch_impl_set(impl);
+
+		rc = osmo_a5_batch(n, keys, fns, BATCH_COUNT, dl, ul, 0);
+		rc |= osmo_a5_batch(n, keys, fns, BATCH_COUNT, dlp, NULL,
+		                    OSMO_A5_BATCH_F_PACKED);
+		rc |= osmo_a5_batch(n, keys, fns, BATCH_COUNT, NULL, ulp,
+		                    OSMO_A5_BATCH_F_PACKED);
+		if (rc) {
+			fprintf(stderr, "[!] A5/%d batch failed (%s)",
+				n, osmo_a5_batch_impl_name(impl));
+			exit(1);
+		}
+
+		for (i=0; i<BATCH_COUNT; i++)
+		{
+			osmo_a5(n, &keys[i*8], fns[i], exp_dl, exp_ul);
+
+			if (memcmp(exp_dl, &dl[i*114], 114) ||
+			    memcmp(exp_ul, &ul[i*114], 114))
+				goto bad;
+
+			osmo_ubit2pbit(exp_p, exp_dl, 114);
+			if (memcmp(exp_p, &dlp[i*15], 15))
+				goto bad;
+
+			osmo_ubit2pbit(exp_p, exp_ul, 114);
+			if (memcmp(exp_p, &ulp[i*15], 15))
+				goto bad;
+		}
+	}
+
+	printf("A5/%d - batch: %d streams => OK\n", n, BATCH_COUNT);
+	return;
+
+bad:
+	printf("A5/%d - batch: stream %d => BAD\n", n, i);
+	fprintf(stderr, "[!] A5/%d batch (%s) failed",
+		n, osmo_a5_batch_impl_name(impl));
+	exit(1);
+}
+
 int main(int argc, char **argv)
 {
 	ubit_t exp[114];
@@ -94,5 +161,8 @@ int main(int argc, char **argv)
 		}
 	}
 
+	for (n=0; n<3; n++)
+		test_batch(n);
+
 	return 0;
 }
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include <osmocom/core/bits.h>
@@ -354,8 +355,142 @@ sbit_to_ubit(ubit_t *dst, sbit_t *src, int n)
 		dst[i] = src[i] < 0;
 }
 
+static void
+ubit_to_sbit_noisy(sbit_t *dst, ubit_t *src, int n)
+{
+	int i;
+	for (i=0; i<n; i++) {
+		int v = (src[i] ? -127 : 127) + (int)(random() % 301) - 150;
+		if (v > 127)
+			v = 127;
+		if (v < -127)
+			v = -127;
+		dst[i] = v;
+	}
+}
+
+/* Decode noisy input with the generic trellis walk and every available
+ * accelerated implementation, which must give the very same result */
+static int
+check_acc(const struct conv_test_vector *tst,
+          ubit_t *bu0, ubit_t *bu1, sbit_t *bs)
+{
+	enum osmo_conv_acc_type saved = osmo_conv_acc_get();
+	enum osmo_conv_acc_type type;
+	ubit_t *ref = malloc(sizeof(ubit_t) * MAX_LEN_BITS);
+	int i, l, rv_ref, rv, rc = 0;
+
+	for (i=0; i<100 && !rc; i++) {
+		fill_random(bu0, tst->in_len);
+		l = osmo_conv_encode(tst->code, bu0, bu1);
+		ubit_to_sbit_noisy(bs, bu1, l);
+
+		osmo_conv_acc_set(CONV_ACC_GENERIC);
+		rv_ref = osmo_conv_decode(tst->code, bs, ref);
+
+		for (type=CONV_ACC_SCALAR; type<=CONV_ACC_AVX2; type++) {
+			if (osmo_conv_acc_set(type) < 0)
+				continue;
+			rv = osmo_conv_decode(tst->code, bs, bu1);
+			if (rv != rv_ref || memcmp(ref, bu1, tst->in_len)) {
+				fprintf(stderr, "[!] %s decoder differs\n",
+					osmo_conv_acc_name(type));
+				rc = -1;
+			}
+		}
+	}
+
+	osmo_conv_acc_set(saved);
+	free(ref);
+
+	return rc;
+}
 
-int main(int argc, char argv[])
+/* A code on the stack, decoded once with each of two puncturing
+ * patterns at the same address: the accelerated decoder must not pick
+ * the tables built for the first one */
+static int
+check_acc_reuse(ubit_t *bu0, ubit_t *bu1, sbit_t *bs)
+{
+	enum osmo_conv_acc_type saved = osmo_conv_acc_get();
+	enum osmo_conv_acc_type type;
+	struct osmo_conv_code code = conv_gsm_tch_afs_7_95;
+	int puncture[ARRAY_SIZE(conv_gsm_tch_afs_7_95_puncture)];
+	int i, l, pass, rc = 0;
+
+	code.puncture = puncture;
+
+	for (type=CONV_ACC_SCALAR; type<=CONV_ACC_AVX2; type++) {
+		if (osmo_conv_acc_set(type) < 0)
+			continue;
+
+		for (pass=0; pass<2; pass++) {
+			/* the second time, every other index is kept */
+			for (i=0, l=0; conv_gsm_tch_afs_7_95_puncture[i] >= 0; i++) {
+				if (!pass || !(i & 1))
+					puncture[l++] = conv_gsm_tch_afs_7_95_puncture[i];
+			}
+			puncture[l] = -1;
+
+			fill_random(bu0, code.len);
+			l = osmo_conv_encode(&code, bu0, bu1);
+			ubit_to_sbit(bs, bu1, l);
+
+			if (osmo_conv_decode(&code, bs, bu1) != 0 ||
+			    memcmp(bu0, bu1, code.len)) {
+				fprintf(stderr, "[!] %s decoder used stale tables\n",
+					osmo_conv_acc_name(type));
+				rc = -1;
+			}
+		}
+	}
+
+	osmo_conv_acc_set(saved);
+
+	return rc;
+}
+
+/* Decoding speed of all available implementations */
+static void
+bench_acc(ubit_t *bu0, ubit_t *bu1, sbit_t *bs)
+{
+	const struct conv_test_vector *tst;
+	enum osmo_conv_acc_type type;
+	const int n_iter = 20000;
+
+	for (tst=tests; tst->name; tst++) {
+		int l;
+
+		printf("[+] %s\n", tst->name);
+
+		fill_random(bu0, tst->in_len);
+		l = osmo_conv_encode(tst->code, bu0, bu1);
+		ubit_to_sbit_noisy(bs, bu1, l);
+
+		for (type=CONV_ACC_GENERIC; type<=CONV_ACC_AVX2; type++) {
+			struct timespec t0, t1;
+			double ns;
+			int i;
+
+			if (osmo_conv_acc_set(type) < 0)
+				continue;
+
+			clock_gettime(CLOCK_MONOTONIC, &t0);
+			for (i=0; i<n_iter; i++)
+				osmo_conv_decode(tst->code, bs, bu1);
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+
+			ns = (t1.tv_sec - t0.tv_sec) * 1e9 +
+			     (t1.tv_nsec - t0.tv_nsec);
+			printf("[.] %-8s: %8.0f ns/block, %7.2f Mbit/s\n",
+				osmo_conv_acc_name(type), ns / n_iter,
+				tst->in_len * n_iter * 1e3 / ns);
+		}
+	}
+}
+
+
+int main(int argc, char **argv)
 {
 	const struct conv_test_vector *tst;
 	ubit_t *bu0, *bu1;
@@ -367,6 +502,11 @@ int main(int argc, char argv[])
 	bu1 = malloc(sizeof(ubit_t) * MAX_LEN_BITS);
 	bs  = malloc(sizeof(sbit_t) * MAX_LEN_BITS);
 
+	if (argc > 1 && !strcmp(argv[1], "-b")) {
+		bench_acc(bu0, bu1, bs);
+		goto out;
+	}
+
 	for (tst=tests; tst->name; tst++)
 	{
 		int i,l;
@@ -474,10 +614,30 @@ int main(int argc, char argv[])
 			printf("OK\n");
 		}
 
+		/* Check accelerated decoders */
+		printf("[..] Accelerated decoding (noisy input) : ");
+
+		if (check_acc(tst, bu0, bu1, bs)) {
+			printf("ERROR !\n");
+			return -1;
+		}
+
+		printf("OK\n");
+
 		/* Spacing */
 		printf("\n");
 	}
 
+	printf("[+] Testing: accelerated tables of a reused code : ");
+
+	if (check_acc_reuse(bu0, bu1, bs)) {
+		printf("ERROR !\n");
+		return -1;
+	}
+
+	printf("OK\n");
+
+out:
 	free(bs);
 	free(bu1);
 	free(bu0);
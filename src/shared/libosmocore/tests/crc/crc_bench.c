@@ -0,0 +1,105 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* Cost of the generic CRC routines per implementation, for the FIRE
+ * code over an xCCH block (184 bits) and CRC-32 over longer buffers,
+ * from unpacked and packed bits. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/crcgen.h>
+
+static const struct osmo_crc64gen_code fire = {
+	.bits = 40, .poly = 0x0004820009ULL, .init = 0,
+	.remainder = 0xffffffffffULL,
+};
+static const struct osmo_crc32gen_code crc32 = {
+	.bits = 32, .poly = 0x04c11db7, .init = 0xffffffff,
+	.remainder = 0xffffffff,
+};
+
+#define MAX_BITS 8192
+
+static ubit_t ub[MAX_BITS];
+static pbit_t pb[MAX_BITS / 8];
+static volatile uint64_t sink;
+
+static double cpu_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(const char *name, int bits, int loops)
+{
+	enum osmo_crcgen_impl impl;
+	double t0, t_ubit, t_pbit;
+	int i;
+
+	for (impl = CRCGEN_BITWISE; impl <= CRCGEN_PCLMUL; impl++) {
+		if (osmo_crcgen_impl_set(impl))
+			continue;
+
+		t0 = cpu_time();
+		for (i = 0; i < loops; i++) {
+			if (bits == 184)
+				sink += osmo_crc64gen_compute_bits(&fire, ub, bits);
+			else
+				sink += osmo_crc32gen_compute_bits(&crc32, ub, bits);
+		}
+		t_ubit = cpu_time() - t0;
+
+		t0 = cpu_time();
+		for (i = 0; i < loops; i++) {
+			if (bits == 184)
+				sink += osmo_crc64gen_compute_pbits(&fire, pb, bits);
+			else
+				sink += osmo_crc32gen_compute_pbits(&crc32, pb, bits);
+		}
+		t_pbit = cpu_time() - t0;
+
+		printf("%-6s %5d bits %-8s ubit %8.1f ns, pbit %8.1f ns\n",
+			name, bits, osmo_crcgen_impl_name(impl),
+			t_ubit * 1e9 / loops, t_pbit * 1e9 / loops);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int i;
+
+	srandom(42);
+	for (i = 0; i < MAX_BITS; i++)
+		ub[i] = random() & 1;
+	osmo_ubit2pbit(pb, ub, MAX_BITS);
+
+	bench("fire", 184, 200000);
+	bench("crc32", 456, 200000);
+	bench("crc32", 1024, 100000);
+	bench("crc32", 8192, 20000);
+
+	return EXIT_SUCCESS;
+}
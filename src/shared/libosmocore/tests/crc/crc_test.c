@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/crcgen.h>
+#include <osmocom/core/utils.h>
+
+/* GSM 05.03 codes, plus two byte oriented ones */
+static const struct osmo_crc8gen_code crc3 = {
+	.bits = 3, .poly = 0x3, .init = 0x0, .remainder = 0x7,
+};
+static const struct osmo_crc8gen_code crc6 = {
+	.bits = 6, .poly = 0x2f, .init = 0x0, .remainder = 0x3f,
+};
+static const struct osmo_crc16gen_code crc10 = {
+	.bits = 10, .poly = 0x175, .init = 0x000, .remainder = 0x3ff,
+};
+static const struct osmo_crc16gen_code crc16 = {
+	.bits = 16, .poly = 0x1021, .init = 0xffff, .remainder = 0xffff,
+};
+static const struct osmo_crc32gen_code crc32 = {
+	.bits = 32, .poly = 0x04c11db7, .init = 0xffffffff,
+	.remainder = 0xffffffff,
+};
+static const struct osmo_crc64gen_code fire = {
+	.bits = 40, .poly = 0x0004820009ULL, .init = 0,
+	.remainder = 0xffffffffffULL,
+};
+
+#define MAX_LEN 1200
+
+static ubit_t ub[MAX_LEN];
+static pbit_t pb[MAX_LEN / 8 + 1];
+
+/* check all lengths up to MAX_LEN against the bitwise implementation */
+#define TEST_CODE(XX, code)						\
+do {									\
+	enum osmo_crcgen_impl impl;					\
+	uint##XX##_t ref, crc;						\
+	pbit_t cp[8];							\
+	int len;							\
+									\
+	for (len=0; len<=MAX_LEN; len++) {				\
+		osmo_crcgen_impl_set(CRCGEN_BITWISE);			\
+		ref = osmo_crc##XX##gen_compute_bits(&code, ub, len);	\
+									\
+		for (impl=CRCGEN_BITWISE; impl<=CRCGEN_PCLMUL; impl++) {\
+			if (osmo_crcgen_impl_set(impl))			\
+				continue;				\
+			crc = osmo_crc##XX##gen_compute_bits(&code, ub, len); \
+			if (crc != ref)					\
+				goto bad_##XX##_##code;			\
+			crc = osmo_crc##XX##gen_compute_pbits(&code, pb, len); \
+			if (crc != ref)					\
+				goto bad_##XX##_##code;			\
+			memset(cp, 0x5a, sizeof(cp));			\
+			osmo_crc##XX##gen_set_pbits(&code, pb, len, cp); \
+			if (osmo_crc##XX##gen_check_pbits(&code, pb, len, cp)) \
+				goto bad_##XX##_##code;			\
+			cp[0] ^= 0x80;					\
+			if (!osmo_crc##XX##gen_check_pbits(&code, pb, len, cp)) \
+				goto bad_##XX##_##code;			\
+		}							\
+	}								\
+	printf("%s: OK\n", #code);					\
+	break;								\
+bad_##XX##_##code:							\
+	printf("%s: length %d (%s) => BAD\n", #code, len,		\
+		osmo_crcgen_impl_name(impl));				\
+	exit(1);							\
+} while (0)
+
+int main(int argc, char **argv)
+{
+	int i;
+
+	for (i=0; i<MAX_LEN; i++)
+		ub[i] = rand() & 1;
+	osmo_ubit2pbit(pb, ub, MAX_LEN);
+
+	TEST_CODE(8, crc3);
+	TEST_CODE(8, crc6);
+	TEST_CODE(16, crc10);
+	TEST_CODE(16, crc16);
+	TEST_CODE(32, crc32);
+	TEST_CODE(64, fire);
+
+	return 0;
+}
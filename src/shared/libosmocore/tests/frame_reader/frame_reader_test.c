@@ -0,0 +1,240 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <osmocom/core/frame_reader.h>
+#include <osmocom/core/msgb.h>
+
+static unsigned int received, bad, next_seq, headroom_short;
+
+/* frame n is n + 1 bytes long and counts up from n */
+static unsigned int put_frame(uint8_t *buf, unsigned int n)
+{
+	unsigned int len = 1 + n % 200, i;
+
+	buf[0] = len >> 8;
+	buf[1] = len;
+	for (i = 0; i < len; i++)
+		buf[2 + i] = n + i;
+
+	return 2 + len;
+}
+
+static int frame_cb(struct osmo_frame_reader *fr, struct msgb *msg)
+{
+	unsigned int len = 1 + next_seq % 200, i;
+
+	if (msgb_l1len(msg) != len)
+		bad++;
+	else {
+		for (i = 0; i < len; i++)
+			bad += msg->l1h[i] != ((next_seq + i) & 0xff);
+	}
+	if (msgb_headroom(msg) < fr->headroom)
+		headroom_short++;
+
+	next_seq++;
+	received++;
+	msgb_free(msg);
+	return 0;
+}
+
+static void open_pair(int fds[2])
+{
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+		perror("socketpair");
+		exit(1);
+	}
+	fcntl(fds[1], F_SETFL, O_NONBLOCK);
+}
+
+static void init_reader(struct osmo_frame_reader *fr)
+{
+	osmo_frame_reader_init(fr, 256, 32, "frame_reader_test");
+	fr->frame_cb = frame_cb;
+	received = bad = next_seq = headroom_short = 0;
+}
+
+/* one frame per write, each arrives complete */
+static void test_single(void)
+{
+	struct osmo_frame_reader fr;
+	uint8_t buf[300];
+	int fds[2], i, len;
+
+	open_pair(fds);
+	init_reader(&fr);
+
+	for (i = 0; i < 50; i++) {
+		len = put_frame(buf, i);
+		if (write(fds[0], buf, len) != len)
+			printf("write failed\n");
+		osmo_frame_reader_read(&fr, fds[1]);
+	}
+
+	printf("single: %u frames, %u bad, %lu reads, %lu copies, "
+	       "headroom short %u\n", received, bad, fr.stats.reads,
+	       fr.stats.copies, headroom_short);
+
+	osmo_frame_reader_reset(&fr);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+/* a burst written at once, split at arbitrary points by a small buffer */
+static void test_burst(unsigned int buf_size)
+{
+	struct osmo_frame_reader fr;
+	static uint8_t buf[64 * 1024];
+	unsigned int len = 0, i, reads = 0;
+	int fds[2], rc;
+
+	open_pair(fds);
+	init_reader(&fr);
+	fr.buf_size = buf_size;
+
+	for (i = 0; i < 200; i++)
+		len += put_frame(buf + len, i);
+	if (write(fds[0], buf, len) != len)
+		printf("write failed\n");
+
+	do {
+		rc = osmo_frame_reader_read(&fr, fds[1]);
+		reads++;
+	} while (rc == 0 && received < 200 && reads < 10000);
+
+	printf("burst %u: %u frames, %u bad, rc %d, copied %lu, "
+	       "headroom short %u\n", buf_size, received, bad, rc,
+	       fr.stats.copies, headroom_short);
+
+	osmo_frame_reader_reset(&fr);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+/* with the msgb pool, the receive buffer handed out is recycled */
+static void test_pool(void)
+{
+	struct osmo_frame_reader fr;
+	struct msgb_pool_stats stats[MSGB_POOL_NUM_CLASSES];
+	unsigned long allocs = 0, reused = 0;
+	uint8_t buf[300];
+	int fds[2], i, len;
+
+	msgb_pool_init(4, 0);
+	open_pair(fds);
+	init_reader(&fr);
+
+	for (i = 0; i < 50; i++) {
+		len = put_frame(buf, i);
+		if (write(fds[0], buf, len) != len)
+			printf("write failed\n");
+		osmo_frame_reader_read(&fr, fds[1]);
+	}
+
+	msgb_pool_get_stats(stats);
+	for (i = 0; i < MSGB_POOL_NUM_CLASSES; i++) {
+		allocs += stats[i].allocs;
+		reused += stats[i].reused;
+	}
+	printf("pool: %u frames, %u bad, %lu reads, %lu pooled, "
+	       "%lu reused\n", received, bad, fr.stats.reads, allocs, reused);
+
+	osmo_frame_reader_reset(&fr);
+	close(fds[0]);
+	close(fds[1]);
+	msgb_pool_destroy();
+}
+
+/* a frame trickling in byte by byte */
+static void test_trickle(void)
+{
+	struct osmo_frame_reader fr;
+	uint8_t buf[300];
+	int fds[2], i, len;
+
+	open_pair(fds);
+	init_reader(&fr);
+
+	len = put_frame(buf, 99);
+	next_seq = 99;
+	for (i = 0; i < len; i++) {
+		if (write(fds[0], buf + i, 1) != 1)
+			printf("write failed\n");
+		osmo_frame_reader_read(&fr, fds[1]);
+		if (received && i != len - 1)
+			printf("trickle: frame early at %d\n", i);
+	}
+
+	printf("trickle: %u frames, %u bad, %lu reads\n", received, bad,
+	       fr.stats.reads);
+
+	osmo_frame_reader_reset(&fr);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+static void test_errors(void)
+{
+	struct osmo_frame_reader fr;
+	uint8_t buf[4] = { 0x01, 0x01, 0x00, 0x00 };
+	int fds[2], rc;
+
+	/* longer than max_len */
+	open_pair(fds);
+	init_reader(&fr);
+	if (write(fds[0], buf, sizeof(buf)) != sizeof(buf))
+		printf("write failed\n");
+	rc = osmo_frame_reader_read(&fr, fds[1]);
+	printf("too long: %s\n", rc == -EBADMSG ? "EBADMSG" : "other");
+	osmo_frame_reader_reset(&fr);
+	close(fds[0]);
+	close(fds[1]);
+
+	/* nothing there yet, then the peer goes away */
+	open_pair(fds);
+	init_reader(&fr);
+	rc = osmo_frame_reader_read(&fr, fds[1]);
+	printf("no data: %d\n", rc);
+	close(fds[0]);
+	rc = osmo_frame_reader_read(&fr, fds[1]);
+	printf("closed: %s\n", rc == -EIO ? "EIO" : "other");
+	osmo_frame_reader_reset(&fr);
+	close(fds[1]);
+}
+
+int main(int argc, char **argv)
+{
+	test_single();
+	test_burst(OSMO_FRAME_READER_BUF_SIZE);
+	test_burst(300);
+	test_pool();
+	test_trickle();
+	test_errors();
+	return 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* Flow control simulation: thousands of per-MS flow controls, each kept
+ * backlogged by a source, feed one BVC flow control the same way
+ * bssgp_tx_dl_ud() chains them.  Reports the throughput at the output
+ * of both levels against the configured leak rates and the CPU time
+ * spent per PDU.  Like bssgp_fc_test, the msgb pointers are just PDU
+ * numbers, flow control never looks into them. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include <osmocom/core/application.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/gprs/gprs_bssgp.h>
+
+#define PDU_LEN		500
+#define MS_QUEUE	4
+#define SOURCE_MS	5
+
+struct sim {
+	const char *name;
+	int num_ms;
+	uint32_t ms_bmax, ms_rate;
+	uint32_t bvc_bmax, bvc_rate;
+};
+
+static const struct sim sims[] = {
+	/* the BVC is the bottleneck */
+	{ "BVC limited", 2000, 1000, 600, 50000, 1000000 },
+	/* the MS are the bottleneck */
+	{ "MS limited", 2000, 1000, 200, 50000, 10000000 },
+};
+
+static void *ctx;
+static struct bssgp_flow_control *bvc_fc;
+static struct bssgp_flow_control **ms_fc;
+static int num_ms;
+static unsigned long pdus_in, pdus_out, pdus_ms_out, pdus_lost;
+static unsigned long long bytes_out;
+static struct osmo_timer_list source_timer;
+
+static struct log_info info = {};
+
+int bssgp_prim_cb(struct osmo_prim_hdr *oph, void *ctx)
+{
+	return 0;
+}
+
+static double now(int clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* output of the BVC flow control, towards NS */
+static int bvc_out_cb(struct bssgp_flow_control *fc, struct msgb *msg,
+		      uint32_t llc_pdu_len, void *priv)
+{
+	pdus_out++;
+	bytes_out += llc_pdu_len;
+	return 0;
+}
+
+/* output of a MS flow control, into the BVC flow control */
+static int ms_out_cb(struct bssgp_flow_control *fc, struct msgb *msg,
+		     uint32_t llc_pdu_len, void *priv)
+{
+	pdus_ms_out++;
+	if (bssgp_fc_in(fc, msg, llc_pdu_len, NULL) < 0)
+		pdus_lost++;
+	return 0;
+}
+
+/* keep every MS flow control backlogged */
+static void source_cb(void *data)
+{
+	int i;
+
+	for (i = 0; i < num_ms; i++) {
+		while (ms_fc[i]->queue_depth < MS_QUEUE) {
+			pdus_in++;
+			if (bssgp_fc_in(ms_fc[i], (struct msgb *) pdus_in,
+					PDU_LEN, bvc_fc) < 0)
+				break;
+		}
+	}
+
+	osmo_timer_schedule(&source_timer, 0, SOURCE_MS * 1000);
+}
+
+static void run(const struct sim *sim, double duration)
+{
+	double t_start, t_end, cpu, rate_bvc, rate_ms;
+	int i;
+
+	num_ms = sim->num_ms;
+	pdus_in = pdus_out = pdus_ms_out = pdus_lost = bytes_out = 0;
+
+	bvc_fc = talloc_zero(ctx, struct bssgp_flow_control);
+	bssgp_fc_init(bvc_fc, sim->bvc_bmax, sim->bvc_rate,
+		      num_ms * MS_QUEUE, bvc_out_cb);
+	ms_fc = talloc_zero_array(ctx, struct bssgp_flow_control *, num_ms);
+	for (i = 0; i < num_ms; i++) {
+		ms_fc[i] = talloc_zero(ms_fc, struct bssgp_flow_control);
+		bssgp_fc_init(ms_fc[i], sim->ms_bmax, sim->ms_rate, MS_QUEUE,
+			      ms_out_cb);
+	}
+
+	source_timer.cb = source_cb;
+	cpu = now(CLOCK_PROCESS_CPUTIME_ID);
+	t_start = now(CLOCK_MONOTONIC);
+	source_cb(NULL);
+	while ((t_end = now(CLOCK_MONOTONIC)) - t_start < duration)
+		osmo_select_main(0);
+	cpu = now(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+
+	osmo_timer_del(&source_timer);
+	osmo_timer_del(&bvc_fc->timer);
+	for (i = 0; i < num_ms; i++)
+		osmo_timer_del(&ms_fc[i]->timer);
+
+	/* the initial bucket sizes may pass as a burst */
+	rate_bvc = sim->bvc_rate + sim->bvc_bmax / duration;
+	rate_ms = (double) num_ms * (sim->ms_rate + sim->ms_bmax / duration);
+	printf("%s: %d MS x %u oct/s into BVC %u oct/s, %.1f s\n", sim->name,
+	       num_ms, sim->ms_rate, sim->bvc_rate, t_end - t_start);
+	printf("  MS output %.0f oct/s (limit %.0f), BVC output %.0f oct/s "
+	       "(limit %.0f), %lu lost\n",
+	       pdus_ms_out * PDU_LEN / (t_end - t_start), rate_ms,
+	       bytes_out / (t_end - t_start), rate_bvc, pdus_lost);
+	printf("  %lu PDUs in, %lu out, %.2f us CPU per PDU\n", pdus_in,
+	       pdus_out, cpu * 1e6 / (pdus_in + pdus_ms_out));
+
+	talloc_free(ms_fc);
+	talloc_free(bvc_fc);
+}
+
+int main(int argc, char **argv)
+{
+	double duration = argc > 1 ? atof(argv[1]) : 3.0;
+	int i;
+
+	ctx = talloc_named_const(NULL, 0, "bssgp_fc_bench");
+	osmo_init_logging(&info);
+	log_set_log_level(osmo_stderr_target, LOGL_FATAL);
+
+	for (i = 0; i < ARRAY_SIZE(sims); i++)
+		run(&sims[i], duration);
+
+	talloc_free(ctx);
+	return 0;
+}
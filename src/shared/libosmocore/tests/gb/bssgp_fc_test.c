@@ -81,7 +81,7 @@ static void test_fc(uint32_t bucket_size_max, uint32_t bucket_leak_rate,
 		osmo_timers_prepare();
 		osmo_timers_update();
 
-		if (llist_empty(&fc->queue))
+		if (!fc->queue_depth)
 			break;
 	}
 }
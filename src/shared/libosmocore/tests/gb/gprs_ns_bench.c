@@ -0,0 +1,186 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* Scaling of the NS-VC and BVC lookups: populate an NS instance with a
+ * growing number of NS-VCs / BVCs and compare the hashed lookups against
+ * a linear walk of the lists, the way they were looked up before. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <osmocom/core/application.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/gprs/gprs_ns.h>
+#include <osmocom/gprs/gprs_bssgp.h>
+
+#define MAX_NUM	10000
+
+static const int steps[] = { 100, 1000, MAX_NUM };
+
+/* bssgp_bvc_ctxts is not exported, keep our own copy for the walk */
+static struct bssgp_bvc_ctx *bvcs[MAX_NUM];
+
+static struct log_info info = {};
+
+int bssgp_prim_cb(struct osmo_prim_hdr *oph, void *ctx)
+{
+	return 0;
+}
+
+static double cpu_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static struct gprs_nsvc *list_by_nsei(struct gprs_ns_inst *nsi, uint16_t nsei)
+{
+	struct gprs_nsvc *nsvc;
+
+	llist_for_each_entry(nsvc, &nsi->gprs_nsvcs, list) {
+		if (nsvc->nsei == nsei)
+			return nsvc;
+	}
+	return NULL;
+}
+
+static struct bssgp_bvc_ctx *list_by_bvci_nsei(int num, uint16_t bvci,
+					       uint16_t nsei)
+{
+	int i;
+
+	for (i = 0; i < num; i++) {
+		if (bvcs[i]->nsei == nsei && bvcs[i]->bvci == bvci)
+			return bvcs[i];
+	}
+	return NULL;
+}
+
+static void set_raid(struct gprs_ra_id *raid, int i)
+{
+	raid->mcc = 262;
+	raid->mnc = 42;
+	raid->lac = 1000 + i / 16;
+	raid->rac = i % 16;
+}
+
+static void bench(struct gprs_ns_inst *nsi, int num, int loops)
+{
+	struct gprs_ra_id raid;
+	double t_list, t_nsei, t_nsvci, t_blist, t_bvci, t_raid;
+	int i, missing = 0;
+
+	srand(num);
+
+	t_list = cpu_time();
+	for (i = 0; i < loops; i++)
+		missing += !list_by_nsei(nsi, rand() % num);
+	t_list = cpu_time() - t_list;
+
+	t_nsei = cpu_time();
+	for (i = 0; i < loops; i++)
+		missing += !gprs_nsvc_by_nsei(nsi, rand() % num);
+	t_nsei = cpu_time() - t_nsei;
+
+	t_nsvci = cpu_time();
+	for (i = 0; i < loops; i++)
+		missing += !gprs_nsvc_by_nsvci(nsi, 10000 + rand() % num);
+	t_nsvci = cpu_time() - t_nsvci;
+
+	t_blist = cpu_time();
+	for (i = 0; i < loops; i++) {
+		int j = rand() % num;
+		missing += !list_by_bvci_nsei(num, 2 + j, j);
+	}
+	t_blist = cpu_time() - t_blist;
+
+	t_bvci = cpu_time();
+	for (i = 0; i < loops; i++) {
+		int j = rand() % num;
+		missing += !btsctx_by_bvci_nsei(2 + j, j);
+	}
+	t_bvci = cpu_time() - t_bvci;
+
+	memset(&raid, 0, sizeof(raid));
+	t_raid = cpu_time();
+	for (i = 0; i < loops; i++) {
+		int j = rand() % num;
+		set_raid(&raid, j);
+		missing += !btsctx_by_raid_cid(&raid, j);
+	}
+	t_raid = cpu_time() - t_raid;
+
+	printf("%5d NS-VC: by_nsei list %8.1f ns, hash %5.1f ns, "
+	       "by_nsvci hash %5.1f ns\n", num, t_list / loops * 1e9,
+	       t_nsei / loops * 1e9, t_nsvci / loops * 1e9);
+	printf("%5d BVC:   by_bvci_nsei list %8.1f ns, hash %5.1f ns, "
+	       "by_raid_cid hash %5.1f ns\n", num, t_blist / loops * 1e9,
+	       t_bvci / loops * 1e9, t_raid / loops * 1e9);
+	if (missing)
+		printf("ERROR: %d lookups failed\n", missing);
+}
+
+int main(int argc, char **argv)
+{
+	int loops = argc > 1 ? atoi(argv[1]) : 200000;
+	void *ctx = talloc_named_const(NULL, 0, "gprs_ns_bench");
+	struct gprs_ns_inst *nsi;
+	int i, s, num = 0;
+
+	osmo_init_logging(&info);
+	log_set_log_level(osmo_stderr_target, LOGL_FATAL);
+
+	nsi = gprs_ns_instantiate(NULL, ctx);
+
+	for (s = 0; s < ARRAY_SIZE(steps); s++) {
+		for (; num < steps[s]; num++) {
+			struct gprs_nsvc *nsvc;
+			struct bssgp_bvc_ctx *bctx;
+
+			nsvc = gprs_nsvc_create(nsi, 10000 + num);
+			nsvc->nsei = num;
+			nsvc->ip.bts_addr.sin_addr.s_addr = htonl(0x0a000000 + num);
+			nsvc->ip.bts_addr.sin_port = htons(23000);
+			gprs_nsvc_rehash(nsvc);
+
+			bctx = bvcs[num] = btsctx_alloc(2 + num, num);
+			set_raid(&bctx->ra_id, num);
+			bctx->cell_id = num;
+			btsctx_rehash(bctx);
+		}
+		/* the linear walk gets slow, keep the total runtime sane */
+		bench(nsi, num, loops / (num / steps[0]));
+	}
+
+	/* NS-VCs must leave the hashes when deleted */
+	for (i = 0; i < num; i++)
+		gprs_nsvc_delete(gprs_nsvc_by_nsvci(nsi, 10000 + i));
+	if (gprs_nsvc_by_nsei(nsi, 0) || gprs_nsvc_by_nsvci(nsi, 10000))
+		printf("ERROR: deleted NS-VC still found\n");
+
+	gprs_ns_destroy(nsi);
+	talloc_free(ctx);
+	return 0;
+}
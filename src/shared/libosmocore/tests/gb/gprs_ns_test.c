@@ -0,0 +1,189 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* Batched NS/UDP receive and transmit: a peer socket sends bursts of
+ * NS-ALIVE and full sized NS-UNITDATA PDUs, the NS instance must deliver
+ * every UNITDATA intact and answer every ALIVE.  The upper layer pulls
+ * each UNITDATA down to length 0, the receive slots must still be usable
+ * in full for the next burst. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <osmocom/core/application.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/gprs/gprs_ns.h>
+#include <osmocom/gprs/protocol/gsm_08_16.h>
+
+#define BURST		20
+/* largest datagram a receive slot takes */
+#define MAX_PDU		(NS_ALLOC_SIZE - NS_ALLOC_HEADROOM)
+
+static struct log_info info = {};
+
+static unsigned int rx_unitdata, rx_bad;
+
+int bssgp_prim_cb(struct osmo_prim_hdr *oph, void *ctx)
+{
+	return 0;
+}
+
+static int ns_cb(enum gprs_ns_evt event, struct gprs_nsvc *nsvc,
+		 struct msgb *msg, uint16_t bvci)
+{
+	uint8_t *data = msgb_bssgph(msg);
+	unsigned int len = msg->tail - data;
+	unsigned int i;
+
+	if (event != GPRS_NS_EVT_UNIT_DATA)
+		return 0;
+
+	if (bvci != 2 || len != MAX_PDU - 4)
+		rx_bad++;
+	for (i = 0; i < len; i++) {
+		if (data[i] != (uint8_t) i) {
+			rx_bad++;
+			break;
+		}
+	}
+	rx_unitdata++;
+
+	/* consume all of it, the slot is left at length 0 */
+	msgb_pull(msg, msgb_length(msg));
+
+	return 0;
+}
+
+static void send_burst(int fd)
+{
+	static uint8_t unitdata[MAX_PDU];
+	uint8_t alive = NS_PDUT_ALIVE;
+	int i;
+
+	unitdata[0] = NS_PDUT_UNITDATA;
+	unitdata[1] = 0;	/* spare */
+	unitdata[2] = 0;	/* BVCI */
+	unitdata[3] = 2;
+	for (i = 4; i < MAX_PDU; i++)
+		unitdata[i] = i - 4;
+
+	for (i = 0; i < BURST; i++) {
+		if (send(fd, &alive, 1, 0) != 1
+		 || send(fd, unitdata, sizeof(unitdata), 0) != sizeof(unitdata)) {
+			perror("send");
+			exit(1);
+		}
+	}
+}
+
+/* dispatch until the burst is handled, returns the ALIVE ACKs seen */
+static unsigned int run_burst(int fd, unsigned int expect)
+{
+	unsigned int acks = 0;
+	uint8_t buf[64];
+	int i, rc;
+
+	for (i = 0; i < 1000 && (rx_unitdata < expect || acks < BURST); i++) {
+		osmo_select_main(1);
+		while ((rc = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+			if (buf[0] == NS_PDUT_ALIVE_ACK)
+				acks++;
+		}
+		if (rx_unitdata < expect || acks < BURST)
+			usleep(1000);
+	}
+
+	return acks;
+}
+
+int main(int argc, char **argv)
+{
+	void *ctx = talloc_named_const(NULL, 0, "gprs_ns_test");
+	struct gprs_ns_inst *nsi;
+	struct gprs_nsvc *nsvc;
+	struct sockaddr_in ns_addr, peer_addr;
+	socklen_t alen;
+	unsigned int acks;
+	int fd, round;
+
+	osmo_init_logging(&info);
+	log_set_log_level(osmo_stderr_target, LOGL_FATAL);
+
+	nsi = gprs_ns_instantiate(ns_cb, ctx);
+	nsi->nsip.local_ip = INADDR_LOOPBACK;
+	nsi->nsip.local_port = 0;
+	if (gprs_ns_nsip_listen(nsi) < 0) {
+		printf("ERROR: cannot listen\n");
+		return 1;
+	}
+	alen = sizeof(ns_addr);
+	getsockname(nsi->nsip.fd.fd, (struct sockaddr *) &ns_addr, &alen);
+
+	/* the peer, with a NS-VC that is alive and unblocked */
+	fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	memset(&peer_addr, 0, sizeof(peer_addr));
+	peer_addr.sin_family = AF_INET;
+	peer_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(fd, (struct sockaddr *) &peer_addr, sizeof(peer_addr)) < 0
+	 || connect(fd, (struct sockaddr *) &ns_addr, sizeof(ns_addr)) < 0) {
+		perror("peer");
+		return 1;
+	}
+	alen = sizeof(peer_addr);
+	getsockname(fd, (struct sockaddr *) &peer_addr, &alen);
+
+	nsvc = gprs_nsvc_create(nsi, 1);
+	nsvc->nsei = 1;
+	nsvc->ip.bts_addr = peer_addr;
+	nsvc->state = NSE_S_ALIVE;
+	nsvc->remote_state = NSE_S_ALIVE;
+	gprs_nsvc_rehash(nsvc);
+
+	for (round = 1; round <= 3; round++) {
+		send_burst(fd);
+		acks = run_burst(fd, round * BURST);
+		printf("burst %d: unitdata %u, alive ack %u\n", round,
+		       rx_unitdata - (round - 1) * BURST, acks);
+	}
+
+	printf("rx_msgs %lu, tx_msgs %lu, tx queue %u\n",
+	       nsi->nsip.stats.rx_msgs, nsi->nsip.stats.tx_msgs,
+	       nsi->nsip.tx_queue_len);
+	if (rx_bad)
+		printf("ERROR: %u UNITDATA damaged\n", rx_bad);
+	if (nsi->nsip.stats.rx_calls >= nsi->nsip.stats.rx_msgs)
+		printf("ERROR: no batching, %lu calls for %lu PDUs\n",
+		       nsi->nsip.stats.rx_calls, nsi->nsip.stats.rx_msgs);
+	if (nsi->nsip.fd.when & BSC_FD_WRITE)
+		printf("ERROR: still waiting to write\n");
+
+	close(fd);
+	gprs_ns_destroy(nsi);
+	talloc_free(ctx);
+	return 0;
+}
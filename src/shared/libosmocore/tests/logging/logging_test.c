@@ -18,6 +18,8 @@
  *
  */
 
+#include <stdio.h>
+
 #include <osmocom/core/logging.h>
 #include <osmocom/core/utils.h>
 
@@ -53,6 +55,13 @@ const struct log_info log_info = {
 	.num_cat = ARRAY_SIZE(default_categories),
 };
 
+static int eval_count;
+
+static int count_eval(void)
+{
+	return ++eval_count;
+}
+
 int main(int argc, char **argv)
 {
 	struct log_target *stderr_target;
@@ -72,5 +81,35 @@ int main(int argc, char **argv)
 	DEBUGP(DCC, "You should see this\n");
 	DEBUGP(DMM, "You should not see this\n");
 
+	/* disabled messages must not evaluate their arguments */
+	printf("check DRLL debug: %d, DMM debug: %d\n",
+	       log_check_level(DRLL, LOGL_DEBUG),
+	       log_check_level(DMM, LOGL_DEBUG));
+	DEBUGP(DMM, "You should not see this %d\n", count_eval());
+	LOGP(DMM, LOGL_FATAL, "You should not see this %d\n", count_eval());
+	log_set_category_filter(stderr_target, DRLL, 1, LOGL_NOTICE);
+	DEBUGP(DRLL, "You should not see this %d\n", count_eval());
+	printf("check DRLL debug: %d, notice: %d\n",
+	       log_check_level(DRLL, LOGL_DEBUG),
+	       log_check_level(DRLL, LOGL_NOTICE));
+	printf("arguments evaluated: %d\n", eval_count);
+	log_set_category_filter(stderr_target, DRLL, 1, LOGL_DEBUG);
+
+	/* same through the writer thread */
+	if (log_target_set_async(stderr_target, 0x10000) == 0) {
+		struct log_async_stats st;
+
+		DEBUGP(DRLL, "You should see this\n");
+		DEBUGP(DCC, "You should see this\n");
+		DEBUGP(DMM, "You should not see this\n");
+
+		log_target_async_flush(stderr_target);
+		log_target_async_stats(stderr_target, &st);
+		printf("async: %lu written, %lu dropped, %u queued\n",
+		       st.written, st.dropped, st.queued);
+
+		log_target_set_async(stderr_target, 0);
+	}
+
 	return 0;
 }
@@ -0,0 +1,96 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* Stress msgb_alloc()/msgb_free() with and without the pool: a window
+ * of in-flight messages of mixed sizes (L1CTL, GSMTAP, NS-IP) where a
+ * random one is replaced by a new one in each step. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/talloc.h>
+
+#define WINDOW	256
+
+static const uint16_t sizes[] = { 256 + 32, 256, 184, 1600, 4096 };
+
+static double cpu_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double run(int loops)
+{
+	struct msgb *win[WINDOW];
+	double t0;
+	int i;
+
+	srand(1);
+	for (i = 0; i < WINDOW; i++)
+		win[i] = msgb_alloc(sizes[i % ARRAY_SIZE(sizes)], "bench");
+
+	t0 = cpu_time();
+	for (i = 0; i < loops; i++) {
+		int j = rand() % WINDOW;
+		uint16_t size = sizes[rand() % ARRAY_SIZE(sizes)];
+
+		msgb_free(win[j]);
+		win[j] = msgb_alloc(size, "bench");
+		msgb_put(win[j], 23)[0] = i;
+	}
+	t0 = cpu_time() - t0;
+
+	for (i = 0; i < WINDOW; i++)
+		msgb_free(win[i]);
+
+	return t0 / loops * 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	int loops = argc > 1 ? atoi(argv[1]) : 5000000;
+	void *ctx = talloc_named_const(NULL, 0, "msgb_bench");
+	double t_talloc, t_pool, t_nozero;
+
+	msgb_set_talloc_ctx(ctx);
+
+	t_talloc = run(loops);
+
+	msgb_pool_init(WINDOW, 0);
+	t_pool = run(loops);
+	msgb_pool_destroy();
+
+	msgb_pool_init(WINDOW, MSGB_POOL_F_NO_ZERO);
+	t_nozero = run(loops);
+	msgb_pool_destroy();
+
+	printf("alloc+free: talloc %.1f ns, pool %.1f ns, pool (no zero) %.1f ns\n",
+	       t_talloc, t_pool, t_nozero);
+
+	talloc_free(ctx);
+	return 0;
+}
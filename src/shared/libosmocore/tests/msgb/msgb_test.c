@@ -0,0 +1,126 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/talloc.h>
+
+static void *ctx;
+
+static void print_stats(void)
+{
+	struct msgb_pool_stats st[MSGB_POOL_NUM_CLASSES];
+	int i;
+
+	msgb_pool_get_stats(st);
+	for (i = 0; i < MSGB_POOL_NUM_CLASSES; i++)
+		printf("  class %4u: %lu allocs, %lu reused, %u cached\n",
+		       st[i].size, st[i].allocs, st[i].reused, st[i].cached);
+}
+
+static int all_zero(const uint8_t *p, int len)
+{
+	while (len--)
+		if (*p++)
+			return 0;
+	return 1;
+}
+
+static void test_pool(unsigned int flags)
+{
+	struct msgb *a, *b, *c, *big;
+	uint8_t *data;
+
+	printf("pool, flags 0x%x:\n", flags);
+	msgb_pool_init(2, flags);
+
+	a = msgb_alloc_headroom(256 + 32, 32, "a");
+	memset(msgb_put(a, 100), 0xaa, 100);
+	a->l2h = a->data;
+	data = a->_data;
+	msgb_free(a);
+
+	/* recycled: same memory, cleared header */
+	b = msgb_alloc(300, "b");
+	printf("  recycled: %d, header clear: %d, data clear: %d, names: %s\n",
+	       b->_data == data, !b->l2h && !b->len && b->data_len == 300,
+	       all_zero(b->_data, 300), talloc_get_name(b));
+
+	/* talloc_free() of a pooled msgb still recycles it */
+	c = msgb_alloc(100, "c");
+	talloc_free(b);
+	talloc_free(c);
+
+	/* too large for the pool */
+	big = msgb_alloc(8000, "big");
+	msgb_free(big);
+
+	/* only max_cached are kept per class */
+	a = msgb_alloc(10, "a"); b = msgb_alloc(10, "b"); c = msgb_alloc(10, "c");
+	msgb_free(a); msgb_free(b); msgb_free(c);
+
+	print_stats();
+	printf("  blocks in use: %zu\n", talloc_total_blocks(ctx));
+
+	msgb_pool_destroy();
+	printf("  blocks after destroy: %zu\n", talloc_total_blocks(ctx));
+}
+
+/* in-use msgbs survive the pool, and freeing their context frees them */
+static void test_destroy(void)
+{
+	void *sub = talloc_named_const(ctx, 0, "sub");
+	struct msgb *a, *b;
+
+	printf("destroy:\n");
+	msgb_pool_init(16, 0);
+	a = msgb_alloc(64, "a");
+	b = msgb_alloc(64, "b");
+	msgb_free(b);
+	msgb_pool_destroy();
+	msgb_free(a);
+	printf("  blocks: %zu\n", talloc_total_blocks(ctx));
+
+	/* freeing the msgb context with the pool enabled */
+	msgb_set_talloc_ctx(sub);
+	msgb_pool_init(16, 0);
+	a = msgb_alloc(64, "a");
+	b = msgb_alloc(600, "b");
+	msgb_free(b);
+	talloc_free(sub);
+	msgb_set_talloc_ctx(ctx);
+	msgb_pool_destroy();
+	printf("  blocks: %zu\n", talloc_total_blocks(ctx));
+}
+
+int main(int argc, char **argv)
+{
+	ctx = talloc_named_const(NULL, 0, "msgb_test");
+	msgb_set_talloc_ctx(ctx);
+
+	test_pool(0);
+	test_pool(MSGB_POOL_F_NO_ZERO);
+	test_destroy();
+
+	talloc_free(ctx);
+	return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <osmocom/core/select.h>
+#include <osmocom/core/utils.h>
+
+#include "../../config.h"
+
+#define NUM_PIPES	8
+
+struct test_pipe {
+	int wr;
+	struct osmo_fd ofd;
+	unsigned int nread;
+	unsigned int nwrite;
+};
+
+static struct test_pipe pipes[NUM_PIPES];
+
+/* the first callback to run unregisters its neighbour, which is ready too */
+static int unregister_neighbour;
+static struct test_pipe *victim;
+
+static int pipe_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct test_pipe *tp = ofd->data;
+	char buf[16];
+
+	if (what & BSC_FD_READ) {
+		if (read(ofd->fd, buf, sizeof(buf)) > 0)
+			tp->nread++;
+		if (unregister_neighbour) {
+			victim = &pipes[(tp - pipes + 1) % NUM_PIPES];
+			osmo_fd_unregister(&victim->ofd);
+			unregister_neighbour = 0;
+		}
+	}
+	if (what & BSC_FD_WRITE)
+		tp->nwrite++;
+
+	return 0;
+}
+
+static void pipes_open(void)
+{
+	int i, fds[2];
+
+	memset(pipes, 0, sizeof(pipes));
+	for (i = 0; i < NUM_PIPES; i++) {
+		if (pipe(fds) < 0) {
+			perror("pipe");
+			exit(EXIT_FAILURE);
+		}
+		pipes[i].wr = fds[1];
+		pipes[i].ofd.fd = fds[0];
+		pipes[i].ofd.when = BSC_FD_READ;
+		pipes[i].ofd.cb = pipe_cb;
+		pipes[i].ofd.data = &pipes[i];
+		osmo_fd_register(&pipes[i].ofd);
+	}
+}
+
+static void pipes_close(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_PIPES; i++) {
+		if (pipes[i].ofd.fd >= 0) {
+			osmo_fd_unregister(&pipes[i].ofd);
+			close(pipes[i].ofd.fd);
+		}
+		close(pipes[i].wr);
+	}
+}
+
+static void pipes_write_all(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_PIPES; i++) {
+		if (pipes[i].ofd.fd < 0)
+			continue;
+		if (write(pipes[i].wr, "x", 1) != 1) {
+			perror("write");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+static unsigned int pipes_nread(void)
+{
+	unsigned int i, n = 0;
+
+	for (i = 0; i < NUM_PIPES; i++)
+		n += pipes[i].nread;
+
+	return n;
+}
+
+static void test_select(enum osmo_select_backend backend, const char *name)
+{
+	struct test_pipe *a, *b;
+	struct osmo_fd wofd;
+	int rc;
+
+	printf("Testing %s back-end\n", name);
+
+	rc = osmo_select_set_backend(backend);
+	if (rc < 0) {
+		printf("back-end not available\n");
+		return;
+	}
+
+	pipes_open();
+
+	/* every readable fd is dispatched exactly once */
+	pipes_write_all();
+	osmo_select_main(1);
+	printf("read: %u\n", pipes_nread());
+
+	/* nothing pending, no callback */
+	rc = osmo_select_main(1);
+	printf("idle work: %d\n", rc);
+
+	/* unregistering a ready fd from within another callback */
+	unregister_neighbour = 1;
+	pipes_write_all();
+	osmo_select_main(1);
+	printf("read after unregister: %u (victim %u)\n", pipes_nread(),
+		victim->nread);
+	osmo_select_main(1);
+	printf("read after unregister: %u (victim %u)\n", pipes_nread(),
+		victim->nread);
+	close(victim->ofd.fd);
+	victim->ofd.fd = -1;
+	a = &pipes[(victim - pipes + 1) % NUM_PIPES];
+	b = &pipes[(victim - pipes + 2) % NUM_PIPES];
+
+	/* 'when' changes, through the helpers and osmo_fd_update_when() */
+	osmo_fd_read_disable(&a->ofd);
+	osmo_fd_update_when(&b->ofd, 0, 0);
+	pipes_write_all();
+	osmo_select_main(1);
+	printf("read with two disabled: %u\n", pipes_nread());
+	osmo_fd_read_enable(&a->ofd);
+	osmo_fd_update_when(&b->ofd, 0, BSC_FD_READ);
+	osmo_select_main(1);
+	printf("read after re-enable: %u\n", pipes_nread());
+
+	/* write notifications, on the writing end of a pipe */
+	memset(&wofd, 0, sizeof(wofd));
+	wofd.fd = a->wr;
+	wofd.cb = pipe_cb;
+	wofd.data = a;
+	osmo_fd_register(&wofd);
+	osmo_select_main(1);
+	printf("write before enable: %u\n", a->nwrite);
+	osmo_fd_write_enable(&wofd);
+	osmo_select_main(1);
+	printf("write after enable: %u\n", a->nwrite);
+	osmo_fd_write_disable(&wofd);
+	osmo_select_main(1);
+	printf("write after disable: %u\n", a->nwrite);
+	osmo_fd_unregister(&wofd);
+
+	pipes_close();
+}
+
+int main(int argc, char **argv)
+{
+	test_select(OSMO_SELECT_BACKEND_SELECT, "select");
+#ifdef HAVE_SYS_EPOLL_H
+	test_select(OSMO_SELECT_BACKEND_EPOLL, "epoll");
+#else
+	printf("Testing epoll back-end\n");
+	printf("back-end not available\n");
+#endif
+	osmo_select_set_backend(OSMO_SELECT_BACKEND_SELECT);
+
+	return EXIT_SUCCESS;
+}
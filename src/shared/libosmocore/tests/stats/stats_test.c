@@ -0,0 +1,167 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/socket.h>
+#include <osmocom/core/statistics.h>
+#include <osmocom/core/stats.h>
+#include <osmocom/core/utils.h>
+
+static const struct rate_ctr_desc ctr_desc[] = {
+	{ "rx", "received" },
+	{ "tx", "transmitted" },
+};
+
+static const struct rate_ctr_group_desc ctrg_desc = {
+	.group_name_prefix = "link",
+	.group_description = "link counters",
+	.num_ctr = ARRAY_SIZE(ctr_desc),
+	.ctr_desc = ctr_desc,
+};
+
+static int bin_fd, statsd_fd;
+
+/* a collector socket on an ephemeral local port */
+static int collector(uint16_t *port)
+{
+	struct sockaddr_in sin;
+	socklen_t len = sizeof(sin);
+	int fd;
+
+	fd = osmo_sock_init(AF_INET, SOCK_DGRAM, IPPROTO_UDP, "127.0.0.1", 0,
+			    OSMO_SOCK_F_BIND | OSMO_SOCK_F_NONBLOCK);
+	getsockname(fd, (struct sockaddr *) &sin, &len);
+	*port = ntohs(sin.sin_port);
+	return fd;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+	return p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static void dump_binary(void)
+{
+	uint8_t buf[2048], *p;
+	struct osmo_stats_bin_hdr *hdr = (struct osmo_stats_bin_hdr *) buf;
+	int len, i;
+
+	len = recv(bin_fd, buf, sizeof(buf), 0);
+	if (len < 0) {
+		printf(" binary: nothing\n");
+		return;
+	}
+
+	printf(" binary: version %u seq %u %s, %u records\n", hdr->version,
+	       ntohl(hdr->seq), hdr->flags & OSMO_STATS_BIN_F_FULL ?
+	       "full" : "changes", ntohs(hdr->num_records));
+	p = buf + sizeof(*hdr);
+	for (i = 0; i < ntohs(hdr->num_records); i++) {
+		switch (p[0]) {
+		case OSMO_STATS_BIN_NAME:
+			printf("  name  %u %.*s\n", get_u32(p + 1), p[5], p + 6);
+			p += 6 + p[5];
+			break;
+		case OSMO_STATS_BIN_VALUE:
+			printf("  value %u %u\n", get_u32(p + 1),
+			       get_u32(p + 9));
+			p += 13;
+			break;
+		default:
+			printf("  unknown record %u\n", p[0]);
+			return;
+		}
+	}
+	if (p != buf + len)
+		printf("  %d bytes left over\n", (int) (buf + len - p));
+}
+
+static void dump_statsd(void)
+{
+	char buf[2048];
+	int len;
+
+	len = recv(statsd_fd, buf, sizeof(buf) - 1, 0);
+	if (len < 0) {
+		printf(" statsd: nothing\n");
+		return;
+	}
+	buf[len] = '\0';
+	printf(" statsd:\n%s", buf);
+}
+
+static void report(const char *what)
+{
+	printf("%s: %d reporters\n", what, osmo_stats_report());
+	dump_binary();
+	dump_statsd();
+}
+
+int main(int argc, char **argv)
+{
+	struct osmo_stats_reporter *bin, *statsd;
+	struct rate_ctr_group *link0, *link1;
+	struct osmo_counter *calls;
+	uint16_t bin_port, statsd_port;
+
+	bin_fd = collector(&bin_port);
+	statsd_fd = collector(&statsd_port);
+
+	link0 = rate_ctr_group_alloc(NULL, &ctrg_desc, 0);
+	calls = osmo_counter_alloc("calls");
+
+	bin = osmo_stats_reporter_create(NULL, OSMO_STATS_REPORTER_BINARY,
+					 "127.0.0.1", bin_port, NULL);
+	statsd = osmo_stats_reporter_create(NULL, OSMO_STATS_REPORTER_STATSD,
+					    "127.0.0.1", statsd_port, "ms");
+
+	rate_ctr_add(&link0->ctr[0], 5);
+	osmo_counter_inc(calls);
+	report("first report");
+
+	/* only the changes, plus the names of a new group */
+	link1 = rate_ctr_group_alloc(NULL, &ctrg_desc, 1);
+	rate_ctr_add(&link0->ctr[1], 2);
+	rate_ctr_inc(&link1->ctr[0]);
+	report("second report");
+
+	report("no changes");
+
+	osmo_counter_inc(calls);
+	report("counter");
+
+	osmo_stats_reporter_free(bin);
+	osmo_stats_reporter_free(statsd);
+	rate_ctr_group_free(link0);
+	rate_ctr_group_free(link1);
+	osmo_counter_free(calls);
+	close(bin_fd);
+	close(statsd_fd);
+
+	return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+/* Members of a talloc pool must give their memory back: the same size
+ * is served again from the free list, the last chunk and an emptied
+ * pool rewind, only the pool itself goes back to malloc. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <osmocom/core/talloc.h>
+
+static void print_pool(const char *what, void *pool)
+{
+	printf("%s: %lu of %lu bytes used, %lu objects\n", what,
+	       (unsigned long) talloc_pool_used(pool),
+	       (unsigned long) talloc_pool_size(pool),
+	       (unsigned long) talloc_pool_objects(pool));
+}
+
+static int in_pool(void *pool, void *ptr)
+{
+	return (char *) ptr > (char *) pool &&
+	       (char *) ptr < (char *) pool + talloc_pool_size(pool);
+}
+
+static void test_reuse(void)
+{
+	void *pool = talloc_pool(NULL, 1024);
+	void *a, *b, *c, *d, *e;
+
+	a = talloc_size(pool, 100);
+	b = talloc_size(pool, 100);
+	c = talloc_size(pool, 40);
+	print_pool("three members", pool);
+
+	/* freed in the middle, comes back for the same size */
+	talloc_free(a);
+	print_pool("first freed", pool);
+	d = talloc_size(pool, 100);
+	printf("same size reused: %d\n", d == a);
+	print_pool("reallocated", pool);
+
+	/* the last chunk rewinds the pool */
+	talloc_free(c);
+	e = talloc_size(pool, 60);
+	printf("tail rewound: %d\n", e == c);
+
+	/* a different size does not fit a free chunk */
+	talloc_free(b);
+	c = talloc_size(pool, 200);
+	printf("other size from the tail: %d\n", c != b && in_pool(pool, c));
+
+	talloc_free(c);
+	talloc_free(d);
+	talloc_free(e);
+	print_pool("all freed", pool);
+
+	/* an empty pool starts again from its beginning */
+	d = talloc_size(pool, 100);
+	printf("empty pool reset: %d\n", d == a);
+
+	talloc_free(pool);
+}
+
+static void test_exhaust(void)
+{
+	void *pool = talloc_pool(NULL, 256);
+	void *ptr[8];
+	int i, inside = 0;
+
+	/* allocations beyond the pool fall back to malloc */
+	for (i = 0; i < 8; i++) {
+		ptr[i] = talloc_size(pool, 64);
+		inside += in_pool(pool, ptr[i]);
+	}
+	printf("exhausted: %d of 8 in the pool\n", inside);
+	print_pool("exhausted", pool);
+
+	for (i = 0; i < 8; i++)
+		talloc_free(ptr[i]);
+	print_pool("exhausted freed", pool);
+
+	talloc_free(pool);
+}
+
+static void test_realloc(void)
+{
+	void *pool = talloc_pool(NULL, 1024);
+	char *a, *b;
+
+	a = talloc_strdup(pool, "pool");
+	b = talloc_size(pool, 16);
+	a = talloc_realloc_size(pool, a, 100);
+	printf("realloc kept contents: %d, in pool %d\n",
+	       strcmp(a, "pool") == 0, in_pool(pool, a));
+	print_pool("reallocated", pool);
+
+	talloc_free(a);
+	talloc_free(b);
+	print_pool("realloc freed", pool);
+
+	talloc_free(pool);
+}
+
+static void test_nested(void)
+{
+	void *pool = talloc_pool(NULL, 1024);
+	void *inner = talloc_pool(pool, 128);
+
+	/* a pool is never carved out of another pool */
+	printf("nested pool outside: %d\n", !in_pool(pool, inner));
+	print_pool("outer", pool);
+
+	talloc_free(pool);
+}
+
+int main(int argc, char **argv)
+{
+	test_reuse();
+	test_exhaust();
+	test_realloc();
+	test_nested();
+
+	return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* Compare the rb-tree and timing wheel timer modes: schedule, re-arm
+ * and delete N timers with protocol-like timeouts (1..600s), then let
+ * N short timers expire through the usual prepare/update cycle. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <osmocom/core/timer.h>
+
+static unsigned int fired;
+
+static void timer_cb(void *data)
+{
+	fired++;
+}
+
+static double cpu_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(enum osmo_timer_mode mode, const char *name,
+		  unsigned int num)
+{
+	struct osmo_timer_list *timers;
+	double t0, t_sched, t_rearm, t_del, t_fire;
+	unsigned int i, loops = 0;
+
+	if (osmo_timers_set_mode(mode) < 0) {
+		fprintf(stderr, "cannot set timer mode\n");
+		exit(EXIT_FAILURE);
+	}
+
+	timers = calloc(num, sizeof(*timers));
+	if (!timers) {
+		fprintf(stderr, "OOM\n");
+		exit(EXIT_FAILURE);
+	}
+	for (i = 0; i < num; i++)
+		timers[i].cb = timer_cb;
+
+	srandom(42);
+
+	t0 = cpu_time();
+	for (i = 0; i < num; i++)
+		osmo_timer_schedule(&timers[i], 1 + random() % 600,
+				    random() % 1000000);
+	t_sched = cpu_time() - t0;
+
+	t0 = cpu_time();
+	for (i = 0; i < num; i++)
+		osmo_timer_schedule(&timers[i], 1 + random() % 600,
+				    random() % 1000000);
+	t_rearm = cpu_time() - t0;
+
+	t0 = cpu_time();
+	for (i = 0; i < num; i++)
+		osmo_timer_del(&timers[i]);
+	t_del = cpu_time() - t0;
+
+	/* all timers expire within 200ms, measure once they're all due */
+	fired = 0;
+	for (i = 0; i < num; i++)
+		osmo_timer_schedule(&timers[i], 0, random() % 200000);
+	usleep(250000);
+	t0 = cpu_time();
+	while (fired < num) {
+		osmo_timers_check();
+		osmo_timers_prepare();
+		osmo_timers_update();
+		loops++;
+	}
+	t_fire = cpu_time() - t0;
+
+	printf("%-7s %8u timers: schedule %7.1f ns, re-arm %7.1f ns, "
+		"delete %7.1f ns, expire %7.1f ns (%u loops)\n", name, num,
+		t_sched * 1e9 / num, t_rearm * 1e9 / num, t_del * 1e9 / num,
+		t_fire * 1e9 / num, loops);
+
+	free(timers);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int sizes[] = { 10000, 100000, 1000000 };
+	unsigned int i;
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		bench(OSMO_TIMER_MODE_RBTREE, "rb-tree", sizes[i]);
+		bench(OSMO_TIMER_MODE_WHEEL, "wheel", sizes[i]);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -155,7 +155,7 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
-	while ((c = getopt_long(argc, argv, "s:", NULL, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "s:w", NULL, NULL)) != -1) {
 	switch(c) {
 		case 's':
 			timer_nsteps = atoi(optarg);
@@ -165,6 +165,9 @@ int main(int argc, char *argv[])
 				exit(EXIT_FAILURE);
 			}
 			break;
+		case 'w':
+			osmo_timers_set_mode(OSMO_TIMER_MODE_WHEEL);
+			break;
 		default:
 			exit(EXIT_FAILURE);
 		}
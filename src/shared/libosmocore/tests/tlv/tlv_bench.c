@@ -0,0 +1,103 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* Cost of tlv_parse() against tlv_parse_sparse() for a small BSSGP
+ * UL-UNITDATA and a larger RSL message. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <osmocom/gsm/tlv.h>
+#include <osmocom/gsm/rsl.h>
+#include <osmocom/gsm/protocol/gsm_08_58.h>
+
+/* IEs of an UL-UNITDATA after the fixed header: PFI, cell id, LLC PDU;
+ * parsed with a TvLV definition like in gprs_bssgp.c */
+static const uint8_t bssgp_ul_ud[] = {
+	0x18, 0x80 | 3, 0x00, 0x00, 0x21,
+	0x08, 0x80 | 8, 0x62, 0xf2, 0x24, 0x00, 0x01, 0x00, 0x02, 0x00,
+	0x0e, 0x80 | 16, 0x01, 0xc0, 0x01, 0x08, 0x0f, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+static const uint8_t rsl_meas_res[] = {
+	RSL_IE_CHAN_NR, 0x0a,
+	RSL_IE_MEAS_RES_NR, 0x12,
+	RSL_IE_UPLINK_MEAS, 3, 0x25, 0x26, 0x00,
+	RSL_IE_BS_POWER, 0x00,
+	RSL_IE_L1_INFO, 0x00, 0x01,
+	RSL_IE_L3_INFO, 0x00, 18, 0x06, 0x15, 0x3f, 0x3f, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	RSL_IE_MS_TIMING_OFFSET, 0x00,
+};
+
+static struct tlv_definition bssgp_def;
+static volatile unsigned long sink;
+
+static double cpu_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(const char *name, const struct tlv_definition *def,
+		  const uint8_t *buf, int len, int loops)
+{
+	struct tlv_parsed tp;
+	struct tlv_parsed_sparse tps;
+	double t0, t_full, t_sparse;
+	int i;
+
+	t0 = cpu_time();
+	for (i = 0; i < loops; i++) {
+		tlv_parse(&tp, def, buf, len, 0, 0);
+		sink += TLVP_LEN(&tp, buf[0]);
+	}
+	t_full = cpu_time() - t0;
+
+	t0 = cpu_time();
+	for (i = 0; i < loops; i++) {
+		tlv_parse_sparse(&tps, def, buf, len, 0, 0);
+		sink += TLVS_LEN(&tps, buf[0]);
+	}
+	t_sparse = cpu_time() - t0;
+
+	printf("%-8s %3d bytes: tlv_parse %6.1f ns, tlv_parse_sparse %6.1f ns (%.1fx)\n",
+	       name, len, t_full / loops * 1e9, t_sparse / loops * 1e9,
+	       t_full / t_sparse);
+}
+
+int main(int argc, char **argv)
+{
+	int loops = argc > 1 ? atoi(argv[1]) : 2000000;
+	int i;
+
+	for (i = 0; i < 256; i++)
+		bssgp_def.def[i].type = TLV_TYPE_TvLV;
+
+	bench("bssgp", &bssgp_def, bssgp_ul_ud, sizeof(bssgp_ul_ud), loops);
+	bench("rsl", &rsl_att_tlvdef, rsl_meas_res, sizeof(rsl_meas_res), loops);
+
+	return 0;
+}
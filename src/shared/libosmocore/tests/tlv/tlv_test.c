@@ -0,0 +1,121 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/tlv.h>
+#include <osmocom/gsm/rsl.h>
+#include <osmocom/gsm/gsm48.h>
+#include <osmocom/gsm/protocol/gsm_04_08.h>
+#include <osmocom/gsm/protocol/gsm_08_58.h>
+
+/* RSL DATA REQUEST, with the link identifier repeated at the end */
+static const uint8_t rsl_data_req[] = {
+	RSL_IE_CHAN_NR, 0x41,
+	RSL_IE_LINK_IDENT, 0x00,
+	RSL_IE_L3_INFO, 0x00, 0x03, 0x06, 0x35, 0x01,
+	RSL_IE_LINK_IDENT, 0x40,
+};
+
+/* compare the sparse result and its conversion against tlv_parse(),
+ * returns the number of mismatches */
+static int compare(const struct tlv_definition *def, const uint8_t *buf, int len,
+		   uint8_t lv_tag, uint8_t lv_tag2, int *rc)
+{
+	static struct tlv_parsed tp, conv;
+	static struct tlv_parsed_sparse tps;
+	int rc_s, tag;
+
+	*rc = tlv_parse(&tp, def, buf, len, lv_tag, lv_tag2);
+	rc_s = tlv_parse_sparse(&tps, def, buf, len, lv_tag, lv_tag2);
+	if (*rc != rc_s) {
+		printf("rc mismatch: %d != %d\n", *rc, rc_s);
+		return 1;
+	}
+
+	for (tag = 0; tag <= 0xff; tag++) {
+		if (TLVP_PRESENT(&tp, tag) != TLVS_PRESENT(&tps, tag) ||
+		    TLVP_VAL(&tp, tag) != TLVS_VAL(&tps, tag) ||
+		    (TLVP_PRESENT(&tp, tag) && TLVP_LEN(&tp, tag) != TLVS_LEN(&tps, tag))) {
+			printf("tag 0x%02x mismatch\n", tag);
+			return 1;
+		}
+	}
+
+	tlv_sparse_to_parsed(&conv, &tps);
+	for (tag = 0; tag <= 0xff; tag++) {
+		if (TLVP_VAL(&tp, tag) != TLVP_VAL(&conv, tag) ||
+		    (TLVP_PRESENT(&tp, tag) && TLVP_LEN(&tp, tag) != TLVP_LEN(&conv, tag))) {
+			printf("converted tag 0x%02x mismatch\n", tag);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void test_rsl(void)
+{
+	struct tlv_parsed_sparse tps;
+	int rc, bad;
+
+	bad = compare(&rsl_att_tlvdef, rsl_data_req, sizeof(rsl_data_req), 0, 0, &rc);
+	printf("rsl: rc=%d, %d mismatches\n", rc, bad);
+
+	tlv_parse_sparse(&tps, &rsl_att_tlvdef, rsl_data_req, sizeof(rsl_data_req), 0, 0);
+	printf("rsl: %u IEs, chan_nr=0x%02x link_id=0x%02x l3=%s\n", tps.num,
+	       *TLVS_VAL(&tps, RSL_IE_CHAN_NR), *TLVS_VAL(&tps, RSL_IE_LINK_IDENT),
+	       osmo_hexdump_nospc(TLVS_VAL(&tps, RSL_IE_L3_INFO),
+				  TLVS_LEN(&tps, RSL_IE_L3_INFO)));
+	printf("rsl: ms power %spresent\n", TLVS_PRESENT(&tps, RSL_IE_MS_POWER) ? "" : "not ");
+
+	/* truncated L3 info */
+	bad = compare(&rsl_att_tlvdef, rsl_data_req, 8, 0, 0, &rc);
+	printf("rsl truncated: rc=%d, %d mismatches\n", rc, bad);
+}
+
+/* random buffers, including leading LV IEs */
+static void test_random(void)
+{
+	uint8_t buf[64];
+	int i, j, rc, bad = 0;
+
+	srand(1);
+	for (i = 0; i < 20000; i++) {
+		int len = rand() % sizeof(buf);
+		const struct tlv_definition *def =
+			(i & 1) ? &rsl_att_tlvdef : &gsm48_att_tlvdef;
+
+		for (j = 0; j < len; j++)
+			buf[j] = rand();
+		bad += compare(def, buf, len, (i % 3) ? 0 : 0xf0, (i % 5) ? 0 : 0xf1, &rc);
+	}
+	printf("random: %d mismatches\n", bad);
+}
+
+int main(int argc, char **argv)
+{
+	test_rsl();
+	test_random();
+	return 0;
+}
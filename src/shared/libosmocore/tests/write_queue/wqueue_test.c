@@ -0,0 +1,205 @@
+/*
+ * (C) 2026 by the osmocom-bb contributors
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/write_queue.h>
+
+static struct msgb *make_msg(unsigned int seq, unsigned int len)
+{
+	struct msgb *msg = msgb_alloc(len + 16, "wqueue_test");
+	unsigned int i;
+
+	for (i = 0; i < len; i++)
+		msgb_put_u8(msg, (seq + i) & 0xff);
+
+	return msg;
+}
+
+static void open_pair(int type, int fds[2])
+{
+	int sndbuf = 4096;
+
+	if (socketpair(AF_UNIX, type, 0, fds) < 0) {
+		perror("socketpair");
+		exit(1);
+	}
+	fcntl(fds[0], F_SETFL, O_NONBLOCK);
+	fcntl(fds[1], F_SETFL, O_NONBLOCK);
+	/* a small buffer forces partial writes */
+	setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+}
+
+/* writev mode on a stream: the peer must see every byte in order even
+ * though the socket keeps accepting only parts of the queue */
+static void test_stream(void)
+{
+	struct osmo_wqueue wq;
+	uint8_t expect[64 * 1024], buf[4096];
+	unsigned int exp_len = 0, got = 0, refused = 0, mismatch = 0;
+	unsigned int i, j;
+	int fds[2], rc;
+
+	open_pair(SOCK_STREAM, fds);
+	osmo_wqueue_init(&wq, 150);
+	wq.bfd.fd = fds[0];
+	wq.flags = OSMO_WQUEUE_F_WRITEV;
+
+	for (i = 0; i < 200; i++) {
+		unsigned int len = 1 + (i * 37) % 400;
+		struct msgb *msg = make_msg(i, len);
+
+		if (osmo_wqueue_enqueue(&wq, msg) != 0) {
+			msgb_free(msg);
+			refused++;
+			continue;
+		}
+		for (j = 0; j < len; j++)
+			expect[exp_len++] = (i + j) & 0xff;
+	}
+
+	while (!llist_empty(&wq.msg_queue)) {
+		osmo_wqueue_bfd_cb(&wq.bfd, BSC_FD_WRITE);
+		while ((rc = read(fds[1], buf, sizeof(buf))) > 0) {
+			for (j = 0; j < rc; j++)
+				mismatch += buf[j] != expect[got + j];
+			got += rc;
+		}
+	}
+
+	printf("stream: refused %u, %u/%u bytes, %u mismatches, "
+	       "write enabled %u\n", refused, got, exp_len, mismatch,
+	       !!(wq.bfd.when & BSC_FD_WRITE));
+	printf("stream: enqueued %lu dropped %lu written %lu high water %u\n",
+	       wq.stats.enqueued, wq.stats.dropped, wq.stats.written,
+	       wq.stats.high_water);
+
+	close(fds[0]);
+	close(fds[1]);
+}
+
+static int error_cb_err;
+
+static int error_cb(struct osmo_fd *fd, int err)
+{
+	error_cb_err = err;
+	return 0;
+}
+
+/* writev mode on a stream whose peer goes away in the middle of a msgb:
+ * nothing may be dropped, the queue stalls until it is cleared */
+static void test_stream_error(void)
+{
+	struct osmo_wqueue wq;
+	unsigned int i, len, offset;
+	struct msgb *msg;
+	int fds[2], rc;
+
+	open_pair(SOCK_STREAM, fds);
+	osmo_wqueue_init(&wq, 0);
+	wq.bfd.fd = fds[0];
+	wq.flags = OSMO_WQUEUE_F_WRITEV;
+	wq.error_cb = error_cb;
+
+	for (i = 0; i < 100; i++)
+		osmo_wqueue_enqueue(&wq, make_msg(i, 300));
+	osmo_wqueue_bfd_cb(&wq.bfd, BSC_FD_WRITE);
+	len = wq.current_length;
+	offset = wq.head_offset;
+
+	close(fds[1]);
+	osmo_wqueue_bfd_cb(&wq.bfd, BSC_FD_WRITE);
+	printf("stream error: %s, %u errors, head kept %u, partial %u, "
+	       "write enabled %u\n", strerror(error_cb_err),
+	       (unsigned int) wq.stats.write_errors,
+	       wq.current_length == len && wq.head_offset == offset,
+	       offset > 0, !!(wq.bfd.when & BSC_FD_WRITE));
+
+	msg = make_msg(0, 10);
+	rc = osmo_wqueue_enqueue(&wq, msg);
+	printf("stream error: enqueue when stalled %s\n", strerror(-rc));
+	osmo_wqueue_clear(&wq);
+	rc = osmo_wqueue_enqueue(&wq, msg);
+	printf("stream error: enqueue after clear %d\n", rc);
+
+	osmo_wqueue_clear(&wq);
+	close(fds[0]);
+}
+
+/* sendmmsg mode with the oldest datagrams dropped on overflow */
+static void test_datagram(void)
+{
+	struct osmo_wqueue wq;
+	uint8_t buf[512];
+	unsigned int first = 0, count = 0, ordered = 1;
+	int fds[2], rc;
+	unsigned int i;
+
+	open_pair(SOCK_DGRAM, fds);
+	osmo_wqueue_init(&wq, 16);
+	wq.bfd.fd = fds[0];
+	wq.flags = OSMO_WQUEUE_F_SENDMMSG;
+	wq.drop_policy = OSMO_WQUEUE_DROP_OLDEST;
+
+	for (i = 0; i < 40; i++) {
+		if (osmo_wqueue_enqueue(&wq, make_msg(i, 100)) != 0)
+			printf("datagram: %u refused\n", i);
+	}
+
+	while (!llist_empty(&wq.msg_queue)) {
+		osmo_wqueue_bfd_cb(&wq.bfd, BSC_FD_WRITE);
+		while ((rc = read(fds[1], buf, sizeof(buf))) > 0) {
+			if (count == 0)
+				first = buf[0];
+			else if (buf[0] != first + count)
+				ordered = 0;
+			count++;
+		}
+	}
+
+	printf("datagram: %u received, first %u, ordered %u\n",
+	       count, first, ordered);
+	printf("datagram: enqueued %lu dropped %lu written %lu high water %u\n",
+	       wq.stats.enqueued, wq.stats.dropped, wq.stats.written,
+	       wq.stats.high_water);
+
+	close(fds[0]);
+	close(fds[1]);
+}
+
+int main(int argc, char **argv)
+{
+	/* writes to the closed peer must fail with EPIPE */
+	signal(SIGPIPE, SIG_IGN);
+
+	test_stream();
+	test_stream_error();
+	test_datagram();
+	return 0;
+}